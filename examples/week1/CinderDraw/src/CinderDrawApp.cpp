@@ -10,6 +10,8 @@
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
 
+#include "PrimitiveCache.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -22,8 +24,11 @@ public:
 	void update();
 	void draw();
 	
-	bool	mPaused;
-	size_t	mIndex, mMinIndex, mMaxIndex;
+	bool			mPaused;
+	size_t			mIndex, mMinIndex, mMaxIndex;
+	
+	bool			mCaching;
+	PrimitiveCache	mCache;
 };
 
 void CinderDrawApp::setup()
@@ -40,6 +45,7 @@ void CinderDrawApp::setup()
 	mMaxIndex = 20;
 	mIndex    = mMinIndex;
 	mPaused   = false;
+	mCaching  = true;
 }
 
 void CinderDrawApp::mouseDown(MouseEvent event)
@@ -53,6 +59,18 @@ void CinderDrawApp::keyUp(KeyEvent event)
 			mPaused = !mPaused;
 			break;
 		}
+		case 'c': {
+			// Toggle between cached meshes and Cinder's immediate-mode functions:
+			mCaching = !mCaching;
+			break;
+		}
+		case 's': {
+			// Print cache stats:
+			const PrimitiveCache::Stats& tStats = mCache.getStats();
+			cout << "Caching " << ( ( mCaching ) ? ( "on" ) : ( "off" ) ) << ": " << tStats.mHits << " hits, " << tStats.mMisses << " misses, "
+				<< tStats.mEvictions << " evictions, " << tStats.mEntries << " meshes, " << tStats.mBytes << " bytes" << endl;
+			break;
+		}
 		default: { break; }
 	}
 }
@@ -123,27 +141,33 @@ void CinderDrawApp::draw()
 			break;
 		}
 		case 6: {
-			gl::drawStrokedRoundedRect( Rectf( tWinSize * 0.25, tWinSize * 0.75 ), 25.0 );
+			if( mCaching ) { mCache.drawRoundedRect( Rectf( tWinSize * 0.25, tWinSize * 0.75 ), 25.0, false ); }
+			else { gl::drawStrokedRoundedRect( Rectf( tWinSize * 0.25, tWinSize * 0.75 ), 25.0 ); }
 			break;
 		}
 		case 7: {
-			gl::drawSolidRoundedRect( Rectf( tWinSize * 0.25, tWinSize * 0.75 ), 25.0 );
+			if( mCaching ) { mCache.drawRoundedRect( Rectf( tWinSize * 0.25, tWinSize * 0.75 ), 25.0, true ); }
+			else { gl::drawSolidRoundedRect( Rectf( tWinSize * 0.25, tWinSize * 0.75 ), 25.0 ); }
 			break;
 		}
 		case 8: {
-			gl::drawStrokedCircle( tWinSize * 0.5, tWinSize.x * 0.25 );
+			if( mCaching ) { mCache.drawCircle( tWinSize * 0.5, tWinSize.x * 0.25, false ); }
+			else { gl::drawStrokedCircle( tWinSize * 0.5, tWinSize.x * 0.25 ); }
 			break;
 		}
 		case 9: {
-			gl::drawSolidCircle( tWinSize * 0.5, tWinSize.x * 0.25 );
+			if( mCaching ) { mCache.drawCircle( tWinSize * 0.5, tWinSize.x * 0.25, true ); }
+			else { gl::drawSolidCircle( tWinSize * 0.5, tWinSize.x * 0.25 ); }
 			break;
 		}
 		case 10: {
-			gl::drawStrokedEllipse( tWinSize * 0.5, tWinSize.x * 0.25, tWinSize.y * 0.25 );
+			if( mCaching ) { mCache.drawEllipse( tWinSize * 0.5, tWinSize.x * 0.25, tWinSize.y * 0.25, false ); }
+			else { gl::drawStrokedEllipse( tWinSize * 0.5, tWinSize.x * 0.25, tWinSize.y * 0.25 ); }
 			break;
 		}
 		case 11: {
-			gl::drawSolidEllipse( tWinSize * 0.5, tWinSize.x * 0.25, tWinSize.y * 0.25 );
+			if( mCaching ) { mCache.drawEllipse( tWinSize * 0.5, tWinSize.x * 0.25, tWinSize.y * 0.25, true ); }
+			else { gl::drawSolidEllipse( tWinSize * 0.5, tWinSize.x * 0.25, tWinSize.y * 0.25 ); }
 			break;
 		}
 		case 12: {
@@ -160,19 +184,22 @@ void CinderDrawApp::draw()
 		}
 		case 15: {
 			gl::enableWireframe();
-			gl::drawSphere( Vec3f::zero(), 10.0, 30 );
+			if( mCaching ) { mCache.drawSphere( Vec3f::zero(), 10.0, 30 ); }
+			else { gl::drawSphere( Vec3f::zero(), 10.0, 30 ); }
 			gl::disableWireframe();
 			break;
 		}
 		case 16: {
-			gl::drawSphere( Vec3f::zero(), 10.0, 30 );
+			if( mCaching ) { mCache.drawSphere( Vec3f::zero(), 10.0, 30 ); }
+			else { gl::drawSphere( Vec3f::zero(), 10.0, 30 ); }
 			break;
 		}
 		case 17: {
 			gl::enableWireframe();
 			gl::pushMatrices();
 			gl::translate( 0.0, -5.0, 0.0 );
-			gl::drawCylinder( 5.0, 5.0, 10.0, 30, 30 );
+			if( mCaching ) { mCache.drawCylinder( 5.0, 5.0, 10.0, 30, 30 ); }
+			else { gl::drawCylinder( 5.0, 5.0, 10.0, 30, 30 ); }
 			gl::popMatrices();
 			gl::disableWireframe();
 			break;
@@ -180,18 +207,21 @@ void CinderDrawApp::draw()
 		case 18: {
 			gl::pushMatrices();
 			gl::translate( 0.0, -5.0, 0.0 );
-			gl::drawCylinder( 5.0, 5.0, 10.0, 30, 30 );
+			if( mCaching ) { mCache.drawCylinder( 5.0, 5.0, 10.0, 30, 30 ); }
+			else { gl::drawCylinder( 5.0, 5.0, 10.0, 30, 30 ); }
 			gl::popMatrices();
 			break;
 		}
 		case 19: {
 			gl::enableWireframe();
-			gl::drawTorus( 10.0, 2.0, 30, 30 );
+			if( mCaching ) { mCache.drawTorus( 10.0, 2.0, 30, 30 ); }
+			else { gl::drawTorus( 10.0, 2.0, 30, 30 ); }
 			gl::disableWireframe();
 			break;
 		}
 		case 20: {
-			gl::drawTorus( 10.0, 2.0, 30, 30 );
+			if( mCaching ) { mCache.drawTorus( 10.0, 2.0, 30, 30 ); }
+			else { gl::drawTorus( 10.0, 2.0, 30, 30 ); }
 			break;
 		}
 		default: { break; }
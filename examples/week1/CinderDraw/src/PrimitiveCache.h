@@ -0,0 +1,368 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <map>
+#include <vector>
+
+#include "cinder/CinderMath.h"
+#include "cinder/Rect.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Vbo.h"
+
+// Cinder's gl::drawSphere(), gl::drawCylinder(), gl::drawTorus() etc compute every
+// vertex with sin() and cos() and send it to the GPU each time they're called,
+// even though the shape is the same from one frame to the next.
+//
+// A "primitive cache" builds each shape once, stores it in a VBO on the GPU and
+// draws it from there afterwards. Shapes are built at unit size where possible
+// (a sphere of radius 1, a circle of radius 1, ...) and scaled into place with
+// the modelview matrix, so a sphere with 30 segments is the same mesh regardless
+// of its radius. Each mesh is looked up by its "key": the shape type and the
+// parameters that change its geometry (tessellation, and ratios like a torus's
+// inner / outer radius).
+//
+// GPU memory isn't free, so the cache has a byte budget. When adding a mesh would
+// go over it, the "least recently used" (LRU) meshes are deleted first.
+//
+// (The meshes are scaled, so if lighting is enabled, enable GL_NORMALIZE too.)
+
+/** @brief builds Cinder's trig-heavy primitives once into VBOs and draws them from there */
+class PrimitiveCache {
+public:
+	/** @brief shape types */
+	enum Shape { SOLID_CIRCLE, STROKED_CIRCLE, SOLID_ROUNDED_RECT, STROKED_ROUNDED_RECT, SPHERE, CYLINDER, TORUS };
+
+	/** @brief cache counters */
+	struct Stats
+	{
+		size_t	mHits;
+		size_t	mMisses;
+		size_t	mEvictions;
+		size_t	mEntries;
+		size_t	mBytes;
+
+		/** @brief default constructor */
+		Stats() : mHits( 0 ), mMisses( 0 ), mEvictions( 0 ), mEntries( 0 ), mBytes( 0 ) {}
+	};
+
+	/** @brief constructor (byte budget for all cached meshes) */
+	PrimitiveCache(const size_t& iBudget = 4 * 1024 * 1024) : mBudget( iBudget ) {}
+
+	/** @brief sets the byte budget (evicting meshes if needed) */
+	void setBudget(const size_t& iBudget)
+	{
+		mBudget = iBudget;
+		evict( 0 );
+	}
+
+	/** @brief deletes all cached meshes */
+	void clear()
+	{
+		mEntries.clear();
+		mLru.clear();
+		mStats.mEntries = 0;
+		mStats.mBytes   = 0;
+	}
+
+	/** @brief resets the hit / miss / eviction counters */
+	void resetStats()
+	{
+		mStats.mHits      = 0;
+		mStats.mMisses    = 0;
+		mStats.mEvictions = 0;
+	}
+
+	/** @brief returns the counters */
+	const Stats& getStats() const { return mStats; }
+
+	/** @brief draws a circle (like gl::drawSolidCircle() / gl::drawStrokedCircle()) */
+	void drawCircle(const ci::Vec2f& iCenter, const float& iRadius, const bool& iSolid = true, const int& iSegments = 0)
+	{
+		drawEllipse( iCenter, iRadius, iRadius, iSolid, iSegments );
+	}
+
+	/** @brief draws an ellipse (like gl::drawSolidEllipse() / gl::drawStrokedEllipse()) */
+	void drawEllipse(const ci::Vec2f& iCenter, const float& iRadiusX, const float& iRadiusY, const bool& iSolid = true, const int& iSegments = 0)
+	{
+		// (Same default tessellation as Cinder: about one segment per pixel of circumference.)
+		int tSegments = ( iSegments > 0 ) ? ( iSegments ) : ( static_cast<int>( std::floor( std::max( iRadiusX, iRadiusY ) * M_PI * 2.0 ) ) );
+		tSegments     = std::max( tSegments, 3 );
+		const ci::gl::VboMesh& tMesh = get( makeKey( ( iSolid ) ? ( SOLID_CIRCLE ) : ( STROKED_CIRCLE ), 0.0f, 0.0f, 0.0f, tSegments, 0 ) );
+		draw( tMesh, ci::Vec3f( iCenter, 0.0f ), ci::Vec3f( iRadiusX, iRadiusY, 1.0f ) );
+	}
+
+	/** @brief draws a rounded rectangle (like gl::drawSolidRoundedRect() / gl::drawStrokedRoundedRect()) */
+	void drawRoundedRect(const ci::Rectf& iRect, const float& iCornerRadius, const bool& iSolid = true, const int& iCornerSegments = 0)
+	{
+		// The corners can't be stretched, so the rectangle's size is part of the key:
+		int tSegments = ( iCornerSegments > 0 ) ? ( iCornerSegments ) : ( static_cast<int>( std::floor( iCornerRadius * M_PI * 2.0 / 4.0 ) ) );
+		tSegments     = std::max( tSegments, 2 );
+		const ci::gl::VboMesh& tMesh = get( makeKey( ( iSolid ) ? ( SOLID_ROUNDED_RECT ) : ( STROKED_ROUNDED_RECT ), iRect.getWidth(), iRect.getHeight(), iCornerRadius, tSegments, 0 ) );
+		draw( tMesh, ci::Vec3f( iRect.getCenter(), 0.0f ), ci::Vec3f::one() );
+	}
+
+	/** @brief draws a sphere (like gl::drawSphere()) */
+	void drawSphere(const ci::Vec3f& iCenter, const float& iRadius, const int& iSegments = 12)
+	{
+		const ci::gl::VboMesh& tMesh = get( makeKey( SPHERE, 0.0f, 0.0f, 0.0f, std::max( iSegments, 3 ), 0 ) );
+		draw( tMesh, iCenter, ci::Vec3f( iRadius, iRadius, iRadius ) );
+	}
+
+	/** @brief draws an open cylinder or cone from y = 0 to y = height (like gl::drawCylinder()) */
+	void drawCylinder(const float& iBaseRadius, const float& iTopRadius, const float& iHeight, const int& iSlices = 12, const int& iStacks = 1)
+	{
+		// Unit base radius and height, so only the taper is part of the key:
+		float tRadius = ( iBaseRadius != 0.0f ) ? ( iBaseRadius ) : ( iTopRadius );
+		float tTaper  = ( tRadius != 0.0f ) ? ( iTopRadius / tRadius ) : ( 1.0f );
+		float tBase   = ( iBaseRadius != 0.0f ) ? ( 1.0f ) : ( 0.0f );
+		const ci::gl::VboMesh& tMesh = get( makeKey( CYLINDER, tBase, tTaper, 0.0f, std::max( iSlices, 3 ), std::max( iStacks, 1 ) ) );
+		draw( tMesh, ci::Vec3f::zero(), ci::Vec3f( tRadius, iHeight, tRadius ) );
+	}
+
+	/** @brief draws a torus around the y axis (like gl::drawTorus()) */
+	void drawTorus(const float& iOuterRadius, const float& iInnerRadius, const int& iLongitudeSegments = 12, const int& iLatitudeSegments = 12)
+	{
+		// (A torus with no outer radius has no size, and no inner / outer ratio:)
+		if( iOuterRadius <= 0.0f ) { return; }
+		// Unit outer radius, so only the inner / outer ratio is part of the key:
+		const ci::gl::VboMesh& tMesh = get( makeKey( TORUS, iInnerRadius / iOuterRadius, 0.0f, 0.0f, std::max( iLongitudeSegments, 3 ), std::max( iLatitudeSegments, 3 ) ) );
+		draw( tMesh, ci::Vec3f::zero(), ci::Vec3f( iOuterRadius, iOuterRadius, iOuterRadius ) );
+	}
+
+protected:
+	/** @brief identifies a mesh */
+	struct Key
+	{
+		Shape	mShape;
+		float	mParams[ 3 ];
+		int		mSegments[ 2 ];
+
+		bool operator<(const Key& iOther) const
+		{
+			if( mShape != iOther.mShape ) { return mShape < iOther.mShape; }
+			for(int i = 0; i < 3; i++) { if( mParams[ i ] != iOther.mParams[ i ] ) { return mParams[ i ] < iOther.mParams[ i ]; } }
+			for(int i = 0; i < 2; i++) { if( mSegments[ i ] != iOther.mSegments[ i ] ) { return mSegments[ i ] < iOther.mSegments[ i ]; } }
+			return false;
+		}
+	};
+
+	/** @brief a cached mesh */
+	struct Entry
+	{
+		ci::gl::VboMesh				mMesh;
+		size_t						mBytes;
+		std::list<Key>::iterator	mLruPos;	//!< position in the recently-used list
+	};
+
+	static Key makeKey(const Shape& iShape, const float& iA, const float& iB, const float& iC, const int& iSegA, const int& iSegB)
+	{
+		Key tKey;
+		tKey.mShape         = iShape;
+		tKey.mParams[ 0 ]   = iA;
+		tKey.mParams[ 1 ]   = iB;
+		tKey.mParams[ 2 ]   = iC;
+		tKey.mSegments[ 0 ] = iSegA;
+		tKey.mSegments[ 1 ] = iSegB;
+		return tKey;
+	}
+
+	/** @brief returns the mesh for a key, building it on a miss */
+	const ci::gl::VboMesh& get(const Key& iKey)
+	{
+		std::map<Key, Entry>::iterator tIt = mEntries.find( iKey );
+		if( tIt != mEntries.end() ) {
+			// Hit: move to the front of the recently-used list:
+			mLru.splice( mLru.begin(), mLru, tIt->second.mLruPos );
+			mStats.mHits++;
+			return tIt->second.mMesh;
+		}
+
+		// Miss: build the geometry:
+		mStats.mMisses++;
+		std::vector<ci::Vec3f> tPositions, tNormals;
+		std::vector<uint32_t>  tIndices;
+		GLenum tPrimitive = build( iKey, tPositions, tNormals, tIndices );
+		size_t tBytes     = ( tPositions.size() + tNormals.size() ) * sizeof( ci::Vec3f ) + tIndices.size() * sizeof( uint32_t );
+
+		// Make room (the new mesh is kept even if it's bigger than the whole budget):
+		evict( tBytes );
+
+		// Upload:
+		ci::gl::VboMesh::Layout tLayout;
+		tLayout.setStaticIndices();
+		tLayout.setStaticPositions();
+		tLayout.setStaticNormals();
+		Entry& tEntry = mEntries[ iKey ];
+		tEntry.mMesh  = ci::gl::VboMesh( tPositions.size(), tIndices.size(), tLayout, tPrimitive );
+		tEntry.mMesh.bufferPositions( tPositions );
+		tEntry.mMesh.bufferNormals( tNormals );
+		tEntry.mMesh.bufferIndices( tIndices );
+		tEntry.mBytes  = tBytes;
+		mLru.push_front( iKey );
+		tEntry.mLruPos = mLru.begin();
+
+		mStats.mEntries = mEntries.size();
+		mStats.mBytes  += tBytes;
+		return tEntry.mMesh;
+	}
+
+	/** @brief deletes least recently used meshes until the given number of bytes fits in the budget */
+	void evict(const size_t& iIncoming)
+	{
+		while( !mLru.empty() && mStats.mBytes + iIncoming > mBudget ) {
+			std::map<Key, Entry>::iterator tIt = mEntries.find( mLru.back() );
+			mStats.mBytes -= tIt->second.mBytes;
+			mEntries.erase( tIt );
+			mLru.pop_back();
+			mStats.mEvictions++;
+		}
+		mStats.mEntries = mEntries.size();
+	}
+
+	/** @brief draws a cached mesh with a translation and scale */
+	static void draw(const ci::gl::VboMesh& iMesh, const ci::Vec3f& iTranslation, const ci::Vec3f& iScale)
+	{
+		ci::gl::pushModelView();
+		ci::gl::translate( iTranslation );
+		ci::gl::scale( iScale );
+		ci::gl::draw( iMesh );
+		ci::gl::popModelView();
+	}
+
+	/** @brief builds the geometry for a key and returns its primitive type */
+	static GLenum build(const Key& iKey, std::vector<ci::Vec3f>& oPositions, std::vector<ci::Vec3f>& oNormals, std::vector<uint32_t>& oIndices)
+	{
+		const float kTwoPi = static_cast<float>( M_PI * 2.0 );
+		switch( iKey.mShape ) {
+			case SOLID_CIRCLE:
+			case STROKED_CIRCLE: {
+				// Unit circle (a fan around the center when solid, a loop when stroked):
+				int  tSegments = iKey.mSegments[ 0 ];
+				bool tSolid    = ( iKey.mShape == SOLID_CIRCLE );
+				if( tSolid ) {
+					oPositions.push_back( ci::Vec3f::zero() );
+					oNormals.push_back( ci::Vec3f::zAxis() );
+					oIndices.push_back( 0 );
+				}
+				for(int i = 0; i < tSegments; i++) {
+					float tTheta = kTwoPi * i / tSegments;
+					oIndices.push_back( static_cast<uint32_t>( oPositions.size() ) );
+					oPositions.push_back( ci::Vec3f( std::cos( tTheta ), std::sin( tTheta ), 0.0f ) );
+					oNormals.push_back( ci::Vec3f::zAxis() );
+				}
+				if( tSolid ) { oIndices.push_back( 1 ); }
+				return ( tSolid ) ? ( GL_TRIANGLE_FAN ) : ( GL_LINE_LOOP );
+			}
+			case SOLID_ROUNDED_RECT:
+			case STROKED_ROUNDED_RECT: {
+				// Centered on the origin, with a quarter circle at each corner:
+				float tHalfW   = iKey.mParams[ 0 ] * 0.5f;
+				float tHalfH   = iKey.mParams[ 1 ] * 0.5f;
+				float tRadius  = std::min( iKey.mParams[ 2 ], std::min( tHalfW, tHalfH ) );
+				int   tSegments = iKey.mSegments[ 0 ];
+				bool  tSolid    = ( iKey.mShape == SOLID_ROUNDED_RECT );
+				if( tSolid ) {
+					oPositions.push_back( ci::Vec3f::zero() );
+					oNormals.push_back( ci::Vec3f::zAxis() );
+					oIndices.push_back( 0 );
+				}
+				const ci::Vec2f kCorners[ 4 ] = { ci::Vec2f( 1, 1 ), ci::Vec2f( -1, 1 ), ci::Vec2f( -1, -1 ), ci::Vec2f( 1, -1 ) };
+				for(int c = 0; c < 4; c++) {
+					ci::Vec2f tCenter( kCorners[ c ].x * ( tHalfW - tRadius ), kCorners[ c ].y * ( tHalfH - tRadius ) );
+					for(int i = 0; i <= tSegments; i++) {
+						float tTheta = kTwoPi * 0.25f * ( c + static_cast<float>( i ) / tSegments );
+						oIndices.push_back( static_cast<uint32_t>( oPositions.size() ) );
+						oPositions.push_back( ci::Vec3f( tCenter.x + std::cos( tTheta ) * tRadius, tCenter.y + std::sin( tTheta ) * tRadius, 0.0f ) );
+						oNormals.push_back( ci::Vec3f::zAxis() );
+					}
+				}
+				if( tSolid ) { oIndices.push_back( 1 ); }
+				return ( tSolid ) ? ( GL_TRIANGLE_FAN ) : ( GL_LINE_LOOP );
+			}
+			case SPHERE: {
+				// Unit sphere (rings from the north to the south pole):
+				int tSlices = iKey.mSegments[ 0 ];
+				int tRings  = std::max( tSlices / 2, 2 );
+				for(int r = 0; r <= tRings; r++) {
+					float tPhi = static_cast<float>( M_PI ) * r / tRings;
+					for(int s = 0; s <= tSlices; s++) {
+						float     tTheta = kTwoPi * s / tSlices;
+						ci::Vec3f tPoint( std::sin( tPhi ) * std::cos( tTheta ), std::cos( tPhi ), std::sin( tPhi ) * std::sin( tTheta ) );
+						oPositions.push_back( tPoint );
+						oNormals.push_back( tPoint );
+					}
+				}
+				addGridIndices( tRings, tSlices, oIndices );
+				return GL_TRIANGLES;
+			}
+			case CYLINDER: {
+				// Unit height, base radius 1 (or 0 for an inverted cone), top radius tapered:
+				float tBase   = iKey.mParams[ 0 ];
+				float tTop    = iKey.mParams[ 1 ];
+				int   tSlices = iKey.mSegments[ 0 ];
+				int   tStacks = iKey.mSegments[ 1 ];
+				for(int r = 0; r <= tStacks; r++) {
+					float tT      = static_cast<float>( r ) / tStacks;
+					float tRadius = tBase + ( tTop - tBase ) * tT;
+					for(int s = 0; s <= tSlices; s++) {
+						float tTheta = kTwoPi * s / tSlices;
+						float tCos = std::cos( tTheta ), tSin = std::sin( tTheta );
+						oPositions.push_back( ci::Vec3f( tCos * tRadius, tT, tSin * tRadius ) );
+						oNormals.push_back( ci::Vec3f( tCos, tBase - tTop, tSin ).normalized() );
+					}
+				}
+				addGridIndices( tStacks, tSlices, oIndices );
+				return GL_TRIANGLES;
+			}
+			case TORUS: {
+				// Outer radius 1 around the y axis, tube radius = inner / outer:
+				float tTube = iKey.mParams[ 0 ];
+				int   tLong = iKey.mSegments[ 0 ];
+				int   tLat  = iKey.mSegments[ 1 ];
+				for(int r = 0; r <= tLong; r++) {
+					float tTheta = kTwoPi * r / tLong;
+					ci::Vec3f tRing( std::cos( tTheta ), 0.0f, std::sin( tTheta ) );
+					for(int s = 0; s <= tLat; s++) {
+						float     tPhi    = kTwoPi * s / tLat;
+						ci::Vec3f tNormal = tRing * std::cos( tPhi ) + ci::Vec3f::yAxis() * std::sin( tPhi );
+						oPositions.push_back( tRing + tNormal * tTube );
+						oNormals.push_back( tNormal );
+					}
+				}
+				addGridIndices( tLong, tLat, oIndices );
+				return GL_TRIANGLES;
+			}
+		}
+		return GL_TRIANGLES;
+	}
+
+	/** @brief adds two triangles for each cell of a ( rows + 1 ) x ( columns + 1 ) vertex grid */
+	static void addGridIndices(const int& iRows, const int& iColumns, std::vector<uint32_t>& oIndices)
+	{
+		uint32_t tStride = static_cast<uint32_t>( iColumns + 1 );
+		for(int r = 0; r < iRows; r++) {
+			for(int c = 0; c < iColumns; c++) {
+				uint32_t tA = r * tStride + c;
+				uint32_t tB = tA + tStride;
+				oIndices.push_back( tA ); oIndices.push_back( tB ); oIndices.push_back( tA + 1 );
+				oIndices.push_back( tA + 1 ); oIndices.push_back( tB ); oIndices.push_back( tB + 1 );
+			}
+		}
+	}
+
+	size_t					mBudget;
+	std::map<Key, Entry>	mEntries;
+	std::list<Key>			mLru;		//!< most recently used first
+	Stats					mStats;
+};
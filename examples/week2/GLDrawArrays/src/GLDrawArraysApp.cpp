@@ -11,21 +11,83 @@
 #include "cinder/Camera.h"
 #include "cinder/Rand.h"
 
+#include <fstream>
+#include <sstream>
+
+#include "MortonSort.h"
+#include "PointCloud.h"
+#include "SubmitBenchmark.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
 
 class GLDrawArraysApp : public AppNative {
 public:
+	void prepareSettings(Settings* settings);
 	void setup();
 	void mouseDown(MouseEvent event);
 	void keyUp(KeyEvent event);
 	void update();
 	void draw();
 	
-	std::vector<float> mPointComponents;
+	void runSubmitBenchmarks(const bool& iSoftware);
+	
+	std::vector<float>		mPointComponents;
+	PointCloud<ci::Vec3f>	mCloud;
+	
+	bool					mBenchmarkOnLaunch;		//!< run the submission benchmark on the first frame (or, with --software, before any window opens), then quit
+	bool					mBenchmarkSoftware;		//!< use the counting stand-in instead of GL
+	std::string				mBenchmarkPath;			//!< where to write the JSON (as well as the console)
 };
 
+void GLDrawArraysApp::runSubmitBenchmarks(const bool& iSoftware)
+{
+	// Workload sizes (items per frame):
+	std::vector<size_t> tItemCounts;
+	tItemCounts.push_back( 1000 );
+	tItemCounts.push_back( 100000 );
+	tItemCounts.push_back( 1000000 );
+	
+	// Run each workload through each strategy:
+	std::ostringstream tJson;
+	if( iSoftware ) {
+		CountingSubmitBackend tBackend;
+		runSubmitBenchmark( tBackend, tJson, tItemCounts );
+	}
+	else {
+		GlSubmitBackend tBackend;
+		runSubmitBenchmark( tBackend, tJson, tItemCounts );
+	}
+	
+	// Report:
+	cout << tJson.str();
+	if( !mBenchmarkPath.empty() ) {
+		std::ofstream tFile( mBenchmarkPath.c_str() );
+		tFile << tJson.str();
+	}
+}
+
+void GLDrawArraysApp::prepareSettings(Settings* settings)
+{
+	// Command line: --submit-benchmark [--software] [--json <path>]
+	mBenchmarkOnLaunch = false;
+	mBenchmarkSoftware = false;
+	const std::vector<std::string>& tArgs = getArgs();
+	for(size_t i = 0; i < tArgs.size(); i++) {
+		if( tArgs[ i ] == "--submit-benchmark" ) { mBenchmarkOnLaunch = true; }
+		else if( tArgs[ i ] == "--software" ) { mBenchmarkSoftware = true; }
+		else if( tArgs[ i ] == "--json" && i + 1 < tArgs.size() ) { mBenchmarkPath = tArgs[ ++i ]; }
+	}
+	
+	// The software run makes no GL calls, so it runs here, before any window
+	// (or GL context) is created, and the app quits as soon as it's written:
+	if( mBenchmarkOnLaunch && mBenchmarkSoftware ) {
+		runSubmitBenchmarks( true );
+		settings->setShouldQuit( true );
+	}
+}
+
 void GLDrawArraysApp::setup()
 {
 	// Enable alpha blending:
@@ -50,6 +112,21 @@ void GLDrawArraysApp::setup()
 			mPointComponents[ i * 3 + j ] = ci::randFloat( -1.0, 1.0 );
 		}
 	}
+	
+	// Collect the points:
+	std::vector<Vec3f> tPoints( tPointCount );
+	for(size_t i = 0; i < tPointCount; i++) {
+		tPoints[ i ] = Vec3f( mPointComponents[ i * 3 ], mPointComponents[ i * 3 + 1 ], mPointComponents[ i * 3 + 2 ] );
+	}
+	
+	// Store them in Morton order (so points close in space are close in memory):
+	std::vector<uint32_t> tOrder = computeMortonOrder<uint32_t>( tPoints );
+	applyOrder( tPoints, tOrder );
+	applyOrder( mPointComponents, tOrder, 3 );
+	
+	// Copy the points into a vertex buffer (uploaded once, on the first draw):
+	mCloud.setPoints( tPoints );
+	
 }
 
 void GLDrawArraysApp::mouseDown(MouseEvent event)
@@ -58,6 +135,25 @@ void GLDrawArraysApp::mouseDown(MouseEvent event)
 
 void GLDrawArraysApp::keyUp(KeyEvent event)
 {
+	switch( event.getChar() ) {
+		case 'b': {
+			runPointCloudBenchmark();
+			break;
+		}
+		case 'g': {
+			runSubmitBenchmarks( false );
+			break;
+		}
+		case 'n': {
+			runSubmitBenchmarks( true );
+			break;
+		}
+		case 'm': {
+			runMortonBenchmark();
+			break;
+		}
+		default: { break; }
+	}
 }
 
 void GLDrawArraysApp::update()
@@ -81,13 +177,20 @@ void GLDrawArraysApp::draw()
 	tCam.lookAt( Vec3f( cos( getElapsedSeconds() ), 0, sin( getElapsedSeconds() ) ), Vec3f::zero() );
 	gl::setMatrices( tCam );
 	
+	// Benchmark run (with the camera's matrices set):
+	if( mBenchmarkOnLaunch ) {
+		runSubmitBenchmarks( mBenchmarkSoftware );
+		quit();
+		return;
+	}
+	
 	// Get vertex count:
 	size_t tVertCount = mPointComponents.size() / 3;
 	
 	// Get current iterator:
-	size_t tIter = getElapsedFrames() % 2;
+	size_t tIter = getElapsedFrames() % 3;
 	
-	// Two approaches to drawing a container of point-components:
+	// Three approaches to drawing a container of point-components:
 	
 	if( tIter == 0 ) {
 		// Prepare to draw the points:
@@ -101,13 +204,17 @@ void GLDrawArraysApp::draw()
 		// End draw:
 		glEnd();
 	}
-	else {
+	else if( tIter == 1 ) {
 		// Draw points, faster:
 		glEnableClientState( GL_VERTEX_ARRAY );
 		glVertexPointer( 3, GL_FLOAT, 0, mPointComponents.data() );
 		glDrawArrays( GL_POINTS, 0, tVertCount );
 		glDisableClientState( GL_VERTEX_ARRAY );
 	}
+	else {
+		// Draw points from a vertex buffer, fastest (the points are already on the GPU):
+		mCloud.draw();
+	}
 }
 
 CINDER_APP_NATIVE( GLDrawArraysApp, RendererGl )
@@ -0,0 +1,42 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Work on large arrays (transforming points, sorting keys, building tables) is
+// often a loop whose iterations don't depend on each other. parallelFor()
+// splits such a loop into one contiguous range per hardware thread, runs the
+// ranges at the same time and waits for all of them to finish.
+//
+// The headers that need it include this file rather than defining their own
+// copy, so any number of them can be included together.
+
+/** @brief runs fn( begin, end ) over [0, count) split across hardware threads */
+template<typename Fn>
+static void parallelFor(const size_t& iCount, Fn iFn)
+{
+	size_t tThreads = std::max<size_t>( std::thread::hardware_concurrency(), 1 );
+	tThreads = std::min<size_t>( tThreads, std::max<size_t>( iCount, 1 ) );
+	size_t tChunk = ( iCount + tThreads - 1 ) / tThreads;
+
+	std::vector<std::thread> tWorkers;
+	for(size_t t = 1; t < tThreads; t++) {
+		size_t tBegin = t * tChunk;
+		size_t tEnd   = std::min( tBegin + tChunk, iCount );
+		if( tBegin < tEnd ) { tWorkers.push_back( std::thread( iFn, tBegin, tEnd ) ); }
+	}
+	// The calling thread takes the first chunk:
+	iFn( static_cast<size_t>( 0 ), std::min( tChunk, iCount ) );
+	for(std::vector<std::thread>::iterator it = tWorkers.begin(); it != tWorkers.end(); it++) {
+		(*it).join();
+	}
+}
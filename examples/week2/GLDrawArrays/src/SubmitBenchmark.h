@@ -0,0 +1,587 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cinder/Rand.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Vbo.h"
+
+#ifndef STRINGIFY
+	#define STRINGIFY(x) #x
+#endif
+
+// There are several ways to hand the same vertices to OpenGL, and they differ a
+// lot in how much work the CPU does each frame:
+//
+//   immediate      glBegin() / glVertex() / glEnd(): one function call per vertex.
+//   client arrays  glVertexPointer() + glDrawArrays(): one call, but the driver
+//                  copies the whole array every frame.
+//   static VBO     the vertices are uploaded to a buffer once; each frame is a
+//                  handful of calls and no copying.
+//   streamed VBO   the vertices are written to a buffer every frame (for data
+//                  that changes every frame), orphaning it when it's full.
+//   instanced      one item's vertices plus a per-item offset, drawn with one
+//                  glDrawArraysInstancedARB() call.
+//
+// The benchmark draws a workload of N points, lines or triangles with each
+// strategy and reports, per strategy:
+//   - the CPU time spent submitting a frame (the draw calls),
+//   - the frame time (submitting, plus waiting for the GPU with glFinish()),
+//   - the bytes sent to the driver per frame (and once, for setup), and
+//   - the number of GL calls per frame,
+// as JSON, so runs on different machines can be compared by a script.
+//
+// The strategies are run through a "backend". Each strategy's calls are written
+// once, in SubmitBackend, which counts every call (and the bytes it hands over)
+// as it's made, and passes it on to an "api". GlSubmitBackend makes the real GL
+// calls (so it needs a context, which can be a software one such as Mesa's
+// llvmpipe). CountingSubmitBackend is a stand-in for machines without any
+// context: it does the copying a driver would do for each call (into a
+// command stream), without drawing anything.
+//
+// From the command line, "--submit-benchmark" runs the GL backend on the first
+// frame (in the app's window) and quits; "--submit-benchmark --software" runs
+// the stand-in at launch, without opening a window or creating a context at
+// all. Either writes its JSON to the console and to "--json <path>", if given.
+
+/** @brief the ways of submitting vertices */
+enum SubmitStrategy
+{
+	SUBMIT_IMMEDIATE,
+	SUBMIT_CLIENT_ARRAYS,
+	SUBMIT_STATIC_VBO,
+	SUBMIT_STREAM_VBO,
+	SUBMIT_INSTANCED,
+	SUBMIT_STRATEGY_COUNT
+};
+
+/** @brief returns a strategy's name (as used in the JSON output) */
+static const char* getSubmitStrategyName(const SubmitStrategy& iStrategy)
+{
+	switch( iStrategy ) {
+		case SUBMIT_IMMEDIATE:     { return "immediate"; }
+		case SUBMIT_CLIENT_ARRAYS: { return "client_arrays"; }
+		case SUBMIT_STATIC_VBO:    { return "static_vbo"; }
+		case SUBMIT_STREAM_VBO:    { return "stream_vbo"; }
+		case SUBMIT_INSTANCED:     { return "instanced"; }
+		default:                   { return "unknown"; }
+	}
+}
+
+/** @brief returns a primitive's name (as used in the JSON output) */
+static const char* getSubmitPrimitiveName(const GLenum& iPrimitive)
+{
+	switch( iPrimitive ) {
+		case GL_POINTS:    { return "points"; }
+		case GL_LINES:     { return "lines"; }
+		case GL_TRIANGLES: { return "triangles"; }
+		default:           { return "unknown"; }
+	}
+}
+
+/** @brief N items (points, lines or triangles) scattered in the unit cube */
+struct SubmitWorkload
+{
+	GLenum					mPrimitive;
+	size_t					mItems;
+	std::vector<ci::Vec3f>	mShape;			//!< one item's vertices (around the origin)
+	std::vector<ci::Vec3f>	mOffsets;		//!< each item's position
+	std::vector<ci::Vec3f>	mVertices;		//!< every item's vertices (shape + offset)
+
+	/** @brief creates a workload */
+	static SubmitWorkload create(const GLenum& iPrimitive, const size_t& iItems, const uint32_t& iSeed = 1234)
+	{
+		SubmitWorkload tWorkload;
+		tWorkload.mPrimitive = iPrimitive;
+		tWorkload.mItems     = iItems;
+
+		float tSize = 0.01f;
+		tWorkload.mShape.push_back( ci::Vec3f::zero() );
+		if( iPrimitive == GL_LINES || iPrimitive == GL_TRIANGLES ) { tWorkload.mShape.push_back( ci::Vec3f( tSize, 0.0f, 0.0f ) ); }
+		if( iPrimitive == GL_TRIANGLES ) { tWorkload.mShape.push_back( ci::Vec3f( 0.0f, tSize, 0.0f ) ); }
+
+		ci::Rand tRand( iSeed );
+		tWorkload.mOffsets.resize( iItems );
+		tWorkload.mVertices.reserve( iItems * tWorkload.mShape.size() );
+		for(size_t i = 0; i < iItems; i++) {
+			tWorkload.mOffsets[ i ] = ci::Vec3f( tRand.nextFloat( -1.0f, 1.0f ), tRand.nextFloat( -1.0f, 1.0f ), tRand.nextFloat( -1.0f, 1.0f ) );
+			for(size_t j = 0; j < tWorkload.mShape.size(); j++) {
+				tWorkload.mVertices.push_back( tWorkload.mShape[ j ] + tWorkload.mOffsets[ i ] );
+			}
+		}
+		return tWorkload;
+	}
+
+	/** @brief returns the size of every item's vertices */
+	size_t getVertexBytes() const { return mVertices.size() * sizeof( ci::Vec3f ); }
+};
+
+/** @brief what one frame's submission cost */
+struct SubmitCost
+{
+	size_t	mCalls;			//!< GL calls
+	size_t	mBytes;			//!< bytes handed to the driver
+
+	/** @brief constructor */
+	SubmitCost(const size_t& iCalls = 0, const size_t& iBytes = 0) : mCalls( iCalls ), mBytes( iBytes ) {}
+};
+
+/** @brief the measurements for one workload and strategy */
+struct SubmitResult
+{
+	GLenum			mPrimitive;
+	size_t			mItems;
+	SubmitStrategy	mStrategy;
+	bool			mSupported;
+	size_t			mFrames;
+	double			mSubmitMs;			//!< average CPU time per frame in the draw calls
+	double			mFrameMs;			//!< average time per frame until the GPU is done
+	size_t			mBytesPerFrame;
+	size_t			mSetupBytes;		//!< bytes uploaded once, before the first frame
+	size_t			mCallsPerFrame;
+
+	/** @brief default constructor */
+	SubmitResult() : mPrimitive( GL_POINTS ), mItems( 0 ), mStrategy( SUBMIT_IMMEDIATE ), mSupported( false ), mFrames( 0 ),
+		mSubmitMs( 0.0 ), mFrameMs( 0.0 ), mBytesPerFrame( 0 ), mSetupBytes( 0 ), mCallsPerFrame( 0 ) {}
+};
+
+/** @brief makes the real GL calls (needs a current context, and the matrices set up) */
+class GlSubmitApi {
+public:
+	/** @brief the buffers a strategy can use */
+	enum Buffer { VERTEX_BUFFER, OFFSET_BUFFER, BUFFER_COUNT };
+
+	/** @brief returns the api's name */
+	const char* getName() const { return "gl"; }
+
+	/** @brief returns whether a strategy can be run */
+	bool supports(const SubmitStrategy& iStrategy) const
+	{
+		if( iStrategy == SUBMIT_INSTANCED ) {
+			return ci::gl::isExtensionAvailable( "GL_ARB_instanced_arrays" ) && ci::gl::isExtensionAvailable( "GL_ARB_draw_instanced" );
+		}
+		return true;
+	}
+
+	void begin(const GLenum& iPrimitive)	{ glBegin( iPrimitive ); }
+	void vertex(const ci::Vec3f& iVertex)	{ glVertex3f( iVertex.x, iVertex.y, iVertex.z ); }
+	void end()								{ glEnd(); }
+
+	void enableVertexArray()				{ glEnableClientState( GL_VERTEX_ARRAY ); }
+	void disableVertexArray()				{ glDisableClientState( GL_VERTEX_ARRAY ); }
+	void vertexPointer(const void* iPointer)	{ glVertexPointer( 3, GL_FLOAT, 0, iPointer ); }
+	void drawArrays(const GLenum& iPrimitive, const GLsizei& iCount)	{ glDrawArrays( iPrimitive, 0, iCount ); }
+	void drawArraysInstanced(const GLenum& iPrimitive, const GLsizei& iCount, const GLsizei& iInstances)	{ glDrawArraysInstancedARB( iPrimitive, 0, iCount, iInstances ); }
+
+	void bindBuffer(const Buffer& iBuffer)		{ getBuffer( iBuffer ).bind(); }
+	void unbindBuffer(const Buffer& iBuffer)	{ getBuffer( iBuffer ).unbind(); }
+	void bufferData(const Buffer& iBuffer, const size_t& iBytes, const void* iData, const GLenum& iUsage)	{ getBuffer( iBuffer ).bufferData( iBytes, iData, iUsage ); }
+	void bufferSubData(const Buffer& iBuffer, const size_t& iOffset, const size_t& iBytes, const void* iData)	{ getBuffer( iBuffer ).bufferSubData( iOffset, iBytes, iData ); }
+
+	void bindProgram()
+	{
+		if( !mProgram ) { mProgram = ci::gl::GlslProg( kInstancedVertGlsl, kInstancedFragGlsl ); }
+		mProgram.bind();
+	}
+	void unbindProgram()							{ mProgram.unbind(); }
+	GLint getAttribLocation(const char* iName)		{ return mProgram.getAttribLocation( iName ); }
+	void enableAttrib(const GLint& iLocation)		{ glEnableVertexAttribArray( iLocation ); }
+	void disableAttrib(const GLint& iLocation)		{ glDisableVertexAttribArray( iLocation ); }
+	void attribPointer(const GLint& iLocation, const void* iPointer)	{ glVertexAttribPointer( iLocation, 3, GL_FLOAT, GL_FALSE, 0, iPointer ); }
+	void attribDivisor(const GLint& iLocation, const GLuint& iDivisor)	{ glVertexAttribDivisorARB( iLocation, iDivisor ); }
+
+	/** @brief waits for the GPU to finish the frame */
+	void finish() { glFinish(); }
+
+	/** @brief frees the buffers */
+	void release()
+	{
+		for(int i = 0; i < BUFFER_COUNT; i++) { mBuffers[ i ] = ci::gl::Vbo(); }
+	}
+
+protected:
+	/** @brief returns a buffer, creating it on first use */
+	ci::gl::Vbo& getBuffer(const Buffer& iBuffer)
+	{
+		if( !mBuffers[ iBuffer ] ) { mBuffers[ iBuffer ] = ci::gl::Vbo( GL_ARRAY_BUFFER ); }
+		return mBuffers[ iBuffer ];
+	}
+
+	static const char* const kInstancedVertGlsl;
+	static const char* const kInstancedFragGlsl;
+
+	ci::gl::Vbo			mBuffers[ BUFFER_COUNT ];
+	ci::gl::GlslProg	mProgram;
+};
+
+// Each instance's vertices, moved by the instance's offset:
+const char* const GlSubmitApi::kInstancedVertGlsl =
+STRINGIFY(
+		  attribute vec3 aOffset;
+
+		  void main()
+		  {
+			  gl_FrontColor = gl_Color;
+			  gl_Position   = gl_ModelViewProjectionMatrix * ( gl_Vertex + vec4( aOffset, 0.0 ) );
+		  }
+		  );
+
+const char* const GlSubmitApi::kInstancedFragGlsl =
+STRINGIFY(
+		  void main()
+		  {
+			  gl_FragColor = gl_Color;
+		  }
+		  );
+
+/** @brief a stand-in for a driver: does the copying each call would make a driver do (into a command stream), without drawing */
+class CountingSubmitApi {
+public:
+	/** @brief the buffers a strategy can use */
+	enum Buffer { VERTEX_BUFFER, OFFSET_BUFFER, BUFFER_COUNT };
+
+	/** @brief constructor */
+	CountingSubmitApi() : mBound( false ), mPointer( NULL ) {}
+
+	/** @brief returns the api's name */
+	const char* getName() const { return "counting"; }
+
+	/** @brief returns whether a strategy can be run */
+	bool supports(const SubmitStrategy& iStrategy) const { return true; }
+
+	// One command (a token and a vertex) per immediate mode call:
+	void begin(const GLenum& iPrimitive)	{ pushCommand( kBegin, NULL, 0 ); }
+	void vertex(const ci::Vec3f& iVertex)	{ pushCommand( kVertex, &iVertex, 1 ); }
+	void end()								{ pushCommand( kEnd, NULL, 0 ); }
+
+	void enableVertexArray()				{}
+	void disableVertexArray()				{}
+	void vertexPointer(const void* iPointer)	{ mPointer = static_cast<const ci::Vec3f*>( iPointer ); }
+
+	/** @brief "draws": client arrays (no buffer bound) are copied into the command stream */
+	void drawArrays(const GLenum& iPrimitive, const GLsizei& iCount)
+	{
+		if( mBound ) { pushCommand( kDraw, NULL, 0 ); }
+		else         { pushCommand( kDraw, mPointer, iCount ); }
+	}
+	void drawArraysInstanced(const GLenum& iPrimitive, const GLsizei& iCount, const GLsizei& iInstances)	{ pushCommand( kDraw, NULL, 0 ); }
+
+	void bindBuffer(const Buffer& iBuffer)		{ mBound = true; }
+	void unbindBuffer(const Buffer& iBuffer)	{ mBound = false; }
+	void bufferData(const Buffer& iBuffer, const size_t& iBytes, const void* iData, const GLenum& iUsage)
+	{
+		mBuffers[ iBuffer ].resize( iBytes );
+		if( iData && iBytes ) { std::memcpy( &mBuffers[ iBuffer ][ 0 ], iData, iBytes ); }
+	}
+	void bufferSubData(const Buffer& iBuffer, const size_t& iOffset, const size_t& iBytes, const void* iData)
+	{
+		std::memcpy( &mBuffers[ iBuffer ][ iOffset ], iData, iBytes );
+	}
+
+	void bindProgram()								{}
+	void unbindProgram()							{}
+	GLint getAttribLocation(const char* iName)		{ return 0; }
+	void enableAttrib(const GLint& iLocation)		{}
+	void disableAttrib(const GLint& iLocation)		{}
+	void attribPointer(const GLint& iLocation, const void* iPointer)	{}
+	void attribDivisor(const GLint& iLocation, const GLuint& iDivisor)	{}
+
+	/** @brief "executes" the command stream (discarding it) */
+	void finish() { mCommands.clear(); }
+
+	/** @brief frees the buffers */
+	void release()
+	{
+		for(int i = 0; i < BUFFER_COUNT; i++) { std::vector<char>().swap( mBuffers[ i ] ); }
+		std::vector<char>().swap( mCommands );
+	}
+
+protected:
+	enum Token { kBegin, kVertex, kEnd, kDraw };
+
+	/** @brief appends a token and its vertices to the command stream */
+	void pushCommand(const Token& iToken, const ci::Vec3f* iData, const size_t& iCount)
+	{
+		size_t tBytes = iCount * sizeof( ci::Vec3f );
+		size_t tStart = mCommands.size();
+		mCommands.resize( tStart + sizeof( uint32_t ) + tBytes );
+		uint32_t tToken = static_cast<uint32_t>( iToken );
+		std::memcpy( &mCommands[ tStart ], &tToken, sizeof( uint32_t ) );
+		if( tBytes ) { std::memcpy( &mCommands[ tStart + sizeof( uint32_t ) ], iData, tBytes ); }
+	}
+
+	std::vector<char>		mBuffers[ BUFFER_COUNT ];	//!< "buffer object" storage
+	std::vector<char>		mCommands;			//!< the frame's command stream
+	bool					mBound;				//!< whether a buffer is bound (so pointers are offsets into it)
+	const ci::Vec3f*		mPointer;			//!< the client array set by vertexPointer()
+};
+
+/** @brief runs each strategy's calls through an api (GlSubmitApi or CountingSubmitApi), counting each call as it's made */
+template<typename ApiT>
+class SubmitBackend {
+public:
+	typedef typename ApiT::Buffer Buffer;
+
+	/** @brief constructor */
+	SubmitBackend() : mBound( false ), mRingBytes( 0 ), mRingOffset( 0 ) {}
+
+	/** @brief returns the backend's name */
+	const char* getName() const { return mApi.getName(); }
+
+	/** @brief returns whether a strategy can be run */
+	bool supports(const SubmitStrategy& iStrategy) const { return mApi.supports( iStrategy ); }
+
+	/** @brief uploads what a strategy needs before its first frame (returns the bytes uploaded) */
+	size_t prepare(const SubmitWorkload& iWorkload, const SubmitStrategy& iStrategy)
+	{
+		mCost = SubmitCost();
+		switch( iStrategy ) {
+			case SUBMIT_STATIC_VBO: {
+				createBuffer( ApiT::VERTEX_BUFFER, iWorkload.mVertices );
+				break;
+			}
+			case SUBMIT_STREAM_VBO: {
+				// Room for three frames before the buffer is orphaned:
+				mRingBytes  = iWorkload.getVertexBytes() * 3;
+				mRingOffset = mRingBytes;
+				break;
+			}
+			case SUBMIT_INSTANCED: {
+				createBuffer( ApiT::VERTEX_BUFFER, iWorkload.mShape );
+				createBuffer( ApiT::OFFSET_BUFFER, iWorkload.mOffsets );
+				break;
+			}
+			default: { break; }
+		}
+		return mCost.mBytes;
+	}
+
+	/** @brief draws one frame */
+	SubmitCost submit(const SubmitWorkload& iWorkload, const SubmitStrategy& iStrategy)
+	{
+		mCost = SubmitCost();
+		GLsizei tCount = static_cast<GLsizei>( iWorkload.mVertices.size() );
+		switch( iStrategy ) {
+			case SUBMIT_IMMEDIATE: {
+				begin( iWorkload.mPrimitive );
+				for(size_t i = 0; i < iWorkload.mVertices.size(); i++) { vertex( iWorkload.mVertices[ i ] ); }
+				end();
+				break;
+			}
+			case SUBMIT_CLIENT_ARRAYS: {
+				enableVertexArray();
+				vertexPointer( &iWorkload.mVertices[ 0 ] );
+				drawArrays( iWorkload.mPrimitive, tCount );
+				disableVertexArray();
+				break;
+			}
+			case SUBMIT_STATIC_VBO: {
+				drawBuffer( iWorkload.mPrimitive, 0, tCount );
+				break;
+			}
+			case SUBMIT_STREAM_VBO: {
+				size_t tBytes = iWorkload.getVertexBytes();
+				bindBuffer( ApiT::VERTEX_BUFFER );
+				if( mRingOffset + tBytes > mRingBytes ) {
+					bufferData( ApiT::VERTEX_BUFFER, mRingBytes, NULL, GL_STREAM_DRAW );
+					mRingOffset = 0;
+				}
+				bufferSubData( ApiT::VERTEX_BUFFER, mRingOffset, tBytes, &iWorkload.mVertices[ 0 ] );
+				unbindBuffer( ApiT::VERTEX_BUFFER );
+				drawBuffer( iWorkload.mPrimitive, mRingOffset, tCount );
+				mRingOffset += tBytes;
+				break;
+			}
+			case SUBMIT_INSTANCED: {
+				bindProgram();
+				GLint tOffsetLoc = getAttribLocation( "aOffset" );
+				bindBuffer( ApiT::OFFSET_BUFFER );
+				enableAttrib( tOffsetLoc );
+				attribPointer( tOffsetLoc, NULL );
+				attribDivisor( tOffsetLoc, 1 );
+				unbindBuffer( ApiT::OFFSET_BUFFER );
+
+				bindBuffer( ApiT::VERTEX_BUFFER );
+				enableVertexArray();
+				vertexPointer( NULL );
+				drawArraysInstanced( iWorkload.mPrimitive, static_cast<GLsizei>( iWorkload.mShape.size() ), static_cast<GLsizei>( iWorkload.mItems ) );
+				disableVertexArray();
+				unbindBuffer( ApiT::VERTEX_BUFFER );
+
+				attribDivisor( tOffsetLoc, 0 );
+				disableAttrib( tOffsetLoc );
+				unbindProgram();
+				break;
+			}
+			default: { break; }
+		}
+		return mCost;
+	}
+
+	/** @brief waits for the GPU to finish the frame */
+	void finish() { mApi.finish(); }
+
+	/** @brief frees a strategy's buffers */
+	void release() { mApi.release(); }
+
+protected:
+	/** @brief creates a static vertex buffer */
+	void createBuffer(const Buffer& iBuffer, const std::vector<ci::Vec3f>& iData)
+	{
+		bindBuffer( iBuffer );
+		bufferData( iBuffer, iData.size() * sizeof( ci::Vec3f ), &iData[ 0 ], GL_STATIC_DRAW );
+		unbindBuffer( iBuffer );
+	}
+
+	/** @brief draws vertices from the vertex buffer, starting at a byte offset */
+	void drawBuffer(const GLenum& iPrimitive, const size_t& iOffset, const GLsizei& iCount)
+	{
+		const char* tBase = NULL;
+		bindBuffer( ApiT::VERTEX_BUFFER );
+		enableVertexArray();
+		vertexPointer( tBase + iOffset );
+		drawArrays( iPrimitive, iCount );
+		disableVertexArray();
+		unbindBuffer( ApiT::VERTEX_BUFFER );
+	}
+
+	// Each call is counted here, as it's made (and the bytes it hands to the driver added),
+	// so the call counts can't drift from the calls that are actually made:
+	void begin(const GLenum& iPrimitive)	{ mCost.mCalls++; mApi.begin( iPrimitive ); }
+	void vertex(const ci::Vec3f& iVertex)	{ mCost.mCalls++; mCost.mBytes += sizeof( ci::Vec3f ); mApi.vertex( iVertex ); }
+	void end()								{ mCost.mCalls++; mApi.end(); }
+
+	void enableVertexArray()				{ mCost.mCalls++; mApi.enableVertexArray(); }
+	void disableVertexArray()				{ mCost.mCalls++; mApi.disableVertexArray(); }
+	void vertexPointer(const void* iPointer)	{ mCost.mCalls++; mApi.vertexPointer( iPointer ); }
+	void drawArrays(const GLenum& iPrimitive, const GLsizei& iCount)
+	{
+		// Without a buffer bound, the driver copies the client array:
+		mCost.mCalls++;
+		if( !mBound ) { mCost.mBytes += iCount * sizeof( ci::Vec3f ); }
+		mApi.drawArrays( iPrimitive, iCount );
+	}
+	void drawArraysInstanced(const GLenum& iPrimitive, const GLsizei& iCount, const GLsizei& iInstances)	{ mCost.mCalls++; mApi.drawArraysInstanced( iPrimitive, iCount, iInstances ); }
+
+	void bindBuffer(const Buffer& iBuffer)		{ mCost.mCalls++; mBound = true;  mApi.bindBuffer( iBuffer ); }
+	void unbindBuffer(const Buffer& iBuffer)	{ mCost.mCalls++; mBound = false; mApi.unbindBuffer( iBuffer ); }
+	void bufferData(const Buffer& iBuffer, const size_t& iBytes, const void* iData, const GLenum& iUsage)
+	{
+		mCost.mCalls++;
+		if( iData ) { mCost.mBytes += iBytes; }
+		mApi.bufferData( iBuffer, iBytes, iData, iUsage );
+	}
+	void bufferSubData(const Buffer& iBuffer, const size_t& iOffset, const size_t& iBytes, const void* iData)	{ mCost.mCalls++; mCost.mBytes += iBytes; mApi.bufferSubData( iBuffer, iOffset, iBytes, iData ); }
+
+	void bindProgram()							{ mCost.mCalls++; mApi.bindProgram(); }
+	void unbindProgram()						{ mCost.mCalls++; mApi.unbindProgram(); }
+	GLint getAttribLocation(const char* iName)	{ mCost.mCalls++; return mApi.getAttribLocation( iName ); }
+	void enableAttrib(const GLint& iLocation)	{ mCost.mCalls++; mApi.enableAttrib( iLocation ); }
+	void disableAttrib(const GLint& iLocation)	{ mCost.mCalls++; mApi.disableAttrib( iLocation ); }
+	void attribPointer(const GLint& iLocation, const void* iPointer)	{ mCost.mCalls++; mApi.attribPointer( iLocation, iPointer ); }
+	void attribDivisor(const GLint& iLocation, const GLuint& iDivisor)	{ mCost.mCalls++; mApi.attribDivisor( iLocation, iDivisor ); }
+
+	ApiT		mApi;
+	SubmitCost	mCost;				//!< the calls and bytes so far (this frame, or this prepare())
+	bool		mBound;				//!< whether a buffer is bound
+	size_t		mRingBytes;
+	size_t		mRingOffset;		//!< next free byte in the streaming buffer
+};
+
+typedef SubmitBackend<GlSubmitApi>			GlSubmitBackend;
+typedef SubmitBackend<CountingSubmitApi>	CountingSubmitBackend;
+
+/** @brief runs a workload through every strategy of a backend */
+template<typename BackendT>
+static std::vector<SubmitResult> runSubmitWorkload(BackendT& ioBackend, const SubmitWorkload& iWorkload, const size_t& iFrames)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	std::vector<SubmitResult> tResults;
+
+	for(int s = 0; s < SUBMIT_STRATEGY_COUNT; s++) {
+		SubmitResult tResult;
+		tResult.mPrimitive = iWorkload.mPrimitive;
+		tResult.mItems     = iWorkload.mItems;
+		tResult.mStrategy  = static_cast<SubmitStrategy>( s );
+		tResult.mSupported = ioBackend.supports( tResult.mStrategy );
+		if( !tResult.mSupported ) {
+			tResults.push_back( tResult );
+			continue;
+		}
+
+		tResult.mSetupBytes = ioBackend.prepare( iWorkload, tResult.mStrategy );
+
+		// One warm-up frame (first-use costs), then the measured frames:
+		ioBackend.submit( iWorkload, tResult.mStrategy );
+		ioBackend.finish();
+
+		double     tSubmitMs = 0.0, tFrameMs = 0.0;
+		SubmitCost tCost;
+		for(size_t f = 0; f < iFrames; f++) {
+			Clock::time_point tStart = Clock::now();
+			tCost = ioBackend.submit( iWorkload, tResult.mStrategy );
+			Clock::time_point tSubmitted = Clock::now();
+			ioBackend.finish();
+			Clock::time_point tFinished = Clock::now();
+			tSubmitMs += std::chrono::duration<double, std::milli>( tSubmitted - tStart ).count();
+			tFrameMs  += std::chrono::duration<double, std::milli>( tFinished - tStart ).count();
+		}
+		ioBackend.release();
+
+		tResult.mFrames        = iFrames;
+		tResult.mSubmitMs      = tSubmitMs / std::max<size_t>( iFrames, 1 );
+		tResult.mFrameMs       = tFrameMs / std::max<size_t>( iFrames, 1 );
+		tResult.mBytesPerFrame = tCost.mBytes;
+		tResult.mCallsPerFrame = tCost.mCalls;
+		tResults.push_back( tResult );
+	}
+	return tResults;
+}
+
+/** @brief writes results as JSON */
+static void writeSubmitJson(std::ostream& oStream, const std::string& iBackend, const std::vector<SubmitResult>& iResults)
+{
+	oStream << "{\n  \"backend\": \"" << iBackend << "\",\n  \"results\": [\n";
+	for(size_t i = 0; i < iResults.size(); i++) {
+		const SubmitResult& r = iResults[ i ];
+		oStream << "    { \"primitive\": \"" << getSubmitPrimitiveName( r.mPrimitive ) << "\", \"items\": " << r.mItems
+			<< ", \"strategy\": \"" << getSubmitStrategyName( r.mStrategy ) << "\", \"supported\": " << ( ( r.mSupported ) ? ( "true" ) : ( "false" ) );
+		if( r.mSupported ) {
+			oStream << ", \"frames\": " << r.mFrames << ", \"submit_ms\": " << r.mSubmitMs << ", \"frame_ms\": " << r.mFrameMs
+				<< ", \"bytes_per_frame\": " << r.mBytesPerFrame << ", \"setup_bytes\": " << r.mSetupBytes << ", \"calls_per_frame\": " << r.mCallsPerFrame;
+		}
+		oStream << " }" << ( ( i + 1 < iResults.size() ) ? ( "," ) : ( "" ) ) << "\n";
+	}
+	oStream << "  ]\n}" << std::endl;
+}
+
+/** @brief runs points, lines and triangles at several sizes through every strategy and writes JSON */
+template<typename BackendT>
+static void runSubmitBenchmark(BackendT& ioBackend, std::ostream& oStream, const std::vector<size_t>& iItemCounts, const size_t& iFrames = 10)
+{
+	const GLenum tPrimitives[] = { GL_POINTS, GL_LINES, GL_TRIANGLES };
+	std::vector<SubmitResult> tResults;
+	for(int p = 0; p < 3; p++) {
+		for(size_t c = 0; c < iItemCounts.size(); c++) {
+			SubmitWorkload tWorkload = SubmitWorkload::create( tPrimitives[ p ], iItemCounts[ c ] );
+			std::vector<SubmitResult> tWorkloadResults = runSubmitWorkload( ioBackend, tWorkload, iFrames );
+			tResults.insert( tResults.end(), tWorkloadResults.begin(), tWorkloadResults.end() );
+		}
+	}
+	writeSubmitJson( oStream, ioBackend.getName(), tResults );
+}
@@ -9,6 +9,8 @@
 #include "cinder/app/AppNative.h"
 #include "cinder/gl/gl.h"
 
+#include "PolylineBatch.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -20,12 +22,26 @@ public:
 	void keyUp(KeyEvent event);
 	void update();
 	void draw();
+	
+	void drawBatch();
+	
+	PolylineBatch						mBatch;			//!< thick lines, tessellated into triangles
+	bool								mUseBatch;		//!< draw thick lines as triangles instead of cycling through the GL line modes
+	bool								mWaves;			//!< also draw a few thousand animated lines
+	PolylineBatch::Join					mJoin;
+	std::vector<std::vector<Vec2f> >	mWavePoints;
+	std::vector<std::vector<ColorA> >	mWaveColors;
 };
 
 void GLLinesApp::setup()
 {
 	// Enable alpha blending:
 	gl::enableAlphaBlending();
+	
+	// Cycle through the GL line modes by default ('l' switches to thick lines as triangles):
+	mUseBatch = false;
+	mWaves    = false;
+	mJoin     = PolylineBatch::JOIN_MITER;
 }
 
 void GLLinesApp::mouseDown(MouseEvent event)
@@ -34,10 +50,72 @@ void GLLinesApp::mouseDown(MouseEvent event)
 
 void GLLinesApp::keyUp(KeyEvent event)
 {
+	switch( event.getChar() ) {
+		case 'l': {
+			mUseBatch = !mUseBatch;
+			cout << ( ( mUseBatch ) ? ( "Drawing thick lines as triangles" ) : ( "Drawing GL_LINES / GL_LINE_STRIP / GL_LINE_LOOP" ) ) << endl;
+			break;
+		}
+		case 'j': {
+			const char* tNames[] = { "miter", "bevel", "round" };
+			mJoin = static_cast<PolylineBatch::Join>( ( mJoin + 1 ) % 3 );
+			cout << "Joins: " << tNames[ mJoin ] << endl;
+			break;
+		}
+		case 'a': {
+			mWaves = !mWaves;
+			mWavePoints.resize( ( mWaves ) ? ( 2000 ) : ( 0 ) );
+			mWaveColors.resize( mWavePoints.size() );
+			break;
+		}
+		case 's': {
+			const PolylineBatch::Stats& tStats = mBatch.getStats();
+			cout << tStats.mPolylines << " polylines, " << tStats.mSegments << " segments, " << tStats.mTriangles << " triangles, "
+				<< tStats.mBatches << " draw calls, " << tStats.mBytes / 1024 << " KB, " << tStats.mTessellateMs << " ms tessellating" << endl;
+			break;
+		}
+		case 'b': {
+			runPolylineBenchmark();
+			break;
+		}
+		default: { break; }
+	}
 }
 
 void GLLinesApp::update()
 {
+	// Animate the waves:
+	float tTime = static_cast<float>( getElapsedSeconds() );
+	float tSpacing = static_cast<float>( getWindowHeight() ) / std::max<size_t>( mWavePoints.size(), 1 );
+	for(size_t i = 0; i < mWavePoints.size(); i++) {
+		createWave( mWavePoints[ i ], mWaveColors[ i ], 64, i * tSpacing, static_cast<float>( getWindowWidth() ), tTime + i * 0.05f );
+	}
+}
+
+void GLLinesApp::drawBatch()
+{
+	// Set matrices window in pixels (so line widths are in pixels):
+	gl::setMatricesWindow( getWindowSize() );
+	Vec2f tSize( getWindowSize() );
+	
+	mBatch.begin();
+	
+	// The waves:
+	for(size_t i = 0; i < mWavePoints.size(); i++) {
+		mBatch.addPolyline( mWavePoints[ i ], mWaveColors[ i ], 1.5f, false, mJoin, PolylineBatch::CAP_ROUND );
+	}
+	
+	// The square, as a closed loop:
+	std::vector<Vec2f> tPoints;
+	std::vector<ColorA> tColors;
+	tPoints.push_back( Vec2f( 0.25, 0.25 ) * tSize ); tColors.push_back( ColorA( 1, 0, 0, 1 ) );
+	tPoints.push_back( Vec2f( 0.75, 0.25 ) * tSize ); tColors.push_back( ColorA( 0, 1, 0, 1 ) );
+	tPoints.push_back( Vec2f( 0.75, 0.75 ) * tSize ); tColors.push_back( ColorA( 0, 0, 1, 1 ) );
+	tPoints.push_back( Vec2f( 0.25, 0.75 ) * tSize ); tColors.push_back( ColorA( 1, 1, 1, 1 ) );
+	mBatch.addPolyline( tPoints, tColors, 16.0f, true, mJoin );
+	
+	// One draw call for all of them:
+	mBatch.end();
 }
 
 void GLLinesApp::draw()
@@ -45,6 +123,12 @@ void GLLinesApp::draw()
 	// Clear window:
 	gl::clear( Color( 0, 0, 0 ) );
 	
+	// Thick lines, as triangles (if switched on with 'l'):
+	if( mUseBatch ) {
+		drawBatch();
+		return;
+	}
+	
 	// Set matrices window from unit size:
 	gl::setMatricesWindow( Vec2i( 1, 1 ) );
 	
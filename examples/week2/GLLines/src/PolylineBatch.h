@@ -0,0 +1,387 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#define POLYLINE_BATCH_SSE 1
+	#include <emmintrin.h>
+#endif
+
+#include "cinder/Color.h"
+#include "cinder/Rand.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Vbo.h"
+
+// glLineWidth() is limited to a driver-specific maximum (often just 1 pixel in
+// core profiles), and GL_LINE_STRIP doesn't join its segments: thick lines show
+// gaps or notches at every corner. Drawing lines as triangles avoids both:
+//
+//   - each segment becomes a quad (two triangles) of the line's width, centered
+//     on the segment (its corners are the end points, moved half the width
+//     along the segment's "normal", the direction perpendicular to it),
+//   - each corner gets a "join" that fills the wedge on its outer side:
+//       miter  extends both edges until they meet (a sharp corner; very sharp
+//              corners would make very long spikes, so past a "miter limit"
+//              they're beveled instead),
+//       bevel  cuts the corner off with one triangle,
+//       round  fills it with a fan of triangles (a circular arc),
+//   - the ends of an open polyline get "caps": butt (none), square (extended
+//     by half the width) or round.
+//
+// The segment normals are computed four segments at a time with SSE. The quads
+// are then written one segment at a time (each is just the normal added to and
+// subtracted from its end points), and so are the joins, which depend on each
+// corner's angle.
+//
+// Many polylines, each vertex with its own color, are collected into one array
+// of triangles and drawn with a single glDrawArrays() call. The vertex buffer
+// is a "streaming" buffer, orphaned each frame, so animated lines don't wait for
+// the GPU to finish drawing the previous frame.
+//
+// (On the inner side of a corner the two segment quads overlap, which shows
+// with translucent colors.)
+
+/** @brief collects thick polylines as triangles and draws them with one call */
+class PolylineBatch {
+public:
+	/** @brief how corners are filled */
+	enum Join { JOIN_MITER, JOIN_BEVEL, JOIN_ROUND };
+
+	/** @brief how the ends of open polylines are drawn */
+	enum Cap { CAP_BUTT, CAP_SQUARE, CAP_ROUND };
+
+	/** @brief a vertex as stored in the vertex buffer (12 bytes) */
+	struct Vertex
+	{
+		ci::Vec2f		mPosition;
+		ci::ColorA8u	mColor;
+	};
+
+	/** @brief per-frame counters (from begin() to end()) */
+	struct Stats
+	{
+		size_t	mPolylines;
+		size_t	mSegments;
+		size_t	mTriangles;
+		size_t	mBatches;			//!< draw calls
+		size_t	mBytes;				//!< vertex bytes uploaded
+		double	mTessellateMs;		//!< time spent in addPolyline()
+
+		/** @brief default constructor */
+		Stats() : mPolylines( 0 ), mSegments( 0 ), mTriangles( 0 ), mBatches( 0 ), mBytes( 0 ), mTessellateMs( 0.0 ) {}
+	};
+
+	/** @brief constructor */
+	PolylineBatch() : mMiterLimit( 4.0f ), mRoundTolerance( 0.25f ), mSimd( true ), mBufferBytes( 0 ) {}
+
+	/** @brief sets how far (in half-widths) a miter may reach before it's beveled */
+	void setMiterLimit(const float& iLimit) { mMiterLimit = std::max( iLimit, 1.0f ); }
+
+	/** @brief sets how far (in line units) round joins and caps may stray from a true circle */
+	void setRoundTolerance(const float& iTolerance) { mRoundTolerance = std::max( iTolerance, 1.0e-3f ); }
+
+	/** @brief enables or disables the SSE path (for comparison) */
+	void setSimdEnabled(const bool& iEnabled) { mSimd = iEnabled; }
+
+	/** @brief starts a frame (clears the polylines and counters) */
+	void begin()
+	{
+		mStats = Stats();
+		mVertices.clear();
+	}
+
+	/** @brief adds a polyline with one color */
+	void addPolyline(const std::vector<ci::Vec2f>& iPoints, const ci::ColorA& iColor, const float& iWidth, const bool& iClosed = false, const Join& iJoin = JOIN_MITER, const Cap& iCap = CAP_BUTT)
+	{
+		if( iPoints.empty() ) { return; }
+		addPolyline( &iPoints[ 0 ], NULL, iPoints.size(), iColor, iWidth, iClosed, iJoin, iCap );
+	}
+
+	/** @brief adds a polyline with one color per point */
+	void addPolyline(const std::vector<ci::Vec2f>& iPoints, const std::vector<ci::ColorA>& iColors, const float& iWidth, const bool& iClosed = false, const Join& iJoin = JOIN_MITER, const Cap& iCap = CAP_BUTT)
+	{
+		if( iPoints.empty() ) { return; }
+		addPolyline( &iPoints[ 0 ], ( iColors.size() >= iPoints.size() ) ? ( &iColors[ 0 ] ) : ( NULL ), iPoints.size(), ( iColors.empty() ) ? ( ci::ColorA::white() ) : ( iColors[ 0 ] ), iWidth, iClosed, iJoin, iCap );
+	}
+
+	/** @brief adds a polyline (iColors may be NULL, to use iColor for every point) */
+	void addPolyline(const ci::Vec2f* iPoints, const ci::ColorA* iColors, const size_t& iCount, const ci::ColorA& iColor, const float& iWidth, const bool& iClosed, const Join& iJoin, const Cap& iCap)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		Clock::time_point tStart = Clock::now();
+
+		// Copy the points into separate x and y arrays (dropping repeated points, which have no direction):
+		mX.clear();
+		mY.clear();
+		mColors.clear();
+		for(size_t i = 0; i < iCount; i++) {
+			if( !mX.empty() && iPoints[ i ].x == mX.back() && iPoints[ i ].y == mY.back() ) { continue; }
+			mX.push_back( iPoints[ i ].x );
+			mY.push_back( iPoints[ i ].y );
+			mColors.push_back( ci::ColorA8u( ( iColors ) ? ( iColors[ i ] ) : ( iColor ) ) );
+		}
+		bool tClosed = iClosed && mX.size() > 2;
+		if( tClosed && mX.back() == mX.front() && mY.back() == mY.front() ) {
+			mX.pop_back();
+			mY.pop_back();
+			mColors.pop_back();
+		}
+		if( mX.size() < 2 ) { return; }
+		if( tClosed ) {
+			// (The closing segment goes back to the first point.)
+			mX.push_back( mX.front() );
+			mY.push_back( mY.front() );
+			mColors.push_back( mColors.front() );
+		}
+
+		float  tHalf     = iWidth * 0.5f;
+		size_t tSegments = mX.size() - 1;
+
+		// Open polylines with square caps are extended by half the width at both ends:
+		if( !tClosed && iCap == CAP_SQUARE ) {
+			ci::Vec2f tStartDir = ci::Vec2f( mX[ 0 ] - mX[ 1 ], mY[ 0 ] - mY[ 1 ] ).normalized() * tHalf;
+			ci::Vec2f tEndDir   = ci::Vec2f( mX[ tSegments ] - mX[ tSegments - 1 ], mY[ tSegments ] - mY[ tSegments - 1 ] ).normalized() * tHalf;
+			mX[ 0 ] += tStartDir.x;
+			mY[ 0 ] += tStartDir.y;
+			mX[ tSegments ] += tEndDir.x;
+			mY[ tSegments ] += tEndDir.y;
+		}
+
+		// Segment normals (scaled to half the width) and quads:
+		computeNormals( tSegments, tHalf );
+		for(size_t s = 0; s < tSegments; s++) {
+			ci::Vec2f tA( mX[ s ], mY[ s ] ), tB( mX[ s + 1 ], mY[ s + 1 ] ), tN( mNx[ s ], mNy[ s ] );
+			const ci::ColorA8u& tColorA = mColors[ s ];
+			const ci::ColorA8u& tColorB = mColors[ s + 1 ];
+			pushTriangle( tA + tN, tColorA, tA - tN, tColorA, tB - tN, tColorB );
+			pushTriangle( tA + tN, tColorA, tB - tN, tColorB, tB + tN, tColorB );
+		}
+
+		// Joins (every inner point, and the first point again for closed polylines):
+		for(size_t p = 1; p < tSegments; p++) { addJoin( p, p - 1, p, tHalf, iJoin ); }
+		if( tClosed ) { addJoin( 0, tSegments - 1, 0, tHalf, iJoin ); }
+
+		// Round caps:
+		if( !tClosed && iCap == CAP_ROUND ) {
+			ci::Vec2f tN0( mNx[ 0 ], mNy[ 0 ] ), tN1( mNx[ tSegments - 1 ], mNy[ tSegments - 1 ] );
+			ci::Vec2f tStartOut( mX[ 0 ] - mX[ 1 ], mY[ 0 ] - mY[ 1 ] );
+			ci::Vec2f tEndOut( mX[ tSegments ] - mX[ tSegments - 1 ], mY[ tSegments ] - mY[ tSegments - 1 ] );
+			addArc( ci::Vec2f( mX[ 0 ], mY[ 0 ] ), -tN0, tN0, tHalf, mColors[ 0 ], tStartOut );
+			addArc( ci::Vec2f( mX[ tSegments ], mY[ tSegments ] ), tN1, -tN1, tHalf, mColors[ tSegments ], tEndOut );
+		}
+
+		mStats.mPolylines++;
+		mStats.mSegments += tSegments;
+		mStats.mTessellateMs += std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+	}
+
+	/** @brief uploads and draws the frame's polylines */
+	void end()
+	{
+		mStats.mTriangles = mVertices.size() / 3;
+		if( mVertices.empty() ) { return; }
+
+		// Orphan the streaming buffer (growing it if needed), then fill it:
+		size_t tBytes = mVertices.size() * sizeof( Vertex );
+		if( !mBuffer ) { mBuffer = ci::gl::Vbo( GL_ARRAY_BUFFER ); }
+		mBuffer.bind();
+		mBufferBytes = std::max( mBufferBytes, tBytes );
+		mBuffer.bufferData( mBufferBytes, NULL, GL_STREAM_DRAW );
+		mBuffer.bufferSubData( 0, tBytes, &mVertices[ 0 ] );
+
+		const char* tBase = NULL;
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, sizeof( Vertex ), tBase + offsetof( Vertex, mPosition ) );
+		glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( Vertex ), tBase + offsetof( Vertex, mColor ) );
+		glDrawArrays( GL_TRIANGLES, 0, static_cast<GLsizei>( mVertices.size() ) );
+		glDisableClientState( GL_COLOR_ARRAY );
+		glDisableClientState( GL_VERTEX_ARRAY );
+		mBuffer.unbind();
+
+		mStats.mBatches++;
+		mStats.mBytes += tBytes;
+	}
+
+	/** @brief returns the tessellated vertices (three per triangle) */
+	const std::vector<Vertex>& getVertices() const { return mVertices; }
+
+	/** @brief returns the counters for the current (or last) frame */
+	const Stats& getStats() const { return mStats; }
+
+protected:
+	/** @brief computes each segment's normal, scaled to half the line width (four segments at a time with SSE) */
+	void computeNormals(const size_t& iSegments, const float& iHalf)
+	{
+		mNx.resize( iSegments );
+		mNy.resize( iSegments );
+		size_t s = 0;
+#if defined( POLYLINE_BATCH_SSE )
+		if( mSimd ) {
+			__m128 tHalf = _mm_set1_ps( iHalf );
+			__m128 tTiny = _mm_set1_ps( 1.0e-30f );
+			for(; s + 4 <= iSegments; s += 4) {
+				__m128 tDx = _mm_sub_ps( _mm_loadu_ps( &mX[ s + 1 ] ), _mm_loadu_ps( &mX[ s ] ) );
+				__m128 tDy = _mm_sub_ps( _mm_loadu_ps( &mY[ s + 1 ] ), _mm_loadu_ps( &mY[ s ] ) );
+				__m128 tLengthSq = _mm_max_ps( _mm_add_ps( _mm_mul_ps( tDx, tDx ), _mm_mul_ps( tDy, tDy ) ), tTiny );
+				__m128 tScale = _mm_div_ps( tHalf, _mm_sqrt_ps( tLengthSq ) );
+				// n = ( -dy, dx ) / length * half:
+				_mm_storeu_ps( &mNx[ s ], _mm_mul_ps( _mm_sub_ps( _mm_setzero_ps(), tDy ), tScale ) );
+				_mm_storeu_ps( &mNy[ s ], _mm_mul_ps( tDx, tScale ) );
+			}
+		}
+#endif
+		for(; s < iSegments; s++) {
+			float tDx = mX[ s + 1 ] - mX[ s ], tDy = mY[ s + 1 ] - mY[ s ];
+			float tScale = iHalf / std::sqrt( std::max( tDx * tDx + tDy * tDy, 1.0e-30f ) );
+			mNx[ s ] = -tDy * tScale;
+			mNy[ s ] = tDx * tScale;
+		}
+	}
+
+	/** @brief fills the outer wedge at point iPoint, between segments iIn and iOut */
+	void addJoin(const size_t& iPoint, const size_t& iIn, const size_t& iOut, const float& iHalf, const Join& iJoin)
+	{
+		ci::Vec2f tP( mX[ iPoint ], mY[ iPoint ] );
+		ci::Vec2f tN0( mNx[ iIn ], mNy[ iIn ] ), tN1( mNx[ iOut ], mNy[ iOut ] );
+		const ci::ColorA8u& tColor = mColors[ iPoint ];
+
+		// Which way the line turns (the outer side is opposite the turn):
+		float tCross = tN0.x * tN1.y - tN0.y * tN1.x;
+		if( std::fabs( tCross ) < 1.0e-12f * iHalf * iHalf && tN0.dot( tN1 ) > 0.0f ) { return; }
+		if( tCross > 0.0f ) {
+			tN0 = -tN0;
+			tN1 = -tN1;
+		}
+
+		if( iJoin == JOIN_ROUND ) {
+			addArc( tP, tN0, tN1, iHalf, tColor, ci::Vec2f::zero() );
+			return;
+		}
+		if( iJoin == JOIN_MITER ) {
+			// The miter's tip is along the average normal, far enough that its edges line up with the segments':
+			ci::Vec2f tMid = tN0 + tN1;
+			float     tMidLength = tMid.length();
+			if( tMidLength > 1.0e-6f * iHalf ) {
+				ci::Vec2f tDir = tMid / tMidLength;
+				float     tReach = iHalf * iHalf / std::max( tDir.dot( tN0 ), 1.0e-6f );
+				if( tReach <= mMiterLimit * iHalf ) {
+					ci::Vec2f tTip = tP + tDir * tReach;
+					pushTriangle( tP, tColor, tP + tN0, tColor, tTip, tColor );
+					pushTriangle( tP, tColor, tTip, tColor, tP + tN1, tColor );
+					return;
+				}
+			}
+		}
+		// Bevel (and miters past the limit):
+		pushTriangle( tP, tColor, tP + tN0, tColor, tP + tN1, tColor );
+	}
+
+	/** @brief adds a fan around iCenter from offset iFrom to offset iTo: the shorter way, or (for caps) the half circle through iOutward */
+	void addArc(const ci::Vec2f& iCenter, const ci::Vec2f& iFrom, const ci::Vec2f& iTo, const float& iRadius, const ci::ColorA8u& iColor, const ci::Vec2f& iOutward)
+	{
+		bool  tShortest = ( iOutward.x == 0.0f && iOutward.y == 0.0f );
+		float tFrom     = std::atan2( iFrom.y, iFrom.x );
+		float tSweep    = std::atan2( iTo.y, iTo.x ) - tFrom;
+		if( tShortest ) {
+			if( tSweep > 3.14159265f ) { tSweep -= 6.28318531f; }
+			if( tSweep < -3.14159265f ) { tSweep += 6.28318531f; }
+		}
+		else {
+			// Turning counter-clockwise from iFrom heads towards iOutward, or away from it:
+			tSweep = ( -iFrom.y * iOutward.x + iFrom.x * iOutward.y > 0.0f ) ? ( 3.14159265f ) : ( -3.14159265f );
+		}
+
+		// Steps small enough that the chords stay within the tolerance of the circle:
+		float tStepMax = 2.0f * std::acos( std::max( 1.0f - mRoundTolerance / std::max( iRadius, 1.0e-6f ), -1.0f ) );
+		int   tSteps   = std::max( 1, static_cast<int>( std::ceil( std::fabs( tSweep ) / std::max( tStepMax, 1.0e-3f ) ) ) );
+		tSteps = std::min( tSteps, 64 );
+
+		ci::Vec2f tPrev = iCenter + iFrom;
+		for(int i = 1; i <= tSteps; i++) {
+			float     tAngle = tFrom + tSweep * i / tSteps;
+			ci::Vec2f tNext  = ( i == tSteps ) ? ( iCenter + iTo ) : ( iCenter + ci::Vec2f( std::cos( tAngle ), std::sin( tAngle ) ) * iRadius );
+			pushTriangle( iCenter, iColor, tPrev, iColor, tNext, iColor );
+			tPrev = tNext;
+		}
+	}
+
+	/** @brief appends a triangle */
+	void pushTriangle(const ci::Vec2f& iA, const ci::ColorA8u& iColorA, const ci::Vec2f& iB, const ci::ColorA8u& iColorB, const ci::Vec2f& iC, const ci::ColorA8u& iColorC)
+	{
+		size_t tSize = mVertices.size();
+		mVertices.resize( tSize + 3 );
+		Vertex* v = &mVertices[ tSize ];
+		v[ 0 ].mPosition = iA; v[ 0 ].mColor = iColorA;
+		v[ 1 ].mPosition = iB; v[ 1 ].mColor = iColorB;
+		v[ 2 ].mPosition = iC; v[ 2 ].mColor = iColorC;
+	}
+
+	float						mMiterLimit;
+	float						mRoundTolerance;
+	bool						mSimd;
+	std::vector<float>			mX, mY;			//!< the current polyline's points
+	std::vector<float>			mNx, mNy;		//!< its segments' normals (times half the width)
+	std::vector<ci::ColorA8u>	mColors;		//!< its points' colors
+	std::vector<Vertex>			mVertices;		//!< the frame's triangles
+	ci::gl::Vbo					mBuffer;
+	size_t						mBufferBytes;
+	Stats						mStats;
+};
+
+/** @brief creates a wavy polyline (for the demo and benchmark) */
+static void createWave(std::vector<ci::Vec2f>& oPoints, std::vector<ci::ColorA>& oColors, const size_t& iPoints, const float& iY, const float& iWidth, const float& iPhase)
+{
+	oPoints.resize( iPoints );
+	oColors.resize( iPoints );
+	for(size_t i = 0; i < iPoints; i++) {
+		float t = static_cast<float>( i ) / std::max<size_t>( iPoints - 1, 1 );
+		oPoints[ i ] = ci::Vec2f( t * iWidth, iY + 12.0f * std::sin( t * 18.0f + iPhase ) + 4.0f * std::sin( t * 53.0f - iPhase * 2.0f ) );
+		oColors[ i ] = ci::ColorA( 0.5f + 0.5f * std::sin( t * 6.0f + iPhase ), 0.5f + 0.5f * std::cos( iY * 0.01f ), 1.0f - t, 1.0f );
+	}
+}
+
+/** @brief times tessellating thousands of polylines with each join (with and without SSE) */
+static void runPolylineBenchmark(const size_t& iLines = 2000, const size_t& iPoints = 64, const size_t& iRepeats = 5)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	std::vector<std::vector<ci::Vec2f> > tLines( iLines );
+	std::vector<std::vector<ci::ColorA> > tColors( iLines );
+	for(size_t l = 0; l < iLines; l++) { createWave( tLines[ l ], tColors[ l ], iPoints, static_cast<float>( l ) * 0.5f, 1000.0f, static_cast<float>( l ) * 0.1f ); }
+
+	const char* tJoinNames[] = { "miter", "bevel", "round" };
+	PolylineBatch tBatch;
+	// (One untimed pass, so the first timing doesn't include growing the vertex array.)
+	tBatch.begin();
+	for(size_t l = 0; l < iLines; l++) { tBatch.addPolyline( tLines[ l ], tColors[ l ], 3.0f, false, PolylineBatch::JOIN_ROUND, PolylineBatch::CAP_ROUND ); }
+	std::cout << "Polyline benchmark: " << iLines << " lines of " << iPoints << " points" << std::endl;
+	for(int j = 0; j < 3; j++) {
+		for(int tSimd = 1; tSimd >= 0; tSimd--) {
+			tBatch.setSimdEnabled( tSimd != 0 );
+			double tMs = 0.0;
+			for(size_t r = 0; r < iRepeats; r++) {
+				Clock::time_point tStart = Clock::now();
+				tBatch.begin();
+				for(size_t l = 0; l < iLines; l++) { tBatch.addPolyline( tLines[ l ], tColors[ l ], 3.0f, false, static_cast<PolylineBatch::Join>( j ), PolylineBatch::CAP_ROUND ); }
+				tMs += std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+			}
+			std::cout << "  " << tJoinNames[ j ] << ( ( tSimd ) ? ( " (SSE):    " ) : ( " (scalar): " ) ) << tMs / iRepeats << " ms/frame, "
+				<< tBatch.getVertices().size() / 3 << " triangles, " << tBatch.getVertices().size() * sizeof( PolylineBatch::Vertex ) / 1024 << " KB" << std::endl;
+		}
+	}
+}
@@ -10,6 +10,8 @@
 #include "cinder/gl/gl.h"
 #include "cinder/Rand.h"
 
+#include "PointCloud.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -22,9 +24,27 @@ public:
 	void update();
 	void draw();
 	
-	std::vector<ci::Vec2f> mPoints;
+	void generatePoints(const size_t& iPointCount);
+	
+	std::vector<ci::Vec2f>	mPoints;
+	PointCloud<ci::Vec2f>	mCloud;		//!< the points, in a vertex buffer
+	bool					mUseCloud;
 };
 
+void GLPoints2dApp::generatePoints(const size_t& iPointCount)
+{
+	// Resize point vector:
+	mPoints.resize( iPointCount );
+	
+	// Generate random points:
+	for(size_t i = 0; i < iPointCount; i++) {
+		mPoints[ i ] = Vec2f( ci::randFloat( 0.0, 1.0 ), ci::randFloat( 0.0, 1.0 ) );
+	}
+	
+	// Upload them (once, rather than every frame):
+	mCloud.setPoints( mPoints );
+}
+
 void GLPoints2dApp::setup()
 {
 	// Enable alpha blending:
@@ -33,16 +53,11 @@ void GLPoints2dApp::setup()
 	// Seed random number generator:
 	ci::randSeed( (unsigned)time( NULL ) );
 	
-	// Choose a point count:
-	size_t tPointCount = 100;
-	
-	// Resize point vector:
-	mPoints.resize( tPointCount );
+	// Choose a point count and generate the points:
+	generatePoints( 100 );
 	
-	// Generate random points:
-	for(size_t i = 0; i < tPointCount; i++) {
-		mPoints[ i ] = Vec2f( ci::randFloat( 0.0, 1.0 ), ci::randFloat( 0.0, 1.0 ) );
-	}
+	// Draw from the vertex buffer by default:
+	mUseCloud = true;
 }
 
 void GLPoints2dApp::mouseDown(MouseEvent event)
@@ -51,6 +66,29 @@ void GLPoints2dApp::mouseDown(MouseEvent event)
 
 void GLPoints2dApp::keyUp(KeyEvent event)
 {
+	switch( event.getChar() ) {
+		case '=':
+		case '+': {
+			generatePoints( std::min<size_t>( mPoints.size() * 10, 10000000 ) );
+			cout << mPoints.size() << " points" << endl;
+			break;
+		}
+		case '-': {
+			generatePoints( std::max<size_t>( mPoints.size() / 10, 100 ) );
+			cout << mPoints.size() << " points" << endl;
+			break;
+		}
+		case 'c': {
+			mUseCloud = !mUseCloud;
+			cout << ( ( mUseCloud ) ? ( "Drawing from a vertex buffer" ) : ( "Drawing with glBegin / glEnd" ) ) << endl;
+			break;
+		}
+		case 'b': {
+			runPointCloudBenchmark();
+			break;
+		}
+		default: { break; }
+	}
 }
 
 void GLPoints2dApp::update()
@@ -74,6 +112,12 @@ void GLPoints2dApp::draw()
 	// Set point display size:
 	glPointSize( 5.0 );
 	
+	// Draw the points from the vertex buffer:
+	if( mUseCloud ) {
+		mCloud.draw();
+		return;
+	}
+	
 	// Prepare to draw the points:
 	glBegin(GL_POINTS);
 	// Iterate over and draw each point:
@@ -0,0 +1,223 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#define FRUSTUM_CULLER_SSE 1
+	#include <emmintrin.h>
+#endif
+
+#include "cinder/Camera.h"
+#include "cinder/Matrix.h"
+#include "cinder/Vector.h"
+
+// The camera only sees what's inside its "view frustum": a pyramid with its top
+// cut off (or, for an orthographic camera, a box), bounded by six planes. Anything
+// entirely outside one of those planes can't appear on screen, so there's no point
+// in sending it to the GPU.
+//
+// The six planes can be read straight out of the combined projection * modelview
+// matrix (this works for both CameraPersp and CameraOrtho). Each plane is stored
+// as a normal n pointing into the frustum plus an offset d, so a point p is on the
+// inside when dot( n, p ) + d >= 0.
+//
+// Testing a box against a plane: the box is outside if even its corner furthest
+// along the normal is behind the plane. For a box with center c and half-size e,
+// that corner is at distance dot( n, c ) + d + dot( abs( n ), e ). A sphere is
+// outside if dot( n, c ) + d < -radius, which is cheaper but looser.
+//
+// The bounds are stored as separate arrays of x, y and z values, so with SSE
+// four objects are tested against each plane at once.
+
+/** @brief the six planes of a camera's view frustum */
+class Frustum {
+public:
+	enum PlaneId { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+	/** @brief default constructor (everything is inside) */
+	Frustum()
+	{
+		for(int i = 0; i < PLANE_COUNT; i++) { mPlanes[ i ] = ci::Vec4f( 0.0f, 0.0f, 0.0f, 1.0f ); }
+	}
+
+	/** @brief extracts the frustum of the given camera (perspective or orthographic) */
+	explicit Frustum(const ci::Camera& iCam)
+	{
+		set( iCam.getProjectionMatrix() * iCam.getModelViewMatrix() );
+	}
+
+	/** @brief extracts the frustum from a combined projection * modelview matrix */
+	void set(const ci::Matrix44f& iViewProj)
+	{
+		// Matrix44f is column-major: row i is ( m[ i ], m[ 4 + i ], m[ 8 + i ], m[ 12 + i ] ):
+		const float* m = iViewProj.m;
+		ci::Vec4f tRow[ 4 ];
+		for(int i = 0; i < 4; i++) { tRow[ i ] = ci::Vec4f( m[ i ], m[ 4 + i ], m[ 8 + i ], m[ 12 + i ] ); }
+
+		// Clip space is -w <= x, y, z <= w, so each plane is the last row plus or minus another row:
+		for(int i = 0; i < 3; i++) {
+			mPlanes[ i * 2 ]     = add( tRow[ 3 ], tRow[ i ], 1.0f );
+			mPlanes[ i * 2 + 1 ] = add( tRow[ 3 ], tRow[ i ], -1.0f );
+		}
+
+		// Normalize, so that dot( n, p ) + d is a true distance:
+		for(int i = 0; i < PLANE_COUNT; i++) {
+			ci::Vec4f& p = mPlanes[ i ];
+			float tLength = std::sqrt( p.x * p.x + p.y * p.y + p.z * p.z );
+			if( tLength > 0.0f ) { p = ci::Vec4f( p.x / tLength, p.y / tLength, p.z / tLength, p.w / tLength ); }
+		}
+	}
+
+	/** @brief returns a plane as ( nx, ny, nz, d ) */
+	const ci::Vec4f& getPlane(const int& iPlane) const { return mPlanes[ iPlane ]; }
+
+	/** @brief returns whether a box (center and half-size) is at least partly inside */
+	bool containsBox(const ci::Vec3f& iCenter, const ci::Vec3f& iHalfSize) const
+	{
+		for(int i = 0; i < PLANE_COUNT; i++) {
+			const ci::Vec4f& p = mPlanes[ i ];
+			float tDist   = p.x * iCenter.x + p.y * iCenter.y + p.z * iCenter.z + p.w;
+			float tRadius = std::fabs( p.x ) * iHalfSize.x + std::fabs( p.y ) * iHalfSize.y + std::fabs( p.z ) * iHalfSize.z;
+			if( tDist + tRadius < 0.0f ) { return false; }
+		}
+		return true;
+	}
+
+	/** @brief returns whether a sphere is at least partly inside */
+	bool containsSphere(const ci::Vec3f& iCenter, const float& iRadius) const
+	{
+		for(int i = 0; i < PLANE_COUNT; i++) {
+			const ci::Vec4f& p = mPlanes[ i ];
+			if( p.x * iCenter.x + p.y * iCenter.y + p.z * iCenter.z + p.w < -iRadius ) { return false; }
+		}
+		return true;
+	}
+
+protected:
+	static ci::Vec4f add(const ci::Vec4f& a, const ci::Vec4f& b, const float& s)
+	{
+		return ci::Vec4f( a.x + b.x * s, a.y + b.y * s, a.z + b.z * s, a.w + b.w * s );
+	}
+
+	ci::Vec4f mPlanes[ PLANE_COUNT ];
+};
+
+/** @brief a set of bounding volumes that are tested against a frustum together */
+class CullBatch {
+public:
+	/** @brief bounding volume used by cull() */
+	enum Mode { BOXES, SPHERES };
+
+	/** @brief culling counters (for the last call to cull()) */
+	struct Stats
+	{
+		size_t	mTested;
+		size_t	mVisible;
+		size_t	mCulled;
+
+		/** @brief default constructor */
+		Stats() : mTested( 0 ), mVisible( 0 ), mCulled( 0 ) {}
+	};
+
+	/** @brief adds an axis-aligned box (its bounding sphere is derived from it) and returns its index */
+	size_t addBox(const ci::Vec3f& iCenter, const ci::Vec3f& iHalfSize)
+	{
+		mCx.push_back( 0.0f ); mCy.push_back( 0.0f ); mCz.push_back( 0.0f );
+		mEx.push_back( 0.0f ); mEy.push_back( 0.0f ); mEz.push_back( 0.0f );
+		mRadius.push_back( 0.0f );
+		setBox( mCx.size() - 1, iCenter, iHalfSize );
+		return mCx.size() - 1;
+	}
+
+	/** @brief moves or resizes a box */
+	void setBox(const size_t& iIndex, const ci::Vec3f& iCenter, const ci::Vec3f& iHalfSize)
+	{
+		mCx[ iIndex ] = iCenter.x;   mCy[ iIndex ] = iCenter.y;   mCz[ iIndex ] = iCenter.z;
+		mEx[ iIndex ] = iHalfSize.x; mEy[ iIndex ] = iHalfSize.y; mEz[ iIndex ] = iHalfSize.z;
+		mRadius[ iIndex ] = iHalfSize.length();
+	}
+
+	/** @brief removes all volumes */
+	void clear()
+	{
+		mCx.clear(); mCy.clear(); mCz.clear();
+		mEx.clear(); mEy.clear(); mEz.clear();
+		mRadius.clear();
+	}
+
+	/** @brief returns the number of volumes */
+	size_t size() const { return mCx.size(); }
+
+	/** @brief writes the indices of the volumes that are at least partly inside the frustum */
+	void cull(const Frustum& iFrustum, std::vector<uint32_t>& oVisible, const Mode& iMode = BOXES)
+	{
+		oVisible.clear();
+		size_t tCount = mCx.size();
+		size_t i = 0;
+#ifdef FRUSTUM_CULLER_SSE
+		const __m128 tZero    = _mm_setzero_ps();
+		const __m128 tAbsMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+		for(; i + 4 <= tCount; i += 4) {
+			__m128 cx = _mm_loadu_ps( &mCx[ i ] );
+			__m128 cy = _mm_loadu_ps( &mCy[ i ] );
+			__m128 cz = _mm_loadu_ps( &mCz[ i ] );
+			__m128 tOutside = _mm_setzero_ps();
+			for(int p = 0; p < Frustum::PLANE_COUNT; p++) {
+				const ci::Vec4f& tPlane = iFrustum.getPlane( p );
+				__m128 nx = _mm_set1_ps( tPlane.x );
+				__m128 ny = _mm_set1_ps( tPlane.y );
+				__m128 nz = _mm_set1_ps( tPlane.z );
+				__m128 tDist = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, cx ), _mm_mul_ps( ny, cy ) ), _mm_add_ps( _mm_mul_ps( nz, cz ), _mm_set1_ps( tPlane.w ) ) );
+				__m128 tRadius;
+				if( iMode == BOXES ) {
+					tRadius = _mm_add_ps( _mm_add_ps(
+						_mm_mul_ps( _mm_and_ps( nx, tAbsMask ), _mm_loadu_ps( &mEx[ i ] ) ),
+						_mm_mul_ps( _mm_and_ps( ny, tAbsMask ), _mm_loadu_ps( &mEy[ i ] ) ) ),
+						_mm_mul_ps( _mm_and_ps( nz, tAbsMask ), _mm_loadu_ps( &mEz[ i ] ) ) );
+				}
+				else {
+					tRadius = _mm_loadu_ps( &mRadius[ i ] );
+				}
+				tOutside = _mm_or_ps( tOutside, _mm_cmplt_ps( _mm_add_ps( tDist, tRadius ), tZero ) );
+			}
+			int tMask = _mm_movemask_ps( tOutside );
+			for(int k = 0; k < 4; k++) {
+				if( !( tMask & ( 1 << k ) ) ) { oVisible.push_back( static_cast<uint32_t>( i + k ) ); }
+			}
+		}
+#endif
+		// Remainder:
+		for(; i < tCount; i++) {
+			ci::Vec3f tCenter( mCx[ i ], mCy[ i ], mCz[ i ] );
+			bool tInside = ( iMode == BOXES ) ?
+				( iFrustum.containsBox( tCenter, ci::Vec3f( mEx[ i ], mEy[ i ], mEz[ i ] ) ) ) :
+				( iFrustum.containsSphere( tCenter, mRadius[ i ] ) );
+			if( tInside ) { oVisible.push_back( static_cast<uint32_t>( i ) ); }
+		}
+
+		// Update counters:
+		mStats.mTested  = tCount;
+		mStats.mVisible = oVisible.size();
+		mStats.mCulled  = tCount - oVisible.size();
+	}
+
+	/** @brief returns the counters for the last call to cull() */
+	const Stats& getStats() const { return mStats; }
+
+protected:
+	// Bounds (structure of arrays):
+	std::vector<float>	mCx, mCy, mCz;	//!< centers
+	std::vector<float>	mEx, mEy, mEz;	//!< box half-sizes
+	std::vector<float>	mRadius;		//!< bounding sphere radii
+	Stats				mStats;
+};
@@ -10,6 +10,14 @@
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
 #include "cinder/Rand.h"
+#include "cinder/Utilities.h"
+
+#include <atomic>
+#include <thread>
+
+#include "MortonSort.h"
+#include "PointCloud.h"
+#include "PointOctree.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -22,10 +30,86 @@ public:
 	void keyUp(KeyEvent event);
 	void update();
 	void draw();
+	void shutdown();
+	
+	void generatePoints(const size_t& iPointCount);
+	bool openOctree();
+	static std::string getOctreePath();
+	static bool buildOctree(const std::string& iPath);
 	
-	std::vector<ci::Vec3f> mPoints;
+	std::vector<ci::Vec3f>	mPoints;
+	PointCloud<ci::Vec3f>	mCloud;		//!< the points, streamed to a vertex buffer
+	bool					mUseCloud;
+	bool					mAnimate;
+	
+	PointOctree				mOctree;	//!< a large point cloud, drawn at a level of detail
+	bool					mUseOctree;
+	std::thread				mOctreeBuilder;	//!< writes the octree file the first time (so the window keeps drawing)
+	std::atomic<bool>		mOctreeBuilt;	//!< set by mOctreeBuilder when it's done
 };
 
+std::string GLPoints3dApp::getOctreePath()
+{
+	return ( getTemporaryDirectory() / "GLPoints3d.pco" ).string();
+}
+
+bool GLPoints3dApp::buildOctree(const std::string& iPath)
+{
+	// A large terrain-like cloud:
+	size_t tPointCount = 8000000;
+	cout << "Creating " << tPointCount << " points in " << iPath << "..." << endl;
+	Rand tRand( 1234 );
+	std::vector<Vec3f>    tPoints( tPointCount );
+	std::vector<ColorA8u> tColors( tPointCount );
+	for(size_t i = 0; i < tPointCount; i++) {
+		float x = tRand.nextFloat( -1.0f, 1.0f ), z = tRand.nextFloat( -1.0f, 1.0f );
+		float y = 0.2f * sin( x * 3.0f ) * cos( z * 3.0f ) + 0.05f * sin( x * 17.0f + z * 11.0f ) + tRand.nextFloat( -0.005f, 0.005f );
+		tPoints[ i ] = Vec3f( x, y, z );
+		float tHeight = std::min( std::max( y * 2.0f + 0.5f, 0.0f ), 1.0f );
+		tColors[ i ] = ColorA8u( ColorA( 0.2f + 0.6f * tHeight, 0.6f, 0.8f - 0.6f * tHeight, 1.0f ) );
+	}
+	PointOctreeBuilder tBuilder;
+	if( !tBuilder.build( tPoints, tColors, iPath ) ) {
+		cout << "Couldn't write " << iPath << endl;
+		return false;
+	}
+	cout << "Built " << tBuilder.getStats().mNodes << " nodes in " << tBuilder.getStats().mBuildMs << " ms" << endl;
+	return true;
+}
+
+bool GLPoints3dApp::openOctree()
+{
+	// Opening only reads the file's node table (the points are loaded on demand):
+	if( !mOctree.open( getOctreePath() ) ) { return false; }
+	
+	// Draw at most a million points, keeping at most 64 MB of them in vertex buffers:
+	mOctree.setPointBudget( 1000000 );
+	mOctree.setMemoryBudget( 64 << 20 );
+	return true;
+}
+
+void GLPoints3dApp::generatePoints(const size_t& iPointCount)
+{
+	// Resize point vector:
+	mPoints.resize( iPointCount );
+	
+	// Generate random points:
+	for(size_t i = 0; i < iPointCount; i++) {
+		mPoints[ i ] = Vec3f( ci::randFloat( -1.0, 1.0 ), ci::randFloat( -1.0, 1.0 ), ci::randFloat( -1.0, 1.0 ) );
+	}
+	
+	// Store the points in Morton order (so points close in space are close in memory):
+	applyOrder( mPoints, computeMortonOrder<uint32_t>( mPoints ) );
+	
+	// Give each point a color from its position:
+	std::vector<ColorA> tColors( iPointCount );
+	for(size_t i = 0; i < iPointCount; i++) {
+		tColors[ i ] = ColorA( mPoints[ i ].x * 0.5 + 0.5, mPoints[ i ].y * 0.5 + 0.5, mPoints[ i ].z * 0.5 + 0.5, 1.0 );
+	}
+	mCloud.setPoints( mPoints );
+	mCloud.setColors( tColors );
+}
+
 void GLPoints3dApp::setup()
 {
 	// Enable alpha blending:
@@ -38,16 +122,23 @@ void GLPoints3dApp::setup()
 	// Seed random number generator:
 	ci::randSeed( (unsigned)time( NULL ) );
 	
-	// Choose a point count:
-	size_t tPointCount = 1000;
+	// Every point moves every frame while animating, so the cloud streams each frame
+	// to the next segment of its vertex buffer (rather than re-uploading in place):
+	mCloud = PointCloud<Vec3f>( PointCloud<Vec3f>::STREAM );
 	
-	// Resize point vector:
-	mPoints.resize( tPointCount );
+	// Choose a point count and generate the points:
+	generatePoints( 1000 );
 	
-	// Generate random points:
-	for(size_t i = 0; i < tPointCount; i++) {
-		mPoints[ i ] = Vec3f( ci::randFloat( -1.0, 1.0 ), ci::randFloat( -1.0, 1.0 ), ci::randFloat( -1.0, 1.0 ) );
-	}
+	// Draw from the vertex buffer by default:
+	mUseCloud    = true;
+	mAnimate     = false;
+	mUseOctree   = false;
+	mOctreeBuilt = false;
+}
+
+void GLPoints3dApp::shutdown()
+{
+	if( mOctreeBuilder.joinable() ) { mOctreeBuilder.join(); }
 }
 
 void GLPoints3dApp::mouseDown(MouseEvent event)
@@ -56,10 +147,94 @@ void GLPoints3dApp::mouseDown(MouseEvent event)
 
 void GLPoints3dApp::keyUp(KeyEvent event)
 {
+	switch( event.getChar() ) {
+		case '=':
+		case '+': {
+			generatePoints( std::min<size_t>( mPoints.size() * 10, 10000000 ) );
+			cout << mPoints.size() << " points" << endl;
+			break;
+		}
+		case '-': {
+			generatePoints( std::max<size_t>( mPoints.size() / 10, 1000 ) );
+			cout << mPoints.size() << " points" << endl;
+			break;
+		}
+		case 'a': {
+			mAnimate = !mAnimate;
+			break;
+		}
+		case 'c': {
+			mUseCloud = !mUseCloud;
+			cout << ( ( mUseCloud ) ? ( "Drawing from a vertex buffer" ) : ( "Drawing with glBegin / glEnd" ) ) << endl;
+			break;
+		}
+		case 'o': {
+			if( mUseOctree || mOctree.isOpen() || openOctree() ) {
+				mUseOctree = !mUseOctree;
+				break;
+			}
+			// The first time, build the octree file on a thread (it takes a while), and show it when it's done:
+			if( !mOctreeBuilder.joinable() ) {
+				std::string tPath = getOctreePath();
+				mOctreeBuilder = std::thread( [this, tPath]() {
+					buildOctree( tPath );
+					mOctreeBuilt = true;
+				} );
+			}
+			break;
+		}
+		case 's': {
+			if( mUseOctree ) {
+				const PointOctree::Stats& tStats = mOctree.getStats();
+				cout << "Octree: " << tStats.mDrawnNodes << " of " << tStats.mSelectedNodes << " picked nodes drawn (" << tStats.mPointsDrawn << " points), "
+					<< tStats.mResidentNodes << " nodes in " << tStats.mResidentBytes / ( 1 << 20 ) << " MB, " << tStats.mPendingLoads << " loads pending" << endl;
+				break;
+			}
+			const PointCloud<Vec3f>::Stats& tStats = mCloud.getStats();
+			cout << "Point cloud: " << tStats.mDraws << " draws, " << tStats.mUploads << " uploads, "
+				<< tStats.mBytes / ( 1 << 20 ) << " MB uploaded, " << tStats.mOrphans << " orphans" << endl;
+			mCloud.resetStats();
+			break;
+		}
+		case 'b': {
+			runPointCloudBenchmark();
+			break;
+		}
+		case 'm': {
+			runMortonBenchmark();
+			break;
+		}
+		default: { break; }
+	}
 }
 
 void GLPoints3dApp::update()
 {
+	// Show the octree once its file has been built:
+	if( mOctreeBuilt ) {
+		mOctreeBuilder.join();
+		mOctreeBuilt = false;
+		mUseOctree   = openOctree();
+	}
+	
+	if( !mAnimate ) { return; }
+	
+	// Swirl the points around the y-axis (every point changes, so the whole
+	// cloud is streamed to the next segment of the vertex buffer):
+	float  tAngle = 0.01f;
+	float  tCos   = cos( tAngle ), tSin = sin( tAngle );
+	size_t tCount = mPoints.size();
+	Vec3f* tPoints = mCloud.editPoints( 0, tCount );
+	parallelFor( tCount, [&](size_t iBegin, size_t iEnd) {
+		for(size_t i = iBegin; i < iEnd; i++) {
+			Vec3f& p = tPoints[ i ];
+			float  tSpeed = 1.0f - p.y * p.y;
+			float  tX = p.x * tCos - p.z * tSin * tSpeed;
+			p.z = p.x * tSin * tSpeed + p.z * tCos;
+			p.x = tX;
+			mPoints[ i ] = p;
+		}
+	} );
 }
 
 void GLPoints3dApp::draw()
@@ -70,6 +245,20 @@ void GLPoints3dApp::draw()
 	// Set color:
 	gl::color( Color( 1, 0, 0 ) );
 	
+	// Draw the large cloud, flying in and out over it:
+	if( mUseOctree ) {
+		float tTime   = getElapsedSeconds();
+		float tRadius = 1.4f + 1.1f * sin( tTime * 0.3f );
+		CameraPersp tCam;
+		tCam.setPerspective( 60, getWindowAspectRatio(), 0.01, 100 );
+		tCam.lookAt( Vec3f( cos( tTime * 0.2f ) * tRadius, 0.2f + 0.3f * tRadius, sin( tTime * 0.2f ) * tRadius ), Vec3f::zero() );
+		gl::setMatrices( tCam );
+		glPointSize( 1.0 );
+		mOctree.update( tCam, getWindowHeight() );
+		mOctree.draw();
+		return;
+	}
+	
 	// Set camera and matrices for 3D:
 	CameraPersp tCam;
 	tCam.setPerspective( 60, getWindowAspectRatio(), 1, 1000 );
@@ -79,8 +268,14 @@ void GLPoints3dApp::draw()
 	// Get point count:
 	size_t tPointCount = mPoints.size();
 	
-	// Set point display size:
-	glPointSize( 5.0 );
+	// Set point display size (smaller when there are many):
+	glPointSize( ( tPointCount > 100000 ) ? ( 1.0 ) : ( 5.0 ) );
+	
+	// Draw the points from the vertex buffer:
+	if( mUseCloud ) {
+		mCloud.draw();
+		return;
+	}
 	
 	// Prepare to draw the points:
 	glBegin(GL_POINTS);
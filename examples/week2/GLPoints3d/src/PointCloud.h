@@ -0,0 +1,371 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "cinder/Color.h"
+#include "cinder/Rand.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Vbo.h"
+
+#include "ParallelFor.h"
+
+// Drawing points with glBegin( GL_POINTS ) and one glVertex() call per point
+// sends every point through the driver, one function call at a time, every
+// frame. Client-side arrays (glVertexPointer() + glDrawArrays()) avoid the calls,
+// but still copy the whole array to the GPU every frame.
+//
+// A point cloud that lives in a vertex buffer object (VBO) is only sent when it
+// changes:
+//   - STATIC clouds are uploaded once. Edits mark a "dirty" range of points, and
+//     only that range is uploaded before the next draw.
+//   - STREAM clouds change every frame. Each frame's points are written to the
+//     next free "segment" of a larger buffer, so the GPU can still be drawing the
+//     previous frame's segment while we write the next one. When the buffer is
+//     full, its storage is "orphaned" (re-allocated with no data): the driver
+//     hands us fresh memory and frees the old memory once the GPU is done with it.
+//
+// (Newer GL versions can keep a buffer permanently mapped and use "fences" to
+// know when the GPU is done with a segment. The legacy GL 2.1 context doesn't
+// have these, and orphaning gets the same result without stalling.)
+//
+// Positions and colors are kept in separate arrays (colors are optional, and are
+// stored as four bytes instead of four floats), so a cloud with one color only
+// uploads its positions.
+//
+// The CPU-side work (filling the arrays, packing colors, and copying a frame into
+// the streaming ring) doesn't need GL, so runPointCloudBenchmark() can measure it
+// without a window.
+
+/** @brief hands out consecutive byte ranges of a fixed-size buffer, starting over (orphaning) when it's full */
+class StreamRing {
+public:
+	/** @brief constructor */
+	StreamRing() : mCapacity( 0 ), mOffset( 0 ) {}
+
+	/** @brief sets the buffer size (the next allocation orphans) */
+	void reset(const size_t& iCapacity)
+	{
+		mCapacity = iCapacity;
+		mOffset   = iCapacity;
+	}
+
+	/** @brief returns the offset of a range of iBytes, and whether the buffer had to be orphaned for it */
+	size_t allocate(const size_t& iBytes, bool& oOrphaned)
+	{
+		// Keep ranges 16-byte aligned (for the vertex pointers):
+		size_t tBytes = ( iBytes + 15 ) & ~static_cast<size_t>( 15 );
+		oOrphaned = ( mOffset + tBytes > mCapacity );
+		if( oOrphaned ) { mOffset = 0; }
+		size_t tOffset = mOffset;
+		mOffset += tBytes;
+		return tOffset;
+	}
+
+	/** @brief returns the buffer size */
+	size_t getCapacity() const { return mCapacity; }
+
+protected:
+	size_t	mCapacity;
+	size_t	mOffset;		//!< next free byte
+};
+
+/** @brief a set of 2D or 3D points (optionally colored) drawn from a vertex buffer */
+template<typename VecT>
+class PointCloud {
+public:
+	static const int kDims = sizeof( VecT ) / sizeof( float );
+
+	/** @brief how often the points change */
+	enum Usage { STATIC, STREAM };
+
+	/** @brief counters (since the last resetStats()) */
+	struct Stats
+	{
+		size_t	mDraws;
+		size_t	mPointsDrawn;
+		size_t	mUploads;				//!< buffer writes
+		size_t	mBytes;					//!< bytes uploaded
+		size_t	mOrphans;				//!< times the buffer storage was re-allocated
+
+		/** @brief default constructor */
+		Stats() : mDraws( 0 ), mPointsDrawn( 0 ), mUploads( 0 ), mBytes( 0 ), mOrphans( 0 ) {}
+	};
+
+	/** @brief constructor (for STREAM clouds, the number of frames the buffer holds before it is orphaned) */
+	explicit PointCloud(const Usage& iUsage = STATIC, const size_t& iSegments = 3) :
+		mUsage( iUsage ), mSegments( std::max<size_t>( iSegments, 1 ) ), mCapacity( 0 ),
+		mDirtyBegin( 0 ), mDirtyEnd( 0 ), mColorsDirty( false ), mPositionOffset( 0 ), mColorOffset( 0 ) {}
+
+	/** @brief replaces the points (keeping the colors if the count is unchanged) */
+	void setPoints(const std::vector<VecT>& iPoints)
+	{
+		if( iPoints.size() != mPoints.size() ) { mColors.clear(); }
+		mPoints = iPoints;
+		markDirty( 0, mPoints.size() );
+	}
+
+	/** @brief sets one color per point (or none, to draw with the current gl::color()) */
+	void setColors(const std::vector<ci::ColorA>& iColors)
+	{
+		if( iColors.empty() ) {
+			mColors.clear();
+			return;
+		}
+		mColors.resize( mPoints.size() );
+		size_t tCount = std::min( iColors.size(), mColors.size() );
+		parallelFor( tCount, [&](size_t iBegin, size_t iEnd) {
+			for(size_t i = iBegin; i < iEnd; i++) { mColors[ i ] = ci::ColorA8u( iColors[ i ] ); }
+		} );
+		mColorsDirty = true;
+		markDirty( 0, mPoints.size() );
+	}
+
+	/** @brief returns a range of points for editing (and marks it for upload) */
+	VecT* editPoints(const size_t& iBegin, const size_t& iCount)
+	{
+		markDirty( iBegin, iBegin + iCount );
+		return &mPoints[ iBegin ];
+	}
+
+	/** @brief returns a range of colors for editing (and marks it for upload; needs setColors() first) */
+	ci::ColorA8u* editColors(const size_t& iBegin, const size_t& iCount)
+	{
+		mColorsDirty = true;
+		markDirty( iBegin, iBegin + iCount );
+		return &mColors[ iBegin ];
+	}
+
+	/** @brief returns the points */
+	const std::vector<VecT>& getPoints() const { return mPoints; }
+
+	/** @brief returns the number of points */
+	size_t size() const { return mPoints.size(); }
+
+	/** @brief returns whether the points have colors */
+	bool hasColors() const { return !mColors.empty(); }
+
+	/** @brief returns the number of bytes a frame of points takes */
+	size_t getFrameBytes() const
+	{
+		return mPoints.size() * sizeof( VecT ) + mColors.size() * sizeof( ci::ColorA8u );
+	}
+
+	/** @brief uploads any changes and draws the points */
+	void draw()
+	{
+		if( mPoints.empty() ) { return; }
+		upload();
+
+		mBuffer.bind();
+		const char* tBase = NULL;
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glVertexPointer( kDims, GL_FLOAT, 0, tBase + mPositionOffset );
+		if( hasColors() ) {
+			glEnableClientState( GL_COLOR_ARRAY );
+			glColorPointer( 4, GL_UNSIGNED_BYTE, 0, tBase + mColorOffset );
+		}
+		glDrawArrays( GL_POINTS, 0, static_cast<GLsizei>( mPoints.size() ) );
+		if( hasColors() ) { glDisableClientState( GL_COLOR_ARRAY ); }
+		glDisableClientState( GL_VERTEX_ARRAY );
+		mBuffer.unbind();
+
+		mStats.mDraws++;
+		mStats.mPointsDrawn += mPoints.size();
+	}
+
+	/** @brief returns the counters */
+	const Stats& getStats() const { return mStats; }
+
+	/** @brief resets the counters */
+	void resetStats() { mStats = Stats(); }
+
+	/** @brief copies a frame (positions, then colors) to a destination and returns the colors' offset from it */
+	size_t writeFrame(char* oDestination) const
+	{
+		size_t tPositionBytes = mPoints.size() * sizeof( VecT );
+		copyBytes( oDestination, reinterpret_cast<const char*>( &mPoints[ 0 ] ), tPositionBytes );
+		if( hasColors() ) {
+			copyBytes( oDestination + tPositionBytes, reinterpret_cast<const char*>( &mColors[ 0 ] ), mColors.size() * sizeof( ci::ColorA8u ) );
+		}
+		return tPositionBytes;
+	}
+
+	/** @brief copies bytes on several threads (large copies are limited by one core's bandwidth) */
+	static void copyBytes(char* oDestination, const char* iSource, const size_t& iBytes)
+	{
+		if( iBytes < ( 1 << 20 ) ) {
+			std::memcpy( oDestination, iSource, iBytes );
+			return;
+		}
+		const size_t tBlock = 1 << 16;
+		parallelFor( ( iBytes + tBlock - 1 ) / tBlock, [&](size_t iBegin, size_t iEnd) {
+			size_t tStart = iBegin * tBlock;
+			size_t tEnd   = std::min( iEnd * tBlock, iBytes );
+			std::memcpy( oDestination + tStart, iSource + tStart, tEnd - tStart );
+		} );
+	}
+
+protected:
+	/** @brief widens the range of points to upload */
+	void markDirty(const size_t& iBegin, const size_t& iEnd)
+	{
+		if( mDirtyBegin >= mDirtyEnd ) {
+			mDirtyBegin = iBegin;
+			mDirtyEnd   = iEnd;
+		}
+		else {
+			mDirtyBegin = std::min( mDirtyBegin, iBegin );
+			mDirtyEnd   = std::max( mDirtyEnd, iEnd );
+		}
+		mDirtyEnd = std::min( mDirtyEnd, mPoints.size() );
+	}
+
+	/** @brief sends the dirty points to the buffer */
+	void upload()
+	{
+		bool   tEverything = ( mDirtyBegin == 0 && mDirtyEnd == mPoints.size() );
+		size_t tFrameBytes = getFrameBytes();
+		if( !mBuffer ) { mBuffer = ci::gl::Vbo( GL_ARRAY_BUFFER ); }
+		mBuffer.bind();
+
+		if( mUsage == STREAM ) {
+			// Each change goes to the next segment (the whole frame, since it's all new):
+			if( mDirtyBegin < mDirtyEnd || mCapacity == 0 ) {
+				if( mRing.getCapacity() < tFrameBytes + 16 || mCapacity != mPoints.size() ) {
+					mRing.reset( ( tFrameBytes + 16 ) * mSegments );
+					mCapacity = mPoints.size();
+				}
+				bool tOrphaned;
+				mPositionOffset = mRing.allocate( tFrameBytes, tOrphaned );
+				if( tOrphaned ) {
+					mBuffer.bufferData( mRing.getCapacity(), NULL, GL_STREAM_DRAW );
+					mStats.mOrphans++;
+				}
+				mBuffer.bufferSubData( mPositionOffset, mPoints.size() * sizeof( VecT ), &mPoints[ 0 ] );
+				mColorOffset = mPositionOffset + mPoints.size() * sizeof( VecT );
+				if( hasColors() ) {
+					mBuffer.bufferSubData( mColorOffset, mColors.size() * sizeof( ci::ColorA8u ), &mColors[ 0 ] );
+				}
+				mStats.mUploads++;
+				mStats.mBytes += tFrameBytes;
+			}
+		}
+		else if( mCapacity != mPoints.size() || ( tEverything && mColorsDirty ) ) {
+			// New size (or all new data): re-allocate and upload everything:
+			mBuffer.bufferData( tFrameBytes, NULL, GL_STATIC_DRAW );
+			mBuffer.bufferSubData( 0, mPoints.size() * sizeof( VecT ), &mPoints[ 0 ] );
+			mPositionOffset = 0;
+			mColorOffset    = mPoints.size() * sizeof( VecT );
+			if( hasColors() ) {
+				mBuffer.bufferSubData( mColorOffset, mColors.size() * sizeof( ci::ColorA8u ), &mColors[ 0 ] );
+			}
+			if( mCapacity != 0 ) { mStats.mOrphans++; }
+			mCapacity = mPoints.size();
+			mStats.mUploads++;
+			mStats.mBytes += tFrameBytes;
+		}
+		else if( mDirtyBegin < mDirtyEnd ) {
+			// Only the edited range:
+			size_t tCount = mDirtyEnd - mDirtyBegin;
+			if( tEverything ) {
+				// (Orphan first, so we don't wait for the GPU to finish with the old points.)
+				mBuffer.bufferData( tFrameBytes, NULL, GL_STATIC_DRAW );
+				mStats.mOrphans++;
+			}
+			mBuffer.bufferSubData( mPositionOffset + mDirtyBegin * sizeof( VecT ), tCount * sizeof( VecT ), &mPoints[ mDirtyBegin ] );
+			mStats.mBytes += tCount * sizeof( VecT );
+			if( hasColors() && ( mColorsDirty || tEverything ) ) {
+				mBuffer.bufferSubData( mColorOffset + mDirtyBegin * sizeof( ci::ColorA8u ), tCount * sizeof( ci::ColorA8u ), &mColors[ mDirtyBegin ] );
+				mStats.mBytes += tCount * sizeof( ci::ColorA8u );
+			}
+			mStats.mUploads++;
+		}
+
+		mBuffer.unbind();
+		mDirtyBegin  = 0;
+		mDirtyEnd    = 0;
+		mColorsDirty = false;
+	}
+
+	Usage						mUsage;
+	size_t						mSegments;			//!< frames per streaming buffer
+	size_t						mCapacity;			//!< number of points the buffer was laid out for
+	std::vector<VecT>			mPoints;
+	std::vector<ci::ColorA8u>	mColors;
+	size_t						mDirtyBegin;		//!< range of points changed since the last upload
+	size_t						mDirtyEnd;
+	bool						mColorsDirty;
+	size_t						mPositionOffset;	//!< byte offsets of the last upload in the buffer
+	size_t						mColorOffset;
+	StreamRing					mRing;
+	ci::gl::Vbo					mBuffer;
+	Stats						mStats;
+};
+
+/** @brief measures the CPU side of streaming a large point cloud every frame (no GL needed) */
+static void runPointCloudBenchmark(const size_t& iPointCount = 10000000, const size_t& iFrames = 10)
+{
+	using namespace ci;
+	typedef std::chrono::high_resolution_clock Clock;
+
+	PointCloud<Vec3f> tCloud( PointCloud<Vec3f>::STREAM );
+	Rand tRand( 1234 );
+	std::vector<Vec3f> tPoints( iPointCount );
+	for(size_t i = 0; i < iPointCount; i++) { tPoints[ i ] = tRand.nextVec3f(); }
+	tCloud.setPoints( tPoints );
+
+	// A host-memory ring the size of the GL one, standing in for the driver's copy:
+	StreamRing        tRing;
+	std::vector<char> tStorage;
+	size_t            tOrphans = 0;
+
+	double tAnimateMs = 0.0, tCopyMs = 0.0;
+	for(size_t f = 0; f < iFrames; f++) {
+		// Move every point a little (the "simulation" that makes the frame new):
+		Clock::time_point tStart = Clock::now();
+		float tOffset = 0.001f * ( ( f % 2 ) ? ( 1.0f ) : ( -1.0f ) );
+		Vec3f* tEdit = tCloud.editPoints( 0, iPointCount );
+		parallelFor( iPointCount, [&](size_t iBegin, size_t iEnd) {
+			for(size_t i = iBegin; i < iEnd; i++) { tEdit[ i ].y += tOffset; }
+		} );
+		Clock::time_point tMid = Clock::now();
+
+		// Write the frame to the next ring segment:
+		size_t tFrameBytes = tCloud.getFrameBytes();
+		if( tRing.getCapacity() < tFrameBytes + 16 ) {
+			tRing.reset( ( tFrameBytes + 16 ) * 3 );
+			tStorage.resize( tRing.getCapacity() );
+		}
+		bool   tOrphaned;
+		size_t tOffsetBytes = tRing.allocate( tFrameBytes, tOrphaned );
+		if( tOrphaned ) { tOrphans++; }
+		tCloud.writeFrame( &tStorage[ tOffsetBytes ] );
+		Clock::time_point tEnd = Clock::now();
+
+		tAnimateMs += std::chrono::duration<double, std::milli>( tMid - tStart ).count();
+		tCopyMs    += std::chrono::duration<double, std::milli>( tEnd - tMid ).count();
+	}
+
+	double tFrameMs = ( tAnimateMs + tCopyMs ) / iFrames;
+	double tBytes   = static_cast<double>( tCloud.getFrameBytes() );
+	std::cout << "Point cloud benchmark: " << iPointCount << " points, " << tBytes / ( 1 << 20 ) << " MB/frame, "
+		<< iFrames << " frames (" << tOrphans << " orphans)" << std::endl;
+	std::cout << "  update:   " << tAnimateMs / iFrames << " ms/frame" << std::endl;
+	std::cout << "  stream:   " << tCopyMs / iFrames << " ms/frame (" << tBytes / ( tCopyMs / iFrames ) / 1.0e6 << " GB/s)" << std::endl;
+	std::cout << "  total:    " << tFrameMs << " ms/frame (" << iPointCount / tFrameMs / 1000.0 << " M points/s)" << std::endl;
+}
@@ -0,0 +1,610 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cinder/Camera.h"
+#include "cinder/Color.h"
+#include "cinder/CinderMath.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Vbo.h"
+
+#include "FrustumCuller.h"
+
+// Drawing every point of a cloud every frame stops working somewhere in the
+// millions of points, and a cloud with billions of points doesn't even fit in
+// memory. But from far away, most of those points land on the same few pixels:
+// a much smaller, evenly spread sample of them looks the same.
+//
+// A "level of detail" (LOD) octree stores the cloud as a tree of boxes:
+//   - the root box holds a coarse sample of the whole cloud (one point per cell
+//     of a small grid over the box),
+//   - each of its eight child boxes holds a finer sample of the points in that
+//     eighth that weren't used yet, and so on,
+//   - until a box has few enough points left to keep them all.
+// Drawing a node together with all of its ancestors gives that region at the
+// node's level of detail (the levels add up, nothing is stored twice).
+//
+// Each frame, nodes are picked from the root down. A node's "screen-space error"
+// is how many pixels apart its points appear (its point spacing, scaled by its
+// distance from the camera): if that's more than a threshold, its children are
+// worth drawing too. Nodes outside the camera's view are skipped, and the
+// closest / coarsest nodes are picked first until a point budget is used up.
+//
+// The tree lives in a file: a header, each node's points as one "chunk", and a
+// table of nodes (bounds, spacing, point count, chunk offset, children) at the
+// end. Opening a file only reads the table. A background thread reads the chunks
+// of the nodes that were picked (most important first), and the main thread
+// uploads a few of them to vertex buffers each frame. Nodes that haven't been
+// used for a while are dropped once a memory budget is reached, so memory use
+// stays bounded no matter how large the file is.
+
+/** @brief the start of an octree file */
+struct PointOctreeHeader
+{
+	char		mMagic[ 4 ];			//!< "POCT"
+	uint32_t	mVersion;
+	uint32_t	mNodeCount;
+	uint32_t	mMaxDepth;
+	uint64_t	mPointCount;
+	uint64_t	mNodeTableOffset;		//!< where the node table starts
+};
+
+/** @brief a node, as stored in the node table */
+struct PointOctreeNode
+{
+	float		mMin[ 3 ];				//!< bounds
+	float		mMax[ 3 ];
+	float		mSpacing;				//!< typical distance between the node's points
+	uint32_t	mPointCount;
+	uint64_t	mOffset;				//!< where the node's chunk starts (positions, then colors)
+	int32_t		mChildren[ 8 ];			//!< child node indices (-1 for none)
+
+	/** @brief returns the center of the bounds */
+	ci::Vec3f getCenter() const { return ci::Vec3f( mMin[ 0 ] + mMax[ 0 ], mMin[ 1 ] + mMax[ 1 ], mMin[ 2 ] + mMax[ 2 ] ) * 0.5f; }
+
+	/** @brief returns half the size of the bounds */
+	ci::Vec3f getHalfSize() const { return ci::Vec3f( mMax[ 0 ] - mMin[ 0 ], mMax[ 1 ] - mMin[ 1 ], mMax[ 2 ] - mMin[ 2 ] ) * 0.5f; }
+
+	/** @brief returns the size of a node's chunk */
+	size_t getChunkBytes() const { return mPointCount * ( sizeof( ci::Vec3f ) + sizeof( ci::ColorA8u ) ); }
+};
+
+/** @brief writes a point cloud to an octree file */
+class PointOctreeBuilder {
+public:
+	/** @brief build counters */
+	struct Stats
+	{
+		size_t	mNodes;
+		size_t	mLeaves;
+		size_t	mMaxDepth;
+		double	mBuildMs;
+
+		/** @brief default constructor */
+		Stats() : mNodes( 0 ), mLeaves( 0 ), mMaxDepth( 0 ), mBuildMs( 0.0 ) {}
+	};
+
+	/** @brief constructor (points per node, and the depth at which nodes keep all of their points) */
+	explicit PointOctreeBuilder(const size_t& iNodePoints = 16384, const int& iMaxDepth = 16) :
+		mNodePoints( std::max<size_t>( iNodePoints, 64 ) ), mMaxDepth( iMaxDepth ), mPoints( NULL ), mColors( NULL ) {}
+
+	/** @brief writes the points (and one color per point) to a file; returns false if the file can't be written */
+	bool build(const std::vector<ci::Vec3f>& iPoints, const std::vector<ci::ColorA8u>& iColors, const std::string& iPath)
+	{
+		std::chrono::high_resolution_clock::time_point tStart = std::chrono::high_resolution_clock::now();
+		mStats  = Stats();
+		mPoints = &iPoints;
+		mColors = &iColors;
+		mNodes.clear();
+
+		mFile.open( iPath.c_str(), std::ios::binary | std::ios::trunc );
+		if( !mFile ) { return false; }
+
+		// Header (rewritten at the end, with the node table's offset):
+		PointOctreeHeader tHeader;
+		std::memset( &tHeader, 0, sizeof( tHeader ) );
+		std::memcpy( tHeader.mMagic, "POCT", 4 );
+		tHeader.mVersion    = 1;
+		tHeader.mPointCount = iPoints.size();
+		mFile.write( reinterpret_cast<const char*>( &tHeader ), sizeof( tHeader ) );
+
+		// Bounds (a cube, so that child cells stay cubes):
+		ci::Vec3f tMin( FLT_MAX, FLT_MAX, FLT_MAX ), tMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+		for(size_t i = 0; i < iPoints.size(); i++) {
+			const ci::Vec3f& p = iPoints[ i ];
+			tMin = ci::Vec3f( std::min( tMin.x, p.x ), std::min( tMin.y, p.y ), std::min( tMin.z, p.z ) );
+			tMax = ci::Vec3f( std::max( tMax.x, p.x ), std::max( tMax.y, p.y ), std::max( tMax.z, p.z ) );
+		}
+		float     tSize   = std::max( std::max( tMax.x - tMin.x, tMax.y - tMin.y ), std::max( tMax.z - tMin.z, 1.0e-6f ) ) * 1.0001f;
+		ci::Vec3f tCenter = ( tMin + tMax ) * 0.5f;
+		tMin = tCenter - ci::Vec3f( tSize, tSize, tSize ) * 0.5f;
+
+		// Nodes:
+		std::vector<uint32_t> tIndices( iPoints.size() );
+		for(size_t i = 0; i < tIndices.size(); i++) { tIndices[ i ] = static_cast<uint32_t>( i ); }
+		mScratch.resize( tIndices.size() );
+		if( !tIndices.empty() ) { buildNode( tIndices, 0, tIndices.size(), tMin, tSize, 0 ); }
+
+		// Node table:
+		tHeader.mNodeCount       = static_cast<uint32_t>( mNodes.size() );
+		tHeader.mMaxDepth        = static_cast<uint32_t>( mStats.mMaxDepth );
+		tHeader.mNodeTableOffset = static_cast<uint64_t>( mFile.tellp() );
+		if( !mNodes.empty() ) { mFile.write( reinterpret_cast<const char*>( &mNodes[ 0 ] ), mNodes.size() * sizeof( PointOctreeNode ) ); }
+		mFile.seekp( 0 );
+		mFile.write( reinterpret_cast<const char*>( &tHeader ), sizeof( tHeader ) );
+		bool tGood = mFile.good();
+		mFile.close();
+
+		std::vector<uint32_t>().swap( mScratch );
+		mStats.mNodes   = mNodes.size();
+		mStats.mBuildMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - tStart ).count();
+		return tGood;
+	}
+
+	/** @brief returns the counters of the last build */
+	const Stats& getStats() const { return mStats; }
+
+protected:
+	/** @brief writes the node for the points iIndices[ iBegin, iEnd ) in a cube, and (recursively) its children; returns its index */
+	int32_t buildNode(std::vector<uint32_t>& ioIndices, const size_t& iBegin, const size_t& iEnd, const ci::Vec3f& iMin, const float& iSize, const size_t& iDepth)
+	{
+		const std::vector<ci::Vec3f>& tPoints = *mPoints;
+		size_t tCount = iEnd - iBegin;
+		int32_t tIndex = static_cast<int32_t>( mNodes.size() );
+		mNodes.push_back( PointOctreeNode() );
+		mStats.mMaxDepth = std::max( mStats.mMaxDepth, iDepth );
+
+		PointOctreeNode tNode;
+		for(int a = 0; a < 3; a++) {
+			tNode.mMin[ a ] = iMin[ a ];
+			tNode.mMax[ a ] = iMin[ a ] + iSize;
+		}
+		for(int c = 0; c < 8; c++) { tNode.mChildren[ c ] = -1; }
+
+		size_t tKept;
+		if( tCount <= mNodePoints || static_cast<int>( iDepth ) >= mMaxDepth ) {
+			// Leaf: keep everything:
+			tKept = tCount;
+			tNode.mSpacing = iSize / std::max( std::pow( static_cast<float>( tCount ), 1.0f / 3.0f ), 1.0f );
+			mStats.mLeaves++;
+		}
+		else {
+			// Keep the first point in each cell of a grid over the node (moving them to the front):
+			int   tRes      = std::max( 2, static_cast<int>( std::pow( static_cast<float>( mNodePoints ), 1.0f / 3.0f ) ) );
+			float tCellSize = iSize / tRes;
+			std::vector<bool> tTaken( tRes * tRes * tRes, false );
+			size_t tFront = iBegin, tBack = iEnd;
+			for(size_t i = iBegin; i < iEnd; i++) {
+				const ci::Vec3f& p = tPoints[ ioIndices[ i ] ];
+				int tCell = 0;
+				for(int a = 2; a >= 0; a--) {
+					int tC = std::min( std::max( static_cast<int>( ( p[ a ] - iMin[ a ] ) / tCellSize ), 0 ), tRes - 1 );
+					tCell = tCell * tRes + tC;
+				}
+				if( !tTaken[ tCell ] ) {
+					tTaken[ tCell ] = true;
+					mScratch[ tFront++ ] = ioIndices[ i ];
+				}
+				else {
+					mScratch[ --tBack ] = ioIndices[ i ];
+				}
+			}
+			std::copy( mScratch.begin() + iBegin, mScratch.begin() + iEnd, ioIndices.begin() + iBegin );
+			tKept = tFront - iBegin;
+			tNode.mSpacing = tCellSize;
+		}
+
+		// The node's chunk:
+		writeChunk( ioIndices, iBegin, iBegin + tKept, tNode );
+		mNodes[ tIndex ] = tNode;
+
+		if( tKept < tCount ) {
+			// Sort the rest into octants (a counting sort on the octant number):
+			float     tHalf = iSize * 0.5f;
+			ci::Vec3f tMid  = iMin + ci::Vec3f( tHalf, tHalf, tHalf );
+			size_t    tStart = iBegin + tKept;
+			size_t    tCounts[ 9 ] = { 0 };
+			for(size_t i = tStart; i < iEnd; i++) { tCounts[ octantOf( tPoints[ ioIndices[ i ] ], tMid ) + 1 ]++; }
+			for(int o = 1; o < 9; o++) { tCounts[ o ] += tCounts[ o - 1 ]; }
+			size_t tNext[ 8 ];
+			for(int o = 0; o < 8; o++) { tNext[ o ] = tStart + tCounts[ o ]; }
+			for(size_t i = tStart; i < iEnd; i++) { mScratch[ tNext[ octantOf( tPoints[ ioIndices[ i ] ], tMid ) ]++ ] = ioIndices[ i ]; }
+			std::copy( mScratch.begin() + tStart, mScratch.begin() + iEnd, ioIndices.begin() + tStart );
+
+			for(int o = 0; o < 8; o++) {
+				size_t tChildBegin = tStart + tCounts[ o ], tChildEnd = tStart + tCounts[ o + 1 ];
+				if( tChildBegin == tChildEnd ) { continue; }
+				ci::Vec3f tChildMin( ( o & 1 ) ? ( tMid.x ) : ( iMin.x ), ( o & 2 ) ? ( tMid.y ) : ( iMin.y ), ( o & 4 ) ? ( tMid.z ) : ( iMin.z ) );
+				int32_t tChild = buildNode( ioIndices, tChildBegin, tChildEnd, tChildMin, tHalf, iDepth + 1 );
+				mNodes[ tIndex ].mChildren[ o ] = tChild;
+			}
+		}
+		return tIndex;
+	}
+
+	/** @brief writes a node's points (positions, then colors) */
+	void writeChunk(const std::vector<uint32_t>& iIndices, const size_t& iBegin, const size_t& iEnd, PointOctreeNode& ioNode)
+	{
+		size_t tCount = iEnd - iBegin;
+		ioNode.mPointCount = static_cast<uint32_t>( tCount );
+		ioNode.mOffset     = static_cast<uint64_t>( mFile.tellp() );
+
+		std::vector<ci::Vec3f>    tPositions( tCount );
+		std::vector<ci::ColorA8u> tColors( tCount, ci::ColorA8u( 255, 255, 255, 255 ) );
+		for(size_t i = 0; i < tCount; i++) {
+			uint32_t tId = iIndices[ iBegin + i ];
+			tPositions[ i ] = ( *mPoints )[ tId ];
+			if( tId < mColors->size() ) { tColors[ i ] = ( *mColors )[ tId ]; }
+		}
+		if( tCount ) {
+			mFile.write( reinterpret_cast<const char*>( &tPositions[ 0 ] ), tCount * sizeof( ci::Vec3f ) );
+			mFile.write( reinterpret_cast<const char*>( &tColors[ 0 ] ), tCount * sizeof( ci::ColorA8u ) );
+		}
+	}
+
+	/** @brief returns the octant (bit 0: x, bit 1: y, bit 2: z) of a point relative to a node's center */
+	static int octantOf(const ci::Vec3f& iPoint, const ci::Vec3f& iMid)
+	{
+		return ( ( iPoint.x >= iMid.x ) ? ( 1 ) : ( 0 ) ) | ( ( iPoint.y >= iMid.y ) ? ( 2 ) : ( 0 ) ) | ( ( iPoint.z >= iMid.z ) ? ( 4 ) : ( 0 ) );
+	}
+
+	size_t								mNodePoints;
+	int									mMaxDepth;
+	const std::vector<ci::Vec3f>*		mPoints;
+	const std::vector<ci::ColorA8u>*	mColors;
+	std::vector<uint32_t>				mScratch;
+	std::vector<PointOctreeNode>		mNodes;
+	std::ofstream						mFile;
+	Stats								mStats;
+};
+
+/** @brief draws a point cloud from an octree file, loading the nodes it needs in the background */
+class PointOctree {
+public:
+	/** @brief per-frame counters */
+	struct Stats
+	{
+		size_t	mNodes;					//!< in the file
+		size_t	mSelectedNodes;			//!< picked this frame
+		size_t	mDrawnNodes;			//!< picked and loaded
+		size_t	mPointsDrawn;
+		size_t	mResidentNodes;			//!< in vertex buffers
+		size_t	mResidentBytes;
+		size_t	mPendingLoads;			//!< waiting for the loader
+		size_t	mUploads;				//!< this frame
+		size_t	mEvictions;				//!< this frame
+
+		/** @brief default constructor */
+		Stats() : mNodes( 0 ), mSelectedNodes( 0 ), mDrawnNodes( 0 ), mPointsDrawn( 0 ), mResidentNodes( 0 ), mResidentBytes( 0 ),
+			mPendingLoads( 0 ), mUploads( 0 ), mEvictions( 0 ) {}
+	};
+
+	/** @brief constructor */
+	PointOctree() :
+		mPointBudget( 2000000 ), mMemoryBudget( 256 << 20 ), mErrorThreshold( 1.5f ), mUploadsPerFrame( 8 ),
+		mFrame( 0 ), mResidentBytes( 0 ), mQuit( false ) {}
+
+	/** @brief destructor (stops the loader) */
+	~PointOctree()
+	{
+		close();
+	}
+
+	/** @brief opens an octree file (reading only its node table); returns false if it isn't one */
+	bool open(const std::string& iPath)
+	{
+		close();
+		std::ifstream tFile( iPath.c_str(), std::ios::binary );
+		PointOctreeHeader tHeader;
+		if( !tFile.read( reinterpret_cast<char*>( &tHeader ), sizeof( tHeader ) ) ) { return false; }
+		if( std::memcmp( tHeader.mMagic, "POCT", 4 ) != 0 || tHeader.mVersion != 1 ) { return false; }
+
+		mNodes.resize( tHeader.mNodeCount );
+		tFile.seekg( static_cast<std::streamoff>( tHeader.mNodeTableOffset ) );
+		if( !mNodes.empty() && !tFile.read( reinterpret_cast<char*>( &mNodes[ 0 ] ), mNodes.size() * sizeof( PointOctreeNode ) ) ) {
+			mNodes.clear();
+			return false;
+		}
+		mStates.assign( mNodes.size(), NodeState() );
+		mLoading.assign( mNodes.size(), 0 );
+		mPath          = iPath;
+		mResidentBytes = 0;
+		mQuit          = false;
+		mLoader        = std::thread( &PointOctree::loaderLoop, this );
+		return true;
+	}
+
+	/** @brief stops the loader and frees everything */
+	void close()
+	{
+		if( mLoader.joinable() ) {
+			{
+				std::lock_guard<std::mutex> tLock( mMutex );
+				mQuit = true;
+			}
+			mCondition.notify_all();
+			mLoader.join();
+		}
+		mRequests.clear();
+		mCompleted.clear();
+		mNodes.clear();
+		mStates.clear();
+		mLoading.clear();
+		mSelected.clear();
+		mResidentBytes = 0;
+	}
+
+	/** @brief returns whether a file is open */
+	bool isOpen() const { return !mNodes.empty(); }
+
+	/** @brief sets the most points drawn per frame */
+	void setPointBudget(const size_t& iPoints) { mPointBudget = iPoints; }
+
+	/** @brief sets the most bytes kept in vertex buffers (should be well above the point budget's 16 bytes per point) */
+	void setMemoryBudget(const size_t& iBytes) { mMemoryBudget = iBytes; }
+
+	/** @brief sets the largest spacing (in pixels) between points before a node's children are drawn */
+	void setErrorThreshold(const float& iPixels) { mErrorThreshold = std::max( iPixels, 0.01f ); }
+
+	/** @brief sets how many loaded nodes are uploaded per frame */
+	void setUploadsPerFrame(const size_t& iUploads) { mUploadsPerFrame = std::max<size_t>( iUploads, 1 ); }
+
+	/** @brief picks the nodes to draw for a camera (and a viewport height in pixels), and uploads loaded nodes */
+	void update(const ci::CameraPersp& iCam, const float& iViewportHeight)
+	{
+		// Pixels per unit at distance 1:
+		float tProjScale = iViewportHeight / ( 2.0f * std::tan( ci::toRadians( iCam.getFov() ) * 0.5f ) );
+		select( Frustum( iCam ), iCam.getEyePoint(), tProjScale );
+		uploadCompleted();
+		evict();
+	}
+
+	/** @brief picks the nodes to draw (closest / coarsest first) and asks the loader for the missing ones */
+	void select(const Frustum& iFrustum, const ci::Vec3f& iEye, const float& iProjScale)
+	{
+		mFrame++;
+		mStats = Stats();
+		mStats.mNodes = mNodes.size();
+		mSelected.clear();
+		if( mNodes.empty() ) { return; }
+
+		typedef std::pair<float, uint32_t> Candidate;
+		std::priority_queue<Candidate> tQueue;
+		std::vector<Candidate>         tRequests;
+		tQueue.push( Candidate( FLT_MAX, 0 ) );
+		size_t tPoints = 0;
+		while( !tQueue.empty() ) {
+			Candidate tTop = tQueue.top();
+			tQueue.pop();
+			const PointOctreeNode& tNode = mNodes[ tTop.second ];
+			if( !iFrustum.containsBox( tNode.getCenter(), tNode.getHalfSize() ) ) { continue; }
+			if( tPoints + tNode.mPointCount > mPointBudget ) { break; }
+
+			tPoints += tNode.mPointCount;
+			mSelected.push_back( tTop.second );
+			NodeState& tState = mStates[ tTop.second ];
+			tState.mLastUsed = mFrame;
+			if( tState.mStatus == UNLOADED || tState.mStatus == QUEUED ) { tRequests.push_back( tTop ); }
+
+			// Refine when the node's points are too far apart on screen:
+			float tError = projectedSpacing( tNode, iEye, iProjScale );
+			if( tError <= mErrorThreshold ) { continue; }
+			for(int c = 0; c < 8; c++) {
+				int32_t tChild = tNode.mChildren[ c ];
+				if( tChild >= 0 ) { tQueue.push( Candidate( projectedSpacing( mNodes[ tChild ], iEye, iProjScale ), static_cast<uint32_t>( tChild ) ) ); }
+			}
+		}
+
+		mStats.mSelectedNodes = mSelected.size();
+
+		// Replace the loader's queue (most important first; nodes no longer wanted go back to unloaded):
+		std::sort( tRequests.begin(), tRequests.end(), std::greater<Candidate>() );
+		{
+			std::lock_guard<std::mutex> tLock( mMutex );
+			for(std::deque<uint32_t>::iterator it = mRequests.begin(); it != mRequests.end(); it++) { mStates[ *it ].mStatus = UNLOADED; }
+			mRequests.clear();
+			for(size_t i = 0; i < tRequests.size(); i++) {
+				// (Nodes the loader is already reading stay queued until they arrive.)
+				mStates[ tRequests[ i ].second ].mStatus = QUEUED;
+				if( !mLoading[ tRequests[ i ].second ] ) { mRequests.push_back( tRequests[ i ].second ); }
+			}
+			mStats.mPendingLoads = mRequests.size();
+		}
+		mCondition.notify_all();
+	}
+
+	/** @brief uploads up to the per-frame number of loaded nodes to vertex buffers */
+	void uploadCompleted()
+	{
+		for(size_t n = 0; n < mUploadsPerFrame; n++) {
+			LoadedChunk tChunk;
+			{
+				std::lock_guard<std::mutex> tLock( mMutex );
+				if( mCompleted.empty() ) { break; }
+				tChunk.mNode = mCompleted.front().mNode;
+				tChunk.mData.swap( mCompleted.front().mData );
+				mCompleted.pop_front();
+				mLoading[ tChunk.mNode ] = 0;
+			}
+			mCondition.notify_all();
+
+			NodeState& tState = mStates[ tChunk.mNode ];
+			if( tChunk.mData.empty() ) {
+				// (The read failed; try again later.)
+				tState.mStatus = UNLOADED;
+				continue;
+			}
+			tState.mBuffer = ci::gl::Vbo( GL_ARRAY_BUFFER );
+			tState.mBuffer.bind();
+			tState.mBuffer.bufferData( tChunk.mData.size(), &tChunk.mData[ 0 ], GL_STATIC_DRAW );
+			tState.mBuffer.unbind();
+			tState.mStatus = RESIDENT;
+			mResidentBytes += tChunk.mData.size();
+			mStats.mUploads++;
+		}
+	}
+
+	/** @brief drops the least recently used nodes until the vertex buffers fit the memory budget */
+	void evict()
+	{
+		std::vector<std::pair<uint64_t, uint32_t> > tCandidates;
+		size_t tResident = 0;
+		for(size_t i = 0; i < mStates.size(); i++) {
+			if( mStates[ i ].mStatus != RESIDENT ) { continue; }
+			tResident++;
+			if( mStates[ i ].mLastUsed != mFrame ) { tCandidates.push_back( std::make_pair( mStates[ i ].mLastUsed, static_cast<uint32_t>( i ) ) ); }
+		}
+		if( mResidentBytes > mMemoryBudget ) {
+			std::sort( tCandidates.begin(), tCandidates.end() );
+			for(size_t i = 0; i < tCandidates.size() && mResidentBytes > mMemoryBudget; i++) {
+				NodeState& tState = mStates[ tCandidates[ i ].second ];
+				tState.mBuffer = ci::gl::Vbo();
+				tState.mStatus = UNLOADED;
+				mResidentBytes -= mNodes[ tCandidates[ i ].second ].getChunkBytes();
+				mStats.mEvictions++;
+				tResident--;
+			}
+		}
+		mStats.mResidentNodes = tResident;
+		mStats.mResidentBytes = mResidentBytes;
+	}
+
+	/** @brief draws the picked nodes that are loaded */
+	void draw()
+	{
+		const char* tBase = NULL;
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+		for(size_t i = 0; i < mSelected.size(); i++) {
+			NodeState& tState = mStates[ mSelected[ i ] ];
+			if( tState.mStatus != RESIDENT ) { continue; }
+			const PointOctreeNode& tNode = mNodes[ mSelected[ i ] ];
+			tState.mBuffer.bind();
+			glVertexPointer( 3, GL_FLOAT, 0, tBase );
+			glColorPointer( 4, GL_UNSIGNED_BYTE, 0, tBase + tNode.mPointCount * sizeof( ci::Vec3f ) );
+			glDrawArrays( GL_POINTS, 0, static_cast<GLsizei>( tNode.mPointCount ) );
+			tState.mBuffer.unbind();
+			mStats.mDrawnNodes++;
+			mStats.mPointsDrawn += tNode.mPointCount;
+		}
+		glDisableClientState( GL_COLOR_ARRAY );
+		glDisableClientState( GL_VERTEX_ARRAY );
+	}
+
+	/** @brief returns the counters for the current frame */
+	const Stats& getStats() const { return mStats; }
+
+	/** @brief returns the nodes picked by the last select() */
+	const std::vector<uint32_t>& getSelectedNodes() const { return mSelected; }
+
+	/** @brief returns whether a node is in a vertex buffer */
+	bool isResident(const uint32_t& iNode) const { return mStates[ iNode ].mStatus == RESIDENT; }
+
+protected:
+	enum NodeStatus { UNLOADED, QUEUED, RESIDENT };
+
+	static const size_t kMaxCompleted = 16;		//!< chunks the loader reads ahead of the uploads
+
+	/** @brief a node's loading state (only used by the main thread) */
+	struct NodeState
+	{
+		NodeStatus	mStatus;
+		uint64_t	mLastUsed;			//!< last frame the node was picked
+		ci::gl::Vbo	mBuffer;
+
+		/** @brief default constructor */
+		NodeState() : mStatus( UNLOADED ), mLastUsed( 0 ) {}
+	};
+
+	/** @brief a node's chunk, read by the loader */
+	struct LoadedChunk
+	{
+		uint32_t			mNode;
+		std::vector<char>	mData;
+	};
+
+	/** @brief returns how far apart (in pixels) a node's points appear */
+	float projectedSpacing(const PointOctreeNode& iNode, const ci::Vec3f& iEye, const float& iProjScale) const
+	{
+		ci::Vec3f tHalf     = iNode.getHalfSize();
+		float     tDistance = ( iNode.getCenter() - iEye ).length() - tHalf.length();
+		return iNode.mSpacing * iProjScale / std::max( tDistance, 1.0e-3f );
+	}
+
+	/** @brief the loader thread: reads the requested chunks, most important first */
+	void loaderLoop()
+	{
+		std::ifstream tFile( mPath.c_str(), std::ios::binary );
+		while( true ) {
+			uint32_t tNode;
+			size_t   tBytes;
+			uint64_t tOffset;
+			{
+				// Wait for a request (and for the main thread to catch up with uploads):
+				std::unique_lock<std::mutex> tLock( mMutex );
+				mCondition.wait( tLock, [&]() { return mQuit || ( !mRequests.empty() && mCompleted.size() < kMaxCompleted ); } );
+				if( mQuit ) { return; }
+				tNode = mRequests.front();
+				mRequests.pop_front();
+				mLoading[ tNode ] = 1;
+				tBytes  = mNodes[ tNode ].getChunkBytes();
+				tOffset = mNodes[ tNode ].mOffset;
+			}
+
+			LoadedChunk tChunk;
+			tChunk.mNode = tNode;
+			tChunk.mData.resize( tBytes );
+			tFile.clear();
+			tFile.seekg( static_cast<std::streamoff>( tOffset ) );
+			if( !tFile.read( &tChunk.mData[ 0 ], tBytes ) ) { tChunk.mData.clear(); }
+
+			std::lock_guard<std::mutex> tLock( mMutex );
+			mCompleted.push_back( LoadedChunk() );
+			mCompleted.back().mNode = tChunk.mNode;
+			mCompleted.back().mData.swap( tChunk.mData );
+		}
+	}
+
+	size_t							mPointBudget;
+	size_t							mMemoryBudget;
+	float							mErrorThreshold;
+	size_t							mUploadsPerFrame;
+	uint64_t						mFrame;
+	size_t							mResidentBytes;
+	std::string						mPath;
+	std::vector<PointOctreeNode>	mNodes;
+	std::vector<NodeState>			mStates;
+	std::vector<uint32_t>			mSelected;			//!< nodes picked this frame
+
+	// Loader (shared with it, under mMutex: mRequests, mCompleted, mLoading and mQuit):
+	std::thread						mLoader;
+	std::mutex						mMutex;
+	std::condition_variable			mCondition;
+	std::deque<uint32_t>			mRequests;
+	std::deque<LoadedChunk>			mCompleted;
+	std::vector<uint8_t>			mLoading;			//!< nodes the loader is reading (or has read, not yet uploaded)
+	bool							mQuit;
+	Stats							mStats;
+};
@@ -9,6 +9,8 @@
 #include "cinder/app/AppNative.h"
 #include "cinder/gl/gl.h"
 
+#include "PointGrid.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -23,6 +25,7 @@ public:
 	void draw();
 	
 	void resetVertices();
+	void rebuildVertexGrid();
 	
 	bool					mWireframeMode;
 	std::vector<ci::Vec2f>	mTriangles;
@@ -31,6 +34,8 @@ public:
 	bool					mBestIsA;
 	int						mBestIdx;
 	
+	PointGrid<Vec2f>		mVertexGrid;	//!< strip vertices first, then triangle vertices
+	
 	Vec2f					mMouseAdjustedPos;
 };
 
@@ -60,6 +65,17 @@ void GLTrianglesApp::resetVertices()
 			mTriangles[ i * 3 + j ] = tVertices[ i + j ] + Vec2f( 0.35, 0.7 );
 		}
 	}
+	
+	// Index the vertices for picking:
+	rebuildVertexGrid();
+}
+
+void GLTrianglesApp::rebuildVertexGrid()
+{
+	std::vector<Vec2f> tPoints( mTriangleStrip.begin(), mTriangleStrip.end() );
+	tPoints.insert( tPoints.end(), mTriangles.begin(), mTriangles.end() );
+	mVertexGrid = PointGrid<Vec2f>( 0.05f );
+	mVertexGrid.build( tPoints );
 }
 
 void GLTrianglesApp::setup()
@@ -82,42 +98,14 @@ void GLTrianglesApp::mouseDown(MouseEvent event)
 	// Compute normalized mouse position:
 	mMouseAdjustedPos = static_cast<Vec2f>( event.getPos() ) / static_cast<Vec2f>( getWindowSize() );
 	
-	// Compute mouse distance from triangle strip vertices:
-	size_t tCountA    = mTriangleStrip.size();
-	float  tBestDistA = 1e6;
-	int    tBestA     = -1;
-	//
-	for(size_t i = 0; i < tCountA; i++) {
-		float tDistA = mMouseAdjustedPos.distance( mTriangleStrip[ i ] );
-		if( tDistA < tBestDistA ) {
-			tBestDistA = tDistA;
-			tBestA = i;
-		}
-	}
+	// Find the closest vertex (of either shape) from the grid, which only
+	// visits the cells around the mouse instead of every vertex:
+	int tBest = mVertexGrid.nearest( mMouseAdjustedPos );
 	
-	// Compute mouse distance from triangle vertices:
-	size_t tCountB    = mTriangles.size();
-	float  tBestDistB = 1e6;
-	int    tBestB     = -1;
-	//
-	for(size_t i = 0; i < tCountB; i++) {
-		float tDistB = mMouseAdjustedPos.distance( mTriangles[ i ] );
-		if( tDistB < tBestDistB ) {
-			tBestDistB = tDistB;
-			tBestB = i;
-		}
-	}
-	
-	// Check whether mouse is closer to triangle strip or triangles
-	// and set member flag/index accordingly:
-	if( tBestDistA < tBestDistB ) {
-		mBestIsA = true;
-		mBestIdx = tBestA;
-	}
-	else {
-		mBestIsA = false;
-		mBestIdx = tBestB;
-	}
+	// Ids below the strip's size are strip vertices, the rest are triangle vertices:
+	int tCountA = static_cast<int>( mTriangleStrip.size() );
+	mBestIsA = ( tBest < tCountA );
+	mBestIdx = ( tBest < 0 || mBestIsA ) ? ( tBest ) : ( tBest - tCountA );
 }
 
 void GLTrianglesApp::mouseDrag(MouseEvent event)
@@ -131,10 +119,16 @@ void GLTrianglesApp::mouseDrag(MouseEvent event)
 	// Make sure that we have a best index:
 	if( mBestIdx >= 0 ) {
 		// Handle triangle strip vertex delta:
-		if( mBestIsA ) { mTriangleStrip[ mBestIdx ] += tDelta; }
+		if( mBestIsA ) {
+			mTriangleStrip[ mBestIdx ] += tDelta;
+			mVertexGrid.move( mBestIdx, mTriangleStrip[ mBestIdx ] );
+		}
 	
 		// Handle triangle vertex delta:
-		else { mTriangles[ mBestIdx ] += tDelta; }
+		else {
+			mTriangles[ mBestIdx ] += tDelta;
+			mVertexGrid.move( mTriangleStrip.size() + mBestIdx, mTriangles[ mBestIdx ] );
+		}
 	}
 	
 	// Update normalized mouse position:
@@ -152,6 +146,10 @@ void GLTrianglesApp::keyUp(KeyEvent event)
 			mWireframeMode = !mWireframeMode;
 			break;
 		}
+		case 'b': {
+			runPointGridBenchmark();
+			break;
+		}
 		default: { break; }
 	}
 }
@@ -0,0 +1,522 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "cinder/Rand.h"
+#include "cinder/Vector.h"
+
+// To find the point closest to the mouse, we could measure the distance to every
+// point. That's fine for a few dozen points, but with a million points it takes
+// milliseconds per query.
+//
+// A "uniform grid" divides space into equally sized cells and remembers which
+// points are in each cell. A query only looks at the cells near the query
+// position: first its own cell, then the ring of cells around it, then the next
+// ring, and so on, until the remaining rings are further away than the best
+// points found so far. If the cell size matches the density of the points (a few
+// points per cell), a query looks at roughly the same number of points no matter
+// how many there are in total.
+//
+// Looking at the same number of points only gives the same query time if those
+// points are also cheap to reach. With millions of points the index is much
+// larger than the CPU's caches, so every scattered memory access (following a
+// linked list from point to point, say) waits on main memory. So the points are
+// stored sorted by cell, in "compressed sparse row" form: the cells are numbered
+// row by row, and each cell has a start offset into one array that holds its
+// points (the position and the id, side by side). A query reads a cell's
+// offset, then its points in one run; the cells of a row are next to each other,
+// so a whole row of a ring is a single run of memory. The array is filled with a
+// counting sort (count the points per cell, add up the counts into offsets, then
+// drop each point into place).
+//
+// The grid covers the bounds of the points. Unless a cell size is given, it is
+// chosen on every build() for about four points per cell. The index costs about
+// 21 bytes per 2D point in all (26 per 3D point), including the stored
+// positions (see getMemoryBytes()). Once it no longer fits in the caches (a few
+// hundred thousand points), a query still waits on main memory for each row it
+// reads, so it gets a little slower, but not because it looks at more points.
+//
+// Each cell gets one spare slot at the end of its run, so points can be dragged
+// around without rebuilding anything: moving a point takes it out of its old
+// cell (the cell's last point fills the gap) and puts it in the spare slot of its
+// new cell. If the new cell has no spare slot left, the cells between it and the
+// nearest cell that still has one each shift by a slot (each moves one point from
+// one end of its run to the other). Only a point moved (or inserted) outside the
+// grid makes it grow, which rebuilds it (with a margin, so dragging along the
+// edge doesn't rebuild every time).
+
+/** @brief a uniform grid over 2D or 3D points (Vec2f or Vec3f) for nearest, k-nearest and radius queries */
+template<typename VecT>
+class PointGrid {
+public:
+	static const int kDims = sizeof( VecT ) / sizeof( float );
+
+	/** @brief constructor (a cell size of 0 is chosen from the points' density on each build()) */
+	explicit PointGrid(const float& iCellSize = 0.0f) : mCellSize( iCellSize ), mAutoCellSize( iCellSize <= 0.0f ), mCellCount( 0 )
+	{
+		for(int a = 0; a < 3; a++) { mOrigin[ a ] = 0.0f; mDims[ a ] = 1; }
+	}
+
+	/** @brief replaces all points (ids are the indices into iPoints) */
+	void build(const std::vector<VecT>& iPoints)
+	{
+		VecT tMin, tMax;
+		getBounds( iPoints, tMin, tMax );
+
+		// Choose about four points per cell (from the volume of the bounds):
+		if( mAutoCellSize && !iPoints.empty() ) {
+			float tVolume = 1.0f;
+			for(int a = 0; a < kDims; a++) { tVolume *= std::max( tMax[ a ] - tMin[ a ], 1.0e-6f ); }
+			mCellSize = std::pow( tVolume * kPointsPerCell / iPoints.size(), 1.0f / kDims );
+		}
+		if( mCellSize <= 0.0f ) { mCellSize = 1.0f; }
+
+		fill( iPoints, tMin, tMax );
+	}
+
+	/** @brief adds a point and returns its id */
+	uint32_t insert(const VecT& iPoint)
+	{
+		uint32_t tId = static_cast<uint32_t>( mSlotOf.size() );
+		if( !contains( iPoint ) ) {
+			std::vector<VecT> tPoints;
+			getPoints( tPoints );
+			tPoints.push_back( iPoint );
+			grow( tPoints );
+			return tId;
+		}
+		mSlotOf.push_back( 0 );
+		addToCell( tId, iPoint, cellOf( iPoint ) );
+		return tId;
+	}
+
+	/** @brief moves a point (only touching its old and new cells, and any cells that shift to make room) */
+	void move(const uint32_t& iId, const VecT& iPoint)
+	{
+		if( !contains( iPoint ) ) {
+			std::vector<VecT> tPoints;
+			getPoints( tPoints );
+			tPoints[ iId ] = iPoint;
+			grow( tPoints );
+			return;
+		}
+		uint32_t tOld = cellOf( mSlots[ mSlotOf[ iId ] ].mPoint );
+		uint32_t tNew = cellOf( iPoint );
+		if( tOld == tNew ) {
+			mSlots[ mSlotOf[ iId ] ].mPoint = iPoint;
+			return;
+		}
+		removeFromCell( iId, tOld );
+		addToCell( iId, iPoint, tNew );
+	}
+
+	/** @brief returns a point */
+	const VecT& getPoint(const uint32_t& iId) const { return mSlots[ mSlotOf[ iId ] ].mPoint; }
+
+	/** @brief returns the number of points */
+	size_t size() const { return mSlotOf.size(); }
+
+	/** @brief returns the cell size */
+	float getCellSize() const { return mCellSize; }
+
+	/** @brief returns the bytes used by the points and the index */
+	size_t getMemoryBytes() const
+	{
+		return mSlots.size() * sizeof( Slot ) + mSlotOf.size() * sizeof( uint32_t ) + mCells.size() * sizeof( Cell );
+	}
+
+	/** @brief returns the closest point within iMaxDistance (or -1) */
+	int nearest(const VecT& iPoint, const float& iMaxDistance = FLT_MAX) const
+	{
+		std::vector<uint32_t> tResult;
+		kNearest( iPoint, 1, tResult, iMaxDistance );
+		return ( tResult.empty() ) ? ( -1 ) : ( static_cast<int>( tResult[ 0 ] ) );
+	}
+
+	/** @brief writes the ids of the (up to) k closest points within iMaxDistance, closest first */
+	void kNearest(const VecT& iPoint, const size_t& iK, std::vector<uint32_t>& oIds, const float& iMaxDistance = FLT_MAX) const
+	{
+		oIds.clear();
+		if( mSlotOf.empty() || iK == 0 ) { return; }
+
+		// Max-heap of the best ( squared distance, id ) pairs found so far:
+		std::vector< std::pair<float, uint32_t> > tBest;
+		tBest.reserve( iK + 1 );
+		float tLimit = ( iMaxDistance < FLT_MAX ) ? ( iMaxDistance * iMaxDistance ) : ( FLT_MAX );
+
+		// (The query can be outside the grid, so the rings start at the first one that reaches it.)
+		int32_t tCenter[ 3 ];
+		getCellCoords( iPoint, tCenter );
+		int tFirstRing = 0, tLastRing = 0;
+		for(int a = 0; a < kDims; a++) {
+			tFirstRing = std::max( tFirstRing, std::max( -tCenter[ a ], tCenter[ a ] - ( mDims[ a ] - 1 ) ) );
+			tLastRing  = std::max( tLastRing, std::max( tCenter[ a ], ( mDims[ a ] - 1 ) - tCenter[ a ] ) );
+		}
+		for(int r = tFirstRing; r <= tLastRing; r++) {
+			// Every point in ring r is at least ( r - 1 ) cells away:
+			float tRingDist = std::max( r - 1, 0 ) * mCellSize;
+			float tWorst    = ( tBest.size() == iK ) ? ( tBest.front().first ) : ( tLimit );
+			if( tRingDist * tRingDist > tWorst ) { break; }
+
+			forEachInRing( tCenter, r, [&](const Slot& iSlot) {
+				float tDistSq = distanceSquared( iSlot.mPoint, iPoint );
+				float tCutoff = ( tBest.size() == iK ) ? ( tBest.front().first ) : ( tLimit );
+				if( tDistSq > tCutoff ) { return; }
+				tBest.push_back( std::make_pair( tDistSq, iSlot.mId ) );
+				std::push_heap( tBest.begin(), tBest.end() );
+				if( tBest.size() > iK ) {
+					std::pop_heap( tBest.begin(), tBest.end() );
+					tBest.pop_back();
+				}
+			} );
+		}
+
+		std::sort_heap( tBest.begin(), tBest.end() );
+		for(size_t i = 0; i < tBest.size(); i++) { oIds.push_back( tBest[ i ].second ); }
+	}
+
+	/** @brief writes the ids of all points within iRadius (in no particular order) */
+	void withinRadius(const VecT& iPoint, const float& iRadius, std::vector<uint32_t>& oIds) const
+	{
+		oIds.clear();
+		if( mSlotOf.empty() ) { return; }
+		int32_t tLo[ 3 ] = { 0, 0, 0 }, tHi[ 3 ] = { 0, 0, 0 };
+		VecT    tOffset;
+		for(int a = 0; a < kDims; a++) { tOffset[ a ] = iRadius; }
+		getCellCoords( iPoint - tOffset, tLo );
+		getCellCoords( iPoint + tOffset, tHi );
+		for(int a = 0; a < 3; a++) {
+			tLo[ a ] = std::max( tLo[ a ], 0 );
+			tHi[ a ] = std::min( tHi[ a ], mDims[ a ] - 1 );
+		}
+		float tRadiusSq = iRadius * iRadius;
+		for(int32_t z = tLo[ 2 ]; z <= tHi[ 2 ]; z++) {
+			for(int32_t y = tLo[ 1 ]; y <= tHi[ 1 ]; y++) {
+				forEachInRow( y, z, tLo[ 0 ], tHi[ 0 ], [&](const Slot& iSlot) {
+					if( distanceSquared( iSlot.mPoint, iPoint ) <= tRadiusSq ) { oIds.push_back( iSlot.mId ); }
+				} );
+			}
+		}
+	}
+
+protected:
+	static const int kPointsPerCell = 4;
+
+	/** @brief a cell's run of slots (its start and count side by side, so reading a cell is one memory access) */
+	struct Cell
+	{
+		uint32_t	mStart;		//!< first slot (the run ends where the next cell's starts)
+		uint32_t	mCount;		//!< points in the run (the rest of the run is spare)
+	};
+
+	/** @brief a point, stored in its cell's run */
+	struct Slot
+	{
+		VecT		mPoint;
+		uint32_t	mId;
+	};
+
+	/** @brief returns the bounds of a set of points */
+	static void getBounds(const std::vector<VecT>& iPoints, VecT& oMin, VecT& oMax)
+	{
+		for(int a = 0; a < kDims; a++) { oMin[ a ] = 0.0f; oMax[ a ] = 0.0f; }
+		if( iPoints.empty() ) { return; }
+		oMin = oMax = iPoints[ 0 ];
+		for(size_t i = 1; i < iPoints.size(); i++) {
+			for(int a = 0; a < kDims; a++) {
+				oMin[ a ] = std::min( oMin[ a ], iPoints[ i ][ a ] );
+				oMax[ a ] = std::max( oMax[ a ], iPoints[ i ][ a ] );
+			}
+		}
+	}
+
+	/** @brief sizes the grid to the given bounds and sorts the points into it */
+	void fill(const std::vector<VecT>& iPoints, const VecT& iMin, const VecT& iMax)
+	{
+		// Size the grid (making the cells larger if a given cell size would need far more cells than points):
+		size_t tMaxCells = std::max<size_t>( iPoints.size() * 4, 4096 );
+		while( true ) {
+			size_t tCells = 1;
+			for(int a = 0; a < kDims; a++) {
+				mOrigin[ a ] = iMin[ a ];
+				mDims[ a ]   = static_cast<int32_t>( std::min( std::floor( ( iMax[ a ] - iMin[ a ] ) / mCellSize ), 1.0e9f ) ) + 1;
+				tCells *= mDims[ a ];
+			}
+			if( tCells <= tMaxCells ) {
+				mCellCount = static_cast<uint32_t>( tCells );
+				break;
+			}
+			mCellSize *= 2.0f;
+		}
+
+		// Counting sort: the points per cell, then each cell's start (with one spare slot per cell), then the points:
+		std::vector<uint32_t> tCellOf( iPoints.size() );
+		Cell tEmpty = { 0, 0 };
+		mCells.assign( mCellCount + 1, tEmpty );
+		for(size_t i = 0; i < iPoints.size(); i++) {
+			tCellOf[ i ] = cellOf( iPoints[ i ] );
+			mCells[ tCellOf[ i ] ].mCount++;
+		}
+		uint32_t tSum = 0;
+		for(uint32_t c = 0; c < mCellCount; c++) {
+			mCells[ c ].mStart = tSum;
+			tSum += mCells[ c ].mCount + 1;
+		}
+		mCells[ mCellCount ].mStart = tSum;
+		mSlots.resize( tSum );
+		mSlotOf.resize( iPoints.size() );
+		for(uint32_t c = 0; c < mCellCount; c++) { mCells[ c ].mCount = 0; }
+		for(size_t i = 0; i < iPoints.size(); i++) {
+			Cell&    tCell = mCells[ tCellOf[ i ] ];
+			uint32_t tSlot = tCell.mStart + tCell.mCount++;
+			mSlots[ tSlot ].mPoint = iPoints[ i ];
+			mSlots[ tSlot ].mId    = static_cast<uint32_t>( i );
+			mSlotOf[ i ] = tSlot;
+		}
+	}
+
+	/** @brief rebuilds the grid over bounds with a margin (for points that left it), keeping the cell size */
+	void grow(const std::vector<VecT>& iPoints)
+	{
+		VecT tMin, tMax;
+		getBounds( iPoints, tMin, tMax );
+		for(int a = 0; a < kDims; a++) {
+			float tMargin = ( tMax[ a ] - tMin[ a ] ) * 0.125f + mCellSize;
+			tMin[ a ] -= tMargin;
+			tMax[ a ] += tMargin;
+		}
+		if( mCellSize <= 0.0f ) { mCellSize = 1.0f; }
+		fill( iPoints, tMin, tMax );
+	}
+
+	/** @brief writes every point, by id */
+	void getPoints(std::vector<VecT>& oPoints) const
+	{
+		oPoints.resize( mSlotOf.size() );
+		for(size_t i = 0; i < mSlotOf.size(); i++) { oPoints[ i ] = mSlots[ mSlotOf[ i ] ].mPoint; }
+	}
+
+	/** @brief writes a position's cell coordinates (which can be outside the grid; the unused ones are 0) */
+	void getCellCoords(const VecT& iPoint, int32_t* oCoords) const
+	{
+		oCoords[ 1 ] = oCoords[ 2 ] = 0;
+		for(int a = 0; a < kDims; a++) {
+			float tCell = std::floor( ( iPoint[ a ] - mOrigin[ a ] ) / mCellSize );
+			oCoords[ a ] = static_cast<int32_t>( std::min( std::max( tCell, -1.0e9f ), 1.0e9f ) );
+		}
+	}
+
+	/** @brief returns true if a position is inside the grid */
+	bool contains(const VecT& iPoint) const
+	{
+		if( mCellCount == 0 ) { return false; }
+		int32_t tCoords[ 3 ];
+		getCellCoords( iPoint, tCoords );
+		for(int a = 0; a < kDims; a++) {
+			if( tCoords[ a ] < 0 || tCoords[ a ] >= mDims[ a ] ) { return false; }
+		}
+		return true;
+	}
+
+	/** @brief returns the (row by row) index of the cell containing a position inside the grid */
+	uint32_t cellOf(const VecT& iPoint) const
+	{
+		int32_t tCoords[ 3 ];
+		getCellCoords( iPoint, tCoords );
+		for(int a = 0; a < kDims; a++) { tCoords[ a ] = std::min( std::max( tCoords[ a ], 0 ), mDims[ a ] - 1 ); }
+		return static_cast<uint32_t>( tCoords[ 0 ] + mDims[ 0 ] * ( tCoords[ 1 ] + mDims[ 1 ] * tCoords[ 2 ] ) );
+	}
+
+	/** @brief calls fn( slot ) for each point in the cells x0..x1 of a row (which are next to each other in memory) */
+	template<typename Fn>
+	void forEachInRow(const int32_t& iY, const int32_t& iZ, const int32_t& iX0, const int32_t& iX1, Fn iFn) const
+	{
+		uint32_t tRow = static_cast<uint32_t>( mDims[ 0 ] * ( iY + mDims[ 1 ] * iZ ) );
+		for(uint32_t c = tRow + iX0; c <= tRow + iX1; c++) {
+			const Cell& tCell = mCells[ c ];
+			const Slot* tSlot = &mSlots[ tCell.mStart ];
+			const Slot* tEnd  = tSlot + tCell.mCount;
+			for(; tSlot != tEnd; tSlot++) { iFn( *tSlot ); }
+		}
+	}
+
+	/** @brief calls fn( slot ) for each point in the cells (inside the grid) exactly r cells away from a center cell */
+	template<typename Fn>
+	void forEachInRing(const int32_t* iCenter, const int& iRing, Fn iFn) const
+	{
+		int tRangeZ = ( kDims == 3 ) ? ( iRing ) : ( 0 );
+		int32_t tZ0 = std::max( iCenter[ 2 ] - tRangeZ, 0 ), tZ1 = std::min( iCenter[ 2 ] + tRangeZ, mDims[ 2 ] - 1 );
+		int32_t tY0 = std::max( iCenter[ 1 ] - iRing, 0 ),   tY1 = std::min( iCenter[ 1 ] + iRing, mDims[ 1 ] - 1 );
+		int32_t tX0 = iCenter[ 0 ] - iRing, tX1 = iCenter[ 0 ] + iRing;
+		for(int32_t z = tZ0; z <= tZ1; z++) {
+			for(int32_t y = tY0; y <= tY1; y++) {
+				// On the ring's surface, the whole row; inside it, only the two ends (the rest was visited before):
+				if( std::abs( z - iCenter[ 2 ] ) == iRing || std::abs( y - iCenter[ 1 ] ) == iRing ) {
+					int32_t tFrom = std::max( tX0, 0 ), tTo = std::min( tX1, mDims[ 0 ] - 1 );
+					if( tFrom <= tTo ) { forEachInRow( y, z, tFrom, tTo, iFn ); }
+					continue;
+				}
+				if( tX0 >= 0 && tX0 < mDims[ 0 ] ) { forEachInRow( y, z, tX0, tX0, iFn ); }
+				if( iRing > 0 && tX1 >= 0 && tX1 < mDims[ 0 ] ) { forEachInRow( y, z, tX1, tX1, iFn ); }
+			}
+		}
+	}
+
+	/** @brief puts a point in a cell, making room first if the cell is full */
+	void addToCell(const uint32_t& iId, const VecT& iPoint, const uint32_t& iCell)
+	{
+		if( mCells[ iCell ].mStart + mCells[ iCell ].mCount == mCells[ iCell + 1 ].mStart && !makeRoom( iCell ) ) {
+			// No spare slot anywhere (only after many inserts): rebuild, which gives every cell a spare slot again:
+			std::vector<VecT> tPoints( mSlotOf.size() );
+			for(size_t i = 0; i < mSlotOf.size(); i++) { tPoints[ i ] = ( i == iId ) ? ( iPoint ) : ( mSlots[ mSlotOf[ i ] ].mPoint ); }
+			grow( tPoints );
+			return;
+		}
+		uint32_t tSlot = mCells[ iCell ].mStart + mCells[ iCell ].mCount++;
+		mSlots[ tSlot ].mPoint = iPoint;
+		mSlots[ tSlot ].mId    = iId;
+		mSlotOf[ iId ] = tSlot;
+	}
+
+	/** @brief takes a point out of its cell (the cell's last point fills its slot) */
+	void removeFromCell(const uint32_t& iId, const uint32_t& iCell)
+	{
+		uint32_t tSlot = mSlotOf[ iId ];
+		uint32_t tLast = mCells[ iCell ].mStart + --mCells[ iCell ].mCount;
+		if( tSlot != tLast ) {
+			mSlots[ tSlot ] = mSlots[ tLast ];
+			mSlotOf[ mSlots[ tSlot ].mId ] = tSlot;
+		}
+	}
+
+	/** @brief gives a full cell a spare slot by shifting the cells between it and the nearest cell with one (returns false if no cell has one) */
+	bool makeRoom(const uint32_t& iCell)
+	{
+		for(uint32_t d = 1; d < mCellCount; d++) {
+			// A spare slot after the cell: shift the cells in between one slot towards the end:
+			if( iCell + d < mCellCount && mCells[ iCell + d ].mStart + mCells[ iCell + d ].mCount < mCells[ iCell + d + 1 ].mStart ) {
+				for(uint32_t c = iCell + d; c > iCell; c--) {
+					if( mCells[ c ].mCount ) { moveSlot( mCells[ c ].mStart, mCells[ c ].mStart + mCells[ c ].mCount ); }
+					mCells[ c ].mStart++;
+				}
+				return true;
+			}
+			// A spare slot before the cell: shift the cells in between one slot towards the start:
+			if( iCell >= d && mCells[ iCell - d ].mStart + mCells[ iCell - d ].mCount < mCells[ iCell - d + 1 ].mStart ) {
+				for(uint32_t c = iCell - d + 1; c <= iCell; c++) {
+					if( mCells[ c ].mCount ) { moveSlot( mCells[ c ].mStart + mCells[ c ].mCount - 1, mCells[ c ].mStart - 1 ); }
+					mCells[ c ].mStart--;
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** @brief moves a point to another slot */
+	void moveSlot(const uint32_t& iFrom, const uint32_t& iTo)
+	{
+		mSlots[ iTo ] = mSlots[ iFrom ];
+		mSlotOf[ mSlots[ iTo ].mId ] = iTo;
+	}
+
+	static float distanceSquared(const VecT& iA, const VecT& iB) { return ( iA - iB ).lengthSquared(); }
+
+	float					mCellSize;
+	bool					mAutoCellSize;	//!< choose the cell size on each build()
+	float					mOrigin[ 3 ];	//!< the corner of cell 0
+	int32_t					mDims[ 3 ];		//!< cells along each axis (1 for unused axes)
+	uint32_t				mCellCount;
+	std::vector<Cell>		mCells;			//!< each cell's run (plus one past the last, whose start is the slot count)
+	std::vector<Slot>		mSlots;			//!< the points, sorted by cell
+	std::vector<uint32_t>	mSlotOf;		//!< each point's slot, by id
+};
+
+/** @brief times nearest, k-nearest and radius queries on growing sets of random 2D points and prints the results */
+static void runPointGridBenchmark(const size_t& iQueries = 100000)
+{
+	using namespace ci;
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const size_t kCounts[] = { 1000, 10000, 100000, 1000000, 4000000 };
+	Rand tRand( 1234 );
+	std::cout << "Point grid benchmark (" << iQueries << " queries per size):" << std::endl;
+	for(size_t c = 0; c < sizeof( kCounts ) / sizeof( kCounts[ 0 ] ); c++) {
+		size_t tCount = kCounts[ c ];
+		std::vector<Vec2f> tPoints( tCount );
+		for(size_t i = 0; i < tCount; i++) { tPoints[ i ] = Vec2f( tRand.nextFloat(), tRand.nextFloat() ); }
+
+		Clock::time_point tStart = Clock::now();
+		PointGrid<Vec2f> tGrid;
+		tGrid.build( tPoints );
+		double tBuildMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+		size_t tBytes   = tGrid.getMemoryBytes();
+
+		std::vector<Vec2f> tQueries( iQueries );
+		for(size_t i = 0; i < iQueries; i++) { tQueries[ i ] = Vec2f( tRand.nextFloat(), tRand.nextFloat() ); }
+
+		// Nearest:
+		std::vector<int> tNearest( iQueries );
+		tStart = Clock::now();
+		for(size_t i = 0; i < iQueries; i++) { tNearest[ i ] = tGrid.nearest( tQueries[ i ] ); }
+		double tNearestUs = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count() / iQueries;
+
+		// 8 nearest:
+		std::vector<uint32_t> tIds;
+		tStart = Clock::now();
+		for(size_t i = 0; i < iQueries; i++) { tGrid.kNearest( tQueries[ i ], 8, tIds ); }
+		double tKnnUs = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count() / iQueries;
+
+		// Radius (about 10 points on average):
+		float tRadius = std::sqrt( 10.0f / ( M_PI * tCount ) );
+		size_t tFound = 0;
+		tStart = Clock::now();
+		for(size_t i = 0; i < iQueries; i++) { tGrid.withinRadius( tQueries[ i ], tRadius, tIds ); tFound += tIds.size(); }
+		double tRadiusUs = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count() / iQueries;
+
+		// Moves (like dragging):
+		size_t tMovedMismatches = 0;
+		tStart = Clock::now();
+		for(size_t i = 0; i < iQueries; i++) {
+			uint32_t tId = static_cast<uint32_t>( i % tCount );
+			tGrid.move( tId, tGrid.getPoint( tId ) + Vec2f( tRand.nextFloat( -0.01f, 0.01f ), tRand.nextFloat( -0.01f, 0.01f ) ) );
+		}
+		double tMoveUs = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count() / iQueries;
+
+		// Check nearest against brute force after the moves too:
+		for(size_t i = 0; i < std::min<size_t>( 100, iQueries ); i++) {
+			float tBest = FLT_MAX;
+			for(uint32_t j = 0; j < tCount; j++) { tBest = std::min( tBest, tGrid.getPoint( j ).distanceSquared( tQueries[ i ] ) ); }
+			if( tGrid.getPoint( tGrid.nearest( tQueries[ i ] ) ).distanceSquared( tQueries[ i ] ) != tBest ) { tMovedMismatches++; }
+		}
+
+		// Check nearest against brute force (for the first few queries, before the moves):
+		size_t tChecks = std::min<size_t>( 100, iQueries ), tMismatches = 0;
+		tStart = Clock::now();
+		for(size_t i = 0; i < tChecks; i++) {
+			float tBest = FLT_MAX;
+			for(size_t j = 0; j < tCount; j++) { tBest = std::min( tBest, tPoints[ j ].distanceSquared( tQueries[ i ] ) ); }
+			if( tPoints[ tNearest[ i ] ].distanceSquared( tQueries[ i ] ) != tBest ) { tMismatches++; }
+		}
+		double tBruteUs = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count() / tChecks;
+
+		std::cout << "  " << tCount << " points (" << tBytes / 1024 << " KB, " << tBytes / tCount << " bytes per point): build " << tBuildMs << " ms, nearest " << tNearestUs << " us, 8-nearest " << tKnnUs
+			<< " us, radius " << tRadiusUs << " us (" << ( tFound / iQueries ) << " found), move " << tMoveUs << " us, brute force "
+			<< tBruteUs << " us (" << tMismatches << " mismatches, " << tMovedMismatches << " after the moves)" << std::endl;
+	}
+}
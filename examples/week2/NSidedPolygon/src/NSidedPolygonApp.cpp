@@ -9,6 +9,9 @@
 #include "cinder/app/AppNative.h"
 #include "cinder/gl/gl.h"
 
+#include "HudText.h"
+#include "PolygonCache.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -17,6 +20,7 @@ class NSidedPolygonApp : public AppNative {
   public:
 	void setup();
 	void mouseDown( MouseEvent event );	
+	void keyUp( KeyEvent event );
 	void update();
 	void draw();
 	
@@ -25,6 +29,11 @@ class NSidedPolygonApp : public AppNative {
 	bool		mGoingUp;
 	
 	ci::Font	mFont;
+	HudText		mHud;		//!< text from a glyph atlas
+	bool		mUseHud;
+	
+	PolygonCache	mCache;		//!< unit-circle points and buffers, by side count
+	bool			mUseCache;
 };
 
 void NSidedPolygonApp::setup()
@@ -52,12 +61,44 @@ void NSidedPolygonApp::setup()
 	
 	// Create font:
 	mFont = ci::Font( "Helvetica", 24 );
+	
+	// Render the font's characters once, for the label:
+	mHud.setup( mFont );
+	mUseHud = true;
+	
+	// Draw from the cached buffers by default:
+	mUseCache = true;
 }
 
 void NSidedPolygonApp::mouseDown( MouseEvent event )
 {
 }
 
+void NSidedPolygonApp::keyUp( KeyEvent event )
+{
+	switch( event.getChar() ) {
+		case 'c': {
+			mUseCache = !mUseCache;
+			cout << ( ( mUseCache ) ? ( "Drawing from cached buffers" ) : ( "Drawing with glBegin / glEnd" ) ) << endl;
+			break;
+		}
+		case 'b': {
+			runPolygonCacheBenchmark();
+			break;
+		}
+		case 't': {
+			mUseHud = !mUseHud;
+			cout << ( ( mUseHud ) ? ( "Drawing text from a glyph atlas" ) : ( "Drawing text with gl::drawStringCentered()" ) ) << endl;
+			break;
+		}
+		case 'h': {
+			runHudTextBenchmark( mHud );
+			break;
+		}
+		default: { break; }
+	}
+}
+
 void NSidedPolygonApp::update()
 {
 }
@@ -79,42 +120,59 @@ void NSidedPolygonApp::draw()
 	// Compute the angle between each point on the polygon:
 	float deltaTheta = ( M_PI * 2.0 ) / mNumSides;
 	
-	// Set color:
-	gl::color( 1, 0, 0 );
-	// Prepare to draw the polygon:
-	glBegin(GL_POLYGON);
-	// Iterate over each vertex:
-	for(int i = 0; i < mNumSides; i++) {
-		// Compute the x and y position of each vertex:
-		float x = mRadius * cos( i * deltaTheta + mTheta );
-		float y = mRadius * sin( i * deltaTheta + mTheta );
-		glVertex2f( x, y );
+	// Draw the polygon and its outline from the cache (the side count's points are computed once, not every frame):
+	if( mUseCache ) {
+		gl::color( 1, 0, 0 );
+		mCache.draw( mNumSides, mRadius, mTheta, PolygonCache::MODE_FILL );
+		gl::color( 0, 0, 1 );
+		gl::lineWidth( 2.0 );
+		mCache.draw( mNumSides, mRadius, mTheta, PolygonCache::MODE_OUTLINE );
 	}
-	// Close the polygon:
-	glEnd();
-	
-	// Set color:
-	gl::color( 0, 0, 1 );
-	// Set line width:
-	gl::lineWidth( 2.0 );
-	// Prepare to draw the line loop:
-	glBegin(GL_LINE_LOOP);
-	// Iterate over each vertex:
-	for(int i = 0; i < mNumSides; i++) {
-		// Compute the x and y position of each vertex:
-		float x = mRadius * cos( i * deltaTheta + mTheta );
-		float y = mRadius * sin( i * deltaTheta + mTheta );
-		glVertex2f( x, y );
+	else {
+		// Set color:
+		gl::color( 1, 0, 0 );
+		// Prepare to draw the polygon:
+		glBegin(GL_POLYGON);
+		// Iterate over each vertex:
+		for(int i = 0; i < mNumSides; i++) {
+			// Compute the x and y position of each vertex:
+			float x = mRadius * cos( i * deltaTheta + mTheta );
+			float y = mRadius * sin( i * deltaTheta + mTheta );
+			glVertex2f( x, y );
+		}
+		// Close the polygon:
+		glEnd();
+		
+		// Set color:
+		gl::color( 0, 0, 1 );
+		// Set line width:
+		gl::lineWidth( 2.0 );
+		// Prepare to draw the line loop:
+		glBegin(GL_LINE_LOOP);
+		// Iterate over each vertex:
+		for(int i = 0; i < mNumSides; i++) {
+			// Compute the x and y position of each vertex:
+			float x = mRadius * cos( i * deltaTheta + mTheta );
+			float y = mRadius * sin( i * deltaTheta + mTheta );
+			glVertex2f( x, y );
+		}
+		// Close the loop:
+		glEnd();
 	}
-	// Close the loop:
-	glEnd();
 	
 	// Pop matrix:
 	gl::popMatrices();
 	
 	// Draw text label:
 	Vec2f textPos = Vec2f( getWindowWidth() / 2.0, 10.0 );
-	gl::drawStringCentered( std::to_string( mNumSides ) + " sides", textPos, ColorA::white(), mFont );
+	if( mUseHud ) {
+		mHud.begin();
+		mHud.addTextf( textPos, ColorA::white(), HudText::ALIGN_CENTER, "%d sides", mNumSides );
+		mHud.end();
+	}
+	else {
+		gl::drawStringCentered( std::to_string( mNumSides ) + " sides", textPos, ColorA::white(), mFont );
+	}
 	
 	// Every 15th frame, change the polygon's side count:
 	if( getElapsedFrames() % 15 == 0 ) {
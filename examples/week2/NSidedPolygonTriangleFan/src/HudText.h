@@ -0,0 +1,413 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cinder/Color.h"
+#include "cinder/Font.h"
+#include "cinder/Rect.h"
+#include "cinder/Surface.h"
+#include "cinder/Text.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Texture.h"
+#include "cinder/gl/Vbo.h"
+
+// gl::drawStringCentered() renders its whole string into a new image with the
+// platform's font engine, uploads it as a texture and draws it: every frame,
+// for every string, even if the text hasn't changed. Building the string with
+// to_string() and + allocates memory as well.
+//
+// A "glyph atlas" instead renders each character once, at setup, into one
+// shared texture (the atlas), and remembers where each one is and how wide it
+// is. Drawing text is then a matter of placing one textured quad per character
+// ("layout"), and every string drawn in a frame goes into one vertex array,
+// drawn with a single call.
+//
+// Laying out a string is cached: the quads for a string are kept (keyed by a
+// hash of its characters), and a string that's the same as in an earlier frame
+// just copies them. Strings are formatted with snprintf() into a fixed buffer,
+// and the caches and vertex array are allocated once, so drawing a HUD doesn't
+// allocate memory at all once it's warmed up.
+//
+// (Only the printable ASCII characters are in the atlas, and there's no kerning:
+// this is meant for debug text, not typesetting.)
+
+/** @brief draws text from a glyph atlas, batching every string in a frame into one draw call */
+class HudText {
+public:
+	/** @brief horizontal alignment, relative to the given position */
+	enum Align { ALIGN_LEFT, ALIGN_CENTER, ALIGN_RIGHT };
+
+	/** @brief a vertex as stored in the vertex buffer (20 bytes) */
+	struct Vertex
+	{
+		ci::Vec2f		mPosition;
+		ci::Vec2f		mTexCoord;
+		ci::ColorA8u	mColor;
+	};
+
+	/** @brief per-frame counters (from begin() to end()) */
+	struct Stats
+	{
+		size_t	mStrings;
+		size_t	mCacheHits;			//!< strings whose layout was reused
+		size_t	mCacheMisses;		//!< strings that were laid out
+		size_t	mGlyphs;
+		size_t	mBatches;			//!< draw calls
+		size_t	mBytes;				//!< vertex bytes uploaded
+
+		/** @brief default constructor */
+		Stats() : mStrings( 0 ), mCacheHits( 0 ), mCacheMisses( 0 ), mGlyphs( 0 ), mBatches( 0 ), mBytes( 0 ) {}
+	};
+
+	/** @brief constructor (the maximum characters drawn per frame, and kept in the layout cache) */
+	HudText(const size_t& iMaxGlyphs = 8192, const size_t& iCacheGlyphs = 16384) :
+		mLineHeight( 0.0f ), mTabWidth( 0.0f ), mMaxGlyphs( iMaxGlyphs ), mCacheGlyphs( iCacheGlyphs ), mBufferBytes( 0 )
+	{
+		mEntries.resize( kCacheSlots );
+		mCachedText.reserve( mCacheGlyphs );
+		mCachedQuads.reserve( mCacheGlyphs );
+		mVertices.reserve( mMaxGlyphs * 6 );
+	}
+
+	/** @brief renders the printable ASCII characters of a font into the atlas (needs a GL context) */
+	void setup(const ci::Font& iFont)
+	{
+		// Render every character on its own (its image is as wide as the character's advance):
+		std::vector<ci::Surface8u> tImages( kGlyphCount );
+		for(int c = 0; c < kGlyphCount; c++) { tImages[ c ] = renderGlyph( iFont, std::string( 1, static_cast<char>( kFirstGlyph + c ) ) ); }
+		// (A lone space may be trimmed, so its advance is measured between two other characters:)
+		float tSpace = static_cast<float>( renderGlyph( iFont, "x x" ).getWidth() - renderGlyph( iFont, "xx" ).getWidth() );
+
+		// Pack them into rows ("shelves") of an atlas 512 pixels wide, one pixel apart:
+		const int tAtlasWidth = 512;
+		int tX = 1, tY = 1, tRowHeight = 0;
+		std::vector<ci::Vec2i> tOffsets( kGlyphCount );
+		for(int c = 0; c < kGlyphCount; c++) {
+			if( tX + tImages[ c ].getWidth() + 1 > tAtlasWidth ) {
+				tX  = 1;
+				tY += tRowHeight + 1;
+				tRowHeight = 0;
+			}
+			tOffsets[ c ] = ci::Vec2i( tX, tY );
+			tX += tImages[ c ].getWidth() + 1;
+			tRowHeight = std::max( tRowHeight, tImages[ c ].getHeight() );
+		}
+		int tAtlasHeight = 1;
+		while( tAtlasHeight < tY + tRowHeight + 1 ) { tAtlasHeight *= 2; }
+
+		// Copy them in (onto a transparent background) and upload:
+		ci::Surface8u tAtlas( tAtlasWidth, tAtlasHeight, true );
+		std::memset( tAtlas.getData(), 0, tAtlas.getRowBytes() * tAtlasHeight );
+		for(int c = 0; c < kGlyphCount; c++) {
+			tAtlas.copyFrom( tImages[ c ], tImages[ c ].getBounds(), tOffsets[ c ] );
+			Glyph& tGlyph = mGlyphs[ c ];
+			tGlyph.mSize     = ci::Vec2f( static_cast<float>( tImages[ c ].getWidth() ), static_cast<float>( tImages[ c ].getHeight() ) );
+			tGlyph.mTexRect  = ci::Rectf( tOffsets[ c ].x / static_cast<float>( tAtlasWidth ), tOffsets[ c ].y / static_cast<float>( tAtlasHeight ),
+										  ( tOffsets[ c ].x + tGlyph.mSize.x ) / tAtlasWidth, ( tOffsets[ c ].y + tGlyph.mSize.y ) / tAtlasHeight );
+			tGlyph.mAdvance  = tGlyph.mSize.x;
+		}
+		mGlyphs[ ' ' - kFirstGlyph ].mAdvance = tSpace;
+		mGlyphs[ ' ' - kFirstGlyph ].mSize    = ci::Vec2f::zero();
+		mAtlas      = ci::gl::Texture( tAtlas );
+		mLineHeight = iFont.getAscent() + iFont.getDescent() + iFont.getLeading();
+		mTabWidth   = tSpace * 4.0f;
+		clearCache();
+	}
+
+	/** @brief starts a frame (clears the strings and counters) */
+	void begin()
+	{
+		mStats = Stats();
+		mVertices.clear();
+	}
+
+	/** @brief adds a string, formatted like printf() (pos is the top of the first line) */
+	void addTextf(const ci::Vec2f& iPos, const ci::ColorA& iColor, const Align& iAlign, const char* iFormat, ...)
+	{
+		va_list tArgs;
+		va_start( tArgs, iFormat );
+		int tLength = std::vsnprintf( mFormat, sizeof( mFormat ), iFormat, tArgs );
+		va_end( tArgs );
+		if( tLength < 0 ) { return; }
+		addText( mFormat, std::min<size_t>( tLength, sizeof( mFormat ) - 1 ), iPos, iColor, iAlign );
+	}
+
+	/** @brief adds a string (pos is the top of the first line) */
+	void addText(const std::string& iText, const ci::Vec2f& iPos, const ci::ColorA& iColor, const Align& iAlign = ALIGN_LEFT)
+	{
+		addText( iText.c_str(), iText.size(), iPos, iColor, iAlign );
+	}
+
+	/** @brief adds iLength characters of a string (pos is the top of the first line) */
+	void addText(const char* iText, const size_t& iLength, const ci::Vec2f& iPos, const ci::ColorA& iColor, const Align& iAlign = ALIGN_LEFT)
+	{
+		if( !mAtlas ) { return; }
+		const Entry& tEntry = getLayout( iText, iLength );
+
+		// Place the cached quads (relative to the start of the text) at the position:
+		ci::Vec2f    tOrigin = iPos - ci::Vec2f( ( iAlign == ALIGN_LEFT ) ? ( 0.0f ) : ( ( iAlign == ALIGN_CENTER ) ? ( tEntry.mWidth * 0.5f ) : ( tEntry.mWidth ) ), 0.0f );
+		ci::ColorA8u tColor( iColor );
+		size_t tCount = std::min<size_t>( tEntry.mQuadCount, mMaxGlyphs - mVertices.size() / 6 );
+		for(size_t q = 0; q < tCount; q++) {
+			const Quad& tQuad = mCachedQuads[ tEntry.mQuadOffset + q ];
+			const ci::Rectf& tTex = mGlyphs[ tQuad.mGlyph ].mTexRect;
+			ci::Vec2f tA = tOrigin + tQuad.mPosition;
+			ci::Vec2f tB = tA + mGlyphs[ tQuad.mGlyph ].mSize;
+			pushVertex( ci::Vec2f( tA.x, tA.y ), ci::Vec2f( tTex.x1, tTex.y1 ), tColor );
+			pushVertex( ci::Vec2f( tB.x, tA.y ), ci::Vec2f( tTex.x2, tTex.y1 ), tColor );
+			pushVertex( ci::Vec2f( tB.x, tB.y ), ci::Vec2f( tTex.x2, tTex.y2 ), tColor );
+			pushVertex( ci::Vec2f( tA.x, tA.y ), ci::Vec2f( tTex.x1, tTex.y1 ), tColor );
+			pushVertex( ci::Vec2f( tB.x, tB.y ), ci::Vec2f( tTex.x2, tTex.y2 ), tColor );
+			pushVertex( ci::Vec2f( tA.x, tB.y ), ci::Vec2f( tTex.x1, tTex.y2 ), tColor );
+		}
+		mStats.mStrings++;
+		mStats.mGlyphs += tCount;
+	}
+
+	/** @brief uploads and draws the frame's strings */
+	void end()
+	{
+		if( mVertices.empty() ) { return; }
+
+		// Orphan the streaming buffer (growing it if needed), then fill it:
+		size_t tBytes = mVertices.size() * sizeof( Vertex );
+		if( !mBuffer ) { mBuffer = ci::gl::Vbo( GL_ARRAY_BUFFER ); }
+		mBuffer.bind();
+		mBufferBytes = std::max( mBufferBytes, tBytes );
+		mBuffer.bufferData( mBufferBytes, NULL, GL_STREAM_DRAW );
+		mBuffer.bufferSubData( 0, tBytes, &mVertices[ 0 ] );
+
+		const char* tBase = NULL;
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, sizeof( Vertex ), tBase + offsetof( Vertex, mPosition ) );
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( Vertex ), tBase + offsetof( Vertex, mTexCoord ) );
+		glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( Vertex ), tBase + offsetof( Vertex, mColor ) );
+		mAtlas.enableAndBind();
+		glDrawArrays( GL_TRIANGLES, 0, static_cast<GLsizei>( mVertices.size() ) );
+		mAtlas.unbind();
+		mAtlas.disable();
+		glDisableClientState( GL_COLOR_ARRAY );
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+		glDisableClientState( GL_VERTEX_ARRAY );
+		mBuffer.unbind();
+
+		mStats.mBatches++;
+		mStats.mBytes += tBytes;
+	}
+
+	/** @brief returns the width of a string, in pixels (its widest line) */
+	float measure(const char* iText, const size_t& iLength)
+	{
+		return ( mAtlas ) ? ( getLayout( iText, iLength ).mWidth ) : ( 0.0f );
+	}
+
+	/** @brief returns the height of a line, in pixels */
+	float getLineHeight() const { return mLineHeight; }
+
+	/** @brief returns the counters for the current (or last) frame */
+	const Stats& getStats() const { return mStats; }
+
+	/** @brief empties the layout cache */
+	void clearCache()
+	{
+		for(std::vector<Entry>::iterator it = mEntries.begin(); it != mEntries.end(); it++) { (*it).mUsed = false; }
+		mCachedText.clear();
+		mCachedQuads.clear();
+	}
+
+protected:
+	enum {
+		kFirstGlyph  = 32,		//!< ' '
+		kGlyphCount  = 95,		//!< ' ' to '~'
+		kCacheSlots  = 256,		//!< layout cache entries (a power of two)
+		kCacheProbes = 8		//!< entries tried before giving up on a hash
+	};
+
+	/** @brief a character in the atlas */
+	struct Glyph
+	{
+		ci::Rectf	mTexRect;		//!< where it is in the atlas (in texture coordinates)
+		ci::Vec2f	mSize;			//!< its quad's size, in pixels
+		float		mAdvance;		//!< how far it moves the next character along
+	};
+
+	/** @brief a character placed in a string (relative to the string's top-left corner) */
+	struct Quad
+	{
+		ci::Vec2f	mPosition;
+		uint8_t		mGlyph;
+	};
+
+	/** @brief a cached layout */
+	struct Entry
+	{
+		bool		mUsed;
+		uint64_t	mHash;
+		size_t		mTextOffset, mTextLength;		//!< its characters, in mCachedText
+		size_t		mQuadOffset, mQuadCount;		//!< its quads, in mCachedQuads
+		float		mWidth;
+
+		/** @brief default constructor */
+		Entry() : mUsed( false ), mHash( 0 ), mTextOffset( 0 ), mTextLength( 0 ), mQuadOffset( 0 ), mQuadCount( 0 ), mWidth( 0.0f ) {}
+	};
+
+	/** @brief renders a string with the platform's font engine (white, on a transparent background) */
+	static ci::Surface8u renderGlyph(const ci::Font& iFont, const std::string& iText)
+	{
+		ci::TextLayout tLayout;
+		tLayout.clear( ci::ColorA( 1.0f, 1.0f, 1.0f, 0.0f ) );
+		tLayout.setFont( iFont );
+		tLayout.setColor( ci::ColorA( 1.0f, 1.0f, 1.0f, 1.0f ) );
+		tLayout.addLine( iText );
+		return tLayout.render( true, false );
+	}
+
+	/** @brief returns a string's layout, from the cache or laid out now (and cached) */
+	const Entry& getLayout(const char* iText, const size_t& iLength)
+	{
+		// FNV-1a hash of the characters:
+		uint64_t tHash = 14695981039346656037ULL;
+		for(size_t i = 0; i < iLength; i++) {
+			tHash ^= static_cast<uint8_t>( iText[ i ] );
+			tHash *= 1099511628211ULL;
+		}
+
+		// Look for it (or a free entry) near its hash's slot:
+		Entry* tFree = NULL;
+		for(size_t p = 0; p < kCacheProbes; p++) {
+			Entry& tEntry = mEntries[ ( tHash + p ) & ( kCacheSlots - 1 ) ];
+			if( !tEntry.mUsed ) {
+				if( !tFree ) { tFree = &tEntry; }
+				continue;
+			}
+			if( tEntry.mHash == tHash && tEntry.mTextLength == iLength && std::memcmp( &mCachedText[ tEntry.mTextOffset ], iText, iLength ) == 0 ) {
+				mStats.mCacheHits++;
+				return tEntry;
+			}
+		}
+
+		// Not cached: make room if needed (by starting the cache over), then lay it out:
+		mStats.mCacheMisses++;
+		if( !tFree || mCachedText.size() + iLength > mCacheGlyphs || mCachedQuads.size() + iLength > mCacheGlyphs ) {
+			clearCache();
+			tFree = &mEntries[ tHash & ( kCacheSlots - 1 ) ];
+			if( iLength > mCacheGlyphs ) {
+				// (Too long to cache at all: lay it out into the scratch entry.)
+				tFree = &mScratch;
+			}
+		}
+		Entry& tEntry = *tFree;
+		tEntry.mUsed       = ( tFree != &mScratch );
+		tEntry.mHash       = tHash;
+		tEntry.mTextOffset = mCachedText.size();
+		tEntry.mTextLength = iLength;
+		tEntry.mQuadOffset = mCachedQuads.size();
+		tEntry.mWidth      = 0.0f;
+		if( tEntry.mUsed ) { mCachedText.insert( mCachedText.end(), iText, iText + iLength ); }
+
+		float tX = 0.0f, tY = 0.0f;
+		for(size_t i = 0; i < iLength; i++) {
+			char c = iText[ i ];
+			if( c == '\n' ) {
+				tX  = 0.0f;
+				tY += mLineHeight;
+				continue;
+			}
+			if( c == '\t' ) {
+				tX = ( std::floor( tX / mTabWidth ) + 1.0f ) * mTabWidth;
+				continue;
+			}
+			int tGlyph = ( c >= kFirstGlyph && c < kFirstGlyph + kGlyphCount ) ? ( c - kFirstGlyph ) : ( '?' - kFirstGlyph );
+			if( c != ' ' && ( tEntry.mUsed || mCachedQuads.size() < mCachedQuads.capacity() ) ) {
+				Quad tQuad;
+				tQuad.mPosition = ci::Vec2f( tX, tY );
+				tQuad.mGlyph    = static_cast<uint8_t>( tGlyph );
+				mCachedQuads.push_back( tQuad );
+			}
+			tX += mGlyphs[ tGlyph ].mAdvance;
+			tEntry.mWidth = std::max( tEntry.mWidth, tX );
+		}
+		tEntry.mQuadCount = mCachedQuads.size() - tEntry.mQuadOffset;
+		return tEntry;
+	}
+
+	/** @brief appends a vertex */
+	void pushVertex(const ci::Vec2f& iPosition, const ci::Vec2f& iTexCoord, const ci::ColorA8u& iColor)
+	{
+		Vertex tVertex;
+		tVertex.mPosition = iPosition;
+		tVertex.mTexCoord = iTexCoord;
+		tVertex.mColor    = iColor;
+		mVertices.push_back( tVertex );
+	}
+
+	Glyph				mGlyphs[ kGlyphCount ];
+	ci::gl::Texture		mAtlas;
+	float				mLineHeight;
+	float				mTabWidth;
+	size_t				mMaxGlyphs;				//!< characters drawn per frame
+	size_t				mCacheGlyphs;			//!< characters kept in the layout cache
+	std::vector<Entry>	mEntries;				//!< the layout cache (open addressing, by hash)
+	Entry				mScratch;				//!< layout for a string too long to cache
+	std::vector<char>	mCachedText;			//!< the cached strings' characters (to tell hash collisions apart)
+	std::vector<Quad>	mCachedQuads;			//!< the cached strings' quads
+	char				mFormat[ 1024 ];		//!< addTextf() output
+	std::vector<Vertex>	mVertices;				//!< this frame's quads (six vertices each)
+	ci::gl::Vbo			mBuffer;
+	size_t				mBufferBytes;
+	Stats				mStats;
+};
+
+/** @brief times formatting and laying out HUD strings: the same strings every frame (cached), and new ones (not cached) */
+static void runHudTextBenchmark(HudText& ioText, const size_t& iStrings = 20000)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	std::cout << "HUD text benchmark: " << iStrings << " strings" << std::endl;
+	for(int tCached = 1; tCached >= 0; tCached--) {
+		ioText.clearCache();
+		ioText.begin();
+		Clock::time_point tStart = Clock::now();
+		for(size_t i = 0; i < iStrings; i++) {
+			// (64 different strings, or all different:)
+			if( i % 256 == 0 ) { ioText.begin(); }
+			int tValue = ( tCached ) ? ( static_cast<int>( i % 64 ) ) : ( static_cast<int>( i ) );
+			ioText.addTextf( ci::Vec2f( 10.0f, 20.0f ), ci::ColorA( 1.0f, 1.0f, 1.0f, 1.0f ), HudText::ALIGN_LEFT, "Frame %d: %.2f ms, %d vertices", tValue, tValue * 0.25f, tValue * 3 );
+		}
+		double tUs = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count();
+		std::cout << "  " << ( ( tCached ) ? ( "cached:     " ) : ( "not cached: " ) ) << tUs / iStrings << " us/string" << std::endl;
+	}
+
+	// For comparison, only building the same strings with to_string() and +:
+	size_t tLength = 0;
+	Clock::time_point tStart = Clock::now();
+	for(size_t i = 0; i < iStrings; i++) {
+		int tValue = static_cast<int>( i % 64 );
+		std::string tText = "Frame " + std::to_string( tValue ) + ": " + std::to_string( tValue * 0.25f ) + " ms, " + std::to_string( tValue * 3 ) + " vertices";
+		tLength += tText.size();
+	}
+	double tUs = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count();
+	std::cout << "  to_string() and + only: " << tUs / iStrings << " us/string (" << tLength << " characters)" << std::endl;
+	ioText.clearCache();
+	ioText.begin();
+}
@@ -9,6 +9,9 @@
 #include "cinder/app/AppNative.h"
 #include "cinder/gl/gl.h"
 
+#include "HudText.h"
+#include "PolygonCache.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -17,6 +20,7 @@ class NSidedPolygonTriangleFanApp : public AppNative {
   public:
 	void setup();
 	void mouseDown( MouseEvent event );	
+	void keyUp( KeyEvent event );
 	void update();
 	void draw();
 	
@@ -25,6 +29,11 @@ class NSidedPolygonTriangleFanApp : public AppNative {
 	bool		mGoingUp;
 	
 	ci::Font	mFont;
+	HudText		mHud;		//!< text from a glyph atlas
+	bool		mUseHud;
+	
+	PolygonCache	mCache;		//!< unit-circle points and buffers, by side count
+	bool			mUseCache;
 };
 
 void NSidedPolygonTriangleFanApp::setup()
@@ -53,12 +62,44 @@ void NSidedPolygonTriangleFanApp::setup()
 	
 	// Create font:
 	mFont = ci::Font( "Helvetica", 24 );
+	
+	// Render the font's characters once, for the label:
+	mHud.setup( mFont );
+	mUseHud = true;
+	
+	// Draw from the cached buffers by default:
+	mUseCache = true;
 }
 
 void NSidedPolygonTriangleFanApp::mouseDown( MouseEvent event )
 {
 }
 
+void NSidedPolygonTriangleFanApp::keyUp( KeyEvent event )
+{
+	switch( event.getChar() ) {
+		case 'c': {
+			mUseCache = !mUseCache;
+			cout << ( ( mUseCache ) ? ( "Drawing from cached buffers" ) : ( "Drawing with glBegin / glEnd" ) ) << endl;
+			break;
+		}
+		case 'b': {
+			runPolygonCacheBenchmark();
+			break;
+		}
+		case 't': {
+			mUseHud = !mUseHud;
+			cout << ( ( mUseHud ) ? ( "Drawing text from a glyph atlas" ) : ( "Drawing text with gl::drawStringCentered()" ) ) << endl;
+			break;
+		}
+		case 'h': {
+			runHudTextBenchmark( mHud );
+			break;
+		}
+		default: { break; }
+	}
+}
+
 void NSidedPolygonTriangleFanApp::update()
 {
 }
@@ -90,22 +131,28 @@ void NSidedPolygonTriangleFanApp::draw()
 		gl::enableWireframe();
 	}
 	
-	// Prepare to draw the polygon:
-	glBegin(GL_TRIANGLE_FAN);
-	// Add center point to triangle fan:
-	glVertex2f( 0.0, 0.0 );
-	// Add circumference points to triangle fan:
-	for(int i = 0; i < mNumSides; i++) {
-		// Compute the x and y position of each vertex:
-		float x = mRadius * cos( i * deltaTheta + mTheta );
-		float y = mRadius * sin( i * deltaTheta + mTheta );
-		glVertex2f( x, y );
+	// Draw the triangle fan from the cache (the side count's points are computed once, not every frame):
+	if( mUseCache ) {
+		mCache.draw( mNumSides, mRadius, mTheta, PolygonCache::MODE_FILL );
+	}
+	else {
+		// Prepare to draw the polygon:
+		glBegin(GL_TRIANGLE_FAN);
+		// Add center point to triangle fan:
+		glVertex2f( 0.0, 0.0 );
+		// Add circumference points to triangle fan:
+		for(int i = 0; i < mNumSides; i++) {
+			// Compute the x and y position of each vertex:
+			float x = mRadius * cos( i * deltaTheta + mTheta );
+			float y = mRadius * sin( i * deltaTheta + mTheta );
+			glVertex2f( x, y );
+		}
+		// To close the triangle fan, we need to return to the first circumference vertex
+		// At that vertex, i = 0, so (i * deltaTheta + theta) reduces to (theta):
+		glVertex2f( mRadius * cos( mTheta ), mRadius * sin( mTheta ) );
+		// Close the polygon:
+		glEnd();
 	}
-	// To close the triangle fan, we need to return to the first circumference vertex
-	// At that vertex, i = 0, so (i * deltaTheta + theta) reduces to (theta):
-	glVertex2f( mRadius * cos( mTheta ), mRadius * sin( mTheta ) );
-	// Close the polygon:
-	glEnd();
 	
 	// Pop matrix:
 	gl::popMatrices();
@@ -115,7 +162,14 @@ void NSidedPolygonTriangleFanApp::draw()
 	
 	// Draw text label:
 	Vec2f textPos = Vec2f( getWindowWidth() / 2.0, 10.0 );
-	gl::drawStringCentered( std::to_string( mNumSides ) + " sides", textPos, ColorA::white(), mFont );
+	if( mUseHud ) {
+		mHud.begin();
+		mHud.addTextf( textPos, ColorA::white(), HudText::ALIGN_CENTER, "%d sides", mNumSides );
+		mHud.end();
+	}
+	else {
+		gl::drawStringCentered( std::to_string( mNumSides ) + " sides", textPos, ColorA::white(), mFont );
+	}
 	
 	// Every 15th frame, change the polygon's side count:
 	if( getElapsedFrames() % 15 == 0 ) {
@@ -0,0 +1,286 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#define POLYGON_CACHE_SSE 1
+	#include <emmintrin.h>
+#endif
+
+#include "cinder/CinderMath.h"
+#include "cinder/Rand.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Vbo.h"
+
+// A regular polygon's vertices are points on a circle:
+//
+//   x = radius * cos( i * 2pi / sides + rotation )
+//   y = radius * sin( i * 2pi / sides + rotation )
+//
+// Computing them with cos() and sin() every frame (once to fill the polygon and
+// again to outline it) repeats the same work over and over: the angles only
+// depend on the side count. A polygon "cache" computes, once per side count, the
+// points of the polygon on a unit circle (radius 1, no rotation):
+//
+//   c[ i ] = cos( i * 2pi / sides ),  s[ i ] = sin( i * 2pi / sides )
+//
+// Any radius and rotation is then a scale and a rotation of the unit points (no
+// trigonometry per vertex, just two multiplies and an add for each coordinate):
+//
+//   x = c[ i ] * ( radius * cos( rotation ) ) - s[ i ] * ( radius * sin( rotation ) )
+//   y = c[ i ] * ( radius * sin( rotation ) ) + s[ i ] * ( radius * cos( rotation ) )
+//
+// which is done four points at a time with SSE.
+//
+// For drawing, it's cheaper still to let the GPU do the scale and rotation: each
+// side count's unit points are uploaded once to a vertex buffer (the center
+// first, then the points around the circle), along with two index buffers:
+//   - fill:    a triangle fan (center, points 1..n, and point 1 again to close it),
+//   - outline: a line loop (points 1..n).
+// Drawing a polygon is then a matrix change and one glDrawElements() call.
+
+/** @brief caches the unit-circle points (and vertex and index buffers) of regular polygons, by side count */
+class PolygonCache {
+public:
+	/** @brief how a polygon is drawn */
+	enum Mode { MODE_FILL, MODE_OUTLINE };
+
+	/** @brief one side count's unit-circle points and buffers */
+	struct Shape
+	{
+		size_t				mSides;
+		std::vector<float>	mCos;					//!< unit-circle x of each point
+		std::vector<float>	mSin;					//!< unit-circle y of each point
+		ci::gl::Vbo			mVertices;				//!< center, then the points (created on first draw)
+		ci::gl::Vbo			mFillIndices;			//!< GL_TRIANGLE_FAN
+		ci::gl::Vbo			mOutlineIndices;		//!< GL_LINE_LOOP
+		bool				mUploaded;
+
+		/** @brief default constructor */
+		Shape() : mSides( 0 ), mUploaded( false ) {}
+	};
+
+	/** @brief counters (since construction) */
+	struct Stats
+	{
+		size_t	mShapes;		//!< side counts built
+		size_t	mLookups;
+		size_t	mDraws;
+
+		/** @brief default constructor */
+		Stats() : mShapes( 0 ), mLookups( 0 ), mDraws( 0 ) {}
+	};
+
+	/** @brief constructor */
+	PolygonCache() : mSimd( true ) {}
+
+	/** @brief enables or disables the SSE path (for comparison) */
+	void setSimdEnabled(const bool& iEnabled) { mSimd = iEnabled; }
+
+	/** @brief returns the shape for a side count (building its unit-circle points the first time) */
+	const Shape& get(const size_t& iSides)
+	{
+		// (Indices are 16 bits; the center takes one.)
+		size_t tSides = std::min<size_t>( std::max<size_t>( iSides, 3 ), 65534 );
+		mStats.mLookups++;
+		std::map<size_t, Shape>::iterator tIt = mShapes.find( tSides );
+		if( tIt != mShapes.end() ) { return tIt->second; }
+
+		Shape& tShape = mShapes[ tSides ];
+		tShape.mSides = tSides;
+		tShape.mCos.resize( tSides );
+		tShape.mSin.resize( tSides );
+		double tDelta = ( M_PI * 2.0 ) / tSides;
+		for(size_t i = 0; i < tSides; i++) {
+			tShape.mCos[ i ] = static_cast<float>( std::cos( i * tDelta ) );
+			tShape.mSin[ i ] = static_cast<float>( std::sin( i * tDelta ) );
+		}
+		mStats.mShapes++;
+		return tShape;
+	}
+
+	/** @brief writes a polygon's points, scaled, rotated (in radians) and moved to iCenter, into oX and oY (which hold the side count) */
+	void computePoints(const size_t& iSides, const float& iRadius, const float& iRotation, const ci::Vec2f& iCenter, float* oX, float* oY)
+	{
+		const Shape& tShape = get( iSides );
+		const float* tCos = &tShape.mCos[ 0 ];
+		const float* tSin = &tShape.mSin[ 0 ];
+		size_t tCount = tShape.mSides;
+		float  tA = iRadius * std::cos( iRotation );
+		float  tB = iRadius * std::sin( iRotation );
+		size_t i = 0;
+#ifdef POLYGON_CACHE_SSE
+		if( mSimd ) {
+			__m128 tA4 = _mm_set1_ps( tA ), tB4 = _mm_set1_ps( tB );
+			__m128 tCx = _mm_set1_ps( iCenter.x ), tCy = _mm_set1_ps( iCenter.y );
+			for(; i + 4 <= tCount; i += 4) {
+				__m128 tC = _mm_loadu_ps( tCos + i );
+				__m128 tS = _mm_loadu_ps( tSin + i );
+				_mm_storeu_ps( oX + i, _mm_add_ps( tCx, _mm_sub_ps( _mm_mul_ps( tC, tA4 ), _mm_mul_ps( tS, tB4 ) ) ) );
+				_mm_storeu_ps( oY + i, _mm_add_ps( tCy, _mm_add_ps( _mm_mul_ps( tC, tB4 ), _mm_mul_ps( tS, tA4 ) ) ) );
+			}
+		}
+#endif
+		for(; i < tCount; i++) {
+			oX[ i ] = iCenter.x + tCos[ i ] * tA - tSin[ i ] * tB;
+			oY[ i ] = iCenter.y + tCos[ i ] * tB + tSin[ i ] * tA;
+		}
+	}
+
+	/** @brief returns a polygon's points, scaled, rotated (in radians) and moved to iCenter */
+	void computePoints(const size_t& iSides, const float& iRadius, const float& iRotation, const ci::Vec2f& iCenter, std::vector<ci::Vec2f>& oPoints)
+	{
+		size_t tSides = get( iSides ).mSides;
+		mX.resize( tSides );
+		mY.resize( tSides );
+		computePoints( tSides, iRadius, iRotation, iCenter, &mX[ 0 ], &mY[ 0 ] );
+		oPoints.resize( tSides );
+		for(size_t i = 0; i < tSides; i++) { oPoints[ i ] = ci::Vec2f( mX[ i ], mY[ i ] ); }
+	}
+
+	/** @brief draws a polygon centered on the origin, scaled and rotated (in radians) by the modelview matrix */
+	void draw(const size_t& iSides, const float& iRadius, const float& iRotation, const Mode& iMode)
+	{
+		Shape& tShape = const_cast<Shape&>( get( iSides ) );
+		upload( tShape );
+
+		ci::gl::pushModelView();
+		ci::gl::rotate( ci::toDegrees( iRotation ) );
+		ci::gl::scale( ci::Vec3f( iRadius, iRadius, 1.0f ) );
+
+		tShape.mVertices.bind();
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, 0, 0 );
+		if( iMode == MODE_FILL ) {
+			tShape.mFillIndices.bind();
+			glDrawElements( GL_TRIANGLE_FAN, static_cast<GLsizei>( tShape.mSides + 2 ), GL_UNSIGNED_SHORT, 0 );
+			tShape.mFillIndices.unbind();
+		}
+		else {
+			tShape.mOutlineIndices.bind();
+			glDrawElements( GL_LINE_LOOP, static_cast<GLsizei>( tShape.mSides ), GL_UNSIGNED_SHORT, 0 );
+			tShape.mOutlineIndices.unbind();
+		}
+		glDisableClientState( GL_VERTEX_ARRAY );
+		tShape.mVertices.unbind();
+
+		ci::gl::popModelView();
+		mStats.mDraws++;
+	}
+
+	/** @brief returns the counters */
+	const Stats& getStats() const { return mStats; }
+
+protected:
+	/** @brief creates a shape's buffers (needs a GL context, so it's deferred until the first draw) */
+	void upload(Shape& ioShape)
+	{
+		if( ioShape.mUploaded ) { return; }
+		size_t tSides = ioShape.mSides;
+
+		// Vertex 0 is the center, vertices 1..n the unit-circle points:
+		std::vector<ci::Vec2f> tVertices( tSides + 1, ci::Vec2f::zero() );
+		for(size_t i = 0; i < tSides; i++) { tVertices[ i + 1 ] = ci::Vec2f( ioShape.mCos[ i ], ioShape.mSin[ i ] ); }
+		ioShape.mVertices = ci::gl::Vbo( GL_ARRAY_BUFFER );
+		ioShape.mVertices.bind();
+		ioShape.mVertices.bufferData( tVertices.size() * sizeof( ci::Vec2f ), &tVertices[ 0 ], GL_STATIC_DRAW );
+		ioShape.mVertices.unbind();
+
+		// Fill: the center, every point, then the first point again:
+		std::vector<uint16_t> tFill( tSides + 2 );
+		for(size_t i = 0; i <= tSides; i++) { tFill[ i ] = static_cast<uint16_t>( i ); }
+		tFill[ tSides + 1 ] = 1;
+		ioShape.mFillIndices = ci::gl::Vbo( GL_ELEMENT_ARRAY_BUFFER );
+		ioShape.mFillIndices.bind();
+		ioShape.mFillIndices.bufferData( tFill.size() * sizeof( uint16_t ), &tFill[ 0 ], GL_STATIC_DRAW );
+		ioShape.mFillIndices.unbind();
+
+		// Outline: every point (the loop closes itself):
+		std::vector<uint16_t> tOutline( tSides );
+		for(size_t i = 0; i < tSides; i++) { tOutline[ i ] = static_cast<uint16_t>( i + 1 ); }
+		ioShape.mOutlineIndices = ci::gl::Vbo( GL_ELEMENT_ARRAY_BUFFER );
+		ioShape.mOutlineIndices.bind();
+		ioShape.mOutlineIndices.bufferData( tOutline.size() * sizeof( uint16_t ), &tOutline[ 0 ], GL_STATIC_DRAW );
+		ioShape.mOutlineIndices.unbind();
+
+		ioShape.mUploaded = true;
+	}
+
+	std::map<size_t, Shape>	mShapes;		//!< by side count (map entries don't move, so references stay valid)
+	std::vector<float>		mX, mY;			//!< scratch for computePoints()
+	bool					mSimd;
+	Stats					mStats;
+};
+
+/** @brief times computing many polygons' points with cos() / sin() per point, and from the cache (with and without SSE) */
+static void runPolygonCacheBenchmark(const size_t& iPolygons = 200000)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	ci::Rand tRand( 1234 );
+	std::vector<size_t> tSides( iPolygons );
+	std::vector<float> tRadii( iPolygons ), tRotations( iPolygons );
+	size_t tPoints = 0;
+	for(size_t p = 0; p < iPolygons; p++) {
+		tSides[ p ]     = 3 + tRand.nextInt( 48 );
+		tRadii[ p ]     = tRand.nextFloat( 10.0f, 200.0f );
+		tRotations[ p ] = tRand.nextFloat( 0.0f, 6.2831853f );
+		tPoints += tSides[ p ];
+	}
+	std::vector<float> tX( 64 ), tY( 64 ), tRefX( 64 ), tRefY( 64 );
+	ci::Vec2f tCenter( 320.0f, 240.0f );
+	std::cout << "Polygon cache benchmark: " << iPolygons << " polygons, " << tPoints << " points" << std::endl;
+
+	// Trigonometry for every point:
+	double tSum = 0.0;
+	Clock::time_point tStart = Clock::now();
+	for(size_t p = 0; p < iPolygons; p++) {
+		float tDelta = static_cast<float>( M_PI * 2.0 ) / tSides[ p ];
+		for(size_t i = 0; i < tSides[ p ]; i++) {
+			tX[ i ] = tCenter.x + tRadii[ p ] * std::cos( i * tDelta + tRotations[ p ] );
+			tY[ i ] = tCenter.y + tRadii[ p ] * std::sin( i * tDelta + tRotations[ p ] );
+		}
+		tSum += tX[ 0 ] + tY[ tSides[ p ] - 1 ];
+	}
+	double tTrigMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+	std::cout << "  cos / sin per point: " << tTrigMs << " ms" << std::endl;
+
+	// From the cache:
+	PolygonCache tCache;
+	for(int tSimd = 1; tSimd >= 0; tSimd--) {
+		tCache.setSimdEnabled( tSimd != 0 );
+		tStart = Clock::now();
+		for(size_t p = 0; p < iPolygons; p++) {
+			tCache.computePoints( tSides[ p ], tRadii[ p ], tRotations[ p ], tCenter, &tX[ 0 ], &tY[ 0 ] );
+			tSum += tX[ 0 ] + tY[ tSides[ p ] - 1 ];
+		}
+		double tMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+		std::cout << "  cached" << ( ( tSimd ) ? ( " (SSE):      " ) : ( " (scalar):   " ) ) << tMs << " ms (" << tTrigMs / tMs << "x)" << std::endl;
+	}
+
+	// Largest difference from the direct computation:
+	float tError = 0.0f;
+	for(size_t p = 0; p < std::min<size_t>( iPolygons, 1000 ); p++) {
+		float tDelta = static_cast<float>( M_PI * 2.0 ) / tSides[ p ];
+		tCache.computePoints( tSides[ p ], tRadii[ p ], tRotations[ p ], tCenter, &tX[ 0 ], &tY[ 0 ] );
+		for(size_t i = 0; i < tSides[ p ]; i++) {
+			tError = std::max( tError, std::fabs( tX[ i ] - ( tCenter.x + tRadii[ p ] * std::cos( i * tDelta + tRotations[ p ] ) ) ) );
+			tError = std::max( tError, std::fabs( tY[ i ] - ( tCenter.y + tRadii[ p ] * std::sin( i * tDelta + tRotations[ p ] ) ) ) );
+		}
+	}
+	std::cout << "  " << tCache.getStats().mShapes << " side counts cached, largest difference " << tError << " (checksum " << tSum << ")" << std::endl;
+}
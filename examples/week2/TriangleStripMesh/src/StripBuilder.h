@@ -0,0 +1,145 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Vbo.h"
+
+// A mesh that grows one vertex at a time could be drawn by sending every vertex
+// again each frame (with glBegin / glVertex / glEnd), but then the work per frame
+// grows with the mesh: building an n-vertex mesh costs n + (n - 1) + ... + 1,
+// about n * n / 2 vertex submissions in all.
+//
+// A strip "builder" instead keeps the vertices in a vertex buffer that is big
+// enough for the whole mesh (allocated once, up front), and only sends the GPU
+// the vertices added since the last frame. Those are written past the end of
+// what's been drawn so far, so the GPU never has to finish with them first.
+// Drawing the strip is one glDrawArrays() call on the buffer, however long the
+// strip has grown, so the total cost of a build is linear in its vertex count.
+//
+// If more vertices are added than were reserved, the buffer is re-allocated at
+// twice the size (and refilled), which keeps appending linear on average.
+
+/** @brief a growing vertex strip, uploaded incrementally to a pre-sized vertex buffer */
+class StripBuilder {
+public:
+	/** @brief counters (since the last clear()) */
+	struct Stats
+	{
+		size_t	mVertices;
+		size_t	mUploads;			//!< bufferSubData() calls
+		size_t	mUploadedBytes;		//!< vertex bytes sent to the GPU
+		size_t	mGrowths;			//!< times the buffer had to be re-allocated
+		size_t	mDraws;
+
+		/** @brief default constructor */
+		Stats() : mVertices( 0 ), mUploads( 0 ), mUploadedBytes( 0 ), mGrowths( 0 ), mDraws( 0 ) {}
+	};
+
+	/** @brief constructor (the expected vertex count, if known) */
+	StripBuilder(const size_t& iCapacity = 0) : mCapacity( 0 ), mReserved( iCapacity ), mUploaded( 0 )
+	{
+		mVertices.reserve( iCapacity );
+	}
+
+	/** @brief returns the vertex count of a u x v grid built as one strip, one row at a time, with two pivot vertices per row */
+	static size_t getGridStripVertexCount(const size_t& iSubdivisionsU, const size_t& iSubdivisionsV)
+	{
+		return iSubdivisionsV * ( ( iSubdivisionsU + 1 ) * 2 + 2 );
+	}
+
+	/** @brief sets the vertex count to allocate for (takes effect when the buffer is next allocated) */
+	void reserve(const size_t& iCapacity)
+	{
+		mReserved = iCapacity;
+		mVertices.reserve( iCapacity );
+	}
+
+	/** @brief removes every vertex (the buffer is kept, and orphaned on the next upload) */
+	void clear()
+	{
+		mVertices.clear();
+		mUploaded = 0;
+		mStats    = Stats();
+	}
+
+	/** @brief appends a vertex */
+	void append(const ci::Vec3f& iVertex)
+	{
+		mVertices.push_back( iVertex );
+		mStats.mVertices = mVertices.size();
+	}
+
+	/** @brief returns the vertex count */
+	size_t size() const { return mVertices.size(); }
+
+	/** @brief returns true if there are no vertices */
+	bool empty() const { return mVertices.empty(); }
+
+	/** @brief returns the vertices (also kept on the CPU) */
+	const std::vector<ci::Vec3f>& getVertices() const { return mVertices; }
+
+	/** @brief sends the vertices added since the last upload to the vertex buffer */
+	void upload()
+	{
+		if( mUploaded == mVertices.size() ) { return; }
+
+		if( !mBuffer ) { mBuffer = ci::gl::Vbo( GL_ARRAY_BUFFER ); }
+		mBuffer.bind();
+		if( mVertices.size() > mCapacity || mUploaded == 0 ) {
+			// (Re-)allocate: enough for the reserved count, or twice what's needed once that's been passed.
+			// Also done when starting over, so the GPU can still draw the old strip while we write the new one:
+			size_t tCapacity = std::max( std::max( mReserved, mCapacity ), static_cast<size_t>( 64 ) );
+			while( tCapacity < mVertices.size() ) { tCapacity *= 2; }
+			if( mCapacity && tCapacity > mCapacity ) { mStats.mGrowths++; }
+			mBuffer.bufferData( tCapacity * sizeof( ci::Vec3f ), NULL, GL_DYNAMIC_DRAW );
+			mCapacity = tCapacity;
+			mUploaded = 0;
+		}
+		size_t tCount = mVertices.size() - mUploaded;
+		mBuffer.bufferSubData( mUploaded * sizeof( ci::Vec3f ), tCount * sizeof( ci::Vec3f ), &mVertices[ mUploaded ] );
+		mBuffer.unbind();
+
+		mStats.mUploads++;
+		mStats.mUploadedBytes += tCount * sizeof( ci::Vec3f );
+		mUploaded = mVertices.size();
+	}
+
+	/** @brief uploads any new vertices and draws the strip (as GL_TRIANGLE_STRIP, GL_POINTS, GL_LINE_STRIP, etc.) */
+	void draw(const GLenum& iMode = GL_TRIANGLE_STRIP)
+	{
+		if( mVertices.empty() ) { return; }
+		upload();
+
+		mBuffer.bind();
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glVertexPointer( 3, GL_FLOAT, 0, 0 );
+		glDrawArrays( iMode, 0, static_cast<GLsizei>( mVertices.size() ) );
+		glDisableClientState( GL_VERTEX_ARRAY );
+		mBuffer.unbind();
+
+		mStats.mDraws++;
+	}
+
+	/** @brief returns the counters */
+	const Stats& getStats() const { return mStats; }
+
+protected:
+	std::vector<ci::Vec3f>	mVertices;		//!< every vertex so far
+	size_t					mCapacity;		//!< vertices the buffer holds
+	size_t					mReserved;		//!< vertices to allocate for
+	size_t					mUploaded;		//!< vertices already in the buffer
+	ci::gl::Vbo				mBuffer;
+	Stats					mStats;
+};
@@ -9,6 +9,9 @@
 #include "cinder/app/AppNative.h"
 #include "cinder/gl/gl.h"
 
+#include "HudText.h"
+#include "StripBuilder.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -18,12 +21,14 @@ public:
 	void prepareSettings(Settings* settings);
 	void setup();
 	void mouseDown( MouseEvent event );
+	void keyUp( KeyEvent event );
 	void update();
 	void draw();
 	
 	void reset();
 	
-	std::vector<ci::Vec3f>	mVertices;
+	StripBuilder			mStrip;			//!< the strip's vertices, uploaded as they're added
+	bool					mUseBuffer;
 	
 	float					mSubdivLengthU, mSubdivLengthV;
 	int						mSubdivisionsU, mSubdivisionsV;
@@ -32,6 +37,8 @@ public:
 	bool					mGoRight, mStepA, mReachedEnd;
 	
 	ci::Font				mFont;
+	HudText					mHud;			//!< text from a glyph atlas
+	bool					mUseHud;
 };
 
 void TriangleStripMeshApp::prepareSettings(Settings* settings)
@@ -47,8 +54,9 @@ void TriangleStripMeshApp::reset()
 	mStepA      = true;
 	mCurrU      = 0;
 	mCurrV      = 0;
-	// Clear the container:
-	mVertices.clear();
+	// Clear the container (the whole strip's vertices are allocated up front):
+	mStrip.clear();
+	mStrip.reserve( StripBuilder::getGridStripVertexCount( mSubdivisionsU, mSubdivisionsV ) );
 }
 
 void TriangleStripMeshApp::setup()
@@ -61,17 +69,51 @@ void TriangleStripMeshApp::setup()
 	mSubdivisionsU = 5;
 	mSubdivisionsV = 5;
 	
+	// Draw from the vertex buffer by default:
+	mUseBuffer = true;
+	
 	// Initialize construction variables:
 	reset();
 	
 	// Create font:
 	mFont = ci::Font( "Helvetica", 24 );
+	
+	// Render the font's characters once, for the info text:
+	mHud.setup( mFont );
+	mUseHud = true;
 }
 
 void TriangleStripMeshApp::mouseDown( MouseEvent event )
 {
 }
 
+void TriangleStripMeshApp::keyUp( KeyEvent event )
+{
+	switch( event.getChar() ) {
+		case 'c': {
+			mUseBuffer = !mUseBuffer;
+			cout << ( ( mUseBuffer ) ? ( "Drawing from a vertex buffer" ) : ( "Drawing with glBegin / glEnd" ) ) << endl;
+			break;
+		}
+		case 's': {
+			const StripBuilder::Stats& tStats = mStrip.getStats();
+			cout << tStats.mVertices << " vertices, " << tStats.mUploads << " uploads, " << tStats.mUploadedBytes << " bytes uploaded, "
+				<< tStats.mGrowths << " buffer growths, " << tStats.mDraws << " draws" << endl;
+			break;
+		}
+		case 't': {
+			mUseHud = !mUseHud;
+			cout << ( ( mUseHud ) ? ( "Drawing text from a glyph atlas" ) : ( "Drawing text with gl::drawStringCentered()" ) ) << endl;
+			break;
+		}
+		case 'h': {
+			runHudTextBenchmark( mHud );
+			break;
+		}
+		default: { break; }
+	}
+}
+
 void TriangleStripMeshApp::update()
 {
 }
@@ -97,25 +139,35 @@ void TriangleStripMeshApp::draw()
 	// Draw mesh:
 	{
 		// Get vertex count:
-		size_t vertCount = mVertices.size();
+		size_t vertCount = mStrip.size();
 		// Set point size:
 		glPointSize( 5 );
 		// Set line width:
 		gl::lineWidth( 1 );
 		// Draw vertices:
-		glBegin(GL_POINTS);
-		for(int i = 0; i < vertCount; i++) {
-			const Vec3f& currVert = mVertices.at(i);
-			glVertex3f( currVert.x, currVert.y, currVert.z );
+		if( mUseBuffer ) {
+			mStrip.draw( GL_POINTS );
+		}
+		else {
+			glBegin(GL_POINTS);
+			for(int i = 0; i < vertCount; i++) {
+				const Vec3f& currVert = mStrip.getVertices().at(i);
+				glVertex3f( currVert.x, currVert.y, currVert.z );
+			}
+			glEnd();
 		}
-		glEnd();
 		// Draw triangle strip:
-		glBegin(GL_TRIANGLE_STRIP);
-		for(int i = 0; i < vertCount; i++) {
-			const Vec3f& currVert = mVertices.at(i);
-			glVertex3f( currVert.x, currVert.y, currVert.z );
+		if( mUseBuffer ) {
+			mStrip.draw( GL_TRIANGLE_STRIP );
+		}
+		else {
+			glBegin(GL_TRIANGLE_STRIP);
+			for(int i = 0; i < vertCount; i++) {
+				const Vec3f& currVert = mStrip.getVertices().at(i);
+				glVertex3f( currVert.x, currVert.y, currVert.z );
+			}
+			glEnd();
 		}
-		glEnd();
 	}
 	
 	// Pop matrix:
@@ -124,14 +176,20 @@ void TriangleStripMeshApp::draw()
 	// Reset polygon mode:
 	gl::disableWireframe();
 	
-	// Draw the info text label
-	string textLabel = ("Vertex Index: " + to_string(mCurrV*mSubdivisionsU + mCurrU)
-						+ "\t\t Coordinate: (" + to_string( mCurrU ) + "," + to_string( mCurrV ) + ")\t\t Direction: "
-						+ (mGoRight?"Right":"Left") + "\t\t Step: " + (mStepA?"A":"B") );
-	
-	// Draw text label:
+	// Draw the info text label (from the glyph atlas: no string building, and no text rendering, each frame):
 	Vec2f textPos = Vec2f( getWindowWidth() / 2.0, 30.0 );
-	gl::drawStringCentered( textLabel, textPos, ColorA::white(), mFont );
+	if( mUseHud ) {
+		mHud.begin();
+		mHud.addTextf( textPos, ColorA::white(), HudText::ALIGN_CENTER, "Vertex Index: %d\t\t Coordinate: (%d,%d)\t\t Direction: %s\t\t Step: %s",
+					   mCurrV*mSubdivisionsU + mCurrU, mCurrU, mCurrV, (mGoRight?"Right":"Left"), (mStepA?"A":"B") );
+		mHud.end();
+	}
+	else {
+		string textLabel = ("Vertex Index: " + to_string(mCurrV*mSubdivisionsU + mCurrU)
+							+ "\t\t Coordinate: (" + to_string( mCurrU ) + "," + to_string( mCurrV ) + ")\t\t Direction: "
+							+ (mGoRight?"Right":"Left") + "\t\t Step: " + (mStepA?"A":"B") );
+		gl::drawStringCentered( textLabel, textPos, ColorA::white(), mFont );
+	}
 	
 	// Update animation
 	if(getElapsedFrames() % 30 == 0) {
@@ -179,15 +237,15 @@ void TriangleStripMeshApp::draw()
 		// Add the current vertex to the triangle strip container
 		// Notice, we are not sharing vertices here. We'll need to address this issue in a later implementation! (See note above)
 		Vec3f currVert = Vec3f( mSubdivLengthU * mCurrU, mSubdivLengthV * mCurrV, 0.0 );
-		mVertices.push_back( currVert );
+		mStrip.append( currVert );
 		
 		// Handle row endings when necessary:
 		// We need to determine whether we are at the last column in the row given the direction we're traveling.
 		// There are two Y values that will be enumerated for the final currU, we want the second of these value, step B.
 		if( !mStepA && ( (mGoRight && mCurrU == mSubdivisionsU) || (!mGoRight && mCurrU == 0) ) ) {
 			// When turning around, we add the last point again as a pivot and reverse normal.
-			mVertices.push_back( currVert );
-			mVertices.push_back( currVert );
+			mStrip.append( currVert );
+			mStrip.append( currVert );
 			// Reset to step type A
 			mStepA   = true;
 			// Alternate between row types
@@ -10,6 +10,8 @@
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
 
+#include "StripBuilder.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -19,13 +21,15 @@ public:
 	void prepareSettings(Settings* settings);
 	void setup();
 	void mouseDown( MouseEvent event );
+	void keyUp( KeyEvent event );
 	void resize();
 	void update();
 	void draw();
 	
 	void reset();
 	
-	std::vector<ci::Vec3f>	mVertices;
+	StripBuilder			mStrip;			//!< the strip's vertices, uploaded as they're added
+	bool					mUseBuffer;
 	
 	float					mProfileRadius, mCylinderLen;
 	int						mSubdivisionsU, mSubdivisionsV;
@@ -58,8 +62,9 @@ void TriangleStripMeshCylinderApp::reset()
 	mDeltaThetaU = ( M_PI * 2.0 ) / mSubdivisionsU;
 	// Set initial camera position:
 	mCamEye = Vec3f( mProfileRadius * mCamProfileRadiusMult, 0.0, 0.0 );
-	// Clear the container:
-	mVertices.clear();
+	// Clear the container (the whole strip's vertices are allocated up front):
+	mStrip.clear();
+	mStrip.reserve( StripBuilder::getGridStripVertexCount( mSubdivisionsU, mSubdivisionsV ) );
 }
 
 void TriangleStripMeshCylinderApp::setup()
@@ -84,6 +89,9 @@ void TriangleStripMeshCylinderApp::setup()
 	// Set the camera's radius multiplier:
 	mCamProfileRadiusMult = 3.0;
 	
+	// Draw from the vertex buffer by default:
+	mUseBuffer = true;
+	
 	// Initialize construction variables:
 	reset();
 }
@@ -98,6 +106,24 @@ void TriangleStripMeshCylinderApp::resize()
 	gl::setMatrices( mCam );
 }
 
+void TriangleStripMeshCylinderApp::keyUp( KeyEvent event )
+{
+	switch( event.getChar() ) {
+		case 'c': {
+			mUseBuffer = !mUseBuffer;
+			cout << ( ( mUseBuffer ) ? ( "Drawing from a vertex buffer" ) : ( "Drawing with glBegin / glEnd" ) ) << endl;
+			break;
+		}
+		case 's': {
+			const StripBuilder::Stats& tStats = mStrip.getStats();
+			cout << tStats.mVertices << " vertices, " << tStats.mUploads << " uploads, " << tStats.mUploadedBytes << " bytes uploaded, "
+				<< tStats.mGrowths << " buffer growths, " << tStats.mDraws << " draws" << endl;
+			break;
+		}
+		default: { break; }
+	}
+}
+
 void TriangleStripMeshCylinderApp::update()
 {
 }
@@ -118,7 +144,7 @@ void TriangleStripMeshCylinderApp::draw()
 	gl::color( 1.0, 0.0, 0.0 );
 	
 	// Get vertex count:
-	size_t tVertCount = mVertices.size();
+	size_t tVertCount = mStrip.size();
 	
 	// Set line width:
 	gl::lineWidth( 2 );
@@ -126,12 +152,17 @@ void TriangleStripMeshCylinderApp::draw()
 	// Draw mesh (in fill mode):
 	{
 		// Draw triangle strip:
-		glBegin(GL_TRIANGLE_STRIP);
-		for(int i = 0; i < tVertCount; i++) {
-			const Vec3f& currVert = mVertices.at(i);
-			glVertex3f( currVert.x, currVert.y, currVert.z );
+		if( mUseBuffer ) {
+			mStrip.draw( GL_TRIANGLE_STRIP );
+		}
+		else {
+			glBegin(GL_TRIANGLE_STRIP);
+			for(int i = 0; i < tVertCount; i++) {
+				const Vec3f& currVert = mStrip.getVertices().at(i);
+				glVertex3f( currVert.x, currVert.y, currVert.z );
+			}
+			glEnd();
 		}
-		glEnd();
 	}
 	
 	// Render polygon as wireframe:
@@ -143,12 +174,17 @@ void TriangleStripMeshCylinderApp::draw()
 	// Draw mesh (in wireframe mode):
 	{
 		// Draw triangle strip:
-		glBegin(GL_TRIANGLE_STRIP);
-		for(int i = 0; i < tVertCount; i++) {
-			const Vec3f& currVert = mVertices.at(i);
-			glVertex3f( currVert.x, currVert.y, currVert.z );
+		if( mUseBuffer ) {
+			mStrip.draw( GL_TRIANGLE_STRIP );
+		}
+		else {
+			glBegin(GL_TRIANGLE_STRIP);
+			for(int i = 0; i < tVertCount; i++) {
+				const Vec3f& currVert = mStrip.getVertices().at(i);
+				glVertex3f( currVert.x, currVert.y, currVert.z );
+			}
+			glEnd();
 		}
-		glEnd();
 	}
 	
 	// Draw origin:
@@ -194,15 +230,15 @@ void TriangleStripMeshCylinderApp::draw()
 	// Add the current vertex to the triangle strip container
 	// Notice, we are not sharing vertices here. We'll need to address this issue in a later implementation!
 	Vec3f currVert = Vec3f( x, y, z );
-	mVertices.push_back( currVert );
+	mStrip.append( currVert );
 	
 	// Handle row endings when necessary:
 	// We need to determine whether we are at the last column in the row given the direction we're traveling.
 	// There are two V values that will be enumerated for the final currU, we want the second of these value, step B.
 	if( !mStepA && ( (mGoRight && mCurrU == mSubdivisionsU) || (!mGoRight && mCurrU == 0) ) ) {
 		// When turning around, we add the last point again as a pivot and reverse normal.
-		mVertices.push_back( currVert );
-		mVertices.push_back( currVert );
+		mStrip.append( currVert );
+		mStrip.append( currVert );
 		// Reset to step type A
 		mStepA   = true;
 		// Alternate between row types
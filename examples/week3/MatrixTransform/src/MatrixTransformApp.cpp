@@ -10,6 +10,8 @@
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
 
+#include "TransformBatch.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -79,6 +81,11 @@ void MatrixTransformApp::keyUp(KeyEvent event)
 			mPaused = !mPaused;
 			break;
 		}
+		case 'b': {
+			// Compare per-node matrix composition with batched evaluation (see TransformBatch.h):
+			runTransformBenchmark();
+			break;
+		}
 		default: { break; }
 	}
 }
@@ -10,6 +10,9 @@
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
 
+#include "SceneNode.h"
+#include "TransformBatch.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -22,7 +25,22 @@ public:
 	void update();
 	void draw();
 	
-	CameraPersp mCam;
+	/** @brief drawing settings for a node */
+	struct Cube
+	{
+		Vec3f	mDimension;
+		Color	mColor;
+	};
+	
+	/** @brief creates a node (tagged with a new cube) and adds it to the given parent */
+	SceneNodeRef addCube(const SceneNodeRef& iParent, const Vec3f& iDimension, const Color& iColor);
+	
+	CameraPersp			mCam;
+	SceneNodeRef		mRoot;
+	SceneNodeRef		mOuterCube;
+	SceneNodeRef		mInnerCube;
+	vector<Cube>		mCubes;
+	SceneGraphFlattener	mFlattener;
 };
 
 void MatrixTransformNestedApp::setup()
@@ -36,6 +54,38 @@ void MatrixTransformNestedApp::setup()
 	
 	// Setup camera:
 	mCam.setPerspective( 60, getWindowAspectRatio(), 1, 1000 );
+	
+	// Build scene graph (the transformation settings are retained by the nodes):
+	mRoot = SceneNode::create();
+	
+	mOuterCube = addCube( mRoot, Vec3f( 1.0, 2.0, 2.0 ), Color( 0.0, 1.0, 0.0 ) );
+	mOuterCube->setTranslation( Vec3f( 1.5, 0.0, 0.0 ) );
+	mOuterCube->setScale( Vec3f( 0.5, 0.5, 0.5 ) );
+	mOuterCube->setAnchor( Vec3f( 0.0, 0.0, 0.0 ) );
+	
+	mInnerCube = addCube( mOuterCube, Vec3f( 3.0, 3.0, 3.0 ), Color( 0.0, 1.0, 1.0 ) );
+	mInnerCube->setTranslation( Vec3f( 0.0, 0.0, 0.0 ) );
+	mInnerCube->setScale( Vec3f( 0.25, 0.25, 0.25 ) );
+	mInnerCube->setAnchor( Vec3f( 0.0, 7.0, 0.0 ) );
+	
+	// Static cube (its matrices are computed once):
+	SceneNodeRef tStaticCube = addCube( mRoot, Vec3f( 1.0, 1.0, 1.0 ), Color( 1.0, 0.5, 0.0 ) );
+	tStaticCube->setTranslation( Vec3f( -1.5, 0.0, 0.0 ) );
+	tStaticCube->setRotation( Vec3f( 0.0, 45.0, 0.0 ) );
+	tStaticCube->setScale( Vec3f( 0.5, 0.5, 0.5 ) );
+}
+
+SceneNodeRef MatrixTransformNestedApp::addCube(const SceneNodeRef& iParent, const Vec3f& iDimension, const Color& iColor)
+{
+	Cube tCube;
+	tCube.mDimension = iDimension;
+	tCube.mColor     = iColor;
+	mCubes.push_back( tCube );
+	
+	SceneNodeRef tNode = SceneNode::create();
+	tNode->setTag( mCubes.size() - 1 );
+	iParent->addChild( tNode );
+	return tNode;
 }
 
 void MatrixTransformNestedApp::mouseDown( MouseEvent event )
@@ -44,10 +94,27 @@ void MatrixTransformNestedApp::mouseDown( MouseEvent event )
 
 void MatrixTransformNestedApp::keyUp(KeyEvent event)
 {
+	if( event.getChar() == 's' ) {
+		// Print the number of matrices computed during the last update:
+		cout << "Local matrix updates: " << SceneNode::getLocalUpdateCount() << ", world matrix updates: ";
+		cout << SceneNode::getWorldUpdateCount() << " (" << mFlattener.getNodes().size() << " nodes)" << endl;
+	}
+	else if( event.getChar() == 'b' ) {
+		// Compare per-node matrix composition with batched evaluation over a large hierarchy:
+		runTransformBenchmark();
+	}
 }
 
 void MatrixTransformNestedApp::update()
 {
+	SceneNode::resetUpdateCounts();
+	
+	// Only the animated nodes change (and only they and their descendants are recomputed):
+	mOuterCube->setRotation( Vec3f( getElapsedSeconds() * 90.0, 0.0, 0.0 ) );
+	mInnerCube->setRotation( Vec3f( getElapsedSeconds() * 180.0, 0.0, 0.0 ) );
+	
+	// Update the depth-ordered world matrix array:
+	mFlattener.update( mRoot );
 }
 
 void MatrixTransformNestedApp::draw()
@@ -70,70 +137,27 @@ void MatrixTransformNestedApp::draw()
 	// Draw origin:
 	gl::drawCoordinateFrame();
 	
-	// Prepare matrix transformation settings:
-	Vec3f tOuterCubeDimension   = Vec3f( 1.0, 2.0, 2.0 );
-	Vec3f tOuterCubeTranslation = Vec3f( 1.5, 0.0, 0.0 );
-	Vec3f tOuterCubeScale       = Vec3f( 0.5, 0.5, 0.5 );
-	Vec3f tOuterCubeRotation    = Vec3f( getElapsedSeconds() * 90.0, 0.0, 0.0 );
-	Vec3f tOuterCubeAnchor	    = Vec3f( 0.0, 0.0, 0.0 );
-	
-	Vec3f tInnerCubeDimension   = Vec3f( 3.0, 3.0, 3.0 );
-	Vec3f tInnerCubeTranslation = Vec3f( 0.0, 0.0, 0.0 );
-	Vec3f tInnerCubeScale       = Vec3f( 0.25, 0.25, 0.25 );
-	Vec3f tInnerCubeRotation    = Vec3f( getElapsedSeconds() * 180.0, 0.0, 0.0 );
-	Vec3f tInnerCubeAnchor	    = Vec3f( 0.0, 7.0, 0.0 );
-	
 	// Draw 3D geometry (that HAS been pre-centered about the origin):
-	{
-		// Set color:
-		gl::color( Color( 0.0, 1.0, 0.0 ) );
-		
-		// Push outer matrix:
-		gl::pushMatrices();
-		
-		// Apply translation:
-		gl::translate( tOuterCubeTranslation );
+	const vector<SceneNode*>& tNodes    = mFlattener.getNodes();
+	const vector<Matrix44f>&  tMatrices = mFlattener.getWorldMatrices();
+	size_t tCount = tNodes.size();
+	for(size_t i = 0; i < tCount; i++) {
+		// Skip nodes without geometry (such as the root):
+		int tTag = tNodes[ i ]->getTag();
+		if( tTag < 0 ) { continue; }
+		const Cube& tCube = mCubes[ tTag ];
 		
-		// Apply rotation:
-		gl::rotate( tOuterCubeRotation );
-		
-		// Apply scaling:
-		gl::scale( tOuterCubeScale );
+		// Set color:
+		gl::color( tCube.mColor );
 		
-		// Apply anchor translation:
-		gl::translate( tOuterCubeAnchor );
+		// Apply the node's (cached) world matrix:
+		gl::pushModelView();
+		gl::multModelView( tMatrices[ i ] );
 		
 		// Draw cube:
-		gl::drawStrokedCube( Vec3f::zero(), tOuterCubeDimension );
-		
-		{
-			// Set color:
-			gl::color( Color( 0.0, 1.0, 1.0 ) );
-			
-			// Push inner matrix:
-			gl::pushMatrices();
-			
-			// Apply translation:
-			gl::translate( tInnerCubeTranslation );
-			
-			// Apply rotation:
-			gl::rotate( tInnerCubeRotation );
-			
-			// Apply scaling:
-			gl::scale( tInnerCubeScale );
-			
-			// Apply anchor translation:
-			gl::translate( tInnerCubeAnchor );
-			
-			// Draw cube:
-			gl::drawStrokedCube( Vec3f::zero(), tInnerCubeDimension );
-			
-			// Pop inner matrix:
-			gl::popMatrices();
-		}
+		gl::drawStrokedCube( Vec3f::zero(), tCube.mDimension );
 		
-		// Pop outer matrix:
-		gl::popMatrices();
+		gl::popModelView();
 	}
 }
 
@@ -0,0 +1,272 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cinder/CinderMath.h"
+#include "cinder/Matrix.h"
+#include "cinder/Vector.h"
+
+// With gl::pushMatrices(), gl::translate(), gl::rotate() etc, the whole chain of
+// transformations is rebuilt every frame, even for objects that haven't moved.
+//
+// A "retained" scene graph instead remembers each object's transformation:
+// every node stores its translation, rotation, scale and anchor along with two
+// cached matrices:
+//
+//   local = translate * rotate * scale * translate( anchor )
+//   world = parent's world * local
+//
+// When a node's transformation changes, its local matrix is flagged as dirty,
+// and so are the world matrices of the node and everything below it (since all
+// of those depend on it). Matrices are only recomputed when they are requested
+// and flagged as dirty, so static parts of the scene cost nothing.
+
+class SceneNode;
+typedef std::shared_ptr<SceneNode> SceneNodeRef;
+
+/** @brief a node of a retained scene graph with cached local and world matrices */
+class SceneNode {
+public:
+	/** @brief returns a new node with the identity transformation */
+	static SceneNodeRef create()
+	{
+		return SceneNodeRef( new SceneNode() );
+	}
+
+	/** @brief destructor */
+	~SceneNode()
+	{
+		for(auto& tChild : mChildren) { tChild->mParent = NULL; }
+	}
+
+	/** @brief sets the translation */
+	void setTranslation(const ci::Vec3f& iTranslation) { if( iTranslation != mTranslation ) { mTranslation = iTranslation; invalidateLocal(); } }
+
+	/** @brief sets the rotation (euler angles in degrees, applied in x, y, z order like gl::rotate()) */
+	void setRotation(const ci::Vec3f& iRotation) { if( iRotation != mRotation ) { mRotation = iRotation; invalidateLocal(); } }
+
+	/** @brief sets the scale */
+	void setScale(const ci::Vec3f& iScale) { if( iScale != mScale ) { mScale = iScale; invalidateLocal(); } }
+
+	/** @brief sets the anchor translation (applied before scaling) */
+	void setAnchor(const ci::Vec3f& iAnchor) { if( iAnchor != mAnchor ) { mAnchor = iAnchor; invalidateLocal(); } }
+
+	const ci::Vec3f& getTranslation() const { return mTranslation; }
+	const ci::Vec3f& getRotation() const    { return mRotation; }
+	const ci::Vec3f& getScale() const       { return mScale; }
+	const ci::Vec3f& getAnchor() const      { return mAnchor; }
+
+	/** @brief appends a child (removing it from its previous parent) */
+	void addChild(const SceneNodeRef& iChild)
+	{
+		if( iChild->mParent ) { iChild->mParent->removeChild( iChild ); }
+		iChild->mParent = this;
+		iChild->invalidateWorld();
+		mChildren.push_back( iChild );
+		invalidateStructure();
+	}
+
+	/** @brief removes a child */
+	void removeChild(const SceneNodeRef& iChild)
+	{
+		auto tIt = std::find( mChildren.begin(), mChildren.end(), iChild );
+		if( tIt == mChildren.end() ) { return; }
+		invalidateStructure();
+		iChild->mParent = NULL;
+		iChild->invalidateWorld();
+		mChildren.erase( tIt );
+	}
+
+	/** @brief returns the parent (NULL for a root) */
+	SceneNode* getParent() const { return mParent; }
+
+	/** @brief returns the children */
+	const std::vector<SceneNodeRef>& getChildren() const { return mChildren; }
+
+	/** @brief sets an application-defined tag (e.g. an index into drawing data) */
+	void setTag(const int& iTag) { mTag = iTag; }
+
+	/** @brief returns the application-defined tag */
+	int getTag() const { return mTag; }
+
+	/** @brief returns the local matrix, recomputing it if dirty */
+	const ci::Matrix44f& getLocalMatrix()
+	{
+		if( mLocalDirty ) {
+			mLocal  = ci::Matrix44f::createTranslation( mTranslation );
+			mLocal *= ci::Matrix44f::createRotation( ci::Vec3f::xAxis(), ci::toRadians( mRotation.x ) );
+			mLocal *= ci::Matrix44f::createRotation( ci::Vec3f::yAxis(), ci::toRadians( mRotation.y ) );
+			mLocal *= ci::Matrix44f::createRotation( ci::Vec3f::zAxis(), ci::toRadians( mRotation.z ) );
+			mLocal *= ci::Matrix44f::createScale( mScale );
+			mLocal *= ci::Matrix44f::createTranslation( mAnchor );
+			mLocalDirty = false;
+			localUpdates()++;
+		}
+		return mLocal;
+	}
+
+	/** @brief returns the world matrix, recomputing it (and any dirty ancestors) if dirty */
+	const ci::Matrix44f& getWorldMatrix()
+	{
+		if( mWorldDirty ) {
+			mWorld = ( mParent ) ? ( mParent->getWorldMatrix() * getLocalMatrix() ) : ( getLocalMatrix() );
+			mWorldDirty = false;
+			mWorldVersion++;
+			worldUpdates()++;
+		}
+		return mWorld;
+	}
+
+	/** @brief returns whether the world matrix needs to be recomputed */
+	bool isWorldDirty() const { return mWorldDirty; }
+
+	/** @brief returns the number of times the world matrix has been recomputed (compare against a saved value to see if it changed) */
+	uint64_t getWorldVersion() const { return mWorldVersion; }
+
+	/** @brief returns true (and clears the flag) if nodes were added or removed below this root */
+	bool checkStructureChanged()
+	{
+		bool tChanged = mStructureDirty;
+		mStructureDirty = false;
+		return tChanged;
+	}
+
+	/** @brief returns the number of local matrices computed since the last call to resetUpdateCounts() */
+	static size_t getLocalUpdateCount() { return localUpdates(); }
+
+	/** @brief returns the number of world matrices computed since the last call to resetUpdateCounts() */
+	static size_t getWorldUpdateCount() { return worldUpdates(); }
+
+	/** @brief resets the update counters */
+	static void resetUpdateCounts() { localUpdates() = 0; worldUpdates() = 0; }
+
+protected:
+	SceneNode() :
+		mTranslation( ci::Vec3f::zero() ), mRotation( ci::Vec3f::zero() ), mScale( ci::Vec3f::one() ), mAnchor( ci::Vec3f::zero() ),
+		mParent( NULL ), mTag( -1 ), mLocalDirty( true ), mWorldDirty( true ), mStructureDirty( true ), mWorldVersion( 0 ) {}
+
+	/** @brief flags the local matrix and the world matrices of this subtree as dirty */
+	void invalidateLocal()
+	{
+		mLocalDirty = true;
+		invalidateWorld();
+	}
+
+	/** @brief flags the world matrices of this subtree as dirty */
+	void invalidateWorld()
+	{
+		// If this node is already dirty, so is everything below it:
+		if( mWorldDirty ) { return; }
+		mWorldDirty = true;
+		for(auto& tChild : mChildren) { tChild->invalidateWorld(); }
+	}
+
+	/** @brief flags the root of this node's tree as structurally changed */
+	void invalidateStructure()
+	{
+		SceneNode* tRoot = this;
+		while( tRoot->mParent ) { tRoot = tRoot->mParent; }
+		tRoot->mStructureDirty = true;
+	}
+
+	ci::Vec3f					mTranslation;
+	ci::Vec3f					mRotation;
+	ci::Vec3f					mScale;
+	ci::Vec3f					mAnchor;
+	ci::Matrix44f				mLocal;
+	ci::Matrix44f				mWorld;
+	SceneNode*					mParent;		//!< not owned (the parent owns its children)
+	std::vector<SceneNodeRef>	mChildren;
+	int							mTag;
+	bool						mLocalDirty;
+	bool						mWorldDirty;
+	bool						mStructureDirty;	//!< only meaningful on a root
+	uint64_t					mWorldVersion;		//!< incremented whenever mWorld is recomputed
+
+	// Counters (function-local statics keep this header-only):
+	static size_t& localUpdates() { static size_t sCount = 0; return sCount; }
+	static size_t& worldUpdates() { static size_t sCount = 0; return sCount; }
+};
+
+/** @brief flattens a scene graph into depth-ordered arrays for drawing */
+class SceneGraphFlattener {
+public:
+	/** @brief default constructor */
+	SceneGraphFlattener() {}
+
+	/** @brief updates the world matrices for the tree under the given root (re-flattening it if its structure changed) */
+	void update(const SceneNodeRef& iRoot)
+	{
+		// (The structure flag is cleared even when switching roots, so it isn't seen again on the next update:)
+		bool tStructureChanged = iRoot->checkStructureChanged();
+		if( iRoot != mRoot || tStructureChanged ) {
+			flatten( iRoot );
+		}
+
+		// Parents come before their children, so each world matrix only needs its
+		// parent's (already updated) matrix. Only matrices that were recomputed
+		// since the last update are copied. (The dirty flag can't tell us that:
+		// getWorldMatrix() calls made elsewhere, e.g. by a child, clear it.)
+		size_t tCount = mNodes.size();
+		for(size_t i = 0; i < tCount; i++) {
+			SceneNode* tNode = mNodes[ i ];
+			const ci::Matrix44f& tWorld = tNode->getWorldMatrix();
+			if( tNode->getWorldVersion() != mVersions[ i ] ) {
+				mWorldMatrices[ i ] = tWorld;
+				mVersions[ i ]      = tNode->getWorldVersion();
+			}
+		}
+	}
+
+	/** @brief returns the nodes in depth order (breadth-first) */
+	const std::vector<SceneNode*>& getNodes() const { return mNodes; }
+
+	/** @brief returns the world matrices, in the same order as getNodes() */
+	const std::vector<ci::Matrix44f>& getWorldMatrices() const { return mWorldMatrices; }
+
+	/** @brief returns the depth of each node, in the same order as getNodes() */
+	const std::vector<size_t>& getDepths() const { return mDepths; }
+
+protected:
+	/** @brief rebuilds the depth-ordered node list */
+	void flatten(const SceneNodeRef& iRoot)
+	{
+		mRoot = iRoot;
+		mNodes.clear();
+		mDepths.clear();
+		mNodes.push_back( iRoot.get() );
+		mDepths.push_back( 0 );
+		// Breadth-first traversal (the node list doubles as the queue):
+		for(size_t i = 0; i < mNodes.size(); i++) {
+			for(auto& tChild : mNodes[ i ]->getChildren()) {
+				mNodes.push_back( tChild.get() );
+				mDepths.push_back( mDepths[ i ] + 1 );
+			}
+		}
+
+		// Fill the (contiguous) world matrix array:
+		mWorldMatrices.resize( mNodes.size() );
+		mVersions.resize( mNodes.size() );
+		for(size_t i = 0; i < mNodes.size(); i++) {
+			mWorldMatrices[ i ] = mNodes[ i ]->getWorldMatrix();
+			mVersions[ i ]      = mNodes[ i ]->getWorldVersion();
+		}
+	}
+
+	SceneNodeRef				mRoot;
+	std::vector<SceneNode*>		mNodes;
+	std::vector<size_t>			mDepths;
+	std::vector<ci::Matrix44f>	mWorldMatrices;
+	std::vector<uint64_t>		mVersions;		//!< each node's world version when its matrix was last copied
+};
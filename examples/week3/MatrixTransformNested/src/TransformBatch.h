@@ -0,0 +1,350 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+	#define TRANSFORM_BATCH_SSE 1
+	#include <xmmintrin.h>
+#endif
+
+#include "cinder/CinderMath.h"
+#include "cinder/Matrix.h"
+#include "cinder/Rand.h"
+#include "cinder/Vector.h"
+
+#include "ParallelFor.h"
+
+// gl::translate(), gl::rotate() and friends handle one object at a time: for each
+// one, the driver multiplies a few matrices onto the top of its matrix stack. That's
+// fine for a handful of objects, but with many thousands the per-object overhead
+// dominates.
+//
+// A "data-oriented" alternative processes all transformations together:
+//
+// 1) Translation, rotation, scale and anchor are stored in separate arrays
+//    ("structure of arrays"), so a loop over one property reads contiguous memory.
+//
+// 2) Nodes are sorted by their depth in the hierarchy. All nodes at one depth only
+//    depend on nodes at the previous depth, so each depth level can be split
+//    between threads without any locking.
+//
+// 3) The world matrix of each node is its parent's world matrix times its local
+//    matrix. With SSE, each column of the result is computed with four multiplies
+//    and three adds on 4-float registers.
+
+/** @brief multiplies two column-major 4x4 matrices: oC = iA * iB (oC must not alias iA or iB) */
+static inline void multiplyMatrices(const float* iA, const float* iB, float* oC)
+{
+#ifdef TRANSFORM_BATCH_SSE
+	__m128 tA0 = _mm_loadu_ps( iA );
+	__m128 tA1 = _mm_loadu_ps( iA + 4 );
+	__m128 tA2 = _mm_loadu_ps( iA + 8 );
+	__m128 tA3 = _mm_loadu_ps( iA + 12 );
+	for(int j = 0; j < 4; j++) {
+		// Column j of C is A's columns weighted by column j of B:
+		const float* tB = iB + j * 4;
+		__m128 tCol = _mm_mul_ps( tA0, _mm_set1_ps( tB[ 0 ] ) );
+		tCol = _mm_add_ps( tCol, _mm_mul_ps( tA1, _mm_set1_ps( tB[ 1 ] ) ) );
+		tCol = _mm_add_ps( tCol, _mm_mul_ps( tA2, _mm_set1_ps( tB[ 2 ] ) ) );
+		tCol = _mm_add_ps( tCol, _mm_mul_ps( tA3, _mm_set1_ps( tB[ 3 ] ) ) );
+		_mm_storeu_ps( oC + j * 4, tCol );
+	}
+#else
+	for(int j = 0; j < 4; j++) {
+		for(int i = 0; i < 4; i++) {
+			oC[ j * 4 + i ] = iA[ i ] * iB[ j * 4 ] + iA[ 4 + i ] * iB[ j * 4 + 1 ] + iA[ 8 + i ] * iB[ j * 4 + 2 ] + iA[ 12 + i ] * iB[ j * 4 + 3 ];
+		}
+	}
+#endif
+}
+
+/** @brief a hierarchy of transformations stored as depth-sorted arrays */
+class TransformBatch {
+public:
+	/** @brief default constructor */
+	TransformBatch() : mSorted( false ), mParallelThreshold( 4096 ) {}
+
+	/** @brief adds a node with the identity transformation and returns its handle (parents must be added before their children) */
+	uint32_t addNode(const int32_t& iParent = -1)
+	{
+		uint32_t tHandle = static_cast<uint32_t>( mSlots.size() );
+		uint32_t tDepth  = ( iParent >= 0 ) ? ( mDepth[ mSlots[ iParent ] ] + 1 ) : ( 0 );
+		mSlots.push_back( static_cast<uint32_t>( mParent.size() ) );
+		mHandles.push_back( tHandle );
+		mParent.push_back( ( iParent >= 0 ) ? ( static_cast<int32_t>( mSlots[ iParent ] ) ) : ( -1 ) );
+		mDepth.push_back( tDepth );
+		mTx.push_back( 0.0f ); mTy.push_back( 0.0f ); mTz.push_back( 0.0f );
+		mRx.push_back( 0.0f ); mRy.push_back( 0.0f ); mRz.push_back( 0.0f );
+		mSx.push_back( 1.0f ); mSy.push_back( 1.0f ); mSz.push_back( 1.0f );
+		mAx.push_back( 0.0f ); mAy.push_back( 0.0f ); mAz.push_back( 0.0f );
+		mSorted = false;
+		return tHandle;
+	}
+
+	/** @brief removes all nodes */
+	void clear()
+	{
+		*this = TransformBatch();
+	}
+
+	/** @brief returns the number of nodes */
+	size_t getNodeCount() const { return mSlots.size(); }
+
+	/** @brief sets a node's translation */
+	void setTranslation(const uint32_t& iHandle, const ci::Vec3f& iValue) { uint32_t s = mSlots[ iHandle ]; mTx[ s ] = iValue.x; mTy[ s ] = iValue.y; mTz[ s ] = iValue.z; }
+
+	/** @brief sets a node's rotation (euler angles in degrees, applied in x, y, z order like gl::rotate()) */
+	void setRotation(const uint32_t& iHandle, const ci::Vec3f& iValue)    { uint32_t s = mSlots[ iHandle ]; mRx[ s ] = iValue.x; mRy[ s ] = iValue.y; mRz[ s ] = iValue.z; }
+
+	/** @brief sets a node's scale */
+	void setScale(const uint32_t& iHandle, const ci::Vec3f& iValue)       { uint32_t s = mSlots[ iHandle ]; mSx[ s ] = iValue.x; mSy[ s ] = iValue.y; mSz[ s ] = iValue.z; }
+
+	/** @brief sets a node's anchor translation (applied before scaling) */
+	void setAnchor(const uint32_t& iHandle, const ci::Vec3f& iValue)      { uint32_t s = mSlots[ iHandle ]; mAx[ s ] = iValue.x; mAy[ s ] = iValue.y; mAz[ s ] = iValue.z; }
+
+	/** @brief sets the minimum level size that is split between threads (0 disables threading) */
+	void setParallelThreshold(const size_t& iThreshold) { mParallelThreshold = iThreshold; }
+
+	/** @brief computes all local and world matrices */
+	void update()
+	{
+		if( !mSorted ) { sortByDepth(); }
+
+		size_t tCount = mParent.size();
+		mLocal.resize( tCount );
+		mWorld.resize( tCount );
+
+		// Process one depth level at a time (each level only reads the previous one):
+		for(size_t iLevel = 0; iLevel + 1 < mLevels.size(); iLevel++) {
+			size_t tBegin = mLevels[ iLevel ];
+			size_t tSize  = mLevels[ iLevel + 1 ] - tBegin;
+			auto tTask = [this, tBegin] (size_t iBegin, size_t iEnd) {
+				computeLocal( tBegin + iBegin, tBegin + iEnd );
+				computeWorld( tBegin + iBegin, tBegin + iEnd );
+			};
+			if( mParallelThreshold > 0 && tSize >= mParallelThreshold ) {
+				parallelFor( tSize, tTask );
+			}
+			else {
+				tTask( 0, tSize );
+			}
+		}
+	}
+
+	/** @brief returns a node's world matrix (valid after update()) */
+	const ci::Matrix44f& getWorldMatrix(const uint32_t& iHandle) const { return mWorld[ mSlots[ iHandle ] ]; }
+
+	/** @brief returns all world matrices in depth order (valid after update()) */
+	const std::vector<ci::Matrix44f>& getWorldMatrices() const { return mWorld; }
+
+	/** @brief returns the handle of the node stored at the given position of getWorldMatrices() */
+	uint32_t getHandle(const size_t& iSlot) const { return mHandles[ iSlot ]; }
+
+	/** @brief returns the number of depth levels */
+	size_t getLevelCount() const { return ( mLevels.empty() ) ? ( 0 ) : ( mLevels.size() - 1 ); }
+
+protected:
+	/** @brief reorders all arrays so that nodes are grouped by depth */
+	void sortByDepth()
+	{
+		size_t tCount = mParent.size();
+		std::vector<uint32_t> tOrder( tCount );
+		for(size_t i = 0; i < tCount; i++) { tOrder[ i ] = static_cast<uint32_t>( i ); }
+		std::stable_sort( tOrder.begin(), tOrder.end(), [this] (uint32_t a, uint32_t b) { return mDepth[ a ] < mDepth[ b ]; } );
+
+		// Old slot -> new slot:
+		std::vector<uint32_t> tRemap( tCount );
+		for(size_t i = 0; i < tCount; i++) { tRemap[ tOrder[ i ] ] = static_cast<uint32_t>( i ); }
+
+		std::vector<int32_t> tParent( tCount );
+		for(size_t i = 0; i < tCount; i++) {
+			int32_t tOld = mParent[ tOrder[ i ] ];
+			tParent[ i ] = ( tOld >= 0 ) ? ( static_cast<int32_t>( tRemap[ tOld ] ) ) : ( -1 );
+		}
+		mParent.swap( tParent );
+		permute( mDepth, tOrder ); permute( mHandles, tOrder );
+		permute( mTx, tOrder ); permute( mTy, tOrder ); permute( mTz, tOrder );
+		permute( mRx, tOrder ); permute( mRy, tOrder ); permute( mRz, tOrder );
+		permute( mSx, tOrder ); permute( mSy, tOrder ); permute( mSz, tOrder );
+		permute( mAx, tOrder ); permute( mAy, tOrder ); permute( mAz, tOrder );
+		for(size_t i = 0; i < tCount; i++) { mSlots[ mHandles[ i ] ] = static_cast<uint32_t>( i ); }
+
+		// Find the first node of each level:
+		mLevels.clear();
+		for(size_t i = 0; i < tCount; i++) {
+			while( mLevels.size() <= mDepth[ i ] ) { mLevels.push_back( i ); }
+		}
+		mLevels.push_back( tCount );
+		mSorted = true;
+	}
+
+	/** @brief reorders an array: oValues[ i ] = old oValues[ iOrder[ i ] ] */
+	template<typename T>
+	static void permute(std::vector<T>& oValues, const std::vector<uint32_t>& iOrder)
+	{
+		std::vector<T> tValues( oValues.size() );
+		for(size_t i = 0; i < iOrder.size(); i++) { tValues[ i ] = oValues[ iOrder[ i ] ]; }
+		oValues.swap( tValues );
+	}
+
+	/** @brief computes local = translate * rotateX * rotateY * rotateZ * scale * translate( anchor ) for a range of slots */
+	void computeLocal(const size_t& iBegin, const size_t& iEnd)
+	{
+		const float tToRad = static_cast<float>( M_PI / 180.0 );
+		for(size_t i = iBegin; i < iEnd; i++) {
+			float cx = cosf( mRx[ i ] * tToRad ), sx = sinf( mRx[ i ] * tToRad );
+			float cy = cosf( mRy[ i ] * tToRad ), sy = sinf( mRy[ i ] * tToRad );
+			float cz = cosf( mRz[ i ] * tToRad ), sz = sinf( mRz[ i ] * tToRad );
+
+			// Rotation columns, scaled:
+			float* m = mLocal[ i ].m;
+			m[ 0 ]  = (  cy * cz )                * mSx[ i ];
+			m[ 1 ]  = (  sx * sy * cz + cx * sz ) * mSx[ i ];
+			m[ 2 ]  = ( -cx * sy * cz + sx * sz ) * mSx[ i ];
+			m[ 3 ]  = 0.0f;
+			m[ 4 ]  = ( -cy * sz )                * mSy[ i ];
+			m[ 5 ]  = ( -sx * sy * sz + cx * cz ) * mSy[ i ];
+			m[ 6 ]  = (  cx * sy * sz + sx * cz ) * mSy[ i ];
+			m[ 7 ]  = 0.0f;
+			m[ 8 ]  = (  sy )                     * mSz[ i ];
+			m[ 9 ]  = ( -sx * cy )                * mSz[ i ];
+			m[ 10 ] = (  cx * cy )                * mSz[ i ];
+			m[ 11 ] = 0.0f;
+
+			// Translation, plus the anchor carried through rotation and scale:
+			m[ 12 ] = mTx[ i ] + m[ 0 ] * mAx[ i ] + m[ 4 ] * mAy[ i ] + m[ 8 ]  * mAz[ i ];
+			m[ 13 ] = mTy[ i ] + m[ 1 ] * mAx[ i ] + m[ 5 ] * mAy[ i ] + m[ 9 ]  * mAz[ i ];
+			m[ 14 ] = mTz[ i ] + m[ 2 ] * mAx[ i ] + m[ 6 ] * mAy[ i ] + m[ 10 ] * mAz[ i ];
+			m[ 15 ] = 1.0f;
+		}
+	}
+
+	/** @brief computes world = parent's world * local for a range of slots */
+	void computeWorld(const size_t& iBegin, const size_t& iEnd)
+	{
+		for(size_t i = iBegin; i < iEnd; i++) {
+			int32_t tParent = mParent[ i ];
+			if( tParent < 0 ) {
+				mWorld[ i ] = mLocal[ i ];
+			}
+			else {
+				multiplyMatrices( mWorld[ tParent ].m, mLocal[ i ].m, mWorld[ i ].m );
+			}
+		}
+	}
+
+	// Structure:
+	std::vector<uint32_t>		mSlots;		//!< handle -> position in the arrays
+	std::vector<uint32_t>		mHandles;	//!< position -> handle
+	std::vector<int32_t>		mParent;	//!< position of the parent (or -1)
+	std::vector<uint32_t>		mDepth;
+	std::vector<size_t>			mLevels;	//!< first position of each depth level (plus the end)
+	bool						mSorted;
+	size_t						mParallelThreshold;
+
+	// Transformations (structure of arrays):
+	std::vector<float>			mTx, mTy, mTz;
+	std::vector<float>			mRx, mRy, mRz;
+	std::vector<float>			mSx, mSy, mSz;
+	std::vector<float>			mAx, mAy, mAz;
+
+	// Results:
+	std::vector<ci::Matrix44f>	mLocal;
+	std::vector<ci::Matrix44f>	mWorld;
+};
+
+/** @brief times a synthetic hierarchy against per-node Matrix44f composition and prints the results */
+static void runTransformBenchmark(const size_t& iNodeCount = 100000, const size_t& iBranching = 4, const size_t& iIterations = 20)
+{
+	using namespace ci;
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// Build a random hierarchy (each node's parent is one of the nodes of the previous level):
+	Rand tRand( 1234 );
+	TransformBatch tBatch;
+	std::vector<int32_t> tParents;
+	std::vector<Vec3f>   tT, tR, tS, tA;
+	size_t tPrevBegin = 0, tPrevEnd = 0;
+	while( tParents.size() < iNodeCount ) {
+		size_t tLevelBegin = tParents.size();
+		size_t tLevelSize  = ( tLevelBegin == 0 ) ? ( 1 ) : ( ( tPrevEnd - tPrevBegin ) * iBranching );
+		for(size_t i = 0; i < tLevelSize && tParents.size() < iNodeCount; i++) {
+			int32_t tParent = ( tLevelBegin == 0 ) ? ( -1 ) : ( static_cast<int32_t>( tPrevBegin + i / iBranching ) );
+			tParents.push_back( tParent );
+			tT.push_back( tRand.nextVec3f() * tRand.nextFloat( 0.5f, 2.0f ) );
+			tR.push_back( Vec3f( tRand.nextFloat( 360.0f ), tRand.nextFloat( 360.0f ), tRand.nextFloat( 360.0f ) ) );
+			tS.push_back( Vec3f( tRand.nextFloat( 0.8f, 1.2f ), tRand.nextFloat( 0.8f, 1.2f ), tRand.nextFloat( 0.8f, 1.2f ) ) );
+			tA.push_back( tRand.nextVec3f() * 0.1f );
+			uint32_t tHandle = tBatch.addNode( tParent );
+			tBatch.setTranslation( tHandle, tT.back() );
+			tBatch.setRotation( tHandle, tR.back() );
+			tBatch.setScale( tHandle, tS.back() );
+			tBatch.setAnchor( tHandle, tA.back() );
+		}
+		tPrevBegin = tLevelBegin;
+		tPrevEnd   = tParents.size();
+	}
+	size_t tCount = tParents.size();
+
+	// Reference: one node at a time, composing Matrix44f objects the way the matrix stack would:
+	std::vector<Matrix44f> tReference( tCount );
+	Clock::time_point tStart = Clock::now();
+	for(size_t iIter = 0; iIter < iIterations; iIter++) {
+		for(size_t i = 0; i < tCount; i++) {
+			Matrix44f tLocal = Matrix44f::createTranslation( tT[ i ] );
+			tLocal *= Matrix44f::createRotation( Vec3f::xAxis(), toRadians( tR[ i ].x ) );
+			tLocal *= Matrix44f::createRotation( Vec3f::yAxis(), toRadians( tR[ i ].y ) );
+			tLocal *= Matrix44f::createRotation( Vec3f::zAxis(), toRadians( tR[ i ].z ) );
+			tLocal *= Matrix44f::createScale( tS[ i ] );
+			tLocal *= Matrix44f::createTranslation( tA[ i ] );
+			tReference[ i ] = ( tParents[ i ] >= 0 ) ? ( tReference[ tParents[ i ] ] * tLocal ) : ( tLocal );
+		}
+	}
+	double tReferenceTime = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count() / iIterations;
+
+	// Batched, single thread:
+	tBatch.setParallelThreshold( 0 );
+	tBatch.update();
+	tStart = Clock::now();
+	for(size_t iIter = 0; iIter < iIterations; iIter++) { tBatch.update(); }
+	double tBatchTime = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count() / iIterations;
+
+	// Batched, threads per level:
+	tBatch.setParallelThreshold( 4096 );
+	tStart = Clock::now();
+	for(size_t iIter = 0; iIter < iIterations; iIter++) { tBatch.update(); }
+	double tParallelTime = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count() / iIterations;
+
+	// Compare results:
+	float tMaxError = 0.0f;
+	for(size_t i = 0; i < tCount; i++) {
+		const Matrix44f& tWorld = tBatch.getWorldMatrix( static_cast<uint32_t>( i ) );
+		for(int k = 0; k < 16; k++) {
+			tMaxError = std::max( tMaxError, std::fabs( tWorld.m[ k ] - tReference[ i ].m[ k ] ) );
+		}
+	}
+
+	std::cout << "Transform benchmark: " << tCount << " nodes, " << tBatch.getLevelCount() << " levels";
+#ifdef TRANSFORM_BATCH_SSE
+	std::cout << " (SSE)";
+#endif
+	std::cout << std::endl;
+	std::cout << "  per-node Matrix44f:  " << tReferenceTime << " ms" << std::endl;
+	std::cout << "  batched:             " << tBatchTime << " ms" << std::endl;
+	std::cout << "  batched + threads:   " << tParallelTime << " ms" << std::endl;
+	std::cout << "  max abs difference:  " << tMaxError << std::endl;
+}
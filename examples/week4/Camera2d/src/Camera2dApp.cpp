@@ -10,6 +10,8 @@
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
 
+#include "QuadBatch.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -23,7 +25,9 @@ class Camera2dApp : public AppNative {
 	void draw();
 	
 	bool		mPreserveAspect;
+	bool		mBatching;
 	CameraOrtho mCam;
+	QuadBatch	mQuads;
 };
 
 void Camera2dApp::setup()
@@ -33,6 +37,7 @@ void Camera2dApp::setup()
 	
 	// Set initial state:
 	mPreserveAspect = false;
+	mBatching       = true;
 }
 
 void Camera2dApp::mouseDown(MouseEvent event)
@@ -41,8 +46,28 @@ void Camera2dApp::mouseDown(MouseEvent event)
 
 void Camera2dApp::keyUp(KeyEvent event)
 {
-	if( event.getChar() == ' ' ) {
-		mPreserveAspect = !mPreserveAspect;
+	switch( event.getChar() ) {
+		case ' ': {
+			mPreserveAspect = !mPreserveAspect;
+			break;
+		}
+		case 'q': {
+			// Toggle between the quad batch and one gl::drawSolidRect() call per square:
+			mBatching = !mBatching;
+			break;
+		}
+		case 's': {
+			// Print batch stats (for the last frame):
+			const QuadBatch::Stats& tStats = mQuads.getStats();
+			if( mBatching ) {
+				cout << tStats.mQuads << " quads, " << tStats.mBatches << " batch(es), " << tStats.mBytes << " bytes" << endl;
+			}
+			else {
+				cout << "Batching off: one draw call per square" << endl;
+			}
+			break;
+		}
+		default: { break; }
 	}
 }
 
@@ -84,19 +109,28 @@ void Camera2dApp::draw()
 	gl::setMatrices( mCam );
 	
 	// Draw checkerboard centered on origin:
+	// (With batching, all 400 squares are collected and drawn with a single call.)
+	if( mBatching ) {
+		mQuads.begin();
+	}
 	for(int x = -10; x < 10; x++) {
 		for(int y = -10; y < 10; y++) {
 			float tMult = lmap<float>( y, -10.0, 10.0, 0.0, 1.0 );
-			if( abs(x) % 2 != abs(y) % 2 ) {
-				gl::color( tMult, 0.3, 0.3 );
+			ColorA tColor = ( abs(x) % 2 != abs(y) % 2 ) ? ( ColorA( tMult, 0.3, 0.3, 1.0 ) ) : ( ColorA( tMult, 0.7, 0.7, 1.0 ) );
+			Rectf tRect( x * tUnitLen, y * tUnitLen, x * tUnitLen + tUnitLen, y * tUnitLen + tUnitLen );
+			if( mBatching ) {
+				mQuads.addQuad( tRect, tColor );
 			}
 			else {
-				gl::color( tMult, 0.7, 0.7 );
+				gl::color( tColor );
+				gl::drawSolidRect( tRect );
 			}
-			gl::drawSolidRect( Rectf( x * tUnitLen, y * tUnitLen, x * tUnitLen + tUnitLen, y * tUnitLen + tUnitLen ) );
 		}
 	}
-	
+	if( mBatching ) {
+		mQuads.end();
+	}
+
 }
 
 CINDER_APP_NATIVE( Camera2dApp, RendererGl )
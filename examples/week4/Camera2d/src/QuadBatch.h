@@ -0,0 +1,241 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cinder/Color.h"
+#include "cinder/Rect.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Texture.h"
+#include "cinder/gl/Vbo.h"
+
+// Calling gl::color() and gl::drawSolidRect() for every rectangle means one draw
+// call (and a round trip through immediate mode) per rectangle. A "quad batcher"
+// instead collects the rectangles' vertices, each with its own color, into a
+// CPU-side array, and sends them to the GPU in one go: one draw call for every
+// rectangle that shares the same "material" (here: the same texture, or none).
+//
+// The batch is "flushed" (uploaded and drawn) when:
+//   - the material changes (quads with different textures can't share a call),
+//   - the array is full (it holds a fixed number of quads), or
+//   - the frame ends (end()).
+//
+// The vertex buffer is used as a "streaming" buffer: each flush writes to the
+// next free part of it. When it's full, its storage is "orphaned" (re-allocated
+// with no data), which lets the driver hand us fresh memory instead of waiting
+// for the GPU to finish drawing from the old contents.
+
+/** @brief collects colored (and optionally textured) quads and draws them with as few calls as possible */
+class QuadBatch {
+public:
+	/** @brief a vertex as stored in the vertex buffer (20 bytes) */
+	struct Vertex
+	{
+		ci::Vec2f		mPosition;
+		ci::Vec2f		mTexCoord;
+		ci::ColorA8u	mColor;
+	};
+
+	/** @brief per-frame counters (from begin() to end()) */
+	struct Stats
+	{
+		size_t	mQuads;
+		size_t	mBatches;				//!< draw calls
+		size_t	mBytes;					//!< vertex bytes uploaded
+		size_t	mMaterialFlushes;		//!< batches ended by a texture change
+		size_t	mCapacityFlushes;		//!< batches ended by a full buffer
+		size_t	mOrphans;				//!< times the vertex buffer storage was re-allocated
+
+		/** @brief default constructor */
+		Stats() : mQuads( 0 ), mBatches( 0 ), mBytes( 0 ), mMaterialFlushes( 0 ), mCapacityFlushes( 0 ), mOrphans( 0 ) {}
+	};
+
+	/** @brief constructor (quads per batch, and the number of batches the streaming buffer holds before it is orphaned) */
+	QuadBatch(const size_t& iQuadsPerBatch = 4096, const size_t& iBatchesPerBuffer = 4) :
+		mQuadsPerBatch( iQuadsPerBatch ), mBufferBytes( iQuadsPerBatch * iBatchesPerBuffer * 4 * sizeof( Vertex ) ),
+		mWriteOffset( 0 ), mTextureId( 0 ), mTextureTarget( GL_TEXTURE_2D ), mInitialized( false )
+	{
+		// (Indices are 16 bits, so a batch can address at most 65536 vertices.)
+		if( mQuadsPerBatch > 16384 ) { mQuadsPerBatch = 16384; }
+		mVertices.reserve( mQuadsPerBatch * 4 );
+	}
+
+	/** @brief starts a frame (resets the counters) */
+	void begin()
+	{
+		mStats = Stats();
+		mVertices.clear();
+	}
+
+	/** @brief draws any remaining quads and ends the frame */
+	void end()
+	{
+		flush();
+	}
+
+	/** @brief sets the texture for subsequent quads (flushing if it differs from the current one) */
+	void setTexture(const ci::gl::Texture& iTexture)
+	{
+		setTexture( iTexture.getId(), iTexture.getTarget() );
+	}
+
+	/** @brief disables texturing for subsequent quads (flushing if a texture was set) */
+	void clearTexture()
+	{
+		setTexture( 0, GL_TEXTURE_2D );
+	}
+
+	/** @brief adds a solid rectangle */
+	void addQuad(const ci::Rectf& iRect, const ci::ColorA& iColor)
+	{
+		addQuad( iRect, ci::Rectf( 0.0f, 0.0f, 1.0f, 1.0f ), iColor, iColor, iColor, iColor );
+	}
+
+	/** @brief adds a textured rectangle */
+	void addQuad(const ci::Rectf& iRect, const ci::Rectf& iTexRect, const ci::ColorA& iColor)
+	{
+		addQuad( iRect, iTexRect, iColor, iColor, iColor, iColor );
+	}
+
+	/** @brief adds a rectangle with one color per corner (upper-left, upper-right, lower-right, lower-left) */
+	void addQuad(const ci::Rectf& iRect, const ci::Rectf& iTexRect, const ci::ColorA& iColorA, const ci::ColorA& iColorB, const ci::ColorA& iColorC, const ci::ColorA& iColorD)
+	{
+		// Full? Draw what we have first:
+		if( mVertices.size() + 4 > mQuadsPerBatch * 4 ) {
+			mStats.mCapacityFlushes++;
+			flush();
+		}
+		pushVertex( ci::Vec2f( iRect.x1, iRect.y1 ), ci::Vec2f( iTexRect.x1, iTexRect.y1 ), iColorA );
+		pushVertex( ci::Vec2f( iRect.x2, iRect.y1 ), ci::Vec2f( iTexRect.x2, iTexRect.y1 ), iColorB );
+		pushVertex( ci::Vec2f( iRect.x2, iRect.y2 ), ci::Vec2f( iTexRect.x2, iTexRect.y2 ), iColorC );
+		pushVertex( ci::Vec2f( iRect.x1, iRect.y2 ), ci::Vec2f( iTexRect.x1, iTexRect.y2 ), iColorD );
+		mStats.mQuads++;
+	}
+
+	/** @brief uploads and draws the pending quads */
+	void flush()
+	{
+		if( mVertices.empty() ) { return; }
+		initialize();
+
+		// Find room in the streaming buffer (orphaning it when it's full):
+		size_t tBytes = mVertices.size() * sizeof( Vertex );
+		mVertexBuffer.bind();
+		if( mWriteOffset + tBytes > mBufferBytes ) {
+			mVertexBuffer.bufferData( mBufferBytes, NULL, GL_STREAM_DRAW );
+			mWriteOffset = 0;
+			mStats.mOrphans++;
+		}
+		mVertexBuffer.bufferSubData( mWriteOffset, tBytes, &mVertices[ 0 ] );
+
+		// Set vertex pointers (relative to this batch's part of the buffer):
+		const char* tBase = reinterpret_cast<const char*>( mWriteOffset );
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, sizeof( Vertex ), tBase + offsetof( Vertex, mPosition ) );
+		glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( Vertex ), tBase + offsetof( Vertex, mColor ) );
+		if( mTextureId ) {
+			glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+			glTexCoordPointer( 2, GL_FLOAT, sizeof( Vertex ), tBase + offsetof( Vertex, mTexCoord ) );
+			glEnable( mTextureTarget );
+			glBindTexture( mTextureTarget, mTextureId );
+		}
+
+		// Draw (two triangles per quad, from the shared index buffer):
+		mIndexBuffer.bind();
+		glDrawElements( GL_TRIANGLES, static_cast<GLsizei>( mVertices.size() / 4 * 6 ), GL_UNSIGNED_SHORT, 0 );
+		mIndexBuffer.unbind();
+
+		// Restore state:
+		if( mTextureId ) {
+			glBindTexture( mTextureTarget, 0 );
+			glDisable( mTextureTarget );
+			glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+		}
+		glDisableClientState( GL_COLOR_ARRAY );
+		glDisableClientState( GL_VERTEX_ARRAY );
+		mVertexBuffer.unbind();
+
+		// Update counters:
+		mWriteOffset += tBytes;
+		mStats.mBatches++;
+		mStats.mBytes += tBytes;
+		mVertices.clear();
+	}
+
+	/** @brief returns the counters for the current (or last) frame */
+	const Stats& getStats() const { return mStats; }
+
+protected:
+	/** @brief creates the buffers (needs a GL context, so it's deferred until the first flush) */
+	void initialize()
+	{
+		if( mInitialized ) { return; }
+
+		// Quad i uses vertices 4i .. 4i + 3, as triangles ( 0, 1, 2 ) and ( 0, 2, 3 ):
+		std::vector<uint16_t> tIndices( mQuadsPerBatch * 6 );
+		for(size_t i = 0; i < mQuadsPerBatch; i++) {
+			uint16_t tBase = static_cast<uint16_t>( i * 4 );
+			tIndices[ i * 6 + 0 ] = tBase;
+			tIndices[ i * 6 + 1 ] = tBase + 1;
+			tIndices[ i * 6 + 2 ] = tBase + 2;
+			tIndices[ i * 6 + 3 ] = tBase;
+			tIndices[ i * 6 + 4 ] = tBase + 2;
+			tIndices[ i * 6 + 5 ] = tBase + 3;
+		}
+		mIndexBuffer = ci::gl::Vbo( GL_ELEMENT_ARRAY_BUFFER );
+		mIndexBuffer.bind();
+		mIndexBuffer.bufferData( tIndices.size() * sizeof( uint16_t ), &tIndices[ 0 ], GL_STATIC_DRAW );
+		mIndexBuffer.unbind();
+
+		mVertexBuffer = ci::gl::Vbo( GL_ARRAY_BUFFER );
+		mVertexBuffer.bind();
+		mVertexBuffer.bufferData( mBufferBytes, NULL, GL_STREAM_DRAW );
+		mVertexBuffer.unbind();
+		mWriteOffset = 0;
+		mInitialized = true;
+	}
+
+	/** @brief changes the material, flushing the pending quads if it differs */
+	void setTexture(const GLuint& iId, const GLenum& iTarget)
+	{
+		if( iId == mTextureId && iTarget == mTextureTarget ) { return; }
+		if( !mVertices.empty() ) {
+			mStats.mMaterialFlushes++;
+			flush();
+		}
+		mTextureId     = iId;
+		mTextureTarget = iTarget;
+	}
+
+	/** @brief appends a vertex */
+	void pushVertex(const ci::Vec2f& iPosition, const ci::Vec2f& iTexCoord, const ci::ColorA& iColor)
+	{
+		Vertex tVertex;
+		tVertex.mPosition = iPosition;
+		tVertex.mTexCoord = iTexCoord;
+		tVertex.mColor    = ci::ColorA8u( iColor );
+		mVertices.push_back( tVertex );
+	}
+
+	size_t				mQuadsPerBatch;
+	size_t				mBufferBytes;
+	size_t				mWriteOffset;		//!< next free byte in the streaming buffer
+	std::vector<Vertex>	mVertices;			//!< pending quads (four vertices each)
+	GLuint				mTextureId;			//!< current material (0 for no texture)
+	GLenum				mTextureTarget;
+	bool				mInitialized;
+	ci::gl::Vbo			mVertexBuffer;
+	ci::gl::Vbo			mIndexBuffer;
+	Stats				mStats;
+};
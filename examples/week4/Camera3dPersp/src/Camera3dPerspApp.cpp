@@ -10,6 +10,9 @@
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
 
+#include "FrustumCuller.h"
+#include "InstanceBatch.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -22,8 +25,16 @@ public:
 	void update();
 	void draw();
 	
-	float		mFovParam;
-	CameraPersp mCam;
+	float				mFovParam;
+	CameraPersp			mCam;
+	
+	vector<Vec3f>		mCubeCenters;
+	float				mCubeSize;
+	CullBatch			mCubeBounds;
+	vector<uint32_t>	mVisible;
+	bool				mCulling;
+	CullBatch::Mode		mCullMode;
+	InstanceBatch		mCubes;
 };
 
 void Camera3dPerspApp::setup()
@@ -37,6 +48,26 @@ void Camera3dPerspApp::setup()
 	
 	// Set initial state:
 	mFovParam = 0.5;
+	mCulling  = true;
+	mCullMode = CullBatch::BOXES;
+	
+	// Choose unit size:
+	float tUnitLen = 10.0;
+	mCubeSize      = tUnitLen / 2.0;
+	
+	// Prepare color cube grid (and each cube's bounding box):
+	for(int x = -10; x < 10; x++) {
+		for(int z = -10; z < 10; z++) {
+			mCubeCenters.push_back( Vec3f( x * tUnitLen, 0.0, z * tUnitLen ) );
+			mCubeBounds.addBox( mCubeCenters.back(), Vec3f( mCubeSize, mCubeSize, mCubeSize ) * 0.5 );
+		}
+	}
+	
+	// Prepare color cube mesh (drawn once per visible cube, with a single draw call):
+	vector<InstanceBatch::Vertex> tVertices;
+	vector<uint32_t> tIndices;
+	createInstanceCube( tVertices, tIndices, true );
+	mCubes.setMesh( tVertices, tIndices );
 }
 
 void Camera3dPerspApp::mouseMove(MouseEvent event)
@@ -46,6 +77,33 @@ void Camera3dPerspApp::mouseMove(MouseEvent event)
 
 void Camera3dPerspApp::keyUp(KeyEvent event)
 {
+	switch( event.getChar() ) {
+		case 'c': {
+			// Toggle frustum culling:
+			mCulling = !mCulling;
+			break;
+		}
+		case 'v': {
+			// Toggle between box and sphere bounding volumes:
+			mCullMode = ( mCullMode == CullBatch::BOXES ) ? ( CullBatch::SPHERES ) : ( CullBatch::BOXES );
+			break;
+		}
+		case 'i': {
+			// Toggle between hardware instancing and CPU expansion:
+			mCubes.setInstancingEnabled( !mCubes.isInstancing() );
+			break;
+		}
+		case 's': {
+			// Print culling and draw stats:
+			const CullBatch::Stats& tStats = mCubeBounds.getStats();
+			cout << "Culling " << ( ( mCulling ) ? ( "on" ) : ( "off" ) ) << " (" << ( ( mCullMode == CullBatch::BOXES ) ? ( "boxes" ) : ( "spheres" ) ) << "): ";
+			cout << mVisible.size() << " cubes drawn, " << tStats.mTested << " tested, " << tStats.mCulled << " culled" << endl;
+			cout << ( ( mCubes.isInstancing() ) ? ( "Instanced" ) : ( "Expanded" ) ) << ": " << mCubes.getStats().mDrawCalls << " draw call(s), "
+				<< mCubes.getStats().mBytesUploaded << " bytes uploaded" << endl;
+			break;
+		}
+		default: { break; }
+	}
 }
 
 void Camera3dPerspApp::update()
@@ -68,16 +126,23 @@ void Camera3dPerspApp::draw()
 	// Set matrix from camera:
 	gl::setMatrices( mCam );
 	
-	// Choose unit size:
-	float tUnitLen = 10.0;
-	float tHalfLen = tUnitLen / 2.0;
+	// Find the cubes that are (at least partly) inside the camera's view frustum:
+	if( mCulling ) {
+		mCubeBounds.cull( Frustum( mCam ), mVisible, mCullMode );
+	}
+	else {
+		mVisible.resize( mCubeCenters.size() );
+		for(size_t i = 0; i < mVisible.size(); i++) { mVisible[ i ] = i; }
+	}
 	
-	// Draw color cube grid:
-	for(int x = -10; x < 10; x++) {
-		for(int z = -10; z < 10; z++) {
-			gl::drawColorCube( Vec3f( x * tUnitLen, 0.0, z * tUnitLen ), Vec3f( tHalfLen, tHalfLen, tHalfLen ) );
-		}
+	// Draw color cube grid (visible cubes only, as instances of a unit cube):
+	mCubes.clear();
+	for(vector<uint32_t>::const_iterator it = mVisible.begin(); it != mVisible.end(); it++) {
+		Matrix44f tTransform = Matrix44f::createTranslation( mCubeCenters[ *it ] );
+		tTransform.scale( Vec3f( mCubeSize, mCubeSize, mCubeSize ) );
+		mCubes.add( tTransform );
 	}
+	mCubes.draw();
 }
 
 CINDER_APP_NATIVE( Camera3dPerspApp, RendererGl )
@@ -0,0 +1,447 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cinder/Color.h"
+#include "cinder/Matrix.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Vbo.h"
+
+#ifndef STRINGIFY
+	#define STRINGIFY(x) #x
+#endif
+
+// Drawing the same mesh many times with push/translate/draw/pop costs a draw call
+// (plus several matrix stack calls) per copy. With "instancing", we put each
+// copy's transformation and color into a buffer, and then draw all of the copies
+// with a single call. The vertex shader reads the current copy's matrix and color
+// from "per-instance" attributes (attributes that advance once per instance
+// instead of once per vertex).
+//
+// Instancing needs GL_ARB_instanced_arrays and GL_ARB_draw_instanced. Without
+// them (e.g. on some software renderers), the batch "expands" the instances on
+// the CPU instead: it transforms a copy of the mesh for each instance into one
+// big vertex array, which is still drawn with a single call.
+//
+// Shaders used with a batch should declare:
+//
+//     attribute mat4 aInstanceMatrix;
+//     attribute vec4 aInstanceColor;
+//
+// and position vertices with gl_ModelViewProjectionMatrix * aInstanceMatrix * gl_Vertex.
+// (In the expanded path, the vertices are already transformed and those
+// attributes are set to the identity matrix and white.)
+
+/** @brief draws many copies of one mesh with a single draw call */
+class InstanceBatch {
+public:
+	/** @brief a vertex of the shared mesh */
+	struct Vertex
+	{
+		ci::Vec3f	mPosition;
+		ci::Vec3f	mNormal;
+		ci::ColorA	mColor;
+
+		/** @brief default constructor */
+		Vertex() : mColor( 1.0f, 1.0f, 1.0f, 1.0f ) {}
+
+		/** @brief basic constructor */
+		Vertex(const ci::Vec3f& iPosition, const ci::Vec3f& iNormal, const ci::ColorA& iColor = ci::ColorA( 1.0f, 1.0f, 1.0f, 1.0f )) :
+			mPosition( iPosition ), mNormal( iNormal ), mColor( iColor ) {}
+	};
+
+	/** @brief per-instance data */
+	struct Instance
+	{
+		ci::Matrix44f	mTransform;
+		ci::ColorA		mColor;
+	};
+
+	/** @brief built-in shading for draw() */
+	enum Shading {
+		UNLIT,	//!< vertex color times instance color
+		LIT		//!< fixed-function style lighting from GL_LIGHT0 and the current material
+	};
+
+	/** @brief draw counters (for the last call to draw()) */
+	struct Stats
+	{
+		size_t	mDrawCalls;
+		size_t	mInstances;
+		size_t	mExpandedVertices;	//!< vertices transformed on the CPU (expanded path only)
+		size_t	mBytesUploaded;
+
+		/** @brief default constructor */
+		Stats() : mDrawCalls( 0 ), mInstances( 0 ), mExpandedVertices( 0 ), mBytesUploaded( 0 ) {}
+	};
+
+	/** @brief default constructor */
+	InstanceBatch(const Shading& iShading = UNLIT) :
+		mShading( iShading ), mPrimitive( GL_TRIANGLES ), mInstancing( true ), mSupportChecked( false ), mSupported( false ),
+		mBuffersDirty( true ), mInstancesDirty( true ), mExpandedDirty( true ) {}
+
+	/** @brief sets the shared mesh (GL_TRIANGLES or GL_TRIANGLE_STRIP) */
+	void setMesh(const std::vector<Vertex>& iVertices, const std::vector<uint32_t>& iIndices, const GLenum& iPrimitive = GL_TRIANGLES)
+	{
+		mVertices  = iVertices;
+		mIndices   = iIndices;
+		mPrimitive = iPrimitive;
+
+		// The expanded path appends copies of the mesh, so it needs independent triangles:
+		mTriangles.clear();
+		if( iPrimitive == GL_TRIANGLE_STRIP ) {
+			for(size_t i = 2; i < iIndices.size(); i++) {
+				uint32_t a = iIndices[ i - 2 ], b = iIndices[ i - 1 ], c = iIndices[ i ];
+				// Skip degenerate triangles (used to join strip rows):
+				if( a == b || b == c || a == c ) { continue; }
+				// Every other triangle in a strip has reversed winding:
+				if( i % 2 == 0 ) { mTriangles.push_back( a ); mTriangles.push_back( b ); mTriangles.push_back( c ); }
+				else             { mTriangles.push_back( b ); mTriangles.push_back( a ); mTriangles.push_back( c ); }
+			}
+		}
+		else {
+			mTriangles = iIndices;
+		}
+		mBuffersDirty  = true;
+		mExpandedDirty = true;
+	}
+
+	/** @brief removes all instances */
+	void clear()
+	{
+		mInstances.clear();
+		mInstancesDirty = true;
+		mExpandedDirty  = true;
+	}
+
+	/** @brief adds an instance */
+	void add(const ci::Matrix44f& iTransform, const ci::ColorA& iColor = ci::ColorA( 1.0f, 1.0f, 1.0f, 1.0f ))
+	{
+		Instance tInstance;
+		tInstance.mTransform = iTransform;
+		tInstance.mColor     = iColor;
+		mInstances.push_back( tInstance );
+		mInstancesDirty = true;
+		mExpandedDirty  = true;
+	}
+
+	/** @brief returns the number of instances */
+	size_t size() const { return mInstances.size(); }
+
+	/** @brief enables or disables hardware instancing (when disabled, instances are always expanded on the CPU) */
+	void setInstancingEnabled(const bool& iEnabled) { mInstancing = iEnabled; }
+
+	/** @brief returns whether draw() uses hardware instancing */
+	bool isInstancing()
+	{
+		if( !mSupportChecked ) {
+			mSupported = ci::gl::isExtensionAvailable( "GL_ARB_instanced_arrays" ) && ci::gl::isExtensionAvailable( "GL_ARB_draw_instanced" );
+			mSupportChecked = true;
+		}
+		return mInstancing && mSupported;
+	}
+
+	/** @brief draws all instances with the built-in shading */
+	void draw()
+	{
+		if( isInstancing() ) {
+			ci::gl::GlslProg& tProgram = getProgram();
+			tProgram.bind();
+			draw( tProgram );
+			tProgram.unbind();
+		}
+		else {
+			// (Fixed-function state, including lighting, applies to the expanded vertices.)
+			drawExpanded( NULL );
+		}
+	}
+
+	/** @brief draws all instances with the given (bound) shader */
+	void draw(ci::gl::GlslProg& iProgram)
+	{
+		mStats = Stats();
+		if( mInstances.empty() || mIndices.empty() ) { return; }
+		if( isInstancing() ) {
+			drawInstanced( iProgram );
+		}
+		else {
+			drawExpanded( &iProgram );
+		}
+	}
+
+	/** @brief returns the counters for the last call to draw() */
+	const Stats& getStats() const { return mStats; }
+
+protected:
+	/** @brief returns the built-in shader for the current shading mode */
+	ci::gl::GlslProg& getProgram()
+	{
+		if( !mProgram ) {
+			const char* tVert = ( mShading == LIT ) ? ( kLitVertGlsl ) : ( kUnlitVertGlsl );
+			mProgram = ci::gl::GlslProg( tVert, kFragGlsl );
+		}
+		return mProgram;
+	}
+
+	/** @brief uploads the mesh (once) */
+	void updateMeshBuffers()
+	{
+		if( !mBuffersDirty ) { return; }
+		mVertexBuffer = ci::gl::Vbo( GL_ARRAY_BUFFER );
+		mVertexBuffer.bind();
+		mVertexBuffer.bufferData( mVertices.size() * sizeof( Vertex ), &mVertices[ 0 ], GL_STATIC_DRAW );
+		mVertexBuffer.unbind();
+		mIndexBuffer = ci::gl::Vbo( GL_ELEMENT_ARRAY_BUFFER );
+		mIndexBuffer.bind();
+		mIndexBuffer.bufferData( mIndices.size() * sizeof( uint32_t ), &mIndices[ 0 ], GL_STATIC_DRAW );
+		mIndexBuffer.unbind();
+		mInstanceBuffer = ci::gl::Vbo( GL_ARRAY_BUFFER );
+		mBuffersDirty   = false;
+		mInstancesDirty = true;
+	}
+
+	/** @brief draws with one instanced draw call */
+	void drawInstanced(ci::gl::GlslProg& iProgram)
+	{
+		updateMeshBuffers();
+
+		// Upload the instance data if it changed (orphaning the previous storage):
+		mInstanceBuffer.bind();
+		if( mInstancesDirty ) {
+			size_t tBytes = mInstances.size() * sizeof( Instance );
+			mInstanceBuffer.bufferData( tBytes, &mInstances[ 0 ], GL_STREAM_DRAW );
+			mStats.mBytesUploaded += tBytes;
+			mInstancesDirty = false;
+		}
+
+		// Per-instance attributes (a mat4 takes four consecutive attribute locations):
+		GLint tMatrixLoc = iProgram.getAttribLocation( "aInstanceMatrix" );
+		GLint tColorLoc  = iProgram.getAttribLocation( "aInstanceColor" );
+		if( tMatrixLoc >= 0 ) {
+			for(GLint k = 0; k < 4; k++) {
+				glEnableVertexAttribArray( tMatrixLoc + k );
+				glVertexAttribPointer( tMatrixLoc + k, 4, GL_FLOAT, GL_FALSE, sizeof( Instance ), reinterpret_cast<const GLvoid*>( k * 4 * sizeof( float ) ) );
+				glVertexAttribDivisorARB( tMatrixLoc + k, 1 );
+			}
+		}
+		if( tColorLoc >= 0 ) {
+			glEnableVertexAttribArray( tColorLoc );
+			glVertexAttribPointer( tColorLoc, 4, GL_FLOAT, GL_FALSE, sizeof( Instance ), reinterpret_cast<const GLvoid*>( sizeof( ci::Matrix44f ) ) );
+			glVertexAttribDivisorARB( tColorLoc, 1 );
+		}
+		mInstanceBuffer.unbind();
+
+		// Per-vertex attributes:
+		mVertexBuffer.bind();
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glEnableClientState( GL_NORMAL_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+		glVertexPointer( 3, GL_FLOAT, sizeof( Vertex ), reinterpret_cast<const GLvoid*>( offsetof( Vertex, mPosition ) ) );
+		glNormalPointer( GL_FLOAT, sizeof( Vertex ), reinterpret_cast<const GLvoid*>( offsetof( Vertex, mNormal ) ) );
+		glColorPointer( 4, GL_FLOAT, sizeof( Vertex ), reinterpret_cast<const GLvoid*>( offsetof( Vertex, mColor ) ) );
+
+		// Draw all instances:
+		mIndexBuffer.bind();
+		glDrawElementsInstancedARB( mPrimitive, static_cast<GLsizei>( mIndices.size() ), GL_UNSIGNED_INT, 0, static_cast<GLsizei>( mInstances.size() ) );
+		mIndexBuffer.unbind();
+
+		// Restore state:
+		glDisableClientState( GL_COLOR_ARRAY );
+		glDisableClientState( GL_NORMAL_ARRAY );
+		glDisableClientState( GL_VERTEX_ARRAY );
+		mVertexBuffer.unbind();
+		if( tMatrixLoc >= 0 ) {
+			for(GLint k = 0; k < 4; k++) {
+				glVertexAttribDivisorARB( tMatrixLoc + k, 0 );
+				glDisableVertexAttribArray( tMatrixLoc + k );
+			}
+		}
+		if( tColorLoc >= 0 ) {
+			glVertexAttribDivisorARB( tColorLoc, 0 );
+			glDisableVertexAttribArray( tColorLoc );
+		}
+
+		mStats.mDrawCalls = 1;
+		mStats.mInstances = mInstances.size();
+	}
+
+	/** @brief transforms a copy of the mesh per instance on the CPU and draws them with one call */
+	void drawExpanded(ci::gl::GlslProg* iProgram)
+	{
+		mStats = Stats();
+		if( mInstances.empty() || mTriangles.empty() ) { return; }
+
+		// Expand (only when the instances changed):
+		if( mExpandedDirty ) {
+			size_t tVertexCount = mVertices.size();
+			mExpandedVertices.resize( tVertexCount * mInstances.size() );
+			mExpandedIndices.resize( mTriangles.size() * mInstances.size() );
+			for(size_t i = 0; i < mInstances.size(); i++) {
+				const Instance& tInstance = mInstances[ i ];
+				const float*    m         = tInstance.mTransform.m;
+				Vertex*         tDst      = &mExpandedVertices[ i * tVertexCount ];
+				for(size_t v = 0; v < tVertexCount; v++) {
+					const Vertex& tSrc = mVertices[ v ];
+					const ci::Vec3f& p = tSrc.mPosition;
+					const ci::Vec3f& n = tSrc.mNormal;
+					tDst[ v ].mPosition = ci::Vec3f( m[ 0 ] * p.x + m[ 4 ] * p.y + m[ 8 ] * p.z + m[ 12 ],
+													 m[ 1 ] * p.x + m[ 5 ] * p.y + m[ 9 ] * p.z + m[ 13 ],
+													 m[ 2 ] * p.x + m[ 6 ] * p.y + m[ 10 ] * p.z + m[ 14 ] );
+					tDst[ v ].mNormal   = ci::Vec3f( m[ 0 ] * n.x + m[ 4 ] * n.y + m[ 8 ] * n.z,
+													 m[ 1 ] * n.x + m[ 5 ] * n.y + m[ 9 ] * n.z,
+													 m[ 2 ] * n.x + m[ 6 ] * n.y + m[ 10 ] * n.z ).normalized();
+					tDst[ v ].mColor    = ci::ColorA( tSrc.mColor.r * tInstance.mColor.r, tSrc.mColor.g * tInstance.mColor.g,
+													  tSrc.mColor.b * tInstance.mColor.b, tSrc.mColor.a * tInstance.mColor.a );
+				}
+				uint32_t  tBase    = static_cast<uint32_t>( i * tVertexCount );
+				uint32_t* tIndices = &mExpandedIndices[ i * mTriangles.size() ];
+				for(size_t k = 0; k < mTriangles.size(); k++) {
+					tIndices[ k ] = mTriangles[ k ] + tBase;
+				}
+			}
+			mExpandedDirty = false;
+		}
+
+		// Shaders written for instancing get the identity matrix and white as constant attributes:
+		if( iProgram ) {
+			GLint tMatrixLoc = iProgram->getAttribLocation( "aInstanceMatrix" );
+			GLint tColorLoc  = iProgram->getAttribLocation( "aInstanceColor" );
+			if( tMatrixLoc >= 0 ) {
+				for(GLint k = 0; k < 4; k++) {
+					glVertexAttrib4f( tMatrixLoc + k, ( k == 0 ) ? 1.0f : 0.0f, ( k == 1 ) ? 1.0f : 0.0f, ( k == 2 ) ? 1.0f : 0.0f, ( k == 3 ) ? 1.0f : 0.0f );
+				}
+			}
+			if( tColorLoc >= 0 ) {
+				glVertexAttrib4f( tColorLoc, 1.0f, 1.0f, 1.0f, 1.0f );
+			}
+		}
+
+		// Draw from client memory:
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glEnableClientState( GL_NORMAL_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+		glVertexPointer( 3, GL_FLOAT, sizeof( Vertex ), &mExpandedVertices[ 0 ].mPosition );
+		glNormalPointer( GL_FLOAT, sizeof( Vertex ), &mExpandedVertices[ 0 ].mNormal );
+		glColorPointer( 4, GL_FLOAT, sizeof( Vertex ), &mExpandedVertices[ 0 ].mColor );
+		glDrawElements( GL_TRIANGLES, static_cast<GLsizei>( mExpandedIndices.size() ), GL_UNSIGNED_INT, &mExpandedIndices[ 0 ] );
+		glDisableClientState( GL_COLOR_ARRAY );
+		glDisableClientState( GL_NORMAL_ARRAY );
+		glDisableClientState( GL_VERTEX_ARRAY );
+
+		mStats.mDrawCalls        = 1;
+		mStats.mInstances        = mInstances.size();
+		mStats.mExpandedVertices = mExpandedVertices.size();
+		mStats.mBytesUploaded    = mExpandedVertices.size() * sizeof( Vertex ) + mExpandedIndices.size() * sizeof( uint32_t );
+	}
+
+	static const char* const kUnlitVertGlsl;
+	static const char* const kLitVertGlsl;
+	static const char* const kFragGlsl;
+
+	Shading					mShading;
+	std::vector<Vertex>		mVertices;
+	std::vector<uint32_t>	mIndices;
+	std::vector<uint32_t>	mTriangles;			//!< mIndices as independent triangles (for the expanded path)
+	GLenum					mPrimitive;
+	std::vector<Instance>	mInstances;
+	bool					mInstancing;
+	bool					mSupportChecked;
+	bool					mSupported;
+	bool					mBuffersDirty;
+	bool					mInstancesDirty;	//!< the instance buffer needs to be uploaded
+	bool					mExpandedDirty;		//!< the expanded vertices need to be rebuilt
+	ci::gl::Vbo				mVertexBuffer;
+	ci::gl::Vbo				mIndexBuffer;
+	ci::gl::Vbo				mInstanceBuffer;
+	ci::gl::GlslProg		mProgram;
+	std::vector<Vertex>		mExpandedVertices;
+	std::vector<uint32_t>	mExpandedIndices;
+	Stats					mStats;
+};
+
+// Vertex color times instance color:
+const char* const InstanceBatch::kUnlitVertGlsl =
+STRINGIFY(
+		  attribute mat4 aInstanceMatrix;
+		  attribute vec4 aInstanceColor;
+
+		  void main()
+		  {
+			  gl_FrontColor = gl_Color * aInstanceColor;
+			  gl_Position   = gl_ModelViewProjectionMatrix * ( aInstanceMatrix * gl_Vertex );
+		  }
+		  );
+
+// Per-vertex lighting from GL_LIGHT0 and the current material (like the fixed-function pipeline):
+const char* const InstanceBatch::kLitVertGlsl =
+STRINGIFY(
+		  attribute mat4 aInstanceMatrix;
+		  attribute vec4 aInstanceColor;
+
+		  void main()
+		  {
+			  vec4 tPosition = gl_ModelViewMatrix * ( aInstanceMatrix * gl_Vertex );
+			  mat3 tRotation = mat3( aInstanceMatrix[ 0 ].xyz, aInstanceMatrix[ 1 ].xyz, aInstanceMatrix[ 2 ].xyz );
+			  vec3 tNormal   = normalize( gl_NormalMatrix * ( tRotation * gl_Normal ) );
+
+			  // Directional (w = 0) or point light:
+			  vec4 tLight    = gl_LightSource[ 0 ].position;
+			  vec3 tLightDir = normalize( ( tLight.w == 0.0 ) ? ( tLight.xyz ) : ( tLight.xyz - tPosition.xyz ) );
+			  vec3 tHalf     = normalize( tLightDir - normalize( tPosition.xyz ) );
+
+			  float tDiffuse  = max( dot( tNormal, tLightDir ), 0.0 );
+			  float tSpecular = ( tDiffuse > 0.0 ) ? ( pow( max( dot( tNormal, tHalf ), 0.0 ), gl_FrontMaterial.shininess ) ) : ( 0.0 );
+
+			  gl_FrontColor   = gl_FrontLightModelProduct.sceneColor + gl_FrontLightProduct[ 0 ].ambient +
+								gl_FrontLightProduct[ 0 ].diffuse * tDiffuse + gl_FrontLightProduct[ 0 ].specular * tSpecular;
+			  gl_FrontColor.a = gl_FrontMaterial.diffuse.a * aInstanceColor.a;
+			  gl_Position     = gl_ProjectionMatrix * tPosition;
+		  }
+		  );
+
+const char* const InstanceBatch::kFragGlsl =
+STRINGIFY(
+		  void main()
+		  {
+			  gl_FragColor = gl_Color;
+		  }
+		  );
+
+/** @brief creates a unit cube (centered on the origin) with one color per face, like gl::drawColorCube() */
+static void createInstanceCube(std::vector<InstanceBatch::Vertex>& oVertices, std::vector<uint32_t>& oIndices, const bool& iColored)
+{
+	// Face normals and colors (+X red, +Y green, +Z blue, -X cyan, -Y magenta, -Z yellow):
+	const ci::Vec3f  kNormals[ 6 ] = { ci::Vec3f( 1, 0, 0 ), ci::Vec3f( 0, 1, 0 ), ci::Vec3f( 0, 0, 1 ), ci::Vec3f( -1, 0, 0 ), ci::Vec3f( 0, -1, 0 ), ci::Vec3f( 0, 0, -1 ) };
+	const ci::ColorA kColors[ 6 ]  = { ci::ColorA( 1, 0, 0, 1 ), ci::ColorA( 0, 1, 0, 1 ), ci::ColorA( 0, 0, 1, 1 ), ci::ColorA( 0, 1, 1, 1 ), ci::ColorA( 1, 0, 1, 1 ), ci::ColorA( 1, 1, 0, 1 ) };
+
+	oVertices.clear();
+	oIndices.clear();
+	for(int f = 0; f < 6; f++) {
+		// Two axes spanning the face (chosen so that the corners wind counter-clockwise seen from outside):
+		ci::Vec3f n = kNormals[ f ];
+		ci::Vec3f u = ci::Vec3f( n.y, n.z, n.x );
+		ci::Vec3f v = n.cross( u );
+		uint32_t  tBase = static_cast<uint32_t>( oVertices.size() );
+		ci::ColorA tColor = ( iColored ) ? ( kColors[ f ] ) : ( ci::ColorA( 1, 1, 1, 1 ) );
+		oVertices.push_back( InstanceBatch::Vertex( ( n - u - v ) * 0.5f, n, tColor ) );
+		oVertices.push_back( InstanceBatch::Vertex( ( n + u - v ) * 0.5f, n, tColor ) );
+		oVertices.push_back( InstanceBatch::Vertex( ( n + u + v ) * 0.5f, n, tColor ) );
+		oVertices.push_back( InstanceBatch::Vertex( ( n - u + v ) * 0.5f, n, tColor ) );
+		const uint32_t kQuad[ 6 ] = { 0, 1, 2, 0, 2, 3 };
+		for(int k = 0; k < 6; k++) { oIndices.push_back( tBase + kQuad[ k ] ); }
+	}
+}
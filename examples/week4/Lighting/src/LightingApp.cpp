@@ -9,9 +9,10 @@
 #include "cinder/app/AppNative.h"
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
-#include "cinder/Timeline.h"
 
+#include "InstanceBatch.h"
 #include "MeshFactory.h"
+#include "TweenBatch.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -23,6 +24,7 @@ public:
 	void setup();
 	void update();
 	void mouseMove(MouseEvent event);
+	void keyUp(KeyEvent event);
 	void draw();
 	void resize();
 
@@ -34,13 +36,16 @@ public:
 	int				mSphereDetail;
 	
 	ProtoMesh		mMeshProto;
-	gl::VboMesh		mMeshVbo;
-	
-	Anim<ColorA>		mDiffuse;
-	Anim<ColorA>		mAmbient;
-	Anim<ColorA>		mSpecular;
-	Anim<ColorA>		mEmissive;
-	Anim<GLfloat>	mShininess;
+	InstanceBatch	mSpheres;
+	bool			mSpheresInstancing;
+	
+	TweenBatch<ColorA>	mColorAnims;
+	TweenBatch<GLfloat>	mFloatAnims;
+	size_t				mDiffuse;
+	size_t				mAmbient;
+	size_t				mSpecular;
+	size_t				mEmissive;
+	size_t				mShininess;
 };
 
 void LightingApp::prepareSettings(Settings* settings)
@@ -72,35 +77,37 @@ void LightingApp::setup()
 	float tSecPerTrans = 2.0;
 	
 	// Set the easing function:
-	EaseFn tEase = EaseInOutCubic();
+	EaseType tEase = EASE_IN_OUT_CUBIC;
 	
 	// Set initial material parameters:
-	mAmbient = ColorA( 0.0, 0.0, 0.0, 1.0 );
-	mDiffuse = ColorA( 0.0, 0.0, 0.0, 1.0 );
-	mSpecular = ColorA( 0.0, 0.0, 0.0, 1.0 );
-	mEmissive = ColorA( 0.0, 0.0, 0.0, 1.0 );
-	mShininess = 0.0;
-
-	// Prepare custom timeline:
-	ci::TimelineRef	tTimeline;
-	tTimeline = cinder::Timeline::create();
-	tTimeline->setInfinite( false );
-	tTimeline->setDefaultAutoRemove( false );
-	tTimeline->setAutoRemove( false );
-	tTimeline->setPingPong( true );
-	timeline().add( tTimeline );
-	
-	// Create timeline transitions:
-	tTimeline->apply( &mAmbient, ColorA( 0.3, 0.3, 0.3, 1.0 ), tSecPerTrans, tEase );
-	tTimeline->apply( &mDiffuse, ColorA( 0.5, 0.1, 0.1, 1.0 ), tSecPerTrans, tEase ).appendTo( &mAmbient );
-	tTimeline->apply( &mSpecular, ColorA( 0.1, 0.5, 0.1, 1.0 ), tSecPerTrans, tEase ).appendTo( &mDiffuse );
-	tTimeline->apply( &mShininess, 128.0f, tSecPerTrans, tEase ).appendTo( &mSpecular );
-	tTimeline->apply( &mEmissive, ColorA( 0.1, 0.1, 0.5, 1.0 ), tSecPerTrans, tEase ).appendTo( &mShininess );
+	// (Colors and floats are animated by separate batches, one per value type.)
+	mAmbient = mColorAnims.addProperty( ColorA( 0.0, 0.0, 0.0, 1.0 ) );
+	mDiffuse = mColorAnims.addProperty( ColorA( 0.0, 0.0, 0.0, 1.0 ) );
+	mSpecular = mColorAnims.addProperty( ColorA( 0.0, 0.0, 0.0, 1.0 ) );
+	mEmissive = mColorAnims.addProperty( ColorA( 0.0, 0.0, 0.0, 1.0 ) );
+	mShininess = mFloatAnims.addProperty( 0.0f );
+	
+	// Create transitions (each one starting when the previous one ends):
+	size_t tTween;
+	tTween = mColorAnims.apply( mAmbient, ColorA( 0.3, 0.3, 0.3, 1.0 ), tSecPerTrans, tEase );
+	tTween = mColorAnims.appendTo( tTween, mDiffuse, ColorA( 0.5, 0.1, 0.1, 1.0 ), tSecPerTrans, tEase );
+	tTween = mColorAnims.appendTo( tTween, mSpecular, ColorA( 0.1, 0.5, 0.1, 1.0 ), tSecPerTrans, tEase );
+	// (Appending across batches: start when the specular transition ends.)
+	tTween = mFloatAnims.apply( mShininess, 128.0f, tSecPerTrans, tEase, mColorAnims.getEndTime( tTween ) );
+	tTween = mColorAnims.apply( mEmissive, ColorA( 0.1, 0.1, 0.5, 1.0 ), tSecPerTrans, tEase, mFloatAnims.getEndTime( tTween ) );
+	
+	// Play both batches forward and backward, in step with each other:
+	float tDuration = mColorAnims.getEndTime( tTween );
+	mColorAnims.setPingPong( true );
+	mColorAnims.setDuration( tDuration );
+	mFloatAnims.setPingPong( true );
+	mFloatAnims.setDuration( tDuration );
 	
 	// Prepare sphere parameters:
 	mSphereRadius = 100.0;
 	mSphereOffset = mSphereRadius + 5.0;
 	mSphereDetail = 500;
+	mSpheresInstancing = true;
 	
 	// Notice: The resolution of the geometry (mSphereDetail) will impact
 	// the render quality of lit objects. There are a few things we could do about this.
@@ -111,8 +118,20 @@ void LightingApp::setup()
 	// Initialize a sphere mesh:
 	createSphere( mSphereDetail, mSphereDetail, mSphereRadius, mMeshProto );
 	
-	// Convert mesh to VBO:
-	createMeshVbo( mMeshProto, mMeshVbo );
+	// Convert mesh to an instance batch (one copy of the mesh, drawn once per instance):
+	vector<InstanceBatch::Vertex> tVertices;
+	tVertices.reserve( mMeshProto.mVertices.size() );
+	for(const auto& tVertex : mMeshProto.mVertices) {
+		tVertices.push_back( InstanceBatch::Vertex( tVertex.mPosition, tVertex.mNormal ) );
+	}
+	mSpheres = InstanceBatch( InstanceBatch::LIT );
+	mSpheres.setMesh( tVertices, mMeshProto.mIndices, GL_TRIANGLE_STRIP );
+	
+	// Add one instance per sphere position:
+	mSpheres.add( Matrix44f::createTranslation( Vec3f( -mSphereOffset, -mSphereOffset, 0.0 ) ) );
+	mSpheres.add( Matrix44f::createTranslation( Vec3f(  mSphereOffset, -mSphereOffset, 0.0 ) ) );
+	mSpheres.add( Matrix44f::createTranslation( Vec3f(  mSphereOffset,  mSphereOffset, 0.0 ) ) );
+	mSpheres.add( Matrix44f::createTranslation( Vec3f( -mSphereOffset,  mSphereOffset, 0.0 ) ) );
 }
 
 void LightingApp::mouseMove(MouseEvent event)
@@ -121,8 +140,32 @@ void LightingApp::mouseMove(MouseEvent event)
 	mMousePos.y = getWindowHeight() * 0.5f - event.getY();
 }
 
+void LightingApp::keyUp(KeyEvent event)
+{
+	switch( event.getChar() ) {
+		case 'i': {
+			// Toggle between hardware instancing and CPU expansion:
+			mSpheresInstancing = !mSpheresInstancing;
+			mSpheres.setInstancingEnabled( mSpheresInstancing );
+			break;
+		}
+		case 's': {
+			// Print draw stats:
+			const InstanceBatch::Stats& tStats = mSpheres.getStats();
+			cout << ( ( mSpheres.isInstancing() ) ? ( "Instanced" ) : ( "Expanded" ) ) << ": "
+				<< tStats.mInstances << " instances, " << tStats.mDrawCalls << " draw call(s), "
+				<< tStats.mExpandedVertices << " expanded vertices, " << tStats.mBytesUploaded << " bytes uploaded" << endl;
+			break;
+		}
+		default: { break; }
+	}
+}
+
 void LightingApp::update()
 {
+	// Evaluate all tweens:
+	mColorAnims.step( getElapsedSeconds() );
+	mFloatAnims.step( getElapsedSeconds() );
 }
 
 void LightingApp::draw()
@@ -155,48 +198,21 @@ void LightingApp::draw()
 	glLightfv( GL_LIGHT0, GL_POSITION, tLightDir );
 	
 	// Set material's ambient color:
-	glMaterialfv( GL_FRONT, GL_AMBIENT, mAmbient.value() );
+	glMaterialfv( GL_FRONT, GL_AMBIENT, mColorAnims.getValue( mAmbient ) );
 	
 	// Set material's diffuse color:
-	glMaterialfv( GL_FRONT, GL_DIFFUSE, mDiffuse.value() );
+	glMaterialfv( GL_FRONT, GL_DIFFUSE, mColorAnims.getValue( mDiffuse ) );
 	
 	// Set material's specular color and shininess:
-	glMaterialfv( GL_FRONT, GL_SPECULAR, mSpecular.value() );
-	glMaterialfv( GL_FRONT, GL_SHININESS,  mShininess.ptr() );
+	glMaterialfv( GL_FRONT, GL_SPECULAR, mColorAnims.getValue( mSpecular ) );
+	glMaterialfv( GL_FRONT, GL_SHININESS,  &mFloatAnims.getValue( mShininess ) );
 	
 	// Set material's emissive color:
-	glMaterialfv( GL_FRONT, GL_EMISSION, mEmissive.value() );
+	glMaterialfv( GL_FRONT, GL_EMISSION, mColorAnims.getValue( mEmissive ) );
 
-	// Draw sphere mesh (four times, with translation):
-	{
-		{
-			gl::pushMatrices();
-			gl::translate( Vec3f( -mSphereOffset, -mSphereOffset, 0.0 ) );
-			gl::draw( mMeshVbo );
-			gl::popMatrices();
-		}
-		
-		{
-			gl::pushMatrices();
-			gl::translate( Vec3f(  mSphereOffset, -mSphereOffset, 0.0 ) );
-			gl::draw( mMeshVbo );
-			gl::popMatrices();
-		}
-		
-		{
-			gl::pushMatrices();
-			gl::translate( Vec3f(  mSphereOffset,  mSphereOffset, 0.0 ) );
-			gl::draw( mMeshVbo );
-			gl::popMatrices();
-		}
-		
-		{
-			gl::pushMatrices();
-			gl::translate( Vec3f( -mSphereOffset,  mSphereOffset, 0.0 ) );
-			gl::draw( mMeshVbo );
-			gl::popMatrices();
-		}
-	}
+	// Draw sphere mesh (four instances, with a single draw call):
+	// (The batch's built-in lit shader reads the light and material state set above.)
+	mSpheres.draw();
 
 	// Disable light0:
 	glDisable( GL_LIGHT0 );
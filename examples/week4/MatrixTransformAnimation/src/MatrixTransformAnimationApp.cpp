@@ -9,7 +9,8 @@
 #include "cinder/app/AppNative.h"
 #include "cinder/gl/gl.h"
 #include "cinder/Camera.h"
-#include "cinder/Timeline.h"
+
+#include "TweenBatch.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -31,7 +32,10 @@ public:
 	Vec3f		mCubeDimension;
 	Vec3f		mCubeTranslationInit, mCubeScaleInit, mCubeRotationInit, mCubeAnchorInit;
 	Vec3f		mCubeTranslationTarg, mCubeScaleTarg, mCubeRotationTarg, mCubeAnchorTarg;
-	Anim<Vec3f>	mCubeTranslationAnim, mCubeScaleAnim, mCubeRotationAnim, mCubeAnchorAnim;
+	
+	TweenBatch<Vec3f>	mCubeAnims;
+	size_t				mCubeTranslationAnim, mCubeScaleAnim, mCubeRotationAnim, mCubeAnchorAnim;
+	bool				mEaseTables;
 };
 
 void MatrixTransformAnimationApp::drawStrokedCubeUncentered(const Vec3f& ori, const Vec3f& size)
@@ -79,34 +83,33 @@ void MatrixTransformAnimationApp::setup()
 	mCubeAnchorTarg      = -mCubeDimension * 0.5;
 	
 	// Set cube anim transformations:
-	mCubeTranslationAnim = mCubeTranslationInit;
-	mCubeScaleAnim       = mCubeScaleInit;
-	mCubeRotationAnim    = mCubeRotationInit;
-	mCubeAnchorAnim      = mCubeAnchorInit;
+	// (Each one is a property of the tween batch, referred to by its handle.)
+	mCubeTranslationAnim = mCubeAnims.addProperty( mCubeTranslationInit );
+	mCubeScaleAnim       = mCubeAnims.addProperty( mCubeScaleInit );
+	mCubeRotationAnim    = mCubeAnims.addProperty( mCubeRotationInit );
+	mCubeAnchorAnim      = mCubeAnims.addProperty( mCubeAnchorInit );
 	
 	// Set the number of seconds per transition:
 	float tSecPerTrans   = 2.0;
 	
 	// Set the easing transition function:
 	// (Cubic is a nice, smooth one. But there are lots of options...)
-	EaseFn tEase;
-	tEase = EaseInOutCubic();
-	//tEase = EaseInOutBounce();
-	
-	// Prepare custom timeline:
-	ci::TimelineRef	tTimeline;
-	tTimeline = cinder::Timeline::create();
-	tTimeline->setInfinite( false );
-	tTimeline->setDefaultAutoRemove( false );
-	tTimeline->setAutoRemove( false );
-	tTimeline->setPingPong( true );
-	timeline().add( tTimeline );
-	
-	// Create timeline transitions:
-	tTimeline->apply( &mCubeTranslationAnim, mCubeTranslationTarg, tSecPerTrans, tEase );
-	tTimeline->apply( &mCubeScaleAnim, mCubeScaleTarg, tSecPerTrans, tEase ).appendTo( &mCubeTranslationAnim );
-	tTimeline->apply( &mCubeRotationAnim, mCubeRotationTarg, tSecPerTrans, tEase ).appendTo( &mCubeScaleAnim );
-	tTimeline->apply( &mCubeAnchorAnim, mCubeAnchorTarg, tSecPerTrans, tEase ).appendTo( &mCubeRotationAnim );
+	EaseType tEase;
+	tEase = EASE_IN_OUT_CUBIC;
+	//tEase = EASE_IN_OUT_BOUNCE;
+	
+	// Evaluate easing curves analytically (press 'e' to use lookup tables):
+	mEaseTables = false;
+	
+	// Play the batch forward and backward:
+	mCubeAnims.setPingPong( true );
+	
+	// Create transitions (each one starting when the previous one ends):
+	size_t tTween;
+	tTween = mCubeAnims.apply( mCubeTranslationAnim, mCubeTranslationTarg, tSecPerTrans, tEase );
+	tTween = mCubeAnims.appendTo( tTween, mCubeScaleAnim, mCubeScaleTarg, tSecPerTrans, tEase );
+	tTween = mCubeAnims.appendTo( tTween, mCubeRotationAnim, mCubeRotationTarg, tSecPerTrans, tEase );
+	tTween = mCubeAnims.appendTo( tTween, mCubeAnchorAnim, mCubeAnchorTarg, tSecPerTrans, tEase );
 }
 
 void MatrixTransformAnimationApp::mouseDown( MouseEvent event )
@@ -115,10 +118,32 @@ void MatrixTransformAnimationApp::mouseDown( MouseEvent event )
 
 void MatrixTransformAnimationApp::keyUp(KeyEvent event)
 {
+	switch( event.getChar() ) {
+		case 'b': {
+			// Time the evaluation of 100,000 animated properties:
+			runTweenBenchmark();
+			break;
+		}
+		case 'e': {
+			// Toggle between analytic easing and lookup tables:
+			mEaseTables = !mEaseTables;
+			mCubeAnims.setEaseTolerance( ( mEaseTables ) ? ( 1.0e-4f ) : ( 0.0f ) );
+			cout << "Easing: " << ( ( mEaseTables ) ? ( "lookup tables" ) : ( "analytic" ) ) << endl;
+			break;
+		}
+		case 't': {
+			// Check each lookup table against its analytic curve:
+			cout << ( ( verifyEaseTables() ) ? ( "All ease tables passed." ) : ( "Some ease tables FAILED." ) ) << endl;
+			break;
+		}
+		default: { break; }
+	}
 }
 
 void MatrixTransformAnimationApp::update()
 {
+	// Evaluate all tweens:
+	mCubeAnims.step( getElapsedSeconds() );
 }
 
 void MatrixTransformAnimationApp::draw()
@@ -141,10 +166,10 @@ void MatrixTransformAnimationApp::draw()
 	// Draw animated:
 	gl::color( Color( 1.0, 1.0, 1.0 ) );
 	gl::pushMatrices();
-	gl::translate( mCubeTranslationAnim );
-	gl::rotate( mCubeRotationAnim );
-	gl::scale( mCubeScaleAnim );
-	gl::translate( mCubeAnchorAnim );
+	gl::translate( mCubeAnims.getValue( mCubeTranslationAnim ) );
+	gl::rotate( mCubeAnims.getValue( mCubeRotationAnim ) );
+	gl::scale( mCubeAnims.getValue( mCubeScaleAnim ) );
+	gl::translate( mCubeAnims.getValue( mCubeAnchorAnim ) );
 	drawStrokedCubeUncentered( Vec3f::zero(), mCubeDimension );
 	gl::popMatrices();
 	
@@ -0,0 +1,563 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#define TWEEN_BATCH_SSE 1
+	#include <emmintrin.h>
+#endif
+
+#include "cinder/Vector.h"
+
+// cinder::Timeline is very flexible, but each Anim<T> tween is a separate heap
+// object, and each frame the timeline visits every one of them and calls its
+// easing function through a std::function. That's fine for a few dozen tweens,
+// but not for tens of thousands.
+//
+// A TweenBatch<T> holds all tweens of one value type in flat arrays:
+//
+// 1) Each tween's progress, clamp( ( time - start ) / duration, 0, 1 ), is
+//    computed in one loop over contiguous start times and durations.
+//
+// 2) Tweens are grouped by easing curve, so each curve is applied to a whole
+//    range of progress values at once (four at a time with SSE, without any
+//    branches: both sides of an "in-out" curve are computed and then blended).
+//
+// 3) Each tween writes from + ( to - from ) * eased progress into its property,
+//    one float component at a time.
+//
+// Like Timeline, a batch can "ping-pong" (play forward, then backward, forever),
+// and tweens can be appended to the end of other tweens.
+
+/** @brief easing curves that can be evaluated in bulk (same definitions as cinder/Easing.h) */
+enum EaseType {
+	EASE_NONE,
+	EASE_IN_QUAD,
+	EASE_OUT_QUAD,
+	EASE_IN_OUT_QUAD,
+	EASE_IN_CUBIC,
+	EASE_OUT_CUBIC,
+	EASE_IN_OUT_CUBIC,
+	EASE_IN_OUT_SINE,
+	EASE_OUT_BOUNCE,
+	EASE_IN_OUT_BOUNCE,
+	EASE_COUNT
+};
+
+/** @brief (helper) cinder's bounce curve */
+static inline float easeOutBounceHelper(float t, float c, float a)
+{
+	if( t == 1.0f ) { return c; }
+	if( t < ( 4.0f / 11.0f ) ) {
+		return c * ( 7.5625f * t * t );
+	}
+	else if( t < ( 8.0f / 11.0f ) ) {
+		t -= ( 6.0f / 11.0f );
+		return -a * ( 1.0f - ( 7.5625f * t * t + 0.75f ) ) + c;
+	}
+	else if( t < ( 10.0f / 11.0f ) ) {
+		t -= ( 9.0f / 11.0f );
+		return -a * ( 1.0f - ( 7.5625f * t * t + 0.9375f ) ) + c;
+	}
+	t -= ( 21.0f / 22.0f );
+	return -a * ( 1.0f - ( 7.5625f * t * t + 0.984375f ) ) + c;
+}
+
+/** @brief evaluates an easing curve for a single value */
+static inline float easeValue(const EaseType& iEase, float t)
+{
+	const float kBounce = 1.70158f;
+	switch( iEase ) {
+		case EASE_IN_QUAD:      { return t * t; }
+		case EASE_OUT_QUAD:     { return -t * ( t - 2.0f ); }
+		case EASE_IN_OUT_QUAD:  { t *= 2.0f; if( t < 1.0f ) { return 0.5f * t * t; } t -= 1.0f; return -0.5f * ( t * ( t - 2.0f ) - 1.0f ); }
+		case EASE_IN_CUBIC:     { return t * t * t; }
+		case EASE_OUT_CUBIC:    { t -= 1.0f; return t * t * t + 1.0f; }
+		case EASE_IN_OUT_CUBIC: { t *= 2.0f; if( t < 1.0f ) { return 0.5f * t * t * t; } t -= 2.0f; return 0.5f * ( t * t * t + 2.0f ); }
+		case EASE_IN_OUT_SINE:  { return -0.5f * ( cosf( static_cast<float>( M_PI ) * t ) - 1.0f ); }
+		case EASE_OUT_BOUNCE:   { return easeOutBounceHelper( t, 1.0f, kBounce ); }
+		case EASE_IN_OUT_BOUNCE: {
+			if( t < 0.5f ) { return ( 1.0f - easeOutBounceHelper( 1.0f - t * 2.0f, 1.0f, kBounce ) ) * 0.5f; }
+			return ( t == 1.0f ) ? ( 1.0f ) : ( easeOutBounceHelper( t * 2.0f - 1.0f, 1.0f, kBounce ) * 0.5f + 0.5f );
+		}
+		default: { return t; }
+	}
+}
+
+/** @brief evaluates an easing curve for an array of values (oValues may alias iValues) */
+static void easeValues(const EaseType& iEase, const float* iValues, float* oValues, const size_t& iCount)
+{
+	size_t i = 0;
+#ifdef TWEEN_BATCH_SSE
+	const __m128 tHalf = _mm_set1_ps( 0.5f );
+	const __m128 tOne  = _mm_set1_ps( 1.0f );
+	const __m128 tTwo  = _mm_set1_ps( 2.0f );
+	switch( iEase ) {
+		case EASE_IN_QUAD:
+		case EASE_OUT_QUAD:
+		case EASE_IN_OUT_QUAD:
+		case EASE_IN_CUBIC:
+		case EASE_OUT_CUBIC:
+		case EASE_IN_OUT_CUBIC: {
+			for(; i + 4 <= iCount; i += 4) {
+				__m128 t = _mm_loadu_ps( iValues + i );
+				__m128 r;
+				if( iEase == EASE_IN_QUAD ) {
+					r = _mm_mul_ps( t, t );
+				}
+				else if( iEase == EASE_OUT_QUAD ) {
+					r = _mm_mul_ps( t, _mm_sub_ps( tTwo, t ) );
+				}
+				else if( iEase == EASE_IN_CUBIC ) {
+					r = _mm_mul_ps( _mm_mul_ps( t, t ), t );
+				}
+				else if( iEase == EASE_OUT_CUBIC ) {
+					__m128 u = _mm_sub_ps( t, tOne );
+					r = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( u, u ), u ), tOne );
+				}
+				else {
+					// In-out curves: compute both halves and select per lane:
+					__m128 u    = _mm_mul_ps( t, tTwo );
+					__m128 tLow = _mm_cmplt_ps( u, tOne );
+					__m128 tIn, tOut;
+					if( iEase == EASE_IN_OUT_QUAD ) {
+						__m128 v = _mm_sub_ps( u, tOne );
+						tIn  = _mm_mul_ps( tHalf, _mm_mul_ps( u, u ) );
+						tOut = _mm_sub_ps( tHalf, _mm_mul_ps( tHalf, _mm_mul_ps( v, _mm_sub_ps( v, tTwo ) ) ) );
+					}
+					else {
+						__m128 v = _mm_sub_ps( u, tTwo );
+						tIn  = _mm_mul_ps( tHalf, _mm_mul_ps( _mm_mul_ps( u, u ), u ) );
+						tOut = _mm_mul_ps( tHalf, _mm_add_ps( _mm_mul_ps( _mm_mul_ps( v, v ), v ), tTwo ) );
+					}
+					r = _mm_or_ps( _mm_and_ps( tLow, tIn ), _mm_andnot_ps( tLow, tOut ) );
+				}
+				_mm_storeu_ps( oValues + i, r );
+			}
+			break;
+		}
+		default: { break; }
+	}
+#endif
+	// Remainder (and curves without a vector path):
+	for(; i < iCount; i++) {
+		oValues[ i ] = easeValue( iEase, iValues[ i ] );
+	}
+}
+
+// Easing curves can also be read from precomputed tables: the curve is sampled
+// at N evenly spaced points, and values in between are linearly interpolated.
+// That turns every curve (including bounce and sine) into the same short
+// sequence of a multiply, a truncation, two loads and a lerp.
+//
+// The error of linear interpolation shrinks with the square of the spacing, so
+// each table doubles its resolution until the worst error (measured between the
+// samples, where it is largest) is within the requested tolerance. Smooth curves
+// need few samples; bounce, with its sharp corners, needs more.
+
+/** @brief a lookup table for one easing curve */
+class EaseTable {
+public:
+	/** @brief default constructor */
+	EaseTable() : mEase( EASE_NONE ), mScale( 1.0f ), mMaxError( 0.0f ) {}
+
+	/** @brief builds the table with the smallest power-of-two resolution that meets the given maximum error */
+	void build(const EaseType& iEase, const float& iMaxError, const size_t& iMaxSize = 1 << 16)
+	{
+		mEase = iEase;
+		for(size_t tIntervals = 4; tIntervals <= iMaxSize; tIntervals *= 2) {
+			sample( tIntervals );
+			mMaxError = measureError( 16 );
+			if( mMaxError <= iMaxError ) { break; }
+		}
+	}
+
+	/** @brief returns the eased value for t in [0, 1] */
+	float lookup(const float& t) const
+	{
+		float   tPos   = t * mScale;
+		int32_t tIndex = std::min( static_cast<int32_t>( tPos ), static_cast<int32_t>( mValues.size() ) - 2 );
+		float   tFrac  = tPos - tIndex;
+		return mValues[ tIndex ] + ( mValues[ tIndex + 1 ] - mValues[ tIndex ] ) * tFrac;
+	}
+
+	/** @brief returns the eased values for an array of t in [0, 1] (oValues may alias iValues) */
+	void lookup(const float* iValues, float* oValues, const size_t& iCount) const
+	{
+		size_t i = 0;
+#ifdef TWEEN_BATCH_SSE
+		// The index and fraction math runs four at a time. (SSE has no "gather"
+		// instruction, so the two table reads per value are still scalar.)
+		const __m128 tScale = _mm_set1_ps( mScale );
+		const __m128 tLast  = _mm_set1_ps( mScale - 1.0f );
+		const float* tTable = &mValues[ 0 ];
+		int32_t      tIndices[ 4 ];
+		float        tLo[ 4 ], tHi[ 4 ];
+		for(; i + 4 <= iCount; i += 4) {
+			__m128  tPos   = _mm_mul_ps( _mm_loadu_ps( iValues + i ), tScale );
+			// t is never negative, so truncation is floor (clamped so that t = 1 uses the last interval):
+			__m128i tIndex = _mm_cvttps_epi32( _mm_min_ps( tPos, tLast ) );
+			__m128  tFrac  = _mm_sub_ps( tPos, _mm_cvtepi32_ps( tIndex ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( tIndices ), tIndex );
+			for(int k = 0; k < 4; k++) {
+				tLo[ k ] = tTable[ tIndices[ k ] ];
+				tHi[ k ] = tTable[ tIndices[ k ] + 1 ];
+			}
+			__m128 tA = _mm_loadu_ps( tLo );
+			__m128 tB = _mm_loadu_ps( tHi );
+			_mm_storeu_ps( oValues + i, _mm_add_ps( tA, _mm_mul_ps( _mm_sub_ps( tB, tA ), tFrac ) ) );
+		}
+#endif
+		for(; i < iCount; i++) {
+			oValues[ i ] = lookup( iValues[ i ] );
+		}
+	}
+
+	/** @brief returns the curve */
+	EaseType getEase() const { return mEase; }
+
+	/** @brief returns the number of samples */
+	size_t getSize() const { return mValues.size(); }
+
+	/** @brief returns the worst error measured when the table was built */
+	float getMaxError() const { return mMaxError; }
+
+	/** @brief returns the worst error against the analytic curve over the given number of evenly spaced test points */
+	float measureError(const size_t& iSubdivisions) const
+	{
+		size_t tCount = ( mValues.size() - 1 ) * iSubdivisions;
+		float tError = 0.0f;
+		for(size_t i = 0; i <= tCount; i++) {
+			float t = static_cast<float>( i ) / tCount;
+			tError = std::max( tError, std::fabs( lookup( t ) - easeValue( mEase, t ) ) );
+		}
+		return tError;
+	}
+
+protected:
+	/** @brief samples the curve at iIntervals + 1 points */
+	void sample(const size_t& iIntervals)
+	{
+		mValues.resize( iIntervals + 1 );
+		for(size_t i = 0; i <= iIntervals; i++) {
+			mValues[ i ] = easeValue( mEase, static_cast<float>( i ) / iIntervals );
+		}
+		mScale = static_cast<float>( iIntervals );
+	}
+
+	EaseType			mEase;
+	std::vector<float>	mValues;
+	float				mScale;		//!< number of intervals
+	float				mMaxError;
+};
+
+/** @brief checks each curve's table against the analytic curve (on a finer grid than the one used to build it) and prints the results */
+static bool verifyEaseTables(const float& iMaxError = 1.0e-4f)
+{
+	bool tPassed = true;
+	std::vector<float> tInput( 100001 ), tOutput( tInput.size() );
+	for(size_t i = 0; i < tInput.size(); i++) { tInput[ i ] = static_cast<float>( i ) / ( tInput.size() - 1 ); }
+
+	for(size_t iEase = 0; iEase < EASE_COUNT; iEase++) {
+		EaseType tEase = static_cast<EaseType>( iEase );
+		EaseTable tTable;
+		tTable.build( tEase, iMaxError );
+
+		// Check the scalar path on a fine grid, and the vector path on the same points:
+		float tScalarError = tTable.measureError( 64 );
+		tTable.lookup( &tInput[ 0 ], &tOutput[ 0 ], tInput.size() );
+		float tVectorError = 0.0f;
+		for(size_t i = 0; i < tInput.size(); i++) {
+			tVectorError = std::max( tVectorError, std::fabs( tOutput[ i ] - easeValue( tEase, tInput[ i ] ) ) );
+		}
+		// (Allow for float rounding on top of the interpolation error.)
+		bool tOk = tScalarError <= iMaxError * 1.01f + 1.0e-6f && tVectorError <= iMaxError * 1.01f + 1.0e-6f;
+		tPassed  = tPassed && tOk;
+		std::cout << "Ease table " << iEase << ": " << tTable.getSize() << " samples, max error " << std::max( tScalarError, tVectorError );
+		std::cout << ( ( tOk ) ? ( " (ok)" ) : ( " (FAILED)" ) ) << std::endl;
+	}
+	return tPassed;
+}
+
+/** @brief a batch of tweens over properties of type T (a type made of floats, e.g. float, Vec3f or ColorA) */
+template<typename T>
+class TweenBatch {
+public:
+	/** @brief default constructor */
+	TweenBatch() : mPingPong( false ), mDuration( -1.0f ), mPassDuration( 0.0f ), mDirty( true ) {}
+
+	/** @brief adds a property with the given initial value and returns its handle */
+	size_t addProperty(const T& iValue)
+	{
+		mValues.push_back( iValue );
+		mLastTween.push_back( -1 );
+		return mValues.size() - 1;
+	}
+
+	/** @brief returns a property's current value */
+	const T& getValue(const size_t& iProperty) const { return mValues[ iProperty ]; }
+
+	/** @brief returns all property values */
+	const std::vector<T>& getValues() const { return mValues; }
+
+	/** @brief tweens a property to the given value and returns the tween's handle
+	 *  (tweens on one property must be added in chronological order: each starts from the previous one's target) */
+	size_t apply(const size_t& iProperty, const T& iTarget, const float& iDuration, const EaseType& iEase, const float& iStartTime = 0.0f)
+	{
+		Tween tTween;
+		tTween.mProperty  = static_cast<uint32_t>( iProperty );
+		tTween.mStartTime = iStartTime;
+		tTween.mDuration  = std::max( iDuration, std::numeric_limits<float>::min() );
+		tTween.mEase      = iEase;
+		tTween.mFrom      = ( mLastTween[ iProperty ] >= 0 ) ? ( mTweens[ mLastTween[ iProperty ] ].mTo ) : ( mValues[ iProperty ] );
+		tTween.mTo        = iTarget;
+		mLastTween[ iProperty ] = static_cast<int32_t>( mTweens.size() );
+		mTweens.push_back( tTween );
+		mDirty = true;
+		return mTweens.size() - 1;
+	}
+
+	/** @brief tweens a property, starting when another tween of this batch ends */
+	size_t appendTo(const size_t& iPrevious, const size_t& iProperty, const T& iTarget, const float& iDuration, const EaseType& iEase)
+	{
+		return apply( iProperty, iTarget, iDuration, iEase, getEndTime( iPrevious ) );
+	}
+
+	/** @brief returns the time at which a tween ends */
+	float getEndTime(const size_t& iTween) const { return mTweens[ iTween ].mStartTime + mTweens[ iTween ].mDuration; }
+
+	/** @brief makes the batch play forward, then backward, repeatedly */
+	void setPingPong(const bool& iPingPong) { mPingPong = iPingPong; }
+
+	/** @brief sets the length of one ping-pong pass (by default, the end of the last tween) */
+	void setDuration(const float& iDuration) { mDuration = iDuration; mDirty = true; }
+
+	/** @brief evaluates easing curves from lookup tables with the given maximum error (0 evaluates them analytically) */
+	void setEaseTolerance(const float& iMaxError)
+	{
+		mEaseTables.clear();
+		if( iMaxError <= 0.0f ) { return; }
+		mEaseTables.resize( EASE_COUNT );
+		for(size_t i = 0; i < EASE_COUNT; i++) {
+			mEaseTables[ i ].build( static_cast<EaseType>( i ), iMaxError );
+		}
+	}
+
+	/** @brief returns the length of one ping-pong pass */
+	float getDuration() const
+	{
+		if( mDuration >= 0.0f ) { return mDuration; }
+		float tEnd = 0.0f;
+		for(size_t i = 0; i < mTweens.size(); i++) { tEnd = std::max( tEnd, getEndTime( i ) ); }
+		return tEnd;
+	}
+
+	/** @brief returns the number of tweens */
+	size_t getTweenCount() const { return mTweens.size(); }
+
+	/** @brief evaluates all tweens at the given time (in seconds) */
+	void step(float iTime)
+	{
+		if( mDirty ) { compile(); }
+
+		// Map the time into the current ping-pong pass:
+		if( mPingPong && mPassDuration > 0.0f ) {
+			iTime = fmodf( std::max( iTime, 0.0f ), mPassDuration * 2.0f );
+			if( iTime > mPassDuration ) { iTime = mPassDuration * 2.0f - iTime; }
+		}
+
+		// Work through each easing curve's range of tweens in small blocks, so that
+		// the intermediate weights never leave the cache:
+		float tWeights[ kBlockSize ];
+		for(size_t iEase = 0; iEase < EASE_COUNT; iEase++) {
+			size_t tEnd = mEaseRanges[ iEase + 1 ];
+			for(size_t tBegin = mEaseRanges[ iEase ]; tBegin < tEnd; tBegin += kBlockSize) {
+				size_t tCount = ( tEnd - tBegin < kBlockSize ) ? ( tEnd - tBegin ) : ( kBlockSize );
+				computeProgress( iTime, tBegin, tCount, tWeights );
+				if( mEaseTables.empty() ) {
+					easeValues( static_cast<EaseType>( iEase ), tWeights, tWeights, tCount );
+				}
+				else {
+					mEaseTables[ iEase ].lookup( tWeights, tWeights, tCount );
+				}
+				writeValues( iTime, tBegin, tCount, tWeights );
+			}
+		}
+	}
+
+protected:
+	static const size_t kComponents = sizeof( T ) / sizeof( float );
+	static const size_t kBlockSize  = 256;
+
+	/** @brief a tween as it was added */
+	struct Tween
+	{
+		uint32_t	mProperty;
+		float		mStartTime;
+		float		mDuration;
+		EaseType	mEase;
+		T			mFrom;
+		T			mTo;
+	};
+
+	/** @brief builds the flat arrays, grouped by easing curve */
+	void compile()
+	{
+		size_t tCount = mTweens.size();
+
+		// Group by easing curve:
+		std::vector<uint32_t> tOrder( tCount );
+		for(size_t i = 0; i < tCount; i++) { tOrder[ i ] = static_cast<uint32_t>( i ); }
+		std::stable_sort( tOrder.begin(), tOrder.end(), [this] (uint32_t a, uint32_t b) { return mTweens[ a ].mEase < mTweens[ b ].mEase; } );
+		mEaseRanges.assign( EASE_COUNT + 1, 0 );
+		for(size_t i = 0; i < tCount; i++) { mEaseRanges[ mTweens[ i ].mEase + 1 ]++; }
+		for(size_t i = 0; i < EASE_COUNT; i++) { mEaseRanges[ i + 1 ] += mEaseRanges[ i ]; }
+
+		// Find, for each tween, when the next tween on the same property takes over:
+		std::vector<float> tNext( tCount, std::numeric_limits<float>::max() );
+		std::vector<bool>  tFirst( tCount, true );
+		std::vector<int32_t> tPrevious( mValues.size(), -1 );
+		for(size_t i = 0; i < tCount; i++) {
+			int32_t& tPrev = tPrevious[ mTweens[ i ].mProperty ];
+			if( tPrev >= 0 ) {
+				tNext[ tPrev ] = mTweens[ i ].mStartTime;
+				tFirst[ i ]    = false;
+			}
+			tPrev = static_cast<int32_t>( i );
+		}
+
+		// Fill the flat arrays:
+		mProperties.resize( tCount );
+		mStartTimes.resize( tCount );
+		mInvDurations.resize( tCount );
+		mOwnStartTimes.resize( tCount );
+		mNextStartTimes.resize( tCount );
+		mFrom.resize( tCount * kComponents );
+		mDelta.resize( tCount * kComponents );
+		for(size_t i = 0; i < tCount; i++) {
+			const Tween& tTween = mTweens[ tOrder[ i ] ];
+			mProperties[ i ]     = tTween.mProperty;
+			mStartTimes[ i ]     = tTween.mStartTime;
+			mInvDurations[ i ]   = 1.0f / tTween.mDuration;
+			mOwnStartTimes[ i ]  = ( tFirst[ tOrder[ i ] ] ) ? ( -std::numeric_limits<float>::max() ) : ( tTween.mStartTime );
+			mNextStartTimes[ i ] = tNext[ tOrder[ i ] ];
+			const float* tFrom = reinterpret_cast<const float*>( &tTween.mFrom );
+			const float* tTo   = reinterpret_cast<const float*>( &tTween.mTo );
+			for(size_t c = 0; c < kComponents; c++) {
+				mFrom[ i * kComponents + c ]  = tFrom[ c ];
+				mDelta[ i * kComponents + c ] = tTo[ c ] - tFrom[ c ];
+			}
+		}
+
+		mPassDuration = getDuration();
+		mDirty = false;
+	}
+
+	/** @brief oWeights[ i ] = clamp( ( time - start ) / duration, 0, 1 ) for tweens [ iBegin, iBegin + iCount ) */
+	void computeProgress(const float& iTime, const size_t& iBegin, const size_t& iCount, float* oWeights) const
+	{
+		const float* tStarts       = &mStartTimes[ iBegin ];
+		const float* tInvDurations = &mInvDurations[ iBegin ];
+		size_t i = 0;
+#ifdef TWEEN_BATCH_SSE
+		const __m128 tTime = _mm_set1_ps( iTime );
+		const __m128 tZero = _mm_setzero_ps();
+		const __m128 tOne  = _mm_set1_ps( 1.0f );
+		for(; i + 4 <= iCount; i += 4) {
+			__m128 t = _mm_mul_ps( _mm_sub_ps( tTime, _mm_loadu_ps( tStarts + i ) ), _mm_loadu_ps( tInvDurations + i ) );
+			_mm_storeu_ps( oWeights + i, _mm_min_ps( _mm_max_ps( t, tZero ), tOne ) );
+		}
+#endif
+		for(; i < iCount; i++) {
+			oWeights[ i ] = std::min( std::max( ( iTime - tStarts[ i ] ) * tInvDurations[ i ], 0.0f ), 1.0f );
+		}
+	}
+
+	/** @brief writes the values of the tweens in [ iBegin, iBegin + iCount ) that currently own their property */
+	void writeValues(const float& iTime, const size_t& iBegin, const size_t& iCount, const float* iWeights)
+	{
+		float*          tValues = reinterpret_cast<float*>( &mValues[ 0 ] );
+		const uint32_t* tProps  = &mProperties[ iBegin ];
+		const float*    tOwns   = &mOwnStartTimes[ iBegin ];
+		const float*    tNexts  = &mNextStartTimes[ iBegin ];
+		const float*    tFrom   = &mFrom[ iBegin * kComponents ];
+		const float*    tDelta  = &mDelta[ iBegin * kComponents ];
+		for(size_t i = 0; i < iCount; i++, tFrom += kComponents, tDelta += kComponents) {
+			if( iTime < tOwns[ i ] || iTime >= tNexts[ i ] ) { continue; }
+			float* tDst = tValues + tProps[ i ] * kComponents;
+			for(size_t c = 0; c < kComponents; c++) {
+				tDst[ c ] = tFrom[ c ] + tDelta[ c ] * iWeights[ i ];
+			}
+		}
+	}
+
+	// Properties:
+	std::vector<T>			mValues;
+	std::vector<int32_t>	mLastTween;		//!< latest tween added on each property
+
+	// Tweens (as added):
+	std::vector<Tween>		mTweens;
+	bool					mPingPong;
+	float					mDuration;		//!< ping-pong pass length (negative = automatic)
+	float					mPassDuration;
+	bool					mDirty;
+	std::vector<EaseTable>	mEaseTables;	//!< one per curve (empty = analytic)
+
+	// Tweens (flat arrays, grouped by easing curve):
+	std::vector<size_t>		mEaseRanges;	//!< first tween of each curve (plus the end)
+	std::vector<uint32_t>	mProperties;
+	std::vector<float>		mStartTimes;
+	std::vector<float>		mInvDurations;
+	std::vector<float>		mOwnStartTimes;	//!< when this tween takes over its property (-inf for the first tween on a property)
+	std::vector<float>		mNextStartTimes;	//!< when the next tween on the same property takes over
+	std::vector<float>		mFrom;
+	std::vector<float>		mDelta;
+};
+
+/** @brief times the evaluation of a large batch of tweens and prints the results */
+static void runTweenBenchmark(const size_t& iPropertyCount = 100000, const size_t& iFrames = 100)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// Each property gets a chain of two tweens, with a mix of easing curves:
+	TweenBatch<ci::Vec3f> tBatch;
+	for(size_t i = 0; i < iPropertyCount; i++) {
+		size_t tProperty = tBatch.addProperty( ci::Vec3f::zero() );
+		EaseType tEase   = static_cast<EaseType>( i % EASE_COUNT );
+		size_t tFirst    = tBatch.apply( tProperty, ci::Vec3f( 1.0f, 2.0f, 3.0f ), 1.0f + ( i % 7 ) * 0.1f, tEase );
+		tBatch.appendTo( tFirst, tProperty, ci::Vec3f( -1.0f, 0.0f, 1.0f ), 1.0f, EASE_IN_OUT_CUBIC );
+	}
+	tBatch.setPingPong( true );
+	tBatch.step( 0.0f );
+
+	std::cout << "Tween benchmark: " << iPropertyCount << " Vec3f properties, " << tBatch.getTweenCount() << " tweens";
+#ifdef TWEEN_BATCH_SSE
+	std::cout << " (SSE)";
+#endif
+	std::cout << std::endl;
+
+	// Analytic curves, then lookup tables:
+	for(int iMode = 0; iMode < 2; iMode++) {
+		tBatch.setEaseTolerance( ( iMode == 0 ) ? ( 0.0f ) : ( 1.0e-4f ) );
+		Clock::time_point tStart = Clock::now();
+		for(size_t iFrame = 0; iFrame < iFrames; iFrame++) {
+			tBatch.step( iFrame / 60.0f );
+		}
+		double tTime = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count() / iFrames;
+		std::cout << ( ( iMode == 0 ) ? ( "  analytic easing:      " ) : ( "  table easing (1e-4):  " ) ) << tTime << " ms per step" << std::endl;
+	}
+}
@@ -0,0 +1,356 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "cinder/Area.h"
+#include "cinder/DataSource.h"
+#include "cinder/ImageIo.h"
+#include "cinder/Surface.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Texture.h"
+
+// Loading a texture has two parts:
+//   - decoding: reading the file and turning its compressed data (PNG, JPEG,
+//     etc.) into pixels, which is slow, but only needs the CPU,
+//   - uploading: copying the pixels into a GL texture, which has to be done on
+//     the thread that owns the GL context (the main, "render", thread).
+//
+// Doing both in setup() means the window doesn't appear until every image has
+// been loaded; doing them while drawing means frames "hitch" (take visibly too
+// long) whenever an image arrives.
+//
+// An asynchronous loader splits them up:
+//   - load() returns a handle straight away; until the texture is ready, the
+//     handle gives out a small "placeholder" texture (a checkerboard),
+//   - a pool of decode threads takes requests from a queue, most important
+//     ("highest priority") first; priorities can be changed while a request
+//     is waiting,
+//   - the render thread calls update() once a frame, which uploads decoded
+//     images, but only so many bytes per frame (the "upload budget"): large
+//     images are uploaded a band of rows at a time, over several frames.
+//
+// Dropping every handle to a request cancels it (if it hasn't been decoded yet).
+
+class AsyncTextureLoader;
+
+/** @brief a texture being loaded (a handle returned by AsyncTextureLoader::load()) */
+class TextureAsset {
+public:
+	/** @brief loading stages */
+	enum State { STATE_QUEUED, STATE_DECODING, STATE_UPLOADING, STATE_READY, STATE_FAILED };
+
+	/** @brief returns the current stage */
+	State getState() const { return static_cast<State>( mState.load() ); }
+
+	/** @brief returns true once the texture is fully uploaded */
+	bool isReady() const { return getState() == STATE_READY; }
+
+	/** @brief returns the texture, or the placeholder until it's ready */
+	const ci::gl::Texture& getTexture() const { return ( isReady() ) ? ( mTexture ) : ( *mPlaceholder ); }
+
+	/** @brief returns the image size (zero until it's been decoded) */
+	ci::Vec2i getSize() const
+	{
+		// (mSize is written once, by a decode thread, before it sets the state to STATE_UPLOADING,
+		// so it's only read once that state has been seen:)
+		State tState = getState();
+		return ( tState == STATE_UPLOADING || tState == STATE_READY ) ? ( mSize ) : ( ci::Vec2i( 0, 0 ) );
+	}
+
+	/** @brief returns the priority (from any thread) */
+	float getPriority() const { return mPriority.load(); }
+
+protected:
+	friend class AsyncTextureLoader;
+
+	/** @brief constructor */
+	TextureAsset(const std::function<ci::Surface8u()>& iDecode, const float& iPriority, const uint64_t& iSequence, const std::shared_ptr<ci::gl::Texture>& iPlaceholder) :
+		mDecode( iDecode ), mPriority( iPriority ), mSequence( iSequence ), mTaken( new bool( false ) ), mState( STATE_QUEUED ), mUploadedRows( 0 ), mSize( 0, 0 ), mPlaceholder( iPlaceholder ) {}
+
+	std::function<ci::Surface8u()>	mDecode;			//!< produces the pixels (on a decode thread)
+	std::atomic<float>				mPriority;			//!< changed under the loader's mutex (atomic, so getPriority() and update() can read it without)
+	uint64_t						mSequence;			//!< request order (among equal priorities, first come first served)
+	std::shared_ptr<bool>			mTaken;				//!< shared with the queue entries: set once one is taken (guarded by the loader's mutex)
+	std::atomic<int>				mState;
+	ci::Surface8u					mSurface;			//!< decoded pixels, until uploaded
+	int32_t							mUploadedRows;
+	ci::Vec2i						mSize;				//!< set before the state becomes STATE_UPLOADING
+	ci::gl::Texture					mTexture;
+	std::shared_ptr<ci::gl::Texture>	mPlaceholder;	//!< the loader's placeholder (created by its first update())
+};
+
+typedef std::shared_ptr<TextureAsset> TextureAssetRef;
+
+/** @brief decodes images on a thread pool (by priority) and uploads them as textures within a per-frame byte budget */
+class AsyncTextureLoader {
+public:
+	/** @brief counters */
+	struct Stats
+	{
+		size_t	mRequested;
+		size_t	mDecoded;
+		size_t	mFailed;
+		size_t	mCancelled;			//!< requests whose handles were all dropped before decoding
+		size_t	mReady;
+		size_t	mPending;			//!< requested, and not yet ready, failed or cancelled
+		double	mDecodeMs;			//!< total time spent decoding (summed over threads)
+		size_t	mFrameBytes;		//!< bytes uploaded in the last update()
+		double	mFrameUploadMs;		//!< time spent uploading in the last update()
+		double	mMaxFrameUploadMs;	//!< the most time spent uploading in one update()
+
+		/** @brief default constructor */
+		Stats() : mRequested( 0 ), mDecoded( 0 ), mFailed( 0 ), mCancelled( 0 ), mReady( 0 ), mPending( 0 ), mDecodeMs( 0.0 ), mFrameBytes( 0 ), mFrameUploadMs( 0.0 ), mMaxFrameUploadMs( 0.0 ) {}
+	};
+
+	/** @brief constructor (decode threads, zero for one fewer than the hardware threads; bytes uploaded per frame) */
+	AsyncTextureLoader(const size_t& iThreads = 0, const size_t& iUploadBudget = 4 * 1024 * 1024) :
+		mThreadCount( iThreads ), mUploadBudget( std::max<size_t>( iUploadBudget, 1 ) ), mLive( 0 ), mSequence( 0 ), mStop( false ), mPlaceholder( new ci::gl::Texture() ) {}
+
+	/** @brief destructor (waits for the decode threads to finish their current images) */
+	~AsyncTextureLoader()
+	{
+		{
+			std::lock_guard<std::mutex> tLock( mMutex );
+			mStop = true;
+		}
+		mCondition.notify_all();
+		for(std::vector<std::thread>::iterator it = mThreads.begin(); it != mThreads.end(); it++) {
+			(*it).join();
+		}
+	}
+
+	/** @brief requests an image from a data source (e.g. loadResource(), loadAsset() or a file path) */
+	TextureAssetRef load(const ci::DataSourceRef& iSource, const float& iPriority = 0.0f)
+	{
+		return load( [iSource]() { return ci::Surface8u( ci::loadImage( iSource ) ); }, iPriority );
+	}
+
+	/** @brief requests an image produced by a function (called on a decode thread) */
+	TextureAssetRef load(const std::function<ci::Surface8u()>& iDecode, const float& iPriority = 0.0f)
+	{
+		start();
+		std::lock_guard<std::mutex> tLock( mMutex );
+		TextureAssetRef tAsset( new TextureAsset( iDecode, iPriority, mSequence++, mPlaceholder ) );
+		mQueue.push( Request( tAsset ) );
+		mStats.mRequested++;
+		mLive++;
+		mCondition.notify_one();
+		return tAsset;
+	}
+
+	/** @brief changes a request's priority (if it's still waiting to be decoded) */
+	void setPriority(const TextureAssetRef& iAsset, const float& iPriority)
+	{
+		std::lock_guard<std::mutex> tLock( mMutex );
+		if( iAsset->getState() != TextureAsset::STATE_QUEUED || iAsset->mPriority == iPriority ) { return; }
+		// (The old queue entry is left in place, and skipped when it comes up, since its priority no longer matches.)
+		iAsset->mPriority = iPriority;
+		mQueue.push( Request( iAsset ) );
+	}
+
+	/** @brief uploads decoded images, up to the byte budget (call once a frame, on the render thread) */
+	void update()
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		Clock::time_point tStart = Clock::now();
+
+		// The placeholder is created here, on the render thread (the handles share it, so ones
+		// returned by load() before the first update() get it too):
+		if( !*mPlaceholder ) { *mPlaceholder = createPlaceholder(); }
+
+		// Collect newly decoded images (highest priority first):
+		{
+			std::lock_guard<std::mutex> tLock( mMutex );
+			mUploads.insert( mUploads.end(), mDecoded.begin(), mDecoded.end() );
+			mDecoded.clear();
+		}
+		// (Decoded assets' priorities no longer change, since setPriority() only changes queued ones:)
+		std::stable_sort( mUploads.begin(), mUploads.end(), [](const TextureAssetRef& a, const TextureAssetRef& b) { return a->mPriority.load() > b->mPriority.load(); } );
+
+		// Upload bands of rows until the budget is spent (always at least one band, so nothing waits forever):
+		size_t tBytes = 0, tReady = 0;
+		while( !mUploads.empty() && ( tBytes == 0 || tBytes < mUploadBudget ) ) {
+			TextureAssetRef tAsset = mUploads.front();
+			const ci::Surface8u& tSurface = tAsset->mSurface;
+			int32_t tRowBytes = tSurface.getWidth() * 4;
+			if( !tAsset->mTexture ) {
+				ci::gl::Texture::Format tFormat;
+				tFormat.setMinFilter( GL_LINEAR );
+				tFormat.setMagFilter( GL_LINEAR );
+				tAsset->mTexture = ci::gl::Texture( tSurface.getWidth(), tSurface.getHeight(), tFormat );
+			}
+			int32_t tRows = static_cast<int32_t>( std::max<size_t>( ( mUploadBudget - std::min( tBytes, mUploadBudget ) ) / std::max( tRowBytes, 1 ), 1 ) );
+			tRows = std::min( tRows, tSurface.getHeight() - tAsset->mUploadedRows );
+			tAsset->mTexture.update( tSurface, ci::Area( 0, tAsset->mUploadedRows, tSurface.getWidth(), tAsset->mUploadedRows + tRows ) );
+			tAsset->mUploadedRows += tRows;
+			tBytes += static_cast<size_t>( tRows ) * tRowBytes;
+
+			if( tAsset->mUploadedRows >= tSurface.getHeight() ) {
+				tAsset->mSurface = ci::Surface8u();
+				tAsset->mState   = TextureAsset::STATE_READY;
+				mUploads.erase( mUploads.begin() );
+				tReady++;
+			}
+		}
+
+		std::lock_guard<std::mutex> tLock( mMutex );
+		mLive -= tReady;
+		mStats.mReady        += tReady;
+		mStats.mPending       = mLive;
+		mStats.mFrameBytes    = tBytes;
+		mStats.mFrameUploadMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+		mStats.mMaxFrameUploadMs = std::max( mStats.mMaxFrameUploadMs, mStats.mFrameUploadMs );
+	}
+
+	/** @brief sets the bytes uploaded per frame */
+	void setUploadBudget(const size_t& iBytes) { mUploadBudget = std::max<size_t>( iBytes, 1 ); }
+
+	/** @brief returns the texture shown until a request is ready (empty until the first update()) */
+	const ci::gl::Texture& getPlaceholder() const { return *mPlaceholder; }
+
+	/** @brief returns the counters */
+	Stats getStats()
+	{
+		std::lock_guard<std::mutex> tLock( mMutex );
+		mStats.mPending = mLive;
+		return mStats;
+	}
+
+protected:
+	/** @brief a queue entry (the asset is only weakly held, so dropping its handles cancels it) */
+	struct Request
+	{
+		std::weak_ptr<TextureAsset>	mAsset;
+		std::shared_ptr<bool>		mTaken;			//!< the asset's mTaken (outlives it, so a cancelled request is only counted once)
+		float						mPriority;
+		uint64_t					mSequence;
+
+		/** @brief constructor */
+		Request(const TextureAssetRef& iAsset) : mAsset( iAsset ), mTaken( iAsset->mTaken ), mPriority( iAsset->mPriority ), mSequence( iAsset->mSequence ) {}
+
+		/** @brief queue order: lower priority (or, for equal priorities, later requests) come out last */
+		bool operator<(const Request& iOther) const
+		{
+			return ( mPriority != iOther.mPriority ) ? ( mPriority < iOther.mPriority ) : ( mSequence > iOther.mSequence );
+		}
+	};
+
+	/** @brief returns a grey checkerboard (needs the GL context) */
+	static ci::gl::Texture createPlaceholder()
+	{
+		ci::Surface8u tSurface( 64, 64, true, ci::SurfaceChannelOrder::RGBA );
+		for(int32_t y = 0; y < 64; y++) {
+			uint8_t* tRow = tSurface.getData() + y * tSurface.getRowBytes();
+			for(int32_t x = 0; x < 64; x++) {
+				uint8_t v = ( ( ( x / 8 ) + ( y / 8 ) ) % 2 ) ? ( 160 ) : ( 96 );
+				tRow[ x * 4 + 0 ] = v;
+				tRow[ x * 4 + 1 ] = v;
+				tRow[ x * 4 + 2 ] = v;
+				tRow[ x * 4 + 3 ] = 255;
+			}
+		}
+		return ci::gl::Texture( tSurface );
+	}
+
+	/** @brief starts the decode threads (on the first request) */
+	void start()
+	{
+		if( !mThreads.empty() ) { return; }
+		size_t tThreads = ( mThreadCount ) ? ( mThreadCount ) : ( std::max<size_t>( std::thread::hardware_concurrency(), 2 ) - 1 );
+		for(size_t t = 0; t < tThreads; t++) {
+			mThreads.push_back( std::thread( &AsyncTextureLoader::decodeLoop, this ) );
+		}
+	}
+
+	/** @brief a decode thread: takes the most important request, decodes it, and hands it to the render thread */
+	void decodeLoop()
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		std::unique_lock<std::mutex> tLock( mMutex );
+		while( true ) {
+			mCondition.wait( tLock, [this]() { return mStop || !mQueue.empty(); } );
+			if( mStop ) { return; }
+
+			Request tRequest = mQueue.top();
+			mQueue.pop();
+			// (Stale entries, left behind by setPriority(), or for a request that's already been taken:)
+			if( *tRequest.mTaken ) { continue; }
+			TextureAssetRef tAsset = tRequest.mAsset.lock();
+			if( !tAsset ) {
+				*tRequest.mTaken = true;
+				mStats.mCancelled++;
+				mLive--;
+				continue;
+			}
+			if( tAsset->mPriority != tRequest.mPriority ) { continue; }
+			*tRequest.mTaken = true;
+			tAsset->mState   = TextureAsset::STATE_DECODING;
+
+			// Decode without holding the lock:
+			tLock.unlock();
+			Clock::time_point tStart = Clock::now();
+			ci::Surface8u tSurface;
+			try {
+				tSurface = tAsset->mDecode();
+			}
+			catch( ... ) {
+				std::cout << "Unable to decode an image" << std::endl;
+			}
+			// (Always tightly packed RGBA, so a band of whole rows can be uploaded straight from the surface:)
+			if( tSurface && ( tSurface.getChannelOrder().getCode() != ci::SurfaceChannelOrder::RGBA || tSurface.getRowBytes() != tSurface.getWidth() * 4 ) ) {
+				ci::Surface8u tPacked( tSurface.getWidth(), tSurface.getHeight(), true, ci::SurfaceChannelOrder::RGBA );
+				tPacked.copyFrom( tSurface, tSurface.getBounds() );
+				tSurface = tPacked;
+			}
+			double tMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+			tLock.lock();
+
+			mStats.mDecodeMs += tMs;
+			tAsset->mDecode = std::function<ci::Surface8u()>();
+			if( !tSurface || tSurface.getWidth() == 0 || tSurface.getHeight() == 0 ) {
+				tAsset->mState = TextureAsset::STATE_FAILED;
+				mStats.mFailed++;
+				mLive--;
+				continue;
+			}
+			tAsset->mSurface = tSurface;
+			tAsset->mSize    = tSurface.getSize();
+			tAsset->mState   = TextureAsset::STATE_UPLOADING;
+			mDecoded.push_back( tAsset );
+			mStats.mDecoded++;
+		}
+	}
+
+	size_t							mThreadCount;
+	size_t							mUploadBudget;
+	std::vector<std::thread>		mThreads;
+	std::mutex						mMutex;				//!< guards everything below except mUploads and mPlaceholder
+	std::condition_variable			mCondition;
+	std::priority_queue<Request>	mQueue;				//!< waiting to be decoded
+	std::vector<TextureAssetRef>	mDecoded;			//!< decoded, not yet picked up by update()
+	size_t							mLive;				//!< requested, and not yet ready, failed or cancelled
+	uint64_t						mSequence;
+	bool							mStop;
+	Stats							mStats;
+	std::vector<TextureAssetRef>	mUploads;			//!< being uploaded (render thread only)
+	std::shared_ptr<ci::gl::Texture>	mPlaceholder;	//!< shared with the handles (the texture is set by the first update(), on the render thread)
+};
@@ -10,6 +10,7 @@
 #include "cinder/gl/gl.h"
 #include "cinder/gl/Texture.h"
 
+#include "AsyncTextureLoader.h"
 #include "Resources.h"
 
 using namespace ci;
@@ -20,10 +21,16 @@ class TextureLoadingApp : public AppNative {
 public:
 	void setup();
 	void mouseDown( MouseEvent event );
+	void keyUp( KeyEvent event );
 	void update();
 	void draw();
 	
-	gl::Texture mTexture;
+	Rectf getTileRect(const size_t& iIndex) const;
+	
+	AsyncTextureLoader				mLoader;		//!< decodes on other threads, uploads a few MB per frame
+	TextureAssetRef					mTexture;
+	std::vector<TextureAssetRef>	mTiles;			//!< many copies of the image, drawn in a grid
+	int								mTileColumns;
 };
 
 void TextureLoadingApp::setup()
@@ -39,10 +46,12 @@ void TextureLoadingApp::setup()
 	
 	// Notice that the resource directory is within the application bundle.
 	
-	// Load texture from resource:
-	mTexture = loadImage( loadResource( CINDER_LOGO_IMG ) );
+	// Load texture from resource (returns straight away; the image is decoded on another thread, and drawn once it's uploaded):
+	mTexture = mLoader.load( loadResource( CINDER_LOGO_IMG ) );
 	// Another approach:
-	//mTexture = loadImage( loadResource( "SplashScreen.png" ) );
+	//mTexture = mLoader.load( loadResource( "SplashScreen.png" ) );
+	// Or, blocking until the image has been decoded and uploaded:
+	//gl::Texture tTexture = loadImage( loadResource( CINDER_LOGO_IMG ) );
 	
 	// The options below do not copy the image into the application bundle.
 	
@@ -50,18 +59,61 @@ void TextureLoadingApp::setup()
 	cout << "Asset path: " << getAssetPath( "SplashScreen.png" ) << endl;
 	
 	// Load texture from asset:
-	//mTexture = loadImage( loadAsset( "SplashScreen.png" ) );
+	//mTexture = mLoader.load( loadAsset( "SplashScreen.png" ) );
 	
 	// Load texture from arbitrary filepath:
-	//mTexture = loadImage( "/Users/you/Desktop/SplashScreen.png" );
+	//mTexture = mLoader.load( loadFile( "/Users/you/Desktop/SplashScreen.png" ) );
+	
+	mTileColumns = 16;
+}
+
+Rectf TextureLoadingApp::getTileRect(const size_t& iIndex) const
+{
+	Vec2f tTileSize = Vec2f( getWindowWidth(), getWindowHeight() ) / mTileColumns;
+	Vec2f tTilePos  = Vec2f( iIndex % mTileColumns, iIndex / mTileColumns ) * tTileSize;
+	return Rectf( tTilePos, tTilePos + tTileSize );
 }
 
 void TextureLoadingApp::mouseDown( MouseEvent event )
 {
+	// Load the tiles nearest the mouse first:
+	for(size_t i = 0; i < mTiles.size(); i++) {
+		mLoader.setPriority( mTiles[ i ], -getTileRect( i ).getCenter().distance( event.getPos() ) );
+	}
+}
+
+void TextureLoadingApp::keyUp( KeyEvent event )
+{
+	switch( event.getChar() ) {
+		case 'g': {
+			// Toggle a grid of many copies of the image (each decoded and uploaded separately), nearest the center first:
+			if( mTiles.empty() ) {
+				for(size_t i = 0; i < mTileColumns * mTileColumns; i++) {
+					mTiles.push_back( mLoader.load( loadResource( CINDER_LOGO_IMG ), -getTileRect( i ).getCenter().distance( getWindowCenter() ) ) );
+				}
+				cout << "Loading " << mTiles.size() << " textures" << endl;
+			}
+			else {
+				// (Dropping the handles cancels any that haven't been decoded yet:)
+				mTiles.clear();
+			}
+			break;
+		}
+		case 's': {
+			AsyncTextureLoader::Stats tStats = mLoader.getStats();
+			cout << tStats.mReady << " of " << tStats.mRequested << " ready, " << tStats.mPending << " pending, " << tStats.mFailed << " failed, "
+				<< tStats.mCancelled << " cancelled, " << tStats.mDecodeMs << " ms decoding, " << tStats.mFrameBytes << " bytes uploaded in "
+				<< tStats.mFrameUploadMs << " ms last frame (at most " << tStats.mMaxFrameUploadMs << " ms)" << endl;
+			break;
+		}
+		default: { break; }
+	}
 }
 
 void TextureLoadingApp::update()
 {
+	// Upload decoded images (within the loader's per-frame budget):
+	mLoader.update();
 }
 
 void TextureLoadingApp::draw()
@@ -72,10 +124,19 @@ void TextureLoadingApp::draw()
 	// Set color:
 	gl::color( 1.0, 1.0, 1.0 );
 	
+	// Draw the grid of textures (placeholders until they're ready):
+	if( !mTiles.empty() ) {
+		for(size_t i = 0; i < mTiles.size(); i++) {
+			gl::draw( mTiles[ i ]->getTexture(), getTileRect( i ) );
+		}
+		return;
+	}
+	
 	// Check whether texture has been instantiated:
-	if( mTexture ) {
-		// Draw texture, centered in window:
-		gl::draw( mTexture, getWindowCenter() - mTexture.getSize() / 2.0 );
+	const gl::Texture& tTexture = mTexture->getTexture();
+	if( tTexture ) {
+		// Draw texture (or its placeholder), centered in window:
+		gl::draw( tTexture, getWindowCenter() - tTexture.getSize() / 2.0 );
 	}
 }
 
@@ -14,6 +14,8 @@
 #include "cinder/gl/gl.h"
 #include "cinder/gl/Vbo.h"
 
+#include "MortonSort.h"
+
 /** @brief a container used in the construction and manipulation of VBO meshes */
 struct ProtoMesh
 {
@@ -169,7 +171,20 @@ static void createSphere(const uint32_t& iDimensionU, const uint32_t& iDimension
 	}
 }
 
-static void updateMeshVbo(ProtoMesh& iMesh, ci::gl::VboMesh& oMeshVbo)
+/** @brief stores a mesh's vertices in Morton order (so vertices close in space are close in memory) and rewrites its indices to match */
+static void sortMeshVertices(ProtoMesh& ioMesh)
+{
+	// Find the order from the vertices' positions:
+	std::vector<ci::Vec3f> tPositions( ioMesh.mVertices.size() );
+	for(size_t i = 0; i < ioMesh.mVertices.size(); i++) { tPositions[ i ] = ioMesh.mVertices[ i ].mPosition; }
+	std::vector<uint32_t> tOrder = computeMortonOrder<uint32_t>( tPositions );
+	
+	// Move the vertices, then point the indices at their new places:
+	applyOrder( ioMesh.mVertices, tOrder );
+	remapIndices( ioMesh.mIndices, tOrder );
+}
+
+static void updateMeshVboVertices(ProtoMesh& iMesh, ci::gl::VboMesh& oMeshVbo)
 {
 	// Prepare VBO vertex iterator:
 	ci::gl::VboMesh::VertexIter itvbo = oMeshVbo.mapVertexBuffer();
@@ -184,6 +199,12 @@ static void updateMeshVbo(ProtoMesh& iMesh, ci::gl::VboMesh& oMeshVbo)
 		// Advance VBO vertex iterator:
 		++itvbo;
 	}
+}
+
+static void updateMeshVbo(ProtoMesh& iMesh, ci::gl::VboMesh& oMeshVbo)
+{
+	// Update vertices:
+	updateMeshVboVertices( iMesh, oMeshVbo );
 	// Buffer triangle strip indices:
 	oMeshVbo.bufferIndices( iMesh.mIndices );
 }
@@ -0,0 +1,418 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Vbo.h"
+
+#include "MeshFactory.h"
+
+// initializeGenericMesh() builds one long triangle strip, and joins its rows (and,
+// as it happens, its columns: each grid square repeats the previous square's
+// two indices) with "degenerate" triangles: triangles with a repeated index,
+// which have no area and draw nothing, but still cost an index fetch and a trip
+// through triangle setup. For a wide, short grid that's a lot of wasted work.
+//
+// The same triangles can be drawn in other ways ("topologies"):
+//   - a stitched strip: one strip, but with as few degenerates as possible
+//     (strip pieces that continue each other are merged; the others are joined
+//     with two or three repeated indices),
+//   - primitive restart strips: separate strips in one index buffer, split by
+//     a special "restart" index (needs OpenGL 3.1 or GL_NV_primitive_restart),
+//   - a triangle list: three indices per triangle and no degenerates, put in an
+//     order that reuses recently transformed vertices (the GPU keeps the last
+//     few vertex shader results in a small "post-transform cache"). The order is
+//     found with the "Tipsify" algorithm (Sander, Nehab and Barczak, 2007): it
+//     "fans" around one vertex at a time, emitting all of its triangles, and
+//     then moves on to a vertex that's still in the cache.
+//
+// Which one is cheapest depends on the mesh's shape, so each is counted on the
+// CPU (indices, real and degenerate triangles, restarts, and vertex cache misses
+// on a simulated first-in first-out cache) and given a rough cost.
+//
+// (The strips keep each triangle's winding: in a strip, every other triangle is
+// wound the other way, so a piece that started on an odd triangle has to start
+// on an odd triangle again.)
+
+/** @brief ways of drawing a ProtoMesh's triangles */
+enum MeshTopology { TOPOLOGY_STRIP, TOPOLOGY_STITCHED_STRIP, TOPOLOGY_RESTART_STRIPS, TOPOLOGY_TRIANGLES };
+
+/** @brief CPU counts for an index buffer */
+struct TopologyStats
+{
+	size_t	mIndices;
+	size_t	mTriangles;				//!< triangles with area (three different indices)
+	size_t	mDegenerates;			//!< triangles with a repeated index
+	size_t	mRestarts;
+	size_t	mCacheMisses;			//!< vertex shader runs, on a simulated FIFO cache
+	double	mCost;					//!< rough cost, in vertex shader runs (see computeTopologyStats())
+
+	/** @brief default constructor */
+	TopologyStats() : mIndices( 0 ), mTriangles( 0 ), mDegenerates( 0 ), mRestarts( 0 ), mCacheMisses( 0 ), mCost( 0.0 ) {}
+
+	/** @brief returns the average cache miss ratio (vertex shader runs per triangle) */
+	double getAcmr() const { return ( mTriangles ) ? ( static_cast<double>( mCacheMisses ) / mTriangles ) : ( 0.0 ); }
+};
+
+/** @brief an index buffer for a ProtoMesh's vertices, in one of the topologies */
+struct MeshIndices
+{
+	MeshTopology			mTopology;
+	GLenum					mPrimitive;
+	std::vector<uint32_t>	mIndices;
+	TopologyStats			mStats;
+
+	/** @brief default constructor */
+	MeshIndices() : mTopology( TOPOLOGY_STRIP ), mPrimitive( GL_TRIANGLE_STRIP ) {}
+};
+
+/** @brief the index that splits primitive restart strips */
+static const uint32_t kRestartIndex = 0xFFFFFFFF;
+
+/** @brief the vertex cache size assumed when counting and ordering */
+static const size_t kVertexCacheSize = 16;
+
+/** @brief returns a topology's name */
+static std::string getTopologyName(const MeshTopology& iTopology)
+{
+	switch( iTopology ) {
+		case TOPOLOGY_STRIP:          { return "strip"; }
+		case TOPOLOGY_STITCHED_STRIP: { return "stitched strip"; }
+		case TOPOLOGY_RESTART_STRIPS: { return "restart strips"; }
+		default:                      { return "triangles"; }
+	}
+}
+
+/** @brief ways of turning on primitive restart */
+enum PrimitiveRestart { RESTART_NONE, RESTART_CORE, RESTART_NV };
+
+/** @brief returns how primitive restart can be turned on in the current context (OpenGL 3.1, or else GL_NV_primitive_restart) */
+static PrimitiveRestart detectPrimitiveRestart()
+{
+#if defined( GL_PRIMITIVE_RESTART ) || defined( GL_PRIMITIVE_RESTART_NV )
+	const char* tVersion = reinterpret_cast<const char*>( glGetString( GL_VERSION ) );
+	int tMajor = ( tVersion ) ? ( std::atoi( tVersion ) ) : ( 0 );
+	int tMinor = ( tVersion && tVersion[ 0 ] && tVersion[ 1 ] == '.' ) ? ( std::atoi( tVersion + 2 ) ) : ( 0 );
+#if defined( GL_PRIMITIVE_RESTART )
+	if( tMajor > 3 || ( tMajor == 3 && tMinor >= 1 ) ) { return RESTART_CORE; }
+#endif
+#if defined( GL_PRIMITIVE_RESTART_NV )
+	if( ci::gl::isExtensionAvailable( "GL_NV_primitive_restart" ) ) { return RESTART_NV; }
+#endif
+#endif
+	return RESTART_NONE;
+}
+
+/** @brief returns how primitive restart is turned on (detected once, the first time it's called, which needs a GL context) */
+static PrimitiveRestart getPrimitiveRestart()
+{
+	static PrimitiveRestart sRestart = detectPrimitiveRestart();
+	return sRestart;
+}
+
+/** @brief returns true if primitive restart can be used (needs a GL context) */
+static bool isPrimitiveRestartAvailable()
+{
+	return getPrimitiveRestart() != RESTART_NONE;
+}
+
+/** @brief counts an index buffer's triangles, restarts and (FIFO) vertex cache misses, and estimates its cost */
+static TopologyStats computeTopologyStats(const std::vector<uint32_t>& iIndices, const GLenum& iPrimitive, const size_t& iCacheSize = kVertexCacheSize)
+{
+	TopologyStats tStats;
+	tStats.mIndices = iIndices.size();
+
+	// Triangles:
+	if( iPrimitive == GL_TRIANGLE_STRIP ) {
+		size_t tStripStart = 0;
+		for(size_t i = 0; i < iIndices.size(); i++) {
+			if( iIndices[ i ] == kRestartIndex ) {
+				tStats.mRestarts++;
+				tStripStart = i + 1;
+				continue;
+			}
+			if( i < tStripStart + 2 ) { continue; }
+			uint32_t a = iIndices[ i - 2 ], b = iIndices[ i - 1 ], c = iIndices[ i ];
+			if( a == b || b == c || a == c ) { tStats.mDegenerates++; }
+			else                             { tStats.mTriangles++; }
+		}
+	}
+	else {
+		for(size_t i = 0; i + 2 < iIndices.size(); i += 3) {
+			uint32_t a = iIndices[ i ], b = iIndices[ i + 1 ], c = iIndices[ i + 2 ];
+			if( a == b || b == c || a == c ) { tStats.mDegenerates++; }
+			else                             { tStats.mTriangles++; }
+		}
+	}
+
+	// Vertex cache misses (a FIFO of the last iCacheSize vertices):
+	std::vector<uint32_t> tCache( iCacheSize, kRestartIndex );
+	size_t tNext = 0;
+	for(size_t i = 0; i < iIndices.size(); i++) {
+		if( iIndices[ i ] == kRestartIndex ) { continue; }
+		if( std::find( tCache.begin(), tCache.end(), iIndices[ i ] ) != tCache.end() ) { continue; }
+		tCache[ tNext ] = iIndices[ i ];
+		tNext = ( tNext + 1 ) % iCacheSize;
+		tStats.mCacheMisses++;
+	}
+
+	// Cost, in vertex shader runs: setting up a triangle (even one that's then
+	// thrown away) is taken to cost about a quarter of one, fetching an index a tenth:
+	tStats.mCost = tStats.mCacheMisses + 0.25 * ( tStats.mTriangles + tStats.mDegenerates ) + 0.1 * tStats.mIndices;
+	return tStats;
+}
+
+/** @brief a piece of a strip with no degenerate triangles */
+struct StripRun
+{
+	size_t	mBegin;			//!< first index (in the source strip)
+	size_t	mCount;			//!< indices (at least three)
+	bool	mOdd;			//!< true if its first triangle is an odd one (wound the other way)
+};
+
+/** @brief splits a strip at its degenerate triangles (and restarts) */
+static void findStripRuns(const std::vector<uint32_t>& iStrip, std::vector<StripRun>& oRuns)
+{
+	oRuns.clear();
+	size_t tStripStart = 0;
+	bool   tInRun = false;
+	for(size_t i = 0; i < iStrip.size(); i++) {
+		if( iStrip[ i ] == kRestartIndex ) {
+			tStripStart = i + 1;
+			tInRun = false;
+			continue;
+		}
+		if( i < tStripStart + 2 ) { continue; }
+		uint32_t a = iStrip[ i - 2 ], b = iStrip[ i - 1 ], c = iStrip[ i ];
+		bool tReal = !( a == b || b == c || a == c );
+		if( tReal && tInRun ) {
+			oRuns.back().mCount++;
+		}
+		else if( tReal ) {
+			StripRun tRun = { i - 2, 3, ( ( i - 2 - tStripStart ) % 2 ) != 0 };
+			oRuns.push_back( tRun );
+		}
+		tInRun = tReal;
+	}
+}
+
+/** @brief appends a strip's runs to oIndices, merging, stitching (with degenerates) or restarting between them */
+static void emitStripRuns(const std::vector<uint32_t>& iStrip, const std::vector<StripRun>& iRuns, const bool& iRestart, std::vector<uint32_t>& oIndices)
+{
+	oIndices.clear();
+	size_t tStripStart = 0;		// where the current output strip starts (its triangles' parity is counted from there)
+	for(std::vector<StripRun>::const_iterator it = iRuns.begin(); it != iRuns.end(); it++) {
+		const uint32_t* tRun = &iStrip[ (*it).mBegin ];
+		size_t tSize = oIndices.size() - tStripStart;
+
+		// The run carries on from the last two indices, with the right parity? Then just continue the strip:
+		if( tSize >= 2 && oIndices[ oIndices.size() - 2 ] == tRun[ 0 ] && oIndices.back() == tRun[ 1 ] && ( ( tSize - 2 ) % 2 != 0 ) == (*it).mOdd ) {
+			oIndices.insert( oIndices.end(), tRun + 2, tRun + (*it).mCount );
+			continue;
+		}
+
+		if( tSize > 0 ) {
+			if( iRestart ) {
+				oIndices.push_back( kRestartIndex );
+				tStripStart = oIndices.size();
+			}
+			else if( oIndices.back() != tRun[ 0 ] ) {
+				// Repeat the last index and the next one (the run's first index will then appear twice):
+				oIndices.push_back( oIndices.back() );
+				oIndices.push_back( tRun[ 0 ] );
+			}
+		}
+		// The run's first triangle must be odd or even as it was: if not, one more repeated index:
+		if( ( ( oIndices.size() - tStripStart ) % 2 != 0 ) != (*it).mOdd ) {
+			oIndices.push_back( tRun[ 0 ] );
+		}
+		oIndices.insert( oIndices.end(), tRun, tRun + (*it).mCount );
+	}
+}
+
+/** @brief converts a strip into a list of triangles (skipping degenerates, keeping the winding) */
+static void decodeStripTriangles(const std::vector<uint32_t>& iStrip, std::vector<uint32_t>& oTriangles)
+{
+	oTriangles.clear();
+	size_t tStripStart = 0;
+	for(size_t i = 0; i < iStrip.size(); i++) {
+		if( iStrip[ i ] == kRestartIndex ) {
+			tStripStart = i + 1;
+			continue;
+		}
+		if( i < tStripStart + 2 ) { continue; }
+		uint32_t a = iStrip[ i - 2 ], b = iStrip[ i - 1 ], c = iStrip[ i ];
+		if( a == b || b == c || a == c ) { continue; }
+		if( ( i - tStripStart ) % 2 == 0 ) { oTriangles.push_back( a ); oTriangles.push_back( b ); oTriangles.push_back( c ); }
+		else                               { oTriangles.push_back( b ); oTriangles.push_back( a ); oTriangles.push_back( c ); }
+	}
+}
+
+/** @brief reorders a triangle list for the vertex cache ("Tipsify") */
+static void optimizeTriangleOrder(const std::vector<uint32_t>& iTriangles, const size_t& iVertexCount, std::vector<uint32_t>& oTriangles, const size_t& iCacheSize = kVertexCacheSize)
+{
+	size_t tTriangleCount = iTriangles.size() / 3;
+	oTriangles.clear();
+	oTriangles.reserve( tTriangleCount * 3 );
+	if( tTriangleCount == 0 ) { return; }
+
+	// Each vertex's triangles (as offsets into one list):
+	std::vector<uint32_t> tLive( iVertexCount, 0 ), tOffsets( iVertexCount + 1, 0 ), tAdjacency( tTriangleCount * 3 );
+	for(size_t i = 0; i < tTriangleCount * 3; i++) { tLive[ iTriangles[ i ] ]++; }
+	for(size_t v = 0; v < iVertexCount; v++) { tOffsets[ v + 1 ] = tOffsets[ v ] + tLive[ v ]; }
+	std::vector<uint32_t> tFill( tOffsets.begin(), tOffsets.end() - 1 );
+	for(size_t i = 0; i < tTriangleCount * 3; i++) { tAdjacency[ tFill[ iTriangles[ i ] ]++ ] = static_cast<uint32_t>( i / 3 ); }
+
+	std::vector<size_t>   tCacheTime( iVertexCount, 0 );		// when each vertex last entered the cache
+	std::vector<bool>     tEmitted( tTriangleCount, false );
+	std::vector<uint32_t> tDeadEnd;								// recently used vertices, to fall back on
+	std::vector<uint32_t> tCandidates;
+	size_t  tTime   = iCacheSize + 1;
+	size_t  tCursor = 0;										// next vertex to try when everything else is used up
+	int64_t tFan    = iTriangles[ 0 ];
+
+	while( tFan >= 0 ) {
+		// Emit every remaining triangle around the fanning vertex:
+		tCandidates.clear();
+		for(uint32_t a = tOffsets[ tFan ]; a < tOffsets[ tFan + 1 ]; a++) {
+			uint32_t t = tAdjacency[ a ];
+			if( tEmitted[ t ] ) { continue; }
+			for(int k = 0; k < 3; k++) {
+				uint32_t v = iTriangles[ t * 3 + k ];
+				oTriangles.push_back( v );
+				tDeadEnd.push_back( v );
+				tCandidates.push_back( v );
+				tLive[ v ]--;
+				if( tTime - tCacheTime[ v ] > iCacheSize ) { tCacheTime[ v ] = tTime++; }
+			}
+			tEmitted[ t ] = true;
+		}
+
+		// Next, the candidate that will still be in the cache after emitting its triangles, and has been in it longest:
+		tFan = -1;
+		size_t tBest = 0;
+		for(std::vector<uint32_t>::const_iterator it = tCandidates.begin(); it != tCandidates.end(); it++) {
+			if( tLive[ *it ] == 0 ) { continue; }
+			size_t tPriority = 0;
+			if( tTime - tCacheTime[ *it ] + 2 * tLive[ *it ] <= iCacheSize ) { tPriority = tTime - tCacheTime[ *it ]; }
+			if( tFan < 0 || tPriority > tBest ) {
+				tBest = tPriority;
+				tFan  = *it;
+			}
+		}
+		// None? A recently used vertex with triangles left, or else the next one in order:
+		while( tFan < 0 && !tDeadEnd.empty() ) {
+			uint32_t v = tDeadEnd.back();
+			tDeadEnd.pop_back();
+			if( tLive[ v ] > 0 ) { tFan = v; }
+		}
+		while( tFan < 0 && tCursor < iVertexCount ) {
+			if( tLive[ tCursor ] > 0 ) { tFan = tCursor; }
+			tCursor++;
+		}
+	}
+}
+
+/** @brief builds an index buffer for a ProtoMesh (whose mIndices are a triangle strip) in the given topology */
+static void convertMeshTopology(const ProtoMesh& iMesh, const MeshTopology& iTopology, MeshIndices& oIndices)
+{
+	oIndices.mTopology  = iTopology;
+	oIndices.mPrimitive = ( iTopology == TOPOLOGY_TRIANGLES ) ? ( GL_TRIANGLES ) : ( GL_TRIANGLE_STRIP );
+	if( iTopology == TOPOLOGY_STRIP ) {
+		oIndices.mIndices = iMesh.mIndices;
+	}
+	else if( iTopology == TOPOLOGY_TRIANGLES ) {
+		std::vector<uint32_t> tTriangles;
+		decodeStripTriangles( iMesh.mIndices, tTriangles );
+		optimizeTriangleOrder( tTriangles, iMesh.mVertices.size(), oIndices.mIndices );
+	}
+	else {
+		std::vector<StripRun> tRuns;
+		findStripRuns( iMesh.mIndices, tRuns );
+		emitStripRuns( iMesh.mIndices, tRuns, iTopology == TOPOLOGY_RESTART_STRIPS, oIndices.mIndices );
+	}
+	oIndices.mStats = computeTopologyStats( oIndices.mIndices, oIndices.mPrimitive );
+}
+
+/** @brief returns the cheapest topology for a ProtoMesh (by the estimated cost), and its index buffer */
+static MeshTopology chooseMeshTopology(const ProtoMesh& iMesh, const bool& iRestartAvailable, MeshIndices& oIndices)
+{
+	MeshIndices tCandidate;
+	for(int t = TOPOLOGY_STRIP; t <= TOPOLOGY_TRIANGLES; t++) {
+		if( t == TOPOLOGY_RESTART_STRIPS && !iRestartAvailable ) { continue; }
+		convertMeshTopology( iMesh, static_cast<MeshTopology>( t ), tCandidate );
+		if( t == TOPOLOGY_STRIP || tCandidate.mStats.mCost < oIndices.mStats.mCost ) { oIndices = tCandidate; }
+	}
+	return oIndices.mTopology;
+}
+
+/** @brief creates a VBO mesh from a ProtoMesh's vertices and converted indices */
+static void createMeshVbo(ProtoMesh& iMesh, const MeshIndices& iIndices, ci::gl::VboMesh& oMeshVbo)
+{
+	ci::gl::VboMesh::Layout tLayout;
+	tLayout.setStaticIndices();
+	tLayout.setDynamicPositions();
+	tLayout.setDynamicNormals();
+	tLayout.setDynamicTexCoords2d();
+	oMeshVbo = ci::gl::VboMesh( iMesh.mVertices.size(), iIndices.mIndices.size(), tLayout, iIndices.mPrimitive );
+	updateMeshVboVertices( iMesh, oMeshVbo );
+	oMeshVbo.bufferIndices( iIndices.mIndices );
+}
+
+/** @brief draws a VBO mesh created from converted indices (enabling primitive restart for restart strips) */
+static void drawMeshVbo(const ci::gl::VboMesh& iMeshVbo, const MeshIndices& iIndices)
+{
+	// Turn restart on the way the context supports (the headers may declare both ways):
+	PrimitiveRestart tRestart = ( iIndices.mTopology == TOPOLOGY_RESTART_STRIPS ) ? ( getPrimitiveRestart() ) : ( RESTART_NONE );
+#if defined( GL_PRIMITIVE_RESTART )
+	if( tRestart == RESTART_CORE ) {
+		glEnable( GL_PRIMITIVE_RESTART );
+		glPrimitiveRestartIndex( kRestartIndex );
+	}
+#endif
+#if defined( GL_PRIMITIVE_RESTART_NV )
+	if( tRestart == RESTART_NV ) {
+		glEnableClientState( GL_PRIMITIVE_RESTART_NV );
+		glPrimitiveRestartIndexNV( kRestartIndex );
+	}
+#endif
+	ci::gl::draw( iMeshVbo );
+#if defined( GL_PRIMITIVE_RESTART )
+	if( tRestart == RESTART_CORE ) { glDisable( GL_PRIMITIVE_RESTART ); }
+#endif
+#if defined( GL_PRIMITIVE_RESTART_NV )
+	if( tRestart == RESTART_NV ) { glDisableClientState( GL_PRIMITIVE_RESTART_NV ); }
+#endif
+}
+
+/** @brief prints each topology's counts for a few grid shapes (square, wide and short, narrow and tall) */
+static void runTopologyReport()
+{
+	const uint32_t tShapes[][ 2 ] = { { 30, 30 }, { 256, 4 }, { 4, 256 }, { 512, 512 } };
+	for(size_t s = 0; s < sizeof( tShapes ) / sizeof( tShapes[ 0 ] ); s++) {
+		ProtoMesh tMesh;
+		initializeGenericMesh( tShapes[ s ][ 0 ], tShapes[ s ][ 1 ], tMesh );
+		std::cout << "Grid " << tShapes[ s ][ 0 ] << " x " << tShapes[ s ][ 1 ] << " (" << tMesh.mVertices.size() << " vertices):" << std::endl;
+		MeshIndices tIndices;
+		for(int t = TOPOLOGY_STRIP; t <= TOPOLOGY_TRIANGLES; t++) {
+			convertMeshTopology( tMesh, static_cast<MeshTopology>( t ), tIndices );
+			const TopologyStats& tStats = tIndices.mStats;
+			std::cout << "  " << getTopologyName( tIndices.mTopology ) << ": " << tStats.mIndices << " indices, " << tStats.mTriangles << " triangles, "
+				<< tStats.mDegenerates << " degenerates, " << tStats.mRestarts << " restarts, ACMR " << tStats.getAcmr() << ", cost " << tStats.mCost << std::endl;
+		}
+		std::cout << "  cheapest: " << getTopologyName( chooseMeshTopology( tMesh, true, tIndices ) ) << std::endl;
+	}
+}
@@ -0,0 +1,363 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "cinder/Rand.h"
+#include "cinder/Vector.h"
+
+#include "ParallelFor.h"
+
+// Points generated at random are stored in random order: two points next to each
+// other in memory are usually far apart in space, and two points close together
+// in space are usually far apart in memory. Anything that visits points by
+// neighborhood (a spatial query, or the GPU rasterizing nearby points one after
+// the other) then jumps all over memory.
+//
+// A "Morton code" (or Z-order code) turns a position into a single number by
+// interleaving the bits of its x, y and z cell coordinates:
+//
+//     x = 0b11, y = 0b00, z = 0b01   ->   code = 0b 101 001   (z y x, z y x)
+//
+// Sorting points by their codes orders them along a "Z"-shaped curve that
+// visits space block by block, so points that are close in space end up close in
+// memory (most of the time).
+//
+// Codes have 10 bits per axis (30 bits in all) or 21 bits per axis (63 bits) in
+// 3D, and 16 or 32 bits per axis in 2D. They are sorted with a "radix sort":
+// one pass per 11-bit "digit" of the code, each pass a stable counting sort of
+// that digit. Passes where every code has the same digit are skipped (so 30-bit
+// codes take at most three passes), and each pass runs on several threads.
+//
+// The sort produces an "order" (for each new position, the old index), which can
+// be applied to any number of per-point arrays (positions, colors, normals, ...)
+// and used to rewrite a mesh's index buffer.
+
+/** @brief spreads the low 10 bits of a value two bits apart (for 30-bit 3D codes) */
+static inline uint32_t mortonSpread3(uint32_t iValue)
+{
+	iValue &= 0x3ff;
+	iValue = ( iValue | ( iValue << 16 ) ) & 0x030000ff;
+	iValue = ( iValue | ( iValue <<  8 ) ) & 0x0300f00f;
+	iValue = ( iValue | ( iValue <<  4 ) ) & 0x030c30c3;
+	iValue = ( iValue | ( iValue <<  2 ) ) & 0x09249249;
+	return iValue;
+}
+
+/** @brief spreads the low 21 bits of a value two bits apart (for 63-bit 3D codes) */
+static inline uint64_t mortonSpread3(uint64_t iValue)
+{
+	iValue &= 0x1fffff;
+	iValue = ( iValue | ( iValue << 32 ) ) & 0x001f00000000ffffull;
+	iValue = ( iValue | ( iValue << 16 ) ) & 0x001f0000ff0000ffull;
+	iValue = ( iValue | ( iValue <<  8 ) ) & 0x100f00f00f00f00full;
+	iValue = ( iValue | ( iValue <<  4 ) ) & 0x10c30c30c30c30c3ull;
+	iValue = ( iValue | ( iValue <<  2 ) ) & 0x1249249249249249ull;
+	return iValue;
+}
+
+/** @brief spreads the low 16 bits of a value one bit apart (for 32-bit 2D codes) */
+static inline uint32_t mortonSpread2(uint32_t iValue)
+{
+	iValue &= 0xffff;
+	iValue = ( iValue | ( iValue << 8 ) ) & 0x00ff00ff;
+	iValue = ( iValue | ( iValue << 4 ) ) & 0x0f0f0f0f;
+	iValue = ( iValue | ( iValue << 2 ) ) & 0x33333333;
+	iValue = ( iValue | ( iValue << 1 ) ) & 0x55555555;
+	return iValue;
+}
+
+/** @brief spreads the low 32 bits of a value one bit apart (for 64-bit 2D codes) */
+static inline uint64_t mortonSpread2(uint64_t iValue)
+{
+	iValue &= 0xffffffffull;
+	iValue = ( iValue | ( iValue << 16 ) ) & 0x0000ffff0000ffffull;
+	iValue = ( iValue | ( iValue <<  8 ) ) & 0x00ff00ff00ff00ffull;
+	iValue = ( iValue | ( iValue <<  4 ) ) & 0x0f0f0f0f0f0f0f0full;
+	iValue = ( iValue | ( iValue <<  2 ) ) & 0x3333333333333333ull;
+	iValue = ( iValue | ( iValue <<  1 ) ) & 0x5555555555555555ull;
+	return iValue;
+}
+
+/** @brief computes Morton codes (KeyT = uint32_t for 30/32-bit codes, uint64_t for 63/64-bit codes) for 2D or 3D points */
+template<typename KeyT, typename VecT>
+class MortonEncoder {
+public:
+	static const int kDims = sizeof( VecT ) / sizeof( float );
+	static const int kBits = ( kDims == 3 ) ? ( ( sizeof( KeyT ) == 8 ) ? ( 21 ) : ( 10 ) ) : ( ( sizeof( KeyT ) == 8 ) ? ( 32 ) : ( 16 ) );
+
+	/** @brief constructor (from the bounds of the points) */
+	MortonEncoder(const VecT& iMin, const VecT& iMax) : mMin( iMin )
+	{
+		// In double: a float can't hold 2^32 - 1 (it rounds up to 2^32, which would
+		// wrap to cell 0 for points on the upper bound of 64-bit 2D codes):
+		double tCells = static_cast<double>( kMaxCell );
+		for(int a = 0; a < kDims; a++) {
+			double tExtent = std::max( static_cast<double>( iMax[ a ] ) - static_cast<double>( iMin[ a ] ), 1.0e-20 );
+			mScale[ a ] = tCells / tExtent;
+		}
+	}
+
+	/** @brief creates an encoder for the bounds of a set of points */
+	static MortonEncoder fromPoints(const std::vector<VecT>& iPoints)
+	{
+		VecT tMin = iPoints[ 0 ], tMax = iPoints[ 0 ];
+		for(size_t i = 1; i < iPoints.size(); i++) {
+			for(int a = 0; a < kDims; a++) {
+				tMin[ a ] = std::min( tMin[ a ], iPoints[ i ][ a ] );
+				tMax[ a ] = std::max( tMax[ a ], iPoints[ i ][ a ] );
+			}
+		}
+		return MortonEncoder( tMin, tMax );
+	}
+
+	/** @brief returns a point's code */
+	KeyT encode(const VecT& iPoint) const
+	{
+		KeyT tCode = 0;
+		for(int a = 0; a < kDims; a++) {
+			double tCell = std::min( std::max( ( static_cast<double>( iPoint[ a ] ) - static_cast<double>( mMin[ a ] ) ) * mScale[ a ], 0.0 ), static_cast<double>( kMaxCell ) );
+			KeyT   tBits = static_cast<KeyT>( tCell );
+			tCode |= ( ( kDims == 3 ) ? ( mortonSpread3( tBits ) ) : ( mortonSpread2( tBits ) ) ) << a;
+		}
+		return tCode;
+	}
+
+protected:
+	static const KeyT kMaxCell = static_cast<KeyT>( ( static_cast<uint64_t>( 1 ) << kBits ) - 1 );
+
+	VecT	mMin;
+	double	mScale[ 3 ];
+};
+
+/** @brief sorts (key, value) pairs by key with a parallel, stable radix sort (one pass per 11-bit digit) */
+template<typename KeyT>
+static void radixSortPairs(std::vector<KeyT>& ioKeys, std::vector<uint32_t>& ioValues)
+{
+	const size_t kRadixBits = 11, kRadix = 1 << kRadixBits, kRadixMask = kRadix - 1;
+	const size_t tCount = ioKeys.size();
+	if( tCount < 2 ) { return; }
+
+	// One chunk per thread (each keeps its own digit counts, so the passes don't need locks):
+	size_t tThreads = std::max<size_t>( std::thread::hardware_concurrency(), 1 );
+	size_t tChunks  = std::min<size_t>( tThreads, std::max<size_t>( tCount / 65536, 1 ) );
+	size_t tChunk   = ( tCount + tChunks - 1 ) / tChunks;
+
+	std::vector<KeyT>     tKeys( tCount );
+	std::vector<uint32_t> tValues( tCount );
+	std::vector<size_t>   tCounts( tChunks * kRadix );
+
+	for(size_t tShift = 0; tShift < sizeof( KeyT ) * 8; tShift += kRadixBits) {
+		// Count each chunk's digits:
+		std::fill( tCounts.begin(), tCounts.end(), 0 );
+		parallelFor( tChunks, [&](size_t iBegin, size_t iEnd) {
+			for(size_t c = iBegin; c < iEnd; c++) {
+				size_t* tHist = &tCounts[ c * kRadix ];
+				size_t  tEnd  = std::min( ( c + 1 ) * tChunk, tCount );
+				for(size_t i = c * tChunk; i < tEnd; i++) { tHist[ ( ioKeys[ i ] >> tShift ) & kRadixMask ]++; }
+			}
+		} );
+
+		// Skip the pass if every key has the same digit:
+		size_t tFirstDigit = ( ioKeys[ 0 ] >> tShift ) & kRadixMask;
+		size_t tSame = 0;
+		for(size_t c = 0; c < tChunks; c++) { tSame += tCounts[ c * kRadix + tFirstDigit ]; }
+		if( tSame == tCount ) { continue; }
+
+		// Turn the counts into each chunk's first output position for each digit
+		// (digit-major, then chunk order, which keeps the sort stable):
+		size_t tSum = 0;
+		for(size_t d = 0; d < kRadix; d++) {
+			for(size_t c = 0; c < tChunks; c++) {
+				size_t tDigitCount = tCounts[ c * kRadix + d ];
+				tCounts[ c * kRadix + d ] = tSum;
+				tSum += tDigitCount;
+			}
+		}
+
+		// Scatter:
+		parallelFor( tChunks, [&](size_t iBegin, size_t iEnd) {
+			for(size_t c = iBegin; c < iEnd; c++) {
+				size_t* tNext = &tCounts[ c * kRadix ];
+				size_t  tEnd  = std::min( ( c + 1 ) * tChunk, tCount );
+				for(size_t i = c * tChunk; i < tEnd; i++) {
+					size_t tTo = tNext[ ( ioKeys[ i ] >> tShift ) & kRadixMask ]++;
+					tKeys[ tTo ]   = ioKeys[ i ];
+					tValues[ tTo ] = ioValues[ i ];
+				}
+			}
+		} );
+		ioKeys.swap( tKeys );
+		ioValues.swap( tValues );
+	}
+}
+
+/** @brief returns the Morton order of a set of points (for each new position, the old index) */
+template<typename KeyT, typename VecT>
+static std::vector<uint32_t> computeMortonOrder(const std::vector<VecT>& iPoints)
+{
+	std::vector<uint32_t> tOrder( iPoints.size() );
+	if( iPoints.empty() ) { return tOrder; }
+
+	// Codes (relative to the points' bounds):
+	MortonEncoder<KeyT, VecT> tEncoder = MortonEncoder<KeyT, VecT>::fromPoints( iPoints );
+	std::vector<KeyT> tKeys( iPoints.size() );
+	parallelFor( iPoints.size(), [&](size_t iBegin, size_t iEnd) {
+		for(size_t i = iBegin; i < iEnd; i++) {
+			tKeys[ i ]  = tEncoder.encode( iPoints[ i ] );
+			tOrder[ i ] = static_cast<uint32_t>( i );
+		}
+	} );
+
+	radixSortPairs( tKeys, tOrder );
+	return tOrder;
+}
+
+/** @brief reorders an array (e.g. positions or colors) by an order from computeMortonOrder() */
+template<typename T>
+static void applyOrder(std::vector<T>& ioValues, const std::vector<uint32_t>& iOrder)
+{
+	std::vector<T> tSorted( ioValues.size() );
+	parallelFor( iOrder.size(), [&](size_t iBegin, size_t iEnd) {
+		for(size_t i = iBegin; i < iEnd; i++) { tSorted[ i ] = ioValues[ iOrder[ i ] ]; }
+	} );
+	ioValues.swap( tSorted );
+}
+
+/** @brief reorders an array of interleaved values (iStride values per point) by an order from computeMortonOrder() */
+template<typename T>
+static void applyOrder(std::vector<T>& ioValues, const std::vector<uint32_t>& iOrder, const size_t& iStride)
+{
+	std::vector<T> tSorted( ioValues.size() );
+	parallelFor( iOrder.size(), [&](size_t iBegin, size_t iEnd) {
+		for(size_t i = iBegin; i < iEnd; i++) {
+			std::copy( ioValues.begin() + iOrder[ i ] * iStride, ioValues.begin() + ( iOrder[ i ] + 1 ) * iStride, tSorted.begin() + i * iStride );
+		}
+	} );
+	ioValues.swap( tSorted );
+}
+
+/** @brief rewrites a mesh's indices after its vertices were reordered by iOrder */
+template<typename IndexT>
+static void remapIndices(std::vector<IndexT>& ioIndices, const std::vector<uint32_t>& iOrder)
+{
+	// iOrder maps new -> old; the indices need old -> new:
+	std::vector<uint32_t> tNewIndex( iOrder.size() );
+	for(size_t i = 0; i < iOrder.size(); i++) { tNewIndex[ iOrder[ i ] ] = static_cast<uint32_t>( i ); }
+	parallelFor( ioIndices.size(), [&](size_t iBegin, size_t iEnd) {
+		for(size_t i = iBegin; i < iEnd; i++) { ioIndices[ i ] = static_cast<IndexT>( tNewIndex[ ioIndices[ i ] ] ); }
+	} );
+}
+
+/** @brief returns the average distance between points that are next to each other in memory */
+template<typename VecT>
+static float computeMemoryLocality(const std::vector<VecT>& iPoints)
+{
+	if( iPoints.size() < 2 ) { return 0.0f; }
+	double tSum = 0.0;
+	for(size_t i = 1; i < iPoints.size(); i++) { tSum += ( iPoints[ i ] - iPoints[ i - 1 ] ).length(); }
+	return static_cast<float>( tSum / ( iPoints.size() - 1 ) );
+}
+
+/** @brief times a neighborhood query: for each point, the closest other point in its grid cell (about 8 points per cell) */
+static double timeCellNeighborQuery(const std::vector<ci::Vec3f>& iPoints, float& oChecksum)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// Bucket the point indices by cell (a counting sort by cell):
+	size_t tCount = iPoints.size();
+	int    tRes   = std::max( 1, static_cast<int>( std::pow( tCount / 8.0, 1.0 / 3.0 ) ) );
+	std::vector<uint32_t> tCells( tCount ), tStarts( tRes * tRes * tRes + 1, 0 ), tItems( tCount );
+	for(size_t i = 0; i < tCount; i++) {
+		int x = std::min( static_cast<int>( ( iPoints[ i ].x * 0.5f + 0.5f ) * tRes ), tRes - 1 );
+		int y = std::min( static_cast<int>( ( iPoints[ i ].y * 0.5f + 0.5f ) * tRes ), tRes - 1 );
+		int z = std::min( static_cast<int>( ( iPoints[ i ].z * 0.5f + 0.5f ) * tRes ), tRes - 1 );
+		tCells[ i ] = ( z * tRes + y ) * tRes + x;
+		tStarts[ tCells[ i ] + 1 ]++;
+	}
+	for(size_t c = 1; c < tStarts.size(); c++) { tStarts[ c ] += tStarts[ c - 1 ]; }
+	std::vector<uint32_t> tNext( tStarts.begin(), tStarts.end() - 1 );
+	for(size_t i = 0; i < tCount; i++) { tItems[ tNext[ tCells[ i ] ]++ ] = static_cast<uint32_t>( i ); }
+
+	// Query (the points are reached through their indices, as a spatial index would):
+	Clock::time_point tStart = Clock::now();
+	double tSum = 0.0;
+	for(size_t i = 0; i < tCount; i++) {
+		uint32_t tCell = tCells[ i ];
+		float    tBest = FLT_MAX;
+		for(uint32_t j = tStarts[ tCell ]; j < tStarts[ tCell + 1 ]; j++) {
+			uint32_t tOther = tItems[ j ];
+			if( tOther != i ) { tBest = std::min( tBest, ( iPoints[ tOther ] - iPoints[ i ] ).lengthSquared() ); }
+		}
+		if( tBest < FLT_MAX ) { tSum += tBest; }
+	}
+	oChecksum = static_cast<float>( tSum );
+	return std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+}
+
+/** @brief times Morton sorting of random 3D points, and how much it improves locality */
+static void runMortonBenchmark()
+{
+	using namespace ci;
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const size_t tCounts[] = { 100000, 1000000, 4000000 };
+	for(int c = 0; c < 3; c++) {
+		size_t tCount = tCounts[ c ];
+		Rand tRand( 1234 );
+		std::vector<Vec3f> tPoints( tCount );
+		for(size_t i = 0; i < tCount; i++) { tPoints[ i ] = Vec3f( tRand.nextFloat( -1.0f, 1.0f ), tRand.nextFloat( -1.0f, 1.0f ), tRand.nextFloat( -1.0f, 1.0f ) ); }
+
+		// 30-bit and 63-bit radix sorts:
+		Clock::time_point tStart = Clock::now();
+		std::vector<uint32_t> tOrder30 = computeMortonOrder<uint32_t>( tPoints );
+		double tSort30Ms = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+		tStart = Clock::now();
+		std::vector<uint32_t> tOrder63 = computeMortonOrder<uint64_t>( tPoints );
+		double tSort63Ms = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+
+		// Comparison sort of the same 30-bit codes:
+		MortonEncoder<uint32_t, Vec3f> tEncoder = MortonEncoder<uint32_t, Vec3f>::fromPoints( tPoints );
+		std::vector<uint64_t> tPairs( tCount );
+		for(size_t i = 0; i < tCount; i++) { tPairs[ i ] = ( static_cast<uint64_t>( tEncoder.encode( tPoints[ i ] ) ) << 32 ) | i; }
+		tStart = Clock::now();
+		std::sort( tPairs.begin(), tPairs.end() );
+		double tStdSortMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+
+		// Check: the (stable) radix sort's order is the same as std::sort's:
+		size_t tMismatches = 0;
+		for(size_t i = 0; i < tCount; i++) {
+			if( tOrder30[ i ] != static_cast<uint32_t>( tPairs[ i ] & 0xffffffff ) ) { tMismatches++; }
+		}
+
+		// Locality, and a neighborhood query before and after sorting:
+		std::vector<Vec3f> tSorted = tPoints;
+		applyOrder( tSorted, tOrder63 );
+		float  tBefore = computeMemoryLocality( tPoints );
+		float  tAfter  = computeMemoryLocality( tSorted );
+		float  tChecksumBefore, tChecksumAfter;
+		double tQueryBeforeMs = timeCellNeighborQuery( tPoints, tChecksumBefore );
+		double tQueryAfterMs  = timeCellNeighborQuery( tSorted, tChecksumAfter );
+
+		std::cout << "Morton sort benchmark: " << tCount << " points" << std::endl;
+		std::cout << "  radix 30-bit: " << tSort30Ms << " ms, 63-bit: " << tSort63Ms << " ms (std::sort: " << tStdSortMs << " ms, "
+			<< tMismatches << " mismatches)" << std::endl;
+		std::cout << "  distance between memory neighbors: " << tBefore << " before, " << tAfter << " after" << std::endl;
+		std::cout << "  cell neighbor query: " << tQueryBeforeMs << " ms before, " << tQueryAfterMs << " ms after"
+			<< ( ( std::fabs( tChecksumBefore - tChecksumAfter ) > 1.0e-3f * std::fabs( tChecksumBefore ) ) ? ( " (results differ!)" ) : ( "" ) ) << std::endl;
+	}
+}
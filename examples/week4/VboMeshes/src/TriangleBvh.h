@@ -0,0 +1,677 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#define TRIANGLE_BVH_SSE 1
+	#include <emmintrin.h>
+#endif
+
+#include "cinder/Rand.h"
+#include "cinder/Vector.h"
+#include "cinder/gl/gl.h"
+
+#include "ParallelFor.h"
+
+// To find which triangle a ray hits (e.g. to pick the triangle under the mouse),
+// we could test the ray against every triangle. For a mesh with a million
+// triangles, that's a million tests per ray.
+//
+// A "bounding volume hierarchy" (BVH) is a tree of boxes: the root box contains
+// the whole mesh, each box is split into two smaller boxes, and so on, down to
+// "leaf" boxes that contain a handful of triangles. A ray that misses a box can
+// skip everything inside it, so a ray typically only visits a few dozen boxes
+// and triangles.
+//
+// How well this works depends on where the boxes are split. The "surface area
+// heuristic" (SAH) estimates the cost of a split from the chance that a ray hits
+// each side (proportional to its surface area) times the number of triangles on
+// that side. Rather than trying every possible split, the triangles are sorted
+// into a few "bins" along each axis (by their centers), and only the bin
+// boundaries are evaluated. For large nodes, the binning runs on several threads.
+//
+// The leaves store their triangles in groups of four, as separate arrays of x, y
+// and z values, so with SSE one ray is tested against four triangles at once.
+// (The ray / box test also uses SSE, with the x, y and z slabs in one register.)
+
+/** @brief ray query result */
+struct BvhHit
+{
+	float		mT;				//!< distance along the ray (in units of the ray's direction)
+	float		mU, mV;			//!< barycentric coordinates of the hit point
+	uint32_t	mTriangle;		//!< index of the triangle (see TriangleBvh::getTriangle())
+
+	/** @brief default constructor */
+	BvhHit() : mT( FLT_MAX ), mU( 0.0f ), mV( 0.0f ), mTriangle( UINT32_MAX ) {}
+};
+
+/** @brief a bounding volume hierarchy over a mesh's triangles, for ray picking */
+class TriangleBvh {
+public:
+	/** @brief build counters */
+	struct Stats
+	{
+		size_t	mTriangles;
+		size_t	mSkipped;		//!< degenerate strip triangles that were left out
+		size_t	mNodes;
+		size_t	mLeaves;
+		size_t	mMaxDepth;
+		double	mBuildMs;
+
+		/** @brief default constructor */
+		Stats() : mTriangles( 0 ), mSkipped( 0 ), mNodes( 0 ), mLeaves( 0 ), mMaxDepth( 0 ), mBuildMs( 0.0 ) {}
+	};
+
+	/** @brief default constructor */
+	TriangleBvh() {}
+
+	/** @brief builds the tree for a ProtoMesh (positions from mVertices, triangle strip indices from mIndices) */
+	template<typename MeshT>
+	void build(const MeshT& iMesh)
+	{
+		std::vector<ci::Vec3f> tPositions( iMesh.mVertices.size() );
+		for(size_t i = 0; i < tPositions.size(); i++) { tPositions[ i ] = iMesh.mVertices[ i ].mPosition; }
+		build( tPositions, iMesh.mIndices, GL_TRIANGLE_STRIP );
+	}
+
+	/** @brief builds the tree for indexed triangles (GL_TRIANGLES or GL_TRIANGLE_STRIP) */
+	void build(const std::vector<ci::Vec3f>& iPositions, const std::vector<uint32_t>& iIndices, const GLenum& iPrimitive = GL_TRIANGLES)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		Clock::time_point tStart = Clock::now();
+
+		mStats = Stats();
+		mNodes.clear();
+		mBlocks.clear();
+		mPositions = iPositions;
+		decodeTriangles( iIndices, iPrimitive );
+
+		// Per-triangle bounds and centers:
+		size_t tCount = mTriangles.size() / 3;
+		mTriMin.resize( tCount );
+		mTriMax.resize( tCount );
+		mCentroids.resize( tCount );
+		mOrder.resize( tCount );
+		for(size_t i = 0; i < tCount; i++) {
+			const ci::Vec3f& a = mPositions[ mTriangles[ i * 3 ] ];
+			const ci::Vec3f& b = mPositions[ mTriangles[ i * 3 + 1 ] ];
+			const ci::Vec3f& c = mPositions[ mTriangles[ i * 3 + 2 ] ];
+			mTriMin[ i ]    = ci::Vec3f( std::min( a.x, std::min( b.x, c.x ) ), std::min( a.y, std::min( b.y, c.y ) ), std::min( a.z, std::min( b.z, c.z ) ) );
+			mTriMax[ i ]    = ci::Vec3f( std::max( a.x, std::max( b.x, c.x ) ), std::max( a.y, std::max( b.y, c.y ) ), std::max( a.z, std::max( b.z, c.z ) ) );
+			mCentroids[ i ] = ( mTriMin[ i ] + mTriMax[ i ] ) * 0.5f;
+			mOrder[ i ]     = static_cast<uint32_t>( i );
+		}
+
+		if( tCount > 0 ) {
+			buildNodes();
+		}
+
+		// The build data isn't needed for queries:
+		std::vector<ci::Vec3f>().swap( mTriMin );
+		std::vector<ci::Vec3f>().swap( mTriMax );
+		std::vector<ci::Vec3f>().swap( mCentroids );
+		std::vector<uint32_t>().swap( mOrder );
+
+		mStats.mTriangles = tCount;
+		mStats.mNodes     = mNodes.size();
+		mStats.mBuildMs   = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+	}
+
+	/** @brief finds the closest triangle hit by a ray (within iMaxT) */
+	bool intersect(const ci::Vec3f& iOrigin, const ci::Vec3f& iDirection, BvhHit& oHit, const float& iMaxT = FLT_MAX) const
+	{
+		oHit = BvhHit();
+		oHit.mT = iMaxT;
+		traverse( iOrigin, iDirection, oHit, false );
+		return oHit.mTriangle != UINT32_MAX;
+	}
+
+	/** @brief returns whether a ray hits any triangle (within iMaxT), stopping at the first hit */
+	bool occluded(const ci::Vec3f& iOrigin, const ci::Vec3f& iDirection, const float& iMaxT = FLT_MAX) const
+	{
+		BvhHit tHit;
+		tHit.mT = iMaxT;
+		traverse( iOrigin, iDirection, tHit, true );
+		return tHit.mTriangle != UINT32_MAX;
+	}
+
+	/** @brief finds the closest hit by testing every triangle (for checking the tree) */
+	bool intersectBruteForce(const ci::Vec3f& iOrigin, const ci::Vec3f& iDirection, BvhHit& oHit, const float& iMaxT = FLT_MAX) const
+	{
+		oHit = BvhHit();
+		oHit.mT = iMaxT;
+		for(size_t i = 0; i < mTriangles.size() / 3; i++) {
+			float t, u, v;
+			if( intersectTriangle( iOrigin, iDirection, i, t, u, v ) && t < oHit.mT ) {
+				oHit.mT = t; oHit.mU = u; oHit.mV = v;
+				oHit.mTriangle = static_cast<uint32_t>( i );
+			}
+		}
+		return oHit.mTriangle != UINT32_MAX;
+	}
+
+	/** @brief returns the number of triangles */
+	size_t getTriangleCount() const { return mTriangles.size() / 3; }
+
+	/** @brief returns a triangle's three vertex indices */
+	const uint32_t* getTriangle(const uint32_t& iTriangle) const { return &mTriangles[ iTriangle * 3 ]; }
+
+	/** @brief returns the vertex positions */
+	const std::vector<ci::Vec3f>& getPositions() const { return mPositions; }
+
+	/** @brief returns the build counters */
+	const Stats& getStats() const { return mStats; }
+
+protected:
+	static const int	kBins            = 16;
+	static const size_t	kBlockSize       = 4;		//!< triangles per SIMD group
+	static const size_t	kMaxLeafSize     = 16;
+	static const size_t	kMaxDepth        = 64;
+	static const size_t	kParallelBinning = 65536;	//!< bin larger nodes on several threads
+
+	/** @brief a node of the tree (interior: children are mOffset and mOffset + 1; leaf: blocks [mOffset, mOffset + mCount)) */
+	struct Node
+	{
+		float		mMin[ 4 ];		//!< ( x, y, z, -FLT_MAX ) so that the SIMD box test can ignore the fourth lane
+		float		mMax[ 4 ];		//!< ( x, y, z, FLT_MAX )
+		uint32_t	mOffset;
+		uint32_t	mCount;			//!< 0 for interior nodes
+		uint32_t	mAxis;			//!< split axis (interior nodes)
+		uint32_t	mPad;
+	};
+
+	/** @brief four triangles as separate x, y, z arrays (vertex 0 and the two edges from it) */
+	struct TriBlock
+	{
+		float		mV0[ 3 ][ 4 ];
+		float		mE1[ 3 ][ 4 ];
+		float		mE2[ 3 ][ 4 ];
+		uint32_t	mIds[ 4 ];		//!< UINT32_MAX for unused lanes (whose edges are zero, so they never hit)
+	};
+
+	/** @brief bounds accumulated in a bin */
+	struct Bin
+	{
+		ci::Vec3f	mMin, mMax;
+		size_t		mCount;
+
+		Bin() : mMin( FLT_MAX, FLT_MAX, FLT_MAX ), mMax( -FLT_MAX, -FLT_MAX, -FLT_MAX ), mCount( 0 ) {}
+
+		void grow(const ci::Vec3f& iMin, const ci::Vec3f& iMax)
+		{
+			mMin = ci::Vec3f( std::min( mMin.x, iMin.x ), std::min( mMin.y, iMin.y ), std::min( mMin.z, iMin.z ) );
+			mMax = ci::Vec3f( std::max( mMax.x, iMax.x ), std::max( mMax.y, iMax.y ), std::max( mMax.z, iMax.z ) );
+		}
+
+		void merge(const Bin& iOther)
+		{
+			grow( iOther.mMin, iOther.mMax );
+			mCount += iOther.mCount;
+		}
+
+		float area() const
+		{
+			if( mCount == 0 ) { return 0.0f; }
+			ci::Vec3f d = mMax - mMin;
+			return 2.0f * ( d.x * d.y + d.y * d.z + d.z * d.x );
+		}
+	};
+
+	/** @brief a range of triangles (in mOrder) waiting to become a node */
+	struct BuildTask
+	{
+		uint32_t	mNode;
+		size_t		mBegin, mEnd;
+		size_t		mDepth;
+	};
+
+	/** @brief converts the indices into a list of triangles (strips: skipping degenerates, restoring winding) */
+	void decodeTriangles(const std::vector<uint32_t>& iIndices, const GLenum& iPrimitive)
+	{
+		mTriangles.clear();
+		if( iPrimitive == GL_TRIANGLE_STRIP ) {
+			mTriangles.reserve( iIndices.size() * 3 );
+			for(size_t i = 2; i < iIndices.size(); i++) {
+				uint32_t a = iIndices[ i - 2 ], b = iIndices[ i - 1 ], c = iIndices[ i ];
+				// Degenerate triangles join the strip's rows and have no area:
+				if( a == b || b == c || a == c ) {
+					mStats.mSkipped++;
+					continue;
+				}
+				// Every other triangle in a strip has reversed winding:
+				if( i % 2 == 0 ) { mTriangles.push_back( a ); mTriangles.push_back( b ); mTriangles.push_back( c ); }
+				else             { mTriangles.push_back( b ); mTriangles.push_back( a ); mTriangles.push_back( c ); }
+			}
+		}
+		else {
+			mTriangles.assign( iIndices.begin(), iIndices.begin() + ( iIndices.size() / 3 ) * 3 );
+		}
+	}
+
+	/** @brief builds the nodes (each node's two children are stored next to each other) */
+	void buildNodes()
+	{
+		mNodes.reserve( 2 * mOrder.size() / 4 + 1 );
+		mNodes.push_back( Node() );
+		std::vector<BuildTask> tStack;
+		BuildTask tRoot = { 0, 0, mOrder.size(), 0 };
+		tStack.push_back( tRoot );
+
+		while( !tStack.empty() ) {
+			BuildTask tTask = tStack.back();
+			tStack.pop_back();
+			mStats.mMaxDepth = std::max( mStats.mMaxDepth, tTask.mDepth );
+
+			// Bounds of the triangles and of their centers:
+			Bin tBounds, tCentroidBounds;
+			for(size_t i = tTask.mBegin; i < tTask.mEnd; i++) {
+				uint32_t t = mOrder[ i ];
+				tBounds.grow( mTriMin[ t ], mTriMax[ t ] );
+				tCentroidBounds.grow( mCentroids[ t ], mCentroids[ t ] );
+			}
+			Node& tNode = mNodes[ tTask.mNode ];
+			tNode.mMin[ 0 ] = tBounds.mMin.x; tNode.mMin[ 1 ] = tBounds.mMin.y; tNode.mMin[ 2 ] = tBounds.mMin.z; tNode.mMin[ 3 ] = -FLT_MAX;
+			tNode.mMax[ 0 ] = tBounds.mMax.x; tNode.mMax[ 1 ] = tBounds.mMax.y; tNode.mMax[ 2 ] = tBounds.mMax.z; tNode.mMax[ 3 ] = FLT_MAX;
+			tNode.mAxis = 0;
+			tNode.mPad  = 0;
+
+			size_t tCount = tTask.mEnd - tTask.mBegin;
+			size_t tMid   = tTask.mBegin;
+			bool   tLeaf  = ( tCount <= kBlockSize || tTask.mDepth >= kMaxDepth );
+			if( !tLeaf ) {
+				tMid  = split( tTask, tBounds, tCentroidBounds, tNode.mAxis );
+				// (split() returns mBegin when keeping a leaf is cheaper.)
+				tLeaf = ( tMid == tTask.mBegin || tMid == tTask.mEnd );
+			}
+
+			if( tLeaf ) {
+				makeLeaf( tNode, tTask.mBegin, tTask.mEnd );
+				continue;
+			}
+
+			// Interior node (the right task is pushed first so that the left one is built first):
+			uint32_t tLeft  = static_cast<uint32_t>( mNodes.size() );
+			uint32_t tRight = tLeft + 1;
+			mNodes.push_back( Node() );
+			mNodes.push_back( Node() );
+			mNodes[ tTask.mNode ].mOffset = tLeft;
+			mNodes[ tTask.mNode ].mCount  = 0;
+			BuildTask tRightTask = { tRight, tMid, tTask.mEnd, tTask.mDepth + 1 };
+			BuildTask tLeftTask  = { tLeft, tTask.mBegin, tMid, tTask.mDepth + 1 };
+			tStack.push_back( tRightTask );
+			tStack.push_back( tLeftTask );
+		}
+	}
+
+	/** @brief partitions a task's triangles at the best binned SAH split and returns the split position (or mBegin for a leaf) */
+	size_t split(const BuildTask& iTask, const Bin& iBounds, const Bin& iCentroidBounds, uint32_t& oAxis)
+	{
+		size_t    tCount  = iTask.mEnd - iTask.mBegin;
+		ci::Vec3f tExtent = iCentroidBounds.mMax - iCentroidBounds.mMin;
+		float     tBestCost = FLT_MAX;
+		int       tBestAxis = -1, tBestBin = 0;
+
+		// Bin along all three axes:
+		Bin tBins[ 3 ][ kBins ];
+		auto tBinRange = [&](size_t iBegin, size_t iEnd, Bin (*oBins)[ kBins ]) {
+			for(size_t i = iBegin; i < iEnd; i++) {
+				uint32_t t = mOrder[ iTask.mBegin + i ];
+				for(int a = 0; a < 3; a++) {
+					int   b = binIndex( mCentroids[ t ][ a ], iCentroidBounds.mMin[ a ], tExtent[ a ] );
+					oBins[ a ][ b ].grow( mTriMin[ t ], mTriMax[ t ] );
+					oBins[ a ][ b ].mCount++;
+				}
+			}
+		};
+		if( tCount >= kParallelBinning ) {
+			std::mutex tMutex;
+			parallelFor( tCount, [&](size_t iBegin, size_t iEnd) {
+				Bin tLocal[ 3 ][ kBins ];
+				tBinRange( iBegin, iEnd, tLocal );
+				std::lock_guard<std::mutex> tLock( tMutex );
+				for(int a = 0; a < 3; a++) {
+					for(int b = 0; b < kBins; b++) { tBins[ a ][ b ].merge( tLocal[ a ][ b ] ); }
+				}
+			} );
+		}
+		else {
+			tBinRange( 0, tCount, tBins );
+		}
+
+		// Evaluate the split after each bin, sweeping from both ends:
+		for(int a = 0; a < 3; a++) {
+			if( tExtent[ a ] <= 0.0f ) { continue; }
+			float  tRightArea[ kBins ];
+			size_t tRightCount[ kBins ];
+			Bin    tAccum;
+			for(int b = kBins - 1; b > 0; b--) {
+				tAccum.merge( tBins[ a ][ b ] );
+				tRightArea[ b ]  = tAccum.area();
+				tRightCount[ b ] = tAccum.mCount;
+			}
+			tAccum = Bin();
+			for(int b = 0; b < kBins - 1; b++) {
+				tAccum.merge( tBins[ a ][ b ] );
+				if( tAccum.mCount == 0 || tRightCount[ b + 1 ] == 0 ) { continue; }
+				float tCost = tAccum.area() * blocks( tAccum.mCount ) + tRightArea[ b + 1 ] * blocks( tRightCount[ b + 1 ] );
+				if( tCost < tBestCost ) {
+					tBestCost = tCost;
+					tBestAxis = a;
+					tBestBin  = b;
+				}
+			}
+		}
+
+		// Compare to the cost of a leaf (one traversal step is about as expensive as one block test):
+		float tArea     = iBounds.area();
+		float tLeafCost = blocks( tCount );
+		float tSplitCost = ( tArea > 0.0f && tBestAxis >= 0 ) ? ( 1.0f + tBestCost / tArea ) : ( FLT_MAX );
+		if( tSplitCost >= tLeafCost && tCount <= kMaxLeafSize ) {
+			return iTask.mBegin;
+		}
+
+		std::vector<uint32_t>::iterator tBegin = mOrder.begin() + iTask.mBegin;
+		std::vector<uint32_t>::iterator tEnd   = mOrder.begin() + iTask.mEnd;
+		if( tBestAxis < 0 ) {
+			// All centers coincide (or no split separates them): split by count along the widest axis:
+			ci::Vec3f tSize = iBounds.mMax - iBounds.mMin;
+			int tAxis = ( tSize.x > tSize.y && tSize.x > tSize.z ) ? ( 0 ) : ( ( tSize.y > tSize.z ) ? ( 1 ) : ( 2 ) );
+			std::vector<uint32_t>::iterator tMid = tBegin + tCount / 2;
+			std::nth_element( tBegin, tMid, tEnd, [&](uint32_t a, uint32_t b) { return mCentroids[ a ][ tAxis ] < mCentroids[ b ][ tAxis ]; } );
+			oAxis = static_cast<uint32_t>( tAxis );
+			return iTask.mBegin + tCount / 2;
+		}
+
+		std::vector<uint32_t>::iterator tMid = std::partition( tBegin, tEnd, [&](uint32_t t) {
+			return binIndex( mCentroids[ t ][ tBestAxis ], iCentroidBounds.mMin[ tBestAxis ], tExtent[ tBestAxis ] ) <= tBestBin;
+		} );
+		oAxis = static_cast<uint32_t>( tBestAxis );
+		return iTask.mBegin + ( tMid - tBegin );
+	}
+
+	/** @brief turns a node into a leaf, packing its triangles into blocks of four */
+	void makeLeaf(Node& oNode, const size_t& iBegin, const size_t& iEnd)
+	{
+		oNode.mOffset = static_cast<uint32_t>( mBlocks.size() );
+		oNode.mCount  = static_cast<uint32_t>( blocks( iEnd - iBegin ) );
+		for(size_t i = iBegin; i < iEnd; i += kBlockSize) {
+			TriBlock tBlock;
+			for(size_t k = 0; k < kBlockSize; k++) {
+				ci::Vec3f tV0, tE1, tE2;
+				uint32_t  tId = UINT32_MAX;
+				if( i + k < iEnd ) {
+					tId = mOrder[ i + k ];
+					tV0 = mPositions[ mTriangles[ tId * 3 ] ];
+					tE1 = mPositions[ mTriangles[ tId * 3 + 1 ] ] - tV0;
+					tE2 = mPositions[ mTriangles[ tId * 3 + 2 ] ] - tV0;
+				}
+				for(int a = 0; a < 3; a++) {
+					tBlock.mV0[ a ][ k ] = tV0[ a ];
+					tBlock.mE1[ a ][ k ] = tE1[ a ];
+					tBlock.mE2[ a ][ k ] = tE2[ a ];
+				}
+				tBlock.mIds[ k ] = tId;
+			}
+			mBlocks.push_back( tBlock );
+		}
+		mStats.mLeaves++;
+	}
+
+	/** @brief returns the number of four-triangle blocks needed for a number of triangles */
+	static size_t blocks(const size_t& iCount) { return ( iCount + kBlockSize - 1 ) / kBlockSize; }
+
+	/** @brief returns the bin of a center coordinate */
+	static int binIndex(const float& iValue, const float& iMin, const float& iExtent)
+	{
+		int b = static_cast<int>( ( iValue - iMin ) / iExtent * kBins );
+		return ( b < 0 ) ? ( 0 ) : ( ( b >= kBins ) ? ( kBins - 1 ) : ( b ) );
+	}
+
+	/** @brief walks the tree, nearest child first (stopping at the first hit if iAnyHit) */
+	void traverse(const ci::Vec3f& iOrigin, const ci::Vec3f& iDirection, BvhHit& ioHit, const bool& iAnyHit) const
+	{
+		if( mNodes.empty() ) { return; }
+		ci::Vec3f tInvDir( 1.0f / iDirection.x, 1.0f / iDirection.y, 1.0f / iDirection.z );
+		bool      tNegative[ 3 ] = { iDirection.x < 0.0f, iDirection.y < 0.0f, iDirection.z < 0.0f };
+
+		uint32_t tStack[ kMaxDepth * 2 + 2 ];
+		size_t   tStackSize = 0;
+		tStack[ tStackSize++ ] = 0;
+		while( tStackSize > 0 ) {
+			const Node& tNode = mNodes[ tStack[ --tStackSize ] ];
+			if( !intersectBox( tNode, iOrigin, tInvDir, ioHit.mT ) ) { continue; }
+			if( tNode.mCount > 0 ) {
+				for(uint32_t b = tNode.mOffset; b < tNode.mOffset + tNode.mCount; b++) {
+					if( intersectBlock( mBlocks[ b ], iOrigin, iDirection, ioHit ) && iAnyHit ) { return; }
+				}
+				continue;
+			}
+			// Visit the child on the ray's side of the split first (push it last):
+			uint32_t tLeft  = tNode.mOffset;
+			uint32_t tRight = tNode.mOffset + 1;
+			if( tNegative[ tNode.mAxis ] ) {
+				tStack[ tStackSize++ ] = tLeft;
+				tStack[ tStackSize++ ] = tRight;
+			}
+			else {
+				tStack[ tStackSize++ ] = tRight;
+				tStack[ tStackSize++ ] = tLeft;
+			}
+		}
+	}
+
+	/** @brief returns whether a ray enters a node's box before iMaxT (slab test) */
+	static bool intersectBox(const Node& iNode, const ci::Vec3f& iOrigin, const ci::Vec3f& iInvDir, const float& iMaxT)
+	{
+#ifdef TRIANGLE_BVH_SSE
+		// All three slabs at once (the fourth lane's bounds are +/- FLT_MAX, so it never limits the result):
+		__m128 tOrigin = _mm_set_ps( 0.0f, iOrigin.z, iOrigin.y, iOrigin.x );
+		__m128 tInv    = _mm_set_ps( 1.0f, iInvDir.z, iInvDir.y, iInvDir.x );
+		__m128 t1      = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( iNode.mMin ), tOrigin ), tInv );
+		__m128 t2      = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( iNode.mMax ), tOrigin ), tInv );
+		__m128 tNear   = _mm_min_ps( t1, t2 );
+		__m128 tFar    = _mm_max_ps( t1, t2 );
+		// Horizontal max of the near distances and min of the far distances:
+		tNear = _mm_max_ps( tNear, _mm_shuffle_ps( tNear, tNear, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+		tNear = _mm_max_ps( tNear, _mm_shuffle_ps( tNear, tNear, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		tFar  = _mm_min_ps( tFar, _mm_shuffle_ps( tFar, tFar, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+		tFar  = _mm_min_ps( tFar, _mm_shuffle_ps( tFar, tFar, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		float tNearT = _mm_cvtss_f32( tNear );
+		float tFarT  = _mm_cvtss_f32( tFar );
+#else
+		float tNearT = -FLT_MAX, tFarT = FLT_MAX;
+		for(int a = 0; a < 3; a++) {
+			float t1 = ( iNode.mMin[ a ] - iOrigin[ a ] ) * iInvDir[ a ];
+			float t2 = ( iNode.mMax[ a ] - iOrigin[ a ] ) * iInvDir[ a ];
+			tNearT = std::max( tNearT, std::min( t1, t2 ) );
+			tFarT  = std::min( tFarT, std::max( t1, t2 ) );
+		}
+#endif
+		return tFarT >= std::max( tNearT, 0.0f ) && tNearT < iMaxT;
+	}
+
+	/** @brief tests a ray against four triangles (Moller-Trumbore), updating the hit if one is closer */
+	static bool intersectBlock(const TriBlock& iBlock, const ci::Vec3f& iOrigin, const ci::Vec3f& iDirection, BvhHit& ioHit)
+	{
+#ifdef TRIANGLE_BVH_SSE
+		const __m128 tZero = _mm_setzero_ps();
+		const __m128 tOne  = _mm_set1_ps( 1.0f );
+		__m128 dx = _mm_set1_ps( iDirection.x ), dy = _mm_set1_ps( iDirection.y ), dz = _mm_set1_ps( iDirection.z );
+		__m128 e1x = _mm_loadu_ps( iBlock.mE1[ 0 ] ), e1y = _mm_loadu_ps( iBlock.mE1[ 1 ] ), e1z = _mm_loadu_ps( iBlock.mE1[ 2 ] );
+		__m128 e2x = _mm_loadu_ps( iBlock.mE2[ 0 ] ), e2y = _mm_loadu_ps( iBlock.mE2[ 1 ] ), e2z = _mm_loadu_ps( iBlock.mE2[ 2 ] );
+
+		// p = d x e2, det = e1 . p:
+		__m128 px  = _mm_sub_ps( _mm_mul_ps( dy, e2z ), _mm_mul_ps( dz, e2y ) );
+		__m128 py  = _mm_sub_ps( _mm_mul_ps( dz, e2x ), _mm_mul_ps( dx, e2z ) );
+		__m128 pz  = _mm_sub_ps( _mm_mul_ps( dx, e2y ), _mm_mul_ps( dy, e2x ) );
+		__m128 det = _mm_add_ps( _mm_add_ps( _mm_mul_ps( e1x, px ), _mm_mul_ps( e1y, py ) ), _mm_mul_ps( e1z, pz ) );
+		__m128 inv = _mm_div_ps( tOne, det );
+
+		// s = o - v0, u = ( s . p ) / det:
+		__m128 sx = _mm_sub_ps( _mm_set1_ps( iOrigin.x ), _mm_loadu_ps( iBlock.mV0[ 0 ] ) );
+		__m128 sy = _mm_sub_ps( _mm_set1_ps( iOrigin.y ), _mm_loadu_ps( iBlock.mV0[ 1 ] ) );
+		__m128 sz = _mm_sub_ps( _mm_set1_ps( iOrigin.z ), _mm_loadu_ps( iBlock.mV0[ 2 ] ) );
+		__m128 u  = _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( sx, px ), _mm_mul_ps( sy, py ) ), _mm_mul_ps( sz, pz ) ), inv );
+
+		// q = s x e1, v = ( d . q ) / det, t = ( e2 . q ) / det:
+		__m128 qx = _mm_sub_ps( _mm_mul_ps( sy, e1z ), _mm_mul_ps( sz, e1y ) );
+		__m128 qy = _mm_sub_ps( _mm_mul_ps( sz, e1x ), _mm_mul_ps( sx, e1z ) );
+		__m128 qz = _mm_sub_ps( _mm_mul_ps( sx, e1y ), _mm_mul_ps( sy, e1x ) );
+		__m128 v  = _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, qx ), _mm_mul_ps( dy, qy ) ), _mm_mul_ps( dz, qz ) ), inv );
+		__m128 t  = _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( e2x, qx ), _mm_mul_ps( e2y, qy ) ), _mm_mul_ps( e2z, qz ) ), inv );
+
+		// Hit if det != 0, u >= 0, v >= 0, u + v <= 1 and 0 < t < closest so far:
+		__m128 tMask = _mm_cmpneq_ps( det, tZero );
+		tMask = _mm_and_ps( tMask, _mm_cmpge_ps( u, tZero ) );
+		tMask = _mm_and_ps( tMask, _mm_cmpge_ps( v, tZero ) );
+		tMask = _mm_and_ps( tMask, _mm_cmple_ps( _mm_add_ps( u, v ), tOne ) );
+		tMask = _mm_and_ps( tMask, _mm_cmpgt_ps( t, tZero ) );
+		tMask = _mm_and_ps( tMask, _mm_cmplt_ps( t, _mm_set1_ps( ioHit.mT ) ) );
+		int tBits = _mm_movemask_ps( tMask );
+		if( tBits == 0 ) { return false; }
+
+		float tT[ 4 ], tU[ 4 ], tV[ 4 ];
+		_mm_storeu_ps( tT, t );
+		_mm_storeu_ps( tU, u );
+		_mm_storeu_ps( tV, v );
+		for(int k = 0; k < 4; k++) {
+			if( ( tBits & ( 1 << k ) ) && tT[ k ] < ioHit.mT ) {
+				ioHit.mT = tT[ k ]; ioHit.mU = tU[ k ]; ioHit.mV = tV[ k ];
+				ioHit.mTriangle = iBlock.mIds[ k ];
+			}
+		}
+		return true;
+#else
+		bool tFound = false;
+		for(int k = 0; k < 4; k++) {
+			if( iBlock.mIds[ k ] == UINT32_MAX ) { continue; }
+			ci::Vec3f tV0( iBlock.mV0[ 0 ][ k ], iBlock.mV0[ 1 ][ k ], iBlock.mV0[ 2 ][ k ] );
+			ci::Vec3f tE1( iBlock.mE1[ 0 ][ k ], iBlock.mE1[ 1 ][ k ], iBlock.mE1[ 2 ][ k ] );
+			ci::Vec3f tE2( iBlock.mE2[ 0 ][ k ], iBlock.mE2[ 1 ][ k ], iBlock.mE2[ 2 ][ k ] );
+			float t, u, v;
+			if( intersectTriangle( iOrigin, iDirection, tV0, tE1, tE2, t, u, v ) && t < ioHit.mT ) {
+				ioHit.mT = t; ioHit.mU = u; ioHit.mV = v;
+				ioHit.mTriangle = iBlock.mIds[ k ];
+				tFound = true;
+			}
+		}
+		return tFound;
+#endif
+	}
+
+	/** @brief tests a ray against one triangle of the mesh */
+	bool intersectTriangle(const ci::Vec3f& iOrigin, const ci::Vec3f& iDirection, const size_t& iTriangle, float& oT, float& oU, float& oV) const
+	{
+		const ci::Vec3f& tV0 = mPositions[ mTriangles[ iTriangle * 3 ] ];
+		return intersectTriangle( iOrigin, iDirection, tV0, mPositions[ mTriangles[ iTriangle * 3 + 1 ] ] - tV0, mPositions[ mTriangles[ iTriangle * 3 + 2 ] ] - tV0, oT, oU, oV );
+	}
+
+	/** @brief tests a ray against a triangle given as a vertex and two edges (Moller-Trumbore) */
+	static bool intersectTriangle(const ci::Vec3f& iOrigin, const ci::Vec3f& iDirection, const ci::Vec3f& iV0, const ci::Vec3f& iE1, const ci::Vec3f& iE2, float& oT, float& oU, float& oV)
+	{
+		ci::Vec3f p   = iDirection.cross( iE2 );
+		float     det = iE1.dot( p );
+		if( det == 0.0f ) { return false; }
+		float     inv = 1.0f / det;
+		ci::Vec3f s   = iOrigin - iV0;
+		oU = s.dot( p ) * inv;
+		if( oU < 0.0f || oU > 1.0f ) { return false; }
+		ci::Vec3f q = s.cross( iE1 );
+		oV = iDirection.dot( q ) * inv;
+		if( oV < 0.0f || oU + oV > 1.0f ) { return false; }
+		oT = iE2.dot( q ) * inv;
+		return oT > 0.0f;
+	}
+
+	std::vector<ci::Vec3f>	mPositions;
+	std::vector<uint32_t>	mTriangles;		//!< three vertex indices per triangle
+	std::vector<Node>		mNodes;
+	std::vector<TriBlock>	mBlocks;
+	Stats					mStats;
+
+	// Build data:
+	std::vector<ci::Vec3f>	mTriMin, mTriMax, mCentroids;
+	std::vector<uint32_t>	mOrder;			//!< triangle indices, partitioned into the nodes' ranges
+};
+
+/** @brief builds a tree for a ProtoMesh, times random ray queries against it and checks a few against brute force */
+template<typename MeshT>
+static void runBvhBenchmark(const MeshT& iMesh, const size_t& iRayCount = 100000, const size_t& iCheckCount = 100)
+{
+	using namespace ci;
+	typedef std::chrono::high_resolution_clock Clock;
+
+	TriangleBvh tBvh;
+	tBvh.build( iMesh );
+	const TriangleBvh::Stats& tStats = tBvh.getStats();
+
+	// Rays from a sphere around the mesh, aimed at random points inside its bounds:
+	Vec3f tMin( FLT_MAX, FLT_MAX, FLT_MAX ), tMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+	for(const auto& tVertex : iMesh.mVertices) {
+		const Vec3f& p = tVertex.mPosition;
+		tMin = Vec3f( std::min( tMin.x, p.x ), std::min( tMin.y, p.y ), std::min( tMin.z, p.z ) );
+		tMax = Vec3f( std::max( tMax.x, p.x ), std::max( tMax.y, p.y ), std::max( tMax.z, p.z ) );
+	}
+	Vec3f tCenter = ( tMin + tMax ) * 0.5f;
+	float tRadius = ( tMax - tMin ).length();
+	Rand tRand( 1234 );
+	std::vector<Vec3f> tOrigins( iRayCount ), tDirections( iRayCount );
+	for(size_t i = 0; i < iRayCount; i++) {
+		Vec3f tTarget( tRand.nextFloat( tMin.x, tMax.x ), tRand.nextFloat( tMin.y, tMax.y ), tRand.nextFloat( tMin.z, tMax.z ) );
+		tOrigins[ i ]    = tCenter + tRand.nextVec3f() * tRadius;
+		tDirections[ i ] = ( tTarget - tOrigins[ i ] ).normalized();
+	}
+
+	// Closest hits:
+	std::vector<BvhHit> tHits( iRayCount );
+	size_t tHitCount = 0;
+	Clock::time_point tStart = Clock::now();
+	for(size_t i = 0; i < iRayCount; i++) {
+		if( tBvh.intersect( tOrigins[ i ], tDirections[ i ], tHits[ i ] ) ) { tHitCount++; }
+	}
+	double tClosestTime = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count();
+
+	// Any hit:
+	tStart = Clock::now();
+	size_t tOccludedCount = 0;
+	for(size_t i = 0; i < iRayCount; i++) {
+		if( tBvh.occluded( tOrigins[ i ], tDirections[ i ] ) ) { tOccludedCount++; }
+	}
+	double tAnyTime = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count();
+
+	// Check against testing every triangle:
+	size_t tMismatches = 0;
+	size_t tChecks = std::min( iCheckCount, iRayCount );
+	tStart = Clock::now();
+	for(size_t i = 0; i < tChecks; i++) {
+		BvhHit tReference;
+		tBvh.intersectBruteForce( tOrigins[ i ], tDirections[ i ], tReference );
+		bool tSame = ( tReference.mTriangle == UINT32_MAX ) ? ( tHits[ i ].mTriangle == UINT32_MAX ) : ( std::fabs( tReference.mT - tHits[ i ].mT ) <= 1.0e-3f * tRadius );
+		if( !tSame ) { tMismatches++; }
+	}
+	double tBruteTime = std::chrono::duration<double, std::micro>( Clock::now() - tStart ).count();
+
+	std::cout << "BVH benchmark: " << tStats.mTriangles << " triangles (" << tStats.mSkipped << " degenerates skipped), "
+		<< tStats.mNodes << " nodes, " << tStats.mLeaves << " leaves, depth " << tStats.mMaxDepth << std::endl;
+	std::cout << "  build:    " << tStats.mBuildMs << " ms" << std::endl;
+	std::cout << "  closest:  " << tClosestTime / iRayCount << " us/ray (" << tHitCount << " of " << iRayCount << " rays hit)" << std::endl;
+	std::cout << "  any hit:  " << tAnyTime / iRayCount << " us/ray (" << tOccludedCount << " rays hit)" << std::endl;
+	if( tChecks > 0 ) {
+		std::cout << "  brute force: " << tBruteTime / tChecks << " us/ray, " << tMismatches << " mismatches in " << tChecks << " rays" << std::endl;
+	}
+}
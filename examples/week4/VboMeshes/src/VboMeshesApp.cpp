@@ -10,6 +10,8 @@
 #include "cinder/Camera.h"
 
 #include "MeshFactory.h"
+#include "MeshTopology.h"
+#include "TriangleBvh.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -19,6 +21,7 @@ class VboMeshesApp : public AppNative {
 public:
 	void setup();
 	void mouseDown(MouseEvent event);
+	void keyUp(KeyEvent event);
 	void update();
 	void draw();
 	void resize();
@@ -27,6 +30,11 @@ public:
 	
 	ProtoMesh	mMeshProto;
 	gl::VboMesh mMeshVbo;
+	MeshIndices	mMeshIndices;		//!< the mesh's triangles, in the cheapest topology
+	
+	Vec3f		mRotation;
+	TriangleBvh	mBvh;
+	int			mPickedTriangle;
 };
 
 void VboMeshesApp::setup()
@@ -41,16 +49,86 @@ void VboMeshesApp::setup()
 	// Initialize a sphere mesh:
 	createSphere( 30, 30, 75.0, mMeshProto );
 	
-	// Convert mesh to VBO:
-	createMeshVbo( mMeshProto, mMeshVbo );
+	// Store its vertices in Morton order (the indices are rewritten to match):
+	sortMeshVertices( mMeshProto );
+	
+	// Convert mesh to VBO (drawing its triangles in whichever topology is cheapest for its shape):
+	chooseMeshTopology( mMeshProto, isPrimitiveRestartAvailable(), mMeshIndices );
+	createMeshVbo( mMeshProto, mMeshIndices, mMeshVbo );
+	cout << "Drawing the mesh as " << getTopologyName( mMeshIndices.mTopology ) << endl;
+	
+	// Build a bounding volume hierarchy for picking triangles:
+	mBvh.build( mMeshProto );
+	mPickedTriangle = -1;
 }
 
 void VboMeshesApp::mouseDown(MouseEvent event)
 {
+	// Get a ray from the camera through the mouse position:
+	float tU = event.getX() / static_cast<float>( getWindowWidth() );
+	float tV = 1.0f - event.getY() / static_cast<float>( getWindowHeight() );
+	Ray   tRay = mCam.generateRay( tU, tV, getWindowAspectRatio() );
+	
+	// Transform the ray into the mesh's (rotated) frame:
+	Matrix44f tModel = Matrix44f::createRotation( Vec3f::xAxis(), toRadians( mRotation.x ) );
+	tModel *= Matrix44f::createRotation( Vec3f::yAxis(), toRadians( mRotation.y ) );
+	tModel *= Matrix44f::createRotation( Vec3f::zAxis(), toRadians( mRotation.z ) );
+	Matrix44f tInverse = tModel.inverted();
+	
+	// Find the closest triangle hit by the ray:
+	BvhHit tHit;
+	if( mBvh.intersect( tInverse.transformPoint( tRay.getOrigin() ), tInverse.transformVec( tRay.getDirection() ), tHit ) ) {
+		mPickedTriangle = static_cast<int>( tHit.mTriangle );
+	}
+	else {
+		mPickedTriangle = -1;
+	}
+}
+
+void VboMeshesApp::keyUp(KeyEvent event)
+{
+	switch( event.getChar() ) {
+		case 'b': {
+			// Time ray queries against a sphere with about a million triangles:
+			ProtoMesh tMesh;
+			createSphere( 710, 710, 75.0, tMesh );
+			sortMeshVertices( tMesh );
+			runBvhBenchmark( tMesh );
+			break;
+		}
+		case 's': {
+			// Print tree stats:
+			const TriangleBvh::Stats& tStats = mBvh.getStats();
+			cout << "BVH: " << tStats.mTriangles << " triangles, " << tStats.mNodes << " nodes, depth " << tStats.mMaxDepth
+				<< ", built in " << tStats.mBuildMs << " ms" << endl;
+			break;
+		}
+		case 't': {
+			// Cycle through the topologies:
+			MeshTopology tTopology = static_cast<MeshTopology>( ( mMeshIndices.mTopology + 1 ) % 4 );
+			if( tTopology == TOPOLOGY_RESTART_STRIPS && !isPrimitiveRestartAvailable() ) {
+				tTopology = TOPOLOGY_TRIANGLES;
+			}
+			convertMeshTopology( mMeshProto, tTopology, mMeshIndices );
+			createMeshVbo( mMeshProto, mMeshIndices, mMeshVbo );
+			const TopologyStats& tStats = mMeshIndices.mStats;
+			cout << getTopologyName( tTopology ) << ": " << tStats.mIndices << " indices, " << tStats.mTriangles << " triangles, "
+				<< tStats.mDegenerates << " degenerates, " << tStats.mRestarts << " restarts, ACMR " << tStats.getAcmr() << endl;
+			break;
+		}
+		case 'r': {
+			// Compare the topologies for a few mesh shapes:
+			runTopologyReport();
+			break;
+		}
+		default: { break; }
+	}
 }
 
 void VboMeshesApp::update()
 {
+	// Update rotation:
+	mRotation = Vec3f( cos( getElapsedSeconds() ), cos( getElapsedSeconds() ), sin( getElapsedSeconds() ) ) * 25.0;
 }
 
 void VboMeshesApp::draw()
@@ -68,25 +146,39 @@ void VboMeshesApp::draw()
 	gl::pushMatrices();
 	
 	// Rotate frame:
-	gl::rotate( Vec3f( cos( getElapsedSeconds() ), cos( getElapsedSeconds() ), sin( getElapsedSeconds() ) ) * 25.0 );
+	gl::rotate( mRotation );
 	
 	// Set color:
 	gl::color( 1.0, 1.0, 1.0 );
 
 	// Draw VBO mesh (filled):
-	gl::draw( mMeshVbo );
+	drawMeshVbo( mMeshVbo, mMeshIndices );
 
 	// Set color:
 	gl::color( 1.0, 0.0, 0.0 );
 
 	// Draw VBO mesh (wireframe):
 	gl::enableWireframe();
-	gl::draw( mMeshVbo );
+	drawMeshVbo( mMeshVbo, mMeshIndices );
 	gl::disableWireframe();
 	
 	// Draw protomesh in debug mode:
 	mMeshProto.drawDebug( 5.0 );
 	
+	// Draw the picked triangle (on top):
+	if( mPickedTriangle >= 0 ) {
+		const uint32_t* tTriangle = mBvh.getTriangle( mPickedTriangle );
+		gl::disableDepthRead();
+		gl::color( 1.0, 1.0, 0.0 );
+		glBegin( GL_TRIANGLES );
+		for(int i = 0; i < 3; i++) {
+			const Vec3f& tPosition = mBvh.getPositions()[ tTriangle[ i ] ];
+			glVertex3f( tPosition.x, tPosition.y, tPosition.z );
+		}
+		glEnd();
+		gl::enableDepthRead();
+	}
+	
 	// Pop matrix:
 	gl::popMatrices();
 }
@@ -11,6 +11,9 @@
 #include "cinder/gl/GlslProg.h"
 #include "cinder/Camera.h"
 
+#include "FrustumCuller.h"
+#include "InstanceBatch.h"
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -19,12 +22,13 @@ using namespace std;
 
 static const string kVertGlsl =
 STRINGIFY(
+		  attribute mat4 aInstanceMatrix;
 		  varying float vCameraDistance;
 		  
 		  void main()
 		  {
-			  // Get the vertex position in camera-space:
-			  vec4 tVertexPositionCameraSpace = gl_ModelViewMatrix * gl_Vertex;
+			  // Get the vertex position in camera-space (placing this cube instance first):
+			  vec4 tVertexPositionCameraSpace = gl_ModelViewMatrix * ( aInstanceMatrix * gl_Vertex );
 			  // Get camera's distance from vertex:
 			  vCameraDistance = -tVertexPositionCameraSpace.z;
 			  // Set vertex position:
@@ -56,12 +60,19 @@ class GLSLDepthShaderApp : public AppNative {
 public:
 	void setup();
 	void mouseDown(MouseEvent event);
+	void keyUp(KeyEvent event);
 	void update();
 	void draw();
 	void resize();
 	
-	CameraPersp		mCam;
-	gl::GlslProg	mShader;
+	CameraPersp			mCam;
+	gl::GlslProg		mShader;
+	
+	vector<Vec3f>		mCubeCenters;
+	float				mCubeSize;
+	CullBatch			mCubeBounds;
+	vector<uint32_t>	mVisible;
+	InstanceBatch		mCubes;
 };
 
 void GLSLDepthShaderApp::setup()
@@ -75,12 +86,49 @@ void GLSLDepthShaderApp::setup()
 	
 	// Load shader from strings (using the stringify macro):
 	mShader = gl::GlslProg( kVertGlsl.c_str(), kFragGlsl.c_str() );
+	
+	// Choose unit size:
+	float tUnitLen = 10.0;
+	mCubeSize      = tUnitLen / 2.0;
+	
+	// Prepare cube grid (and each cube's bounding box):
+	for(int x = -10; x < 10; x++) {
+		for(int z = -10; z < 10; z++) {
+			mCubeCenters.push_back( Vec3f( x * tUnitLen, 0.0, z * tUnitLen ) );
+			mCubeBounds.addBox( mCubeCenters.back(), Vec3f( mCubeSize, mCubeSize, mCubeSize ) * 0.5 );
+		}
+	}
+	
+	// Prepare cube mesh (drawn once per visible cube, with a single draw call):
+	vector<InstanceBatch::Vertex> tVertices;
+	vector<uint32_t> tIndices;
+	createInstanceCube( tVertices, tIndices, false );
+	mCubes.setMesh( tVertices, tIndices );
 }
 
 void GLSLDepthShaderApp::mouseDown(MouseEvent event)
 {
 }
 
+void GLSLDepthShaderApp::keyUp(KeyEvent event)
+{
+	switch( event.getChar() ) {
+		case 'i': {
+			// Toggle between hardware instancing and CPU expansion:
+			mCubes.setInstancingEnabled( !mCubes.isInstancing() );
+			break;
+		}
+		case 's': {
+			// Print culling and draw stats:
+			const CullBatch::Stats& tStats = mCubeBounds.getStats();
+			cout << mVisible.size() << " cubes drawn, " << tStats.mTested << " tested, " << tStats.mCulled << " culled" << endl;
+			cout << ( ( mCubes.isInstancing() ) ? ( "Instanced" ) : ( "Expanded" ) ) << ": " << mCubes.getStats().mDrawCalls << " draw call(s)" << endl;
+			break;
+		}
+		default: { break; }
+	}
+}
+
 void GLSLDepthShaderApp::update()
 {
 }
@@ -96,9 +144,8 @@ void GLSLDepthShaderApp::draw()
 	// Set matrix from camera:
 	gl::setMatrices( mCam );
 	
-	// Choose unit size:
-	float tUnitLen = 10.0;
-	float tHalfLen = tUnitLen / 2.0;
+	// Find the cubes that are (at least partly) inside the camera's view frustum:
+	mCubeBounds.cull( Frustum( mCam ), mVisible );
 	
 	// Bind shader:
 	mShader.bind();
@@ -106,12 +153,14 @@ void GLSLDepthShaderApp::draw()
 	// Set shader uniform parameter for distance-mapping range:
 	mShader.uniform( "mDistanceRange", Vec2f( 10.0, 40.0 ) );
 	
-	// Draw color cube grid:
-	for(int x = -10; x < 10; x++) {
-		for(int z = -10; z < 10; z++) {
-			gl::drawCube( Vec3f( x * tUnitLen, 0.0, z * tUnitLen ), Vec3f( tHalfLen, tHalfLen, tHalfLen ) );
-		}
+	// Draw cube grid (visible cubes only, as instances of a unit cube):
+	mCubes.clear();
+	for(vector<uint32_t>::const_iterator it = mVisible.begin(); it != mVisible.end(); it++) {
+		Matrix44f tTransform = Matrix44f::createTranslation( mCubeCenters[ *it ] );
+		tTransform.scale( Vec3f( mCubeSize, mCubeSize, mCubeSize ) );
+		mCubes.add( tTransform );
 	}
+	mCubes.draw( mShader );
 	
 	// Unbind shader:
 	mShader.unbind();
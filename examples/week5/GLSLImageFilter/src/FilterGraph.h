@@ -0,0 +1,588 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cinder/Surface.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Fbo.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/gl/Texture.h"
+
+// A filter graph is a list of passes. Each pass reads one or more named images
+// and writes one named image. The graph is compiled into a shorter list of
+// "kernels": adjacent point-wise passes (which only look at the current pixel)
+// are fused together with their neighbors so that a chain such as
+// invert -> convolution runs as a single shader. Intermediate images are
+// assigned to a small number of framebuffer slots based on when they are last
+// read, so that a long graph only needs a handful of FBOs.
+//
+// Every pass carries both a GLSL snippet and an equivalent CPU function.
+// The CPU executor runs the same compiled graph on a Surface32f, which is
+// useful for testing a graph without a GL context.
+
+/** @brief the name of the graph's source image */
+static const std::string kFilterSource = "source";
+
+/** @brief exception thrown when a filter graph is malformed */
+class FilterGraphExc : public std::exception {
+public:
+	FilterGraphExc(const std::string& iMessage) : mMessage( iMessage ) {}
+	virtual ~FilterGraphExc() throw() {}
+	virtual const char* what() const throw() { return mMessage.c_str(); }
+private:
+	std::string mMessage;
+};
+
+class FilterCpuInputs;
+
+/** @brief cpu implementation of a point-wise pass */
+typedef std::function<ci::ColorA (const ci::ColorA&)> FilterPointFn;
+
+/** @brief cpu implementation of a sampling pass */
+typedef std::function<ci::ColorA (const FilterCpuInputs&, int, int)> FilterSampleFn;
+
+/** @brief a single pass within a filter graph */
+struct FilterPass
+{
+	enum Kind
+	{
+		POINTWISE,		//!< reads only the current pixel of its (single) input
+		SAMPLER			//!< reads arbitrary pixels of its inputs
+	};
+
+	std::string					mName;		//!< the pass's name (used in generated GLSL)
+	Kind						mKind;		//!< the pass's kind
+	std::vector<std::string>	mInputs;	//!< the names of the images read by the pass
+	std::string					mOutput;	//!< the name of the image written by the pass
+
+	// GLSL function body:
+	// POINTWISE passes receive "vec4 c" and return a vec4.
+	// SAMPLER passes receive "vec2 uv" and return a vec4. They may call
+	// readInput0( uv ), readInput1( uv ), ... and use the "mTexelSize" uniform.
+	std::string					mGlsl;
+	std::string					mGlslHelpers;	//!< optional GLSL declarations emitted before a SAMPLER pass's function
+
+	FilterPointFn				mCpuPoint;	//!< cpu equivalent of a POINTWISE pass
+	FilterSampleFn				mCpuSample;	//!< cpu equivalent of a SAMPLER pass
+};
+
+/** @brief a compiled unit of work: one shader invocation writing one image */
+struct FilterKernel
+{
+	std::vector<std::string>	mInputs;		//!< the images read by the kernel
+	std::vector<size_t>			mPre;			//!< point-wise passes applied to each read of input 0
+	int							mSampler;		//!< the kernel's sampling pass (or -1)
+	std::vector<size_t>			mPost;			//!< point-wise passes applied to the result
+	std::string					mOutput;		//!< the image written by the kernel
+	std::vector<int>			mInputSlots;	//!< the pool slot for each input (-1 for the source)
+	size_t						mOutputSlot;	//!< the pool slot for the output
+	std::string					mFrag;			//!< the kernel's generated fragment shader
+
+	/** @brief default constructor */
+	FilterKernel() : mSampler( -1 ), mOutputSlot( 0 ) {}
+};
+
+/** @brief cpu-side view of a kernel's inputs */
+class FilterCpuInputs {
+public:
+	/** @brief basic constructor */
+	FilterCpuInputs(const std::vector<const ci::Surface32f*>& iImages, const std::vector<FilterPass>& iPasses, const std::vector<size_t>& iPre) :
+		mImages( iImages ), mPasses( iPasses ), mPre( iPre ) {}
+
+	/** @brief returns the pixel at (x,y) of the given input, clamped to the image edge */
+	ci::ColorA read(const size_t& iInput, int iX, int iY) const
+	{
+		const ci::Surface32f& tImage = *mImages[ iInput ];
+		iX = std::min<int>( std::max<int>( iX, 0 ), tImage.getWidth() - 1 );
+		iY = std::min<int>( std::max<int>( iY, 0 ), tImage.getHeight() - 1 );
+		ci::ColorA tColor = tImage.getPixel( ci::Vec2i( iX, iY ) );
+		// Fused point-wise passes only apply to the first input:
+		if( iInput == 0 ) {
+			for(std::vector<size_t>::const_iterator it = mPre.begin(); it != mPre.end(); it++) {
+				tColor = mPasses[ *it ].mCpuPoint( tColor );
+			}
+		}
+		return tColor;
+	}
+
+	/** @brief returns the width of the inputs */
+	int getWidth() const { return mImages[ 0 ]->getWidth(); }
+
+	/** @brief returns the height of the inputs */
+	int getHeight() const { return mImages[ 0 ]->getHeight(); }
+
+private:
+	const std::vector<const ci::Surface32f*>&	mImages;
+	const std::vector<FilterPass>&				mPasses;
+	const std::vector<size_t>&					mPre;
+};
+
+/** @brief a multi-pass image filter graph */
+class FilterGraph {
+public:
+	/** @brief default constructor */
+	FilterGraph() : mCompiled( false ), mSlotCount( 0 ) {}
+
+	/** @brief adds a pass to the graph (passes must be added in dependency order) */
+	void addPass(const FilterPass& iPass)
+	{
+		mPasses.push_back( iPass );
+		mCompiled = false;
+	}
+
+	/** @brief sets the image that the graph produces (defaults to the last pass's output) */
+	void setOutput(const std::string& iOutput)
+	{
+		mOutput = iOutput;
+		mCompiled = false;
+	}
+
+	/** @brief removes all passes */
+	void clear()
+	{
+		mPasses.clear();
+		mKernels.clear();
+		mOutput.clear();
+		mCompiled = false;
+		mSlotCount = 0;
+	}
+
+	/** @brief fuses passes, assigns pool slots and generates shaders */
+	void compile()
+	{
+		if( mCompiled ) { return; }
+		if( mPasses.empty() ) { throw FilterGraphExc( "Filter graph has no passes" ); }
+
+		std::string tOutput = ( mOutput.empty() ) ? ( mPasses.back().mOutput ) : ( mOutput );
+
+		// Validate dependencies and count the readers of each image:
+		std::map<std::string, size_t> tReaders;
+		std::map<std::string, bool>   tWritten;
+		tWritten[ kFilterSource ] = true;
+		for(std::vector<FilterPass>::const_iterator it = mPasses.begin(); it != mPasses.end(); it++) {
+			if( (*it).mInputs.empty() ) {
+				throw FilterGraphExc( "Pass '" + (*it).mName + "' has no inputs" );
+			}
+			if( (*it).mKind == FilterPass::POINTWISE && (*it).mInputs.size() != 1 ) {
+				throw FilterGraphExc( "Point-wise pass '" + (*it).mName + "' must have exactly one input" );
+			}
+			for(std::vector<std::string>::const_iterator in = (*it).mInputs.begin(); in != (*it).mInputs.end(); in++) {
+				if( !tWritten[ *in ] ) {
+					throw FilterGraphExc( "Pass '" + (*it).mName + "' reads '" + *in + "' before it is written" );
+				}
+				tReaders[ *in ]++;
+			}
+			if( tWritten[ (*it).mOutput ] ) {
+				throw FilterGraphExc( "Image '" + (*it).mOutput + "' is written more than once" );
+			}
+			tWritten[ (*it).mOutput ] = true;
+		}
+		if( !tWritten[ tOutput ] || tOutput == kFilterSource ) {
+			throw FilterGraphExc( "Graph output '" + tOutput + "' is not written by any pass" );
+		}
+
+		// Fuse passes into kernels:
+		mKernels.clear();
+		std::map<std::string, size_t> tProducer;
+		for(size_t i = 0; i < mPasses.size(); i++) {
+			const FilterPass& tPass = mPasses[ i ];
+
+			// A single-input pass can join the kernel that produces its input,
+			// provided nobody else needs that intermediate image:
+			bool tFused = false;
+			if( tPass.mInputs.size() == 1 && tPass.mInputs[ 0 ] != kFilterSource &&
+			    tPass.mInputs[ 0 ] != tOutput && tReaders[ tPass.mInputs[ 0 ] ] == 1 ) {
+				FilterKernel& tKernel = mKernels[ tProducer[ tPass.mInputs[ 0 ] ] ];
+				if( tPass.mKind == FilterPass::POINTWISE ) {
+					if( tKernel.mSampler < 0 ) { tKernel.mPre.push_back( i ); }
+					else                       { tKernel.mPost.push_back( i ); }
+					tFused = true;
+				}
+				else if( tKernel.mSampler < 0 && tKernel.mInputs.size() == 1 ) {
+					tKernel.mSampler = static_cast<int>( i );
+					tFused = true;
+				}
+				if( tFused ) {
+					tKernel.mOutput = tPass.mOutput;
+					tProducer[ tPass.mOutput ] = tProducer[ tPass.mInputs[ 0 ] ];
+				}
+			}
+
+			// Otherwise, start a new kernel:
+			if( !tFused ) {
+				FilterKernel tKernel;
+				tKernel.mInputs = tPass.mInputs;
+				tKernel.mOutput = tPass.mOutput;
+				if( tPass.mKind == FilterPass::POINTWISE ) { tKernel.mPre.push_back( i ); }
+				else                                       { tKernel.mSampler = static_cast<int>( i ); }
+				tProducer[ tPass.mOutput ] = mKernels.size();
+				mKernels.push_back( tKernel );
+			}
+		}
+
+		// Find the last kernel to read each image:
+		std::map<std::string, size_t> tLastUse;
+		for(size_t k = 0; k < mKernels.size(); k++) {
+			for(std::vector<std::string>::const_iterator in = mKernels[ k ].mInputs.begin(); in != mKernels[ k ].mInputs.end(); in++) {
+				tLastUse[ *in ] = k;
+			}
+		}
+
+		// Assign pool slots, recycling a slot once its image has been read for the last time:
+		std::map<std::string, size_t> tSlotOf;
+		std::vector<size_t> tFree;
+		mSlotCount = 0;
+		for(size_t k = 0; k < mKernels.size(); k++) {
+			FilterKernel& tKernel = mKernels[ k ];
+			// Acquire output slot before releasing inputs, so a kernel never reads and writes the same target:
+			if( tFree.empty() ) {
+				tKernel.mOutputSlot = mSlotCount++;
+			}
+			else {
+				tKernel.mOutputSlot = tFree.back();
+				tFree.pop_back();
+			}
+			tSlotOf[ tKernel.mOutput ] = tKernel.mOutputSlot;
+
+			tKernel.mInputSlots.clear();
+			for(std::vector<std::string>::const_iterator in = tKernel.mInputs.begin(); in != tKernel.mInputs.end(); in++) {
+				tKernel.mInputSlots.push_back( ( *in == kFilterSource ) ? ( -1 ) : ( static_cast<int>( tSlotOf[ *in ] ) ) );
+			}
+			for(std::vector<std::string>::const_iterator in = tKernel.mInputs.begin(); in != tKernel.mInputs.end(); in++) {
+				if( *in != kFilterSource && *in != tOutput && tLastUse[ *in ] == k &&
+				    std::find( tFree.begin(), tFree.end(), tSlotOf[ *in ] ) == tFree.end() ) {
+					tFree.push_back( tSlotOf[ *in ] );
+				}
+			}
+
+			tKernel.mFrag = generateFrag( tKernel );
+		}
+
+		mOutput   = tOutput;
+		mCompiled = true;
+	}
+
+	/** @brief runs the compiled graph on the cpu */
+	ci::Surface32f runCpu(const ci::Surface32f& iSource)
+	{
+		compile();
+
+		int tWidth  = iSource.getWidth();
+		int tHeight = iSource.getHeight();
+
+		// Allocate one image per pool slot:
+		std::vector<ci::Surface32f> tSlots;
+		for(size_t i = 0; i < mSlotCount; i++) {
+			tSlots.push_back( ci::Surface32f( tWidth, tHeight, true ) );
+		}
+
+		size_t tResultSlot = 0;
+		for(std::vector<FilterKernel>::const_iterator it = mKernels.begin(); it != mKernels.end(); it++) {
+			// Gather inputs:
+			std::vector<const ci::Surface32f*> tImages;
+			for(std::vector<int>::const_iterator in = (*it).mInputSlots.begin(); in != (*it).mInputSlots.end(); in++) {
+				tImages.push_back( ( *in < 0 ) ? ( &iSource ) : ( &tSlots[ *in ] ) );
+			}
+			FilterCpuInputs tInputs( tImages, mPasses, (*it).mPre );
+
+			// Evaluate kernel for each pixel:
+			ci::Surface32f& tTarget = tSlots[ (*it).mOutputSlot ];
+			for(int y = 0; y < tHeight; y++) {
+				for(int x = 0; x < tWidth; x++) {
+					ci::ColorA tColor = ( (*it).mSampler < 0 ) ? ( tInputs.read( 0, x, y ) ) : ( mPasses[ (*it).mSampler ].mCpuSample( tInputs, x, y ) );
+					for(std::vector<size_t>::const_iterator p = (*it).mPost.begin(); p != (*it).mPost.end(); p++) {
+						tColor = mPasses[ *p ].mCpuPoint( tColor );
+					}
+					tTarget.setPixel( ci::Vec2i( x, y ), tColor );
+				}
+			}
+
+			if( (*it).mOutput == mOutput ) { tResultSlot = (*it).mOutputSlot; }
+		}
+
+		return tSlots[ tResultSlot ];
+	}
+
+	/** @brief returns the number of passes */
+	size_t getPassCount() const { return mPasses.size(); }
+
+	/** @brief returns the compiled kernels */
+	const std::vector<FilterKernel>& getKernels() { compile(); return mKernels; }
+
+	/** @brief returns the number of render targets needed by the compiled graph */
+	size_t getSlotCount() { compile(); return mSlotCount; }
+
+	/** @brief returns the name of the graph's output image */
+	const std::string& getOutput() { compile(); return mOutput; }
+
+	/** @brief returns the pass with the given index */
+	const FilterPass& getPass(const size_t& iIndex) const { return mPasses[ iIndex ]; }
+
+private:
+	/** @brief generates the fragment shader for a kernel */
+	std::string generateFrag(const FilterKernel& iKernel) const
+	{
+		std::stringstream ss;
+
+		// Uniforms:
+		for(size_t i = 0; i < iKernel.mInputs.size(); i++) {
+			ss << "uniform sampler2D mInput" << i << ";" << std::endl;
+		}
+		ss << "uniform vec2 mTexelSize;" << std::endl;
+
+		// Point-wise pass functions:
+		std::vector<size_t> tPointwise( iKernel.mPre );
+		tPointwise.insert( tPointwise.end(), iKernel.mPost.begin(), iKernel.mPost.end() );
+		for(std::vector<size_t>::const_iterator it = tPointwise.begin(); it != tPointwise.end(); it++) {
+			ss << "vec4 pass_" << mPasses[ *it ].mName << "(vec4 c) {" << std::endl;
+			ss << "\t" << mPasses[ *it ].mGlsl << std::endl;
+			ss << "}" << std::endl;
+		}
+
+		// Input readers (fused point-wise passes are applied to every read of input 0):
+		for(size_t i = 0; i < iKernel.mInputs.size(); i++) {
+			ss << "vec4 readInput" << i << "(vec2 uv) {" << std::endl;
+			ss << "\tvec4 c = texture2D( mInput" << i << ", uv );" << std::endl;
+			if( i == 0 ) {
+				for(std::vector<size_t>::const_iterator it = iKernel.mPre.begin(); it != iKernel.mPre.end(); it++) {
+					ss << "\tc = pass_" << mPasses[ *it ].mName << "( c );" << std::endl;
+				}
+			}
+			ss << "\treturn c;" << std::endl;
+			ss << "}" << std::endl;
+		}
+
+		// Sampling pass function:
+		if( iKernel.mSampler >= 0 ) {
+			ss << mPasses[ iKernel.mSampler ].mGlslHelpers;
+			ss << "vec4 pass_" << mPasses[ iKernel.mSampler ].mName << "(vec2 uv) {" << std::endl;
+			ss << "\t" << mPasses[ iKernel.mSampler ].mGlsl << std::endl;
+			ss << "}" << std::endl;
+		}
+
+		// Entry point:
+		ss << "void main() {" << std::endl;
+		ss << "\tvec2 uv = gl_TexCoord[0].xy;" << std::endl;
+		if( iKernel.mSampler >= 0 ) {
+			ss << "\tvec4 c = pass_" << mPasses[ iKernel.mSampler ].mName << "( uv );" << std::endl;
+		}
+		else {
+			ss << "\tvec4 c = readInput0( uv );" << std::endl;
+		}
+		for(std::vector<size_t>::const_iterator it = iKernel.mPost.begin(); it != iKernel.mPost.end(); it++) {
+			ss << "\tc = pass_" << mPasses[ *it ].mName << "( c );" << std::endl;
+		}
+		ss << "\tgl_FragColor = c;" << std::endl;
+		ss << "}" << std::endl;
+
+		return ss.str();
+	}
+
+	std::vector<FilterPass>		mPasses;
+	std::vector<FilterKernel>	mKernels;
+	std::string					mOutput;
+	bool						mCompiled;
+	size_t						mSlotCount;
+};
+
+/** @brief a pool of framebuffers indexed by slot */
+class FilterFboPool {
+public:
+	/** @brief default constructor */
+	FilterFboPool() : mColorFormat( GL_RGBA8 ), mAllocations( 0 ) {}
+
+	/** @brief sets the internal format of the pool's color buffers (e.g. GL_RGBA32F_ARB) */
+	void setColorFormat(const GLint& iFormat)
+	{
+		if( iFormat == mColorFormat ) { return; }
+		mColorFormat = iFormat;
+		mFbos.clear();
+	}
+
+	/** @brief returns the framebuffer for the given slot, (re)allocating it if needed */
+	ci::gl::Fbo& acquire(const size_t& iSlot, const int& iWidth, const int& iHeight)
+	{
+		if( iSlot >= mFbos.size() ) { mFbos.resize( iSlot + 1 ); }
+		ci::gl::Fbo& tFbo = mFbos[ iSlot ];
+		if( !tFbo || tFbo.getWidth() != iWidth || tFbo.getHeight() != iHeight ) {
+			ci::gl::Fbo::Format tFormat;
+			tFormat.enableDepthBuffer( false );
+			tFormat.setColorInternalFormat( mColorFormat );
+			tFbo = ci::gl::Fbo( iWidth, iHeight, tFormat );
+			mAllocations++;
+		}
+		return tFbo;
+	}
+
+	/** @brief returns the number of framebuffers held by the pool */
+	size_t getSize() const { return mFbos.size(); }
+
+	/** @brief returns the number of framebuffer allocations made so far */
+	size_t getAllocationCount() const { return mAllocations; }
+
+private:
+	std::vector<ci::gl::Fbo>	mFbos;
+	GLint						mColorFormat;
+	size_t						mAllocations;
+};
+
+/** @brief runs a filter graph on the gpu */
+class FilterGraphGl {
+public:
+	/** @brief sets the graph and generates its shaders (if any shader fails to compile, the previous graph is kept) */
+	void setGraph(const FilterGraph& iGraph)
+	{
+		// Compile every kernel before replacing anything, so a compile error can't leave the graph and its shaders out of step:
+		FilterGraph tGraph = iGraph;
+		std::vector<ci::gl::GlslProgRef> tShaders;
+		const std::vector<FilterKernel>& tKernels = tGraph.getKernels();
+		for(std::vector<FilterKernel>::const_iterator it = tKernels.begin(); it != tKernels.end(); it++) {
+			tShaders.push_back( ci::gl::GlslProg::create( getVertGlsl(), (*it).mFrag.c_str() ) );
+		}
+		mGraph = tGraph;
+		mShaders.swap( tShaders );
+	}
+
+	/** @brief runs the graph on the given source texture and returns the output texture */
+	ci::gl::Texture run(const ci::gl::Texture& iSource)
+	{
+		int tWidth  = iSource.getWidth();
+		int tHeight = iSource.getHeight();
+		const std::vector<FilterKernel>& tKernels = mGraph.getKernels();
+		ci::gl::Texture tResult;
+
+		// Save state:
+		ci::gl::SaveFramebufferBinding tSaveFbo;
+		glPushAttrib( GL_VIEWPORT_BIT );
+		ci::gl::pushMatrices();
+
+		for(size_t k = 0; k < tKernels.size(); k++) {
+			const FilterKernel& tKernel = tKernels[ k ];
+
+			// Bind target:
+			ci::gl::Fbo& tTarget = mPool.acquire( tKernel.mOutputSlot, tWidth, tHeight );
+			tTarget.bindFramebuffer();
+			ci::gl::setViewport( tTarget.getBounds() );
+			ci::gl::setMatricesWindow( tTarget.getSize(), false );
+
+			// Bind inputs:
+			for(size_t i = 0; i < tKernel.mInputSlots.size(); i++) {
+				int tSlot = tKernel.mInputSlots[ i ];
+				if( tSlot < 0 ) { iSource.bind( i ); }
+				else            { mPool.acquire( tSlot, tWidth, tHeight ).bindTexture( i ); }
+			}
+
+			// Bind shader and draw:
+			ci::gl::GlslProgRef& tShader = mShaders[ k ];
+			tShader->bind();
+			for(size_t i = 0; i < tKernel.mInputSlots.size(); i++) {
+				std::stringstream ss;
+				ss << "mInput" << i;
+				tShader->uniform( ss.str(), static_cast<int>( i ) );
+			}
+			tShader->uniform( "mTexelSize", ci::Vec2f( 1.0f / tWidth, 1.0f / tHeight ) );
+			ci::gl::drawSolidRect( tTarget.getBounds() );
+			tShader->unbind();
+
+			// Unbind inputs:
+			for(size_t i = 0; i < tKernel.mInputSlots.size(); i++) {
+				glActiveTexture( GL_TEXTURE0 + i );
+				glBindTexture( GL_TEXTURE_2D, 0 );
+			}
+			glActiveTexture( GL_TEXTURE0 );
+
+			tTarget.unbindFramebuffer();
+
+			if( tKernel.mOutput == mGraph.getOutput() ) { tResult = tTarget.getTexture(); }
+		}
+
+		// Restore state:
+		ci::gl::popMatrices();
+		glPopAttrib();
+
+		return tResult;
+	}
+
+	/** @brief sets the internal format of intermediate render targets (defaults to GL_RGBA8) */
+	void setColorFormat(const GLint& iFormat) { mPool.setColorFormat( iFormat ); }
+
+	/** @brief returns the graph */
+	FilterGraph& getGraph() { return mGraph; }
+
+	/** @brief returns the framebuffer pool */
+	const FilterFboPool& getPool() const { return mPool; }
+
+private:
+	/** @brief returns the pass-through vertex shader shared by all kernels */
+	static const char* getVertGlsl()
+	{
+		return
+		"void main() {\n"
+		"\tgl_FrontColor = gl_Color;\n"
+		"\tgl_TexCoord[0] = gl_MultiTexCoord0;\n"
+		"\tgl_Position = ftransform();\n"
+		"}\n";
+	}
+
+	FilterGraph							mGraph;
+	FilterFboPool						mPool;
+	std::vector<ci::gl::GlslProgRef>	mShaders;
+};
+
+/** @brief creates a point-wise pass that inverts the color channels */
+static FilterPass createInvertPass(const std::string& iName, const std::string& iInput, const std::string& iOutput)
+{
+	FilterPass tPass;
+	tPass.mName		= iName;
+	tPass.mKind		= FilterPass::POINTWISE;
+	tPass.mInputs.push_back( iInput );
+	tPass.mOutput	= iOutput;
+	tPass.mGlsl		= "return vec4( vec3( 1.0 ) - c.rgb, c.a );";
+	tPass.mCpuPoint	= [] (const ci::ColorA& c) { return ci::ColorA( 1.0f - c.r, 1.0f - c.g, 1.0f - c.b, c.a ); };
+	return tPass;
+}
+
+/** @brief creates a sampling pass that convolves its input with a 3x3 kernel */
+static FilterPass createConvolutionPass(const std::string& iName, const std::string& iInput, const std::string& iOutput, const float* iKernel)
+{
+	std::vector<float> tKernel( iKernel, iKernel + 9 );
+
+	// Bake the kernel weights into the shader source:
+	std::stringstream ss;
+	ss << "vec4 tSum = vec4( 0.0 );";
+	for(int i = 0; i < 9; i++) {
+		if( tKernel[ i ] == 0.0f ) { continue; }
+		ss << " tSum += readInput0( uv + vec2( " << ( i % 3 - 1 ) << ".0, " << ( i / 3 - 1 ) << ".0 ) * mTexelSize ) * " << std::showpoint << tKernel[ i ] << ";";
+	}
+	ss << " return tSum;";
+
+	FilterPass tPass;
+	tPass.mName		= iName;
+	tPass.mKind		= FilterPass::SAMPLER;
+	tPass.mInputs.push_back( iInput );
+	tPass.mOutput	= iOutput;
+	tPass.mGlsl		= ss.str();
+	tPass.mCpuSample = [tKernel] (const FilterCpuInputs& iIn, int x, int y) {
+		ci::ColorA tSum( 0.0f, 0.0f, 0.0f, 0.0f );
+		for(int i = 0; i < 9; i++) {
+			if( tKernel[ i ] == 0.0f ) { continue; }
+			tSum += iIn.read( 0, x + i % 3 - 1, y + i / 3 - 1 ) * tKernel[ i ];
+		}
+		return tSum;
+	};
+	return tPass;
+}
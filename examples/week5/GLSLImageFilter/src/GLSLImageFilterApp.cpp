@@ -10,77 +10,113 @@
 #include "cinder/gl/gl.h"
 #include "cinder/gl/Texture.h"
 #include "cinder/gl/GlslProg.h"
-#include "cinder/Capture.h"
+
+#include "FilterGraph.h"
+#include "ThreadedFrameSource.h"
+#include "TextureUploadRing.h"
 
 using namespace ci;
 using namespace ci::app;
 using namespace std;
 
-#define STRINGIFY(x) #x
-
-static const string kVertGlsl =
-STRINGIFY(
-		  // Pass-through vertex shader:
-		  void main()
-		  {
-			  gl_FrontColor = gl_Color;
-			  gl_TexCoord[0] = gl_MultiTexCoord0;
-			  gl_Position = ftransform();
-		  }
-		  );
-
-static const string kFragGlsl =
-STRINGIFY(
-		  uniform sampler2D mTexture;
-		  
-		  void main()
-		  {
-			  // Get texture coordinate:
-			  vec2 tCoord  = gl_TexCoord[0].xy;
-			  // Get color value for current texture coordinate:
-			  vec4 tColor  = texture2D( mTexture, tCoord );
-			  // Flip color:
-			  tColor.rgb   = vec3( 1.0 ) - tColor.rgb;
-			  // Set final color:
-			  gl_FragColor = tColor;
-		  }
-		  );
+// Box blur filter:
+static const float kBlurKernel[] =
+{
+	1.0/9.0, 1.0/9.0, 1.0/9.0,
+	1.0/9.0, 1.0/9.0, 1.0/9.0,
+	1.0/9.0, 1.0/9.0, 1.0/9.0
+};
 
 class GLSLImageFilterApp : public AppNative {
 public:
 	void setup();
 	void mouseDown(MouseEvent event);
+	void keyUp(KeyEvent event);
 	void update();
 	void draw();
 	
-	CaptureRef			mCapture;
+	void buildGraph();
+	void printStats();
+	
+	ThreadedFrameSourceRef	mSource;
 	gl::TextureRef		mTexture;
-	gl::GlslProg		mShader;
+	TextureUploadRing	mUploadRing;
+	bool				mUploaded;	//!< a new frame was uploaded and hasn't been drawn yet
+	FilterGraphGl		mFilter;
+	bool				mBlur;
 };
 
 void GLSLImageFilterApp::setup()
 {
-	// Load shader from strings (using the stringify macro):
-	mShader = gl::GlslProg( kVertGlsl.c_str(), kFragGlsl.c_str() );
+	// Open camera capture (or a stand-in when no camera is available, see FrameSource.h)
+	// and run it on a worker thread (see ThreadedFrameSource.h):
+	mSource = ThreadedFrameSource::create( createDefaultFrameSource( 640, 480 ) );
+	mUploaded = false;
+	mSource->start();
 	
-	// Try to load camera capture:
-	try {
-		mCapture = Capture::create( 640, 480 );
-		mCapture->start();
-	}
-	catch(...) {
-		cout << "Failed to initialize capture" << endl;
-	}
+	// Build the initial filter graph:
+	mBlur = false;
+	buildGraph();
 }
 
 void GLSLImageFilterApp::mouseDown(MouseEvent event)
 {
+	// Toggle the blur pass:
+	mBlur = !mBlur;
+	buildGraph();
+}
+
+void GLSLImageFilterApp::keyUp(KeyEvent event)
+{
+	if( event.getChar() == 's' ) {
+		printStats();
+	}
+}
+
+void GLSLImageFilterApp::printStats()
+{
+	const TextureUploadRing::Stats& tFrame = mUploadRing.getFrameStats();
+	const TextureUploadRing::Stats& tTotal = mUploadRing.getTotalStats();
+	ThreadedFrameSource::Stats tCapture = mSource->getStats();
+	cout << "Uploads this frame: " << tFrame.mUploads << " (" << tFrame.mBytesUploaded << " bytes, " << tFrame.mTextureAllocations << " allocations)" << endl;
+	cout << "Uploads in total: " << tTotal.mUploads << " (" << tTotal.mBytesUploaded << " bytes, " << tTotal.mTextureAllocations << " allocations)" << endl;
+	cout << "Frames captured: " << tCapture.mCaptured << ", delivered: " << tCapture.mDelivered << ", dropped: " << tCapture.mDropped << endl;
+	cout << "Capture to update latency: " << tCapture.mCaptureLatency * 1000.0 << " ms" << endl;
+	cout << "Capture to draw latency: " << tCapture.mPhotonLatency * 1000.0 << " ms (average " << tCapture.mAveragePhotonLatency * 1000.0 << " ms)" << endl;
+}
+
+void GLSLImageFilterApp::buildGraph()
+{
+	// The invert pass flips each color (see createInvertPass() in FilterGraph.h).
+	// When the blur pass is added, the graph fuses both into a single shader.
+	FilterGraph tGraph;
+	tGraph.addPass( createInvertPass( "invert", kFilterSource, "inverted" ) );
+	if( mBlur ) {
+		tGraph.addPass( createConvolutionPass( "blur", "inverted", "blurred", kBlurKernel ) );
+	}
+	
+	try {
+		mFilter.setGraph( tGraph );
+	}
+	catch( gl::GlslProgCompileExc &exc ) {
+		cout << "Shader compile error: " << endl;
+		cout << exc.what();
+	}
+	catch( FilterGraphExc &exc ) {
+		cout << "Filter graph error: " << exc.what() << endl;
+	}
 }
 
 void GLSLImageFilterApp::update()
 {
-	if( mCapture && mCapture->checkNewFrame() ) {
-		mTexture = gl::Texture::create( mCapture->getSurface() );
+	// Reset per-frame upload counters:
+	mUploadRing.resetFrameStats();
+	
+	if( mSource->checkNewFrame() ) {
+		// Update the next texture of the ring in place (no per-frame allocation):
+		mUploadRing.upload( mSource->getSurface() );
+		mTexture = mUploadRing.getTexture();
+		mUploaded = mUploaded || ( mUploadRing.getFrameStats().mUploads > 0 );
 	}
 }
 
@@ -89,35 +125,28 @@ void GLSLImageFilterApp::draw()
 	// Clear window:
 	gl::clear( Color( 0, 0, 0 ) );
 	
-	// Set matrices from window size:
-	gl::setMatricesWindow( getWindowSize() );
-	
-	// Set color:
-	gl::color( 1.0, 1.0, 1.0 );
-	
 	// Check whether texture has been initialized:
 	if( mTexture ) {
-		// Draw texture (using traditional approach):
-		//gl::draw( mTexture, getWindowBounds() );
-		
-		// Bind texture:
-		mTexture->bind( 0 );
+		// Run the filter graph into an offscreen framebuffer:
+		gl::Texture tFiltered = mFilter.run( *mTexture );
 		
-		// Bind shader:
-		mShader.bind();
+		// Set matrices from window size:
+		gl::setMatricesWindow( getWindowSize() );
 		
-		// Set shader uniform for texture id:
-		mShader.uniform( "mTexture", 0 );
+		// Set color:
+		gl::color( 1.0, 1.0, 1.0 );
 		
-		// Draw a solid rectangle:
-		// (The shader will be drawn onto the rect surface)
+		// Draw the filtered texture onto a solid rectangle:
+		tFiltered.enableAndBind();
 		gl::drawSolidRect( getWindowBounds() );
+		tFiltered.unbind();
+		tFiltered.disable();
 		
-		// Unbind shader:
-		mShader.unbind();
-		
-		// Unbind texture:
-		mTexture->unbind();
+		// Record capture-to-draw latency (once per uploaded frame, not on every redraw):
+		if( mUploaded ) {
+			mSource->markPresented();
+			mUploaded = false;
+		}
 	}
 }
 
@@ -0,0 +1,181 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "cinder/Surface.h"
+#include "cinder/gl/gl.h"
+#include "cinder/gl/Texture.h"
+#include "cinder/gl/Vbo.h"
+
+// Calling gl::Texture::create( surface ) for every camera frame allocates a new
+// texture object (and its storage) 30-60 times per second, then throws the old
+// one away. Instead, we can allocate a few textures once and update their
+// pixels in place with glTexSubImage2D.
+//
+// The pixels are staged through a pixel buffer object (PBO). Once the frame has
+// been copied into the mapped PBO, glTexSubImage2D reads from the buffer rather
+// than from our memory, so the call returns immediately and the driver performs
+// the actual transfer in the background.
+//
+// We cycle through several texture/PBO pairs so that we never write into a
+// texture (or buffer) that the GPU may still be reading from the previous frame.
+
+/** @brief a ring of persistent textures updated in place through pixel buffer objects */
+class TextureUploadRing {
+public:
+	/** @brief upload counters */
+	struct Stats
+	{
+		size_t	mTextureAllocations;	//!< textures allocated
+		size_t	mBufferAllocations;		//!< pixel buffer (re)allocations
+		size_t	mUploads;				//!< frames uploaded
+		size_t	mBytesUploaded;			//!< bytes copied into pixel buffers
+
+		/** @brief default constructor */
+		Stats() : mTextureAllocations( 0 ), mBufferAllocations( 0 ), mUploads( 0 ), mBytesUploaded( 0 ) {}
+	};
+
+	/** @brief basic constructor */
+	TextureUploadRing(const size_t& iRingSize = 3) : mRingSize( std::max<size_t>( iRingSize, 1 ) ), mIndex( 0 ), mWidth( 0 ), mHeight( 0 ), mBufferSize( 0 ) {}
+
+	/** @brief copies the surface into the next texture of the ring */
+	void upload(const ci::Surface8u& iSurface)
+	{
+		// Ignore empty frames (nothing to copy, and nothing to size the ring by):
+		if( !iSurface || iSurface.getWidth() == 0 || iSurface.getHeight() == 0 ) { return; }
+
+		int tWidth  = iSurface.getWidth();
+		int tHeight = iSurface.getHeight();
+
+		// (Re)allocate the ring when the frame dimension changes:
+		if( tWidth != mWidth || tHeight != mHeight ) {
+			allocate( tWidth, tHeight );
+		}
+
+		// Advance to the next slot:
+		mIndex = ( mIndex + 1 ) % mRingSize;
+		ci::gl::Vbo& tBuffer = mBuffers[ mIndex ];
+
+		// Orphan the buffer's previous storage (so we don't wait for pending transfers) and map it:
+		tBuffer.bind();
+		tBuffer.bufferData( mBufferSize, NULL, GL_STREAM_DRAW );
+		uint8_t* tDst = tBuffer.map( GL_WRITE_ONLY );
+		if( tDst ) {
+			copyPixels( iSurface, tDst );
+			tBuffer.unmap();
+
+			// Update the texture from the bound pixel buffer (offset 0):
+			ci::gl::TextureRef& tTexture = mTextures[ mIndex ];
+			tTexture->bind();
+			glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+			glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, tWidth, tHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0 );
+			tTexture->unbind();
+
+			mLatest = tTexture;
+
+			// Update counters:
+			mFrameStats.mUploads++;
+			mFrameStats.mBytesUploaded += mBufferSize;
+			mTotalStats.mUploads++;
+			mTotalStats.mBytesUploaded += mBufferSize;
+		}
+		tBuffer.unbind();
+	}
+
+	/** @brief returns the most recently uploaded texture (null before the first upload) */
+	const ci::gl::TextureRef& getTexture() const { return mLatest; }
+
+	/** @brief returns the counters accumulated since the last call to resetFrameStats() */
+	const Stats& getFrameStats() const { return mFrameStats; }
+
+	/** @brief returns the counters accumulated since construction */
+	const Stats& getTotalStats() const { return mTotalStats; }
+
+	/** @brief resets the per-frame counters (call once per frame) */
+	void resetFrameStats() { mFrameStats = Stats(); }
+
+private:
+	/** @brief allocates the ring's textures and pixel buffers */
+	void allocate(const int& iWidth, const int& iHeight)
+	{
+		mWidth      = iWidth;
+		mHeight     = iHeight;
+		mBufferSize = static_cast<size_t>( iWidth ) * iHeight * 4;
+
+		ci::gl::Texture::Format tFormat;
+		tFormat.setInternalFormat( GL_RGBA );
+
+		mTextures.clear();
+		mBuffers.clear();
+		for(size_t i = 0; i < mRingSize; i++) {
+			mTextures.push_back( ci::gl::Texture::create( iWidth, iHeight, tFormat ) );
+			mBuffers.push_back( ci::gl::Vbo( GL_PIXEL_UNPACK_BUFFER ) );
+			// Allocate buffer storage up front:
+			mBuffers.back().bind();
+			mBuffers.back().bufferData( mBufferSize, NULL, GL_STREAM_DRAW );
+			mBuffers.back().unbind();
+		}
+		mLatest.reset();
+
+		// Update counters:
+		mFrameStats.mTextureAllocations += mRingSize;
+		mFrameStats.mBufferAllocations  += mRingSize;
+		mTotalStats.mTextureAllocations += mRingSize;
+		mTotalStats.mBufferAllocations  += mRingSize;
+	}
+
+	/** @brief copies the surface into a tightly packed RGBA destination */
+	void copyPixels(const ci::Surface8u& iSurface, uint8_t* oDst) const
+	{
+		const ci::SurfaceChannelOrder& tOrder = iSurface.getChannelOrder();
+		size_t tRowLength = static_cast<size_t>( mWidth ) * 4;
+
+		// Fast path: rows are already RGBA, so we can copy them directly:
+		if( tOrder.getCode() == ci::SurfaceChannelOrder::RGBA ) {
+			for(int y = 0; y < mHeight; y++) {
+				memcpy( oDst + y * tRowLength, iSurface.getData() + y * iSurface.getRowBytes(), tRowLength );
+			}
+			return;
+		}
+
+		// General path: reorder channels (e.g. BGRA or RGB camera frames):
+		uint8_t tInc   = iSurface.getPixelInc();
+		int8_t  tRed   = tOrder.getRedOffset();
+		int8_t  tGreen = tOrder.getGreenOffset();
+		int8_t  tBlue  = tOrder.getBlueOffset();
+		int8_t  tAlpha = tOrder.getAlphaOffset();
+		for(int y = 0; y < mHeight; y++) {
+			const uint8_t* tSrc = iSurface.getData() + y * iSurface.getRowBytes();
+			uint8_t*       tRow = oDst + y * tRowLength;
+			for(int x = 0; x < mWidth; x++) {
+				tRow[ 0 ] = tSrc[ tRed ];
+				tRow[ 1 ] = tSrc[ tGreen ];
+				tRow[ 2 ] = tSrc[ tBlue ];
+				tRow[ 3 ] = ( tAlpha >= 0 ) ? ( tSrc[ tAlpha ] ) : ( 255 );
+				tSrc += tInc;
+				tRow += 4;
+			}
+		}
+	}
+
+	size_t							mRingSize;
+	size_t							mIndex;
+	int								mWidth;
+	int								mHeight;
+	size_t							mBufferSize;
+	std::vector<ci::gl::TextureRef>	mTextures;
+	std::vector<ci::gl::Vbo>		mBuffers;
+	ci::gl::TextureRef				mLatest;
+	Stats							mFrameStats;
+	Stats							mTotalStats;
+};
@@ -0,0 +1,441 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined( CINDER_MSW )
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "cinder/Capture.h"
+#include "cinder/DataSource.h"
+#include "cinder/Filesystem.h"
+#include "cinder/ImageIo.h"
+#include "cinder/Surface.h"
+
+// The capture examples are driven by a camera. Without one (for example, on a
+// server), they have nothing to filter. A FrameSource hides where frames come
+// from, so the same filter pipeline can be fed by:
+//
+//   CaptureFrameSource   - a live camera (ci::Capture)
+//   RawFrameSource       - a single file of raw RGBA frames stored back to back
+//   ImageSequenceSource  - a directory of images (e.g. PNG), played in name order
+//   PatternFrameSource   - synthetic test patterns computed per frame
+//
+// File-backed sources read through memory-mapped files, so the operating system
+// pages frames in on demand rather than us reading whole files into memory.
+//
+// Every source except the camera delivers frames at a configurable rate.
+// A rate of zero delivers a new frame on every checkNewFrame() call, which
+// makes load tests deterministic (and as fast as the pipeline allows).
+
+/** @brief a read-only memory-mapped file */
+class MappedFile {
+public:
+	/** @brief maps the file at the given path */
+	MappedFile(const std::string& iPath) : mData( NULL ), mSize( 0 )
+	{
+#if defined( CINDER_MSW )
+		mMapping = NULL;
+		mFile = CreateFileA( iPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+		if( mFile == INVALID_HANDLE_VALUE ) { return; }
+		LARGE_INTEGER tSize;
+		GetFileSizeEx( mFile, &tSize );
+		mSize = static_cast<size_t>( tSize.QuadPart );
+		mMapping = CreateFileMappingA( mFile, NULL, PAGE_READONLY, 0, 0, NULL );
+		if( mMapping ) {
+			mData = static_cast<const uint8_t*>( MapViewOfFile( mMapping, FILE_MAP_READ, 0, 0, 0 ) );
+		}
+#else
+		int tFile = open( iPath.c_str(), O_RDONLY );
+		if( tFile < 0 ) { return; }
+		struct stat tStat;
+		if( fstat( tFile, &tStat ) == 0 && tStat.st_size > 0 ) {
+			void* tData = mmap( NULL, tStat.st_size, PROT_READ, MAP_PRIVATE, tFile, 0 );
+			if( tData != MAP_FAILED ) {
+				mData = static_cast<const uint8_t*>( tData );
+				mSize = static_cast<size_t>( tStat.st_size );
+			}
+		}
+		// The mapping stays valid after the descriptor is closed:
+		close( tFile );
+#endif
+	}
+
+	/** @brief unmaps the file */
+	~MappedFile()
+	{
+#if defined( CINDER_MSW )
+		if( mData ) { UnmapViewOfFile( mData ); }
+		if( mMapping ) { CloseHandle( mMapping ); }
+		if( mFile != INVALID_HANDLE_VALUE ) { CloseHandle( mFile ); }
+#else
+		if( mData ) { munmap( const_cast<uint8_t*>( mData ), mSize ); }
+#endif
+	}
+
+	/** @brief returns the mapped bytes (or null if the file could not be mapped) */
+	const uint8_t* getData() const { return mData; }
+
+	/** @brief returns the size of the file in bytes */
+	size_t getSize() const { return mSize; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const uint8_t*	mData;
+	size_t			mSize;
+#if defined( CINDER_MSW )
+	HANDLE			mFile;
+	HANDLE			mMapping;
+#endif
+};
+
+class FrameSource;
+typedef std::shared_ptr<FrameSource> FrameSourceRef;
+
+/** @brief an abstract source of video frames */
+class FrameSource {
+public:
+	/** @brief default constructor */
+	FrameSource() : mRate( 0.0 ), mFrameIndex( 0 ), mStarted( false ) {}
+
+	/** @brief destructor */
+	virtual ~FrameSource() {}
+
+	/** @brief starts delivering frames */
+	virtual void start()
+	{
+		mStarted    = true;
+		mStartTime  = std::chrono::steady_clock::now();
+		mFrameIndex = 0;
+	}
+
+	/** @brief stops delivering frames */
+	virtual void stop() { mStarted = false; }
+
+	/** @brief returns true (once) when a new frame is available */
+	virtual bool checkNewFrame()
+	{
+		if( !mStarted ) { return false; }
+
+		// Determine which frame is due:
+		size_t tDue = mFrameIndex + 1;
+		if( mRate > 0.0 ) {
+			std::chrono::duration<double> tElapsed = std::chrono::steady_clock::now() - mStartTime;
+			tDue = static_cast<size_t>( tElapsed.count() * mRate ) + 1;
+		}
+		if( tDue <= mFrameIndex ) { return false; }
+
+		// Produce the frame (a frame that can't be read isn't reported as new):
+		mFrameIndex = tDue;
+		return readFrame( mFrameIndex - 1, mSurface ) && mSurface;
+	}
+
+	/** @brief returns the current frame */
+	const ci::Surface8u& getSurface() const { return mSurface; }
+
+	/** @brief sets the delivery rate in frames per second (zero delivers a frame on every poll) */
+	void setRate(const double& iFramesPerSecond) { mRate = std::max( iFramesPerSecond, 0.0 ); }
+
+	/** @brief returns the delivery rate in frames per second */
+	double getRate() const { return mRate; }
+
+	/** @brief returns the number of frames delivered since start() */
+	size_t getFrameCount() const { return mFrameIndex; }
+
+	/** @brief returns the frame width */
+	virtual int32_t getWidth() const = 0;
+
+	/** @brief returns the frame height */
+	virtual int32_t getHeight() const = 0;
+
+	/** @brief returns false if the source can never deliver a frame (e.g. its file is missing) */
+	virtual bool isValid() const { return true; }
+
+protected:
+	/** @brief writes the frame with the given index into the surface (returns false if nothing was written) */
+	virtual bool readFrame(const size_t& iIndex, ci::Surface8u& oSurface) = 0;
+
+	ci::Surface8u	mSurface;
+
+private:
+	double									mRate;
+	size_t									mFrameIndex;
+	bool									mStarted;
+	std::chrono::steady_clock::time_point	mStartTime;
+};
+
+/** @brief a frame source backed by a live camera */
+class CaptureFrameSource : public FrameSource {
+public:
+	/** @brief creates a camera source (throws if no camera is available) */
+	static FrameSourceRef create(const int32_t& iWidth, const int32_t& iHeight)
+	{
+		return FrameSourceRef( new CaptureFrameSource( ci::Capture::create( iWidth, iHeight ) ) );
+	}
+
+	void start() { mCapture->start(); }
+	void stop()  { mCapture->stop(); }
+
+	bool checkNewFrame()
+	{
+		if( !mCapture->checkNewFrame() ) { return false; }
+		mSurface = mCapture->getSurface();
+		return true;
+	}
+
+	int32_t getWidth() const  { return mCapture->getWidth(); }
+	int32_t getHeight() const { return mCapture->getHeight(); }
+
+protected:
+	CaptureFrameSource(const ci::CaptureRef& iCapture) : mCapture( iCapture ) {}
+
+	bool readFrame(const size_t& iIndex, ci::Surface8u& oSurface) { return false; }
+
+	ci::CaptureRef	mCapture;
+};
+
+/** @brief a frame source that plays a file of back-to-back raw RGBA frames */
+class RawFrameSource : public FrameSource {
+public:
+	/** @brief creates a raw source for frames of the given dimension */
+	static FrameSourceRef create(const std::string& iPath, const int32_t& iWidth, const int32_t& iHeight, const double& iRate = 30.0)
+	{
+		FrameSourceRef tSource( new RawFrameSource( iPath, iWidth, iHeight ) );
+		tSource->setRate( iRate );
+		return tSource;
+	}
+
+	int32_t getWidth() const  { return mWidth; }
+	int32_t getHeight() const { return mHeight; }
+
+	bool isValid() const { return mFrameCount > 0; }
+
+	/** @brief returns the number of frames in the file */
+	size_t getFileFrameCount() const { return mFrameCount; }
+
+protected:
+	RawFrameSource(const std::string& iPath, const int32_t& iWidth, const int32_t& iHeight) :
+		mFile( new MappedFile( iPath ) ), mWidth( iWidth ), mHeight( iHeight )
+	{
+		mFrameBytes = static_cast<size_t>( iWidth ) * iHeight * 4;
+		mFrameCount = ( mFrameBytes > 0 ) ? ( mFile->getSize() / mFrameBytes ) : ( 0 );
+		if( mFrameCount == 0 ) {
+			std::cout << "Raw frame file '" << iPath << "' is missing or smaller than one frame" << std::endl;
+		}
+	}
+
+	bool readFrame(const size_t& iIndex, ci::Surface8u& oSurface)
+	{
+		if( mFrameCount == 0 ) { return false; }
+		// Wrap the mapped bytes directly (no copy). The surface does not own
+		// the memory, which stays mapped for the lifetime of the source:
+		uint8_t* tFrame = const_cast<uint8_t*>( mFile->getData() ) + ( iIndex % mFrameCount ) * mFrameBytes;
+		oSurface = ci::Surface8u( tFrame, mWidth, mHeight, mWidth * 4, ci::SurfaceChannelOrder::RGBA );
+		return true;
+	}
+
+	std::shared_ptr<MappedFile>	mFile;
+	int32_t						mWidth;
+	int32_t						mHeight;
+	size_t						mFrameBytes;
+	size_t						mFrameCount;
+};
+
+/** @brief a frame source that plays a directory of images (in name order) */
+class ImageSequenceSource : public FrameSource {
+public:
+	/** @brief creates a sequence source from all files with the given extension in a directory */
+	static FrameSourceRef create(const std::string& iDirectory, const std::string& iExtension = ".png", const double& iRate = 30.0)
+	{
+		FrameSourceRef tSource( new ImageSequenceSource( iDirectory, iExtension ) );
+		tSource->setRate( iRate );
+		return tSource;
+	}
+
+	int32_t getWidth() const  { return mWidth; }
+	int32_t getHeight() const { return mHeight; }
+
+	bool isValid() const { return mWidth > 0 && mHeight > 0; }
+
+protected:
+	ImageSequenceSource(const std::string& iDirectory, const std::string& iExtension) : mWidth( 0 ), mHeight( 0 )
+	{
+		// Collect matching files:
+		if( ci::fs::is_directory( iDirectory ) ) {
+			for(ci::fs::directory_iterator it( iDirectory ); it != ci::fs::directory_iterator(); ++it) {
+				if( it->path().extension().string() == iExtension ) {
+					mPaths.push_back( it->path().string() );
+				}
+			}
+		}
+		std::sort( mPaths.begin(), mPaths.end() );
+		if( mPaths.empty() ) {
+			std::cout << "No '" << iExtension << "' images found in '" << iDirectory << "'" << std::endl;
+			return;
+		}
+
+		// Decode the first frame to learn the dimension:
+		ci::Surface8u tFirst;
+		if( readFrame( 0, tFirst ) ) {
+			mWidth  = tFirst.getWidth();
+			mHeight = tFirst.getHeight();
+		}
+	}
+
+	bool readFrame(const size_t& iIndex, ci::Surface8u& oSurface)
+	{
+		if( mPaths.empty() ) { return false; }
+		const std::string& tPath = mPaths[ iIndex % mPaths.size() ];
+
+		// Decode straight from the mapped file. The image is decoded into a new
+		// surface, so the file can be unmapped as soon as loading finishes:
+		MappedFile tFile( tPath );
+		if( !tFile.getData() ) { return false; }
+		try {
+			ci::Buffer tBuffer( const_cast<uint8_t*>( tFile.getData() ), tFile.getSize() );
+			oSurface = ci::Surface8u( ci::loadImage( ci::DataSourceBuffer::create( tBuffer ), ci::ImageSource::Options(), ci::fs::path( tPath ).extension().string().substr( 1 ) ) );
+		}
+		catch( ... ) {
+			std::cout << "Unable to decode '" << tPath << "'" << std::endl;
+			return false;
+		}
+		return oSurface && oSurface.getWidth() > 0 && oSurface.getHeight() > 0;
+	}
+
+	std::vector<std::string>	mPaths;
+	int32_t						mWidth;
+	int32_t						mHeight;
+};
+
+/** @brief a frame source that generates synthetic test patterns */
+class PatternFrameSource : public FrameSource {
+public:
+	enum Pattern
+	{
+		GRADIENT,		//!< a color gradient scrolling one pixel per frame
+		CHECKERBOARD,	//!< a checkerboard that inverts every 15 frames
+		NOISE			//!< deterministic per-frame white noise
+	};
+
+	/** @brief creates a pattern source */
+	static FrameSourceRef create(const int32_t& iWidth, const int32_t& iHeight, const Pattern& iPattern = GRADIENT, const double& iRate = 30.0)
+	{
+		FrameSourceRef tSource( new PatternFrameSource( iWidth, iHeight, iPattern ) );
+		tSource->setRate( iRate );
+		return tSource;
+	}
+
+	int32_t getWidth() const  { return mWidth; }
+	int32_t getHeight() const { return mHeight; }
+
+protected:
+	PatternFrameSource(const int32_t& iWidth, const int32_t& iHeight, const Pattern& iPattern) :
+		mWidth( iWidth ), mHeight( iHeight ), mPattern( iPattern )
+	{
+		// Allocate the frame once; each frame is generated in place:
+		mFrame = ci::Surface8u( iWidth, iHeight, true, ci::SurfaceChannelOrder::RGBA );
+	}
+
+	bool readFrame(const size_t& iIndex, ci::Surface8u& oSurface)
+	{
+		uint32_t tSeed = static_cast<uint32_t>( iIndex ) * 2654435761u;
+		for(int32_t y = 0; y < mHeight; y++) {
+			uint8_t* tRow = mFrame.getData() + y * mFrame.getRowBytes();
+			for(int32_t x = 0; x < mWidth; x++) {
+				uint8_t r, g, b;
+				switch( mPattern ) {
+					case CHECKERBOARD: {
+						uint8_t v = ( ( ( x / 32 ) + ( y / 32 ) + ( iIndex / 15 ) ) % 2 ) ? ( 255 ) : ( 0 );
+						r = g = b = v;
+						break;
+					}
+					case NOISE: {
+						// Xorshift:
+						tSeed ^= tSeed << 13;
+						tSeed ^= tSeed >> 17;
+						tSeed ^= tSeed << 5;
+						r = tSeed & 0xFF;
+						g = ( tSeed >> 8 ) & 0xFF;
+						b = ( tSeed >> 16 ) & 0xFF;
+						break;
+					}
+					default: {
+						r = static_cast<uint8_t>( ( x + iIndex ) * 255 / std::max( mWidth, 1 ) );
+						g = static_cast<uint8_t>( y * 255 / std::max( mHeight, 1 ) );
+						b = static_cast<uint8_t>( ( iIndex * 4 ) & 0xFF );
+						break;
+					}
+				}
+				tRow[ 0 ] = r;
+				tRow[ 1 ] = g;
+				tRow[ 2 ] = b;
+				tRow[ 3 ] = 255;
+				tRow += 4;
+			}
+		}
+		oSurface = mFrame;
+		return true;
+	}
+
+	int32_t			mWidth;
+	int32_t			mHeight;
+	Pattern			mPattern;
+	ci::Surface8u	mFrame;
+};
+
+/** @brief creates the default frame source for the capture examples
+ *
+ *  The AOGP_FRAME_SOURCE environment variable selects a stand-in source:
+ *  - a directory path plays the PNG images in that directory
+ *  - a file path plays a raw RGBA file of iWidth x iHeight frames
+ *  - "gradient", "checkerboard" or "noise" generates a test pattern
+ *  AOGP_FRAME_RATE sets the stand-in's rate (0 = a new frame on every poll).
+ *  Otherwise, a camera is used. A test pattern is used instead of a stand-in
+ *  that can't deliver frames, or if no camera exists.
+ */
+static FrameSourceRef createDefaultFrameSource(const int32_t& iWidth, const int32_t& iHeight)
+{
+	const char* tSpec = getenv( "AOGP_FRAME_SOURCE" );
+	const char* tRate = getenv( "AOGP_FRAME_RATE" );
+	double tFps = ( tRate ) ? ( atof( tRate ) ) : ( 30.0 );
+
+	if( tSpec ) {
+		std::string tName( tSpec );
+		if( tName == "gradient" )     { return PatternFrameSource::create( iWidth, iHeight, PatternFrameSource::GRADIENT, tFps ); }
+		if( tName == "checkerboard" ) { return PatternFrameSource::create( iWidth, iHeight, PatternFrameSource::CHECKERBOARD, tFps ); }
+		if( tName == "noise" )        { return PatternFrameSource::create( iWidth, iHeight, PatternFrameSource::NOISE, tFps ); }
+		FrameSourceRef tSource = ( ci::fs::is_directory( tName ) ) ? ( ImageSequenceSource::create( tName, ".png", tFps ) ) : ( RawFrameSource::create( tName, iWidth, iHeight, tFps ) );
+		if( tSource->isValid() ) { return tSource; }
+		std::cout << "Unable to play '" << tName << "', using a test pattern instead" << std::endl;
+		return PatternFrameSource::create( iWidth, iHeight, PatternFrameSource::GRADIENT, tFps );
+	}
+
+	try {
+		return CaptureFrameSource::create( iWidth, iHeight );
+	}
+	catch( ... ) {
+		std::cout << "Failed to initialize capture, using a test pattern instead" << std::endl;
+	}
+	return PatternFrameSource::create( iWidth, iHeight, PatternFrameSource::GRADIENT, tFps );
+}
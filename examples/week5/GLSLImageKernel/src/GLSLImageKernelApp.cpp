@@ -10,62 +10,16 @@
 #include "cinder/gl/gl.h"
 #include "cinder/gl/Texture.h"
 #include "cinder/gl/GlslProg.h"
-#include "cinder/Capture.h"
+
+#include "FilterGraph.h"
+#include "SummedAreaTable.h"
+#include "ThreadedFrameSource.h"
+#include "TextureUploadRing.h"
 
 using namespace ci;
 using namespace ci::app;
 using namespace std;
 
-#define STRINGIFY(x) #x
-
-static const string kVertGlsl =
-STRINGIFY(
-		  // Pass-through vertex shader:
-		  void main()
-		  {
-			  gl_FrontColor = gl_Color;
-			  gl_TexCoord[0] = gl_MultiTexCoord0;
-			  gl_Position = ftransform();
-		  }
-		  );
-
-static const string kFragGlsl =
-STRINGIFY(
-		  uniform sampler2D mTexture;
-		  uniform float		mWidth;
-		  uniform float		mHeight;
-		  uniform float		mKernel[9];
-		  void main()
-		  {
-			  // Get pixel dimension in [0,1] range per axis:
-			  float tStepX = 1.0 / mWidth;
-			  float tStepY = 1.0 / mHeight;
-			  
-			  // Compute neighbor offsets:
-			  vec2 tOffsets[ 9 ];
-			  tOffsets[ 0 ] = vec2( -tStepX, -tStepY );
-			  tOffsets[ 1 ] = vec2(     0.0, -tStepY );
-			  tOffsets[ 2 ] = vec2(  tStepX, -tStepY );
-			  tOffsets[ 3 ] = vec2( -tStepX,     0.0 );
-			  tOffsets[ 4 ] = vec2(     0.0,     0.0 );
-			  tOffsets[ 5 ] = vec2(  tStepX,     0.0 );
-			  tOffsets[ 6 ] = vec2( -tStepX,  tStepY );
-			  tOffsets[ 7 ] = vec2(     0.0,  tStepY );
-			  tOffsets[ 8 ] = vec2(  tStepX,  tStepY );
-			  
-			  // Initialize kernel sum:
-			  vec4 tSum = vec4( 0.0 );
-			  
-			  // Iterate over kernel and sum components:
-			  for(int i = 0; i < 9; i++) {
-				  tSum += texture2D( mTexture, gl_TexCoord[0].xy + tOffsets[ i ] ) * mKernel[ i ];
-			  }
-			
-			  // Set final color:
-			  gl_FragColor = tSum;
-		  }
-		  );
-
 // Prepare a few sample filter kernels:
 
 // No Filter:
@@ -116,28 +70,34 @@ public:
 	void update();
 	void draw();
 	
-	CaptureRef			mCapture;
+	void buildGraph();
+	void printStats();
+	
+	ThreadedFrameSourceRef	mSource;
 	gl::TextureRef		mTexture;
-	gl::GlslProg		mShader;
+	TextureUploadRing	mUploadRing;
+	bool				mUploaded;	//!< a new frame was uploaded and hasn't been drawn yet
+	FilterGraphGl		mFilter;
 	size_t				mFilterIdx;
+	bool				mInvert;
+	int					mBlurRadius;
 };
 
 void GLSLImageKernelApp::setup()
 {
-	// Load shader from strings (using the stringify macro):
-	mShader = gl::GlslProg( kVertGlsl.c_str(), kFragGlsl.c_str() );
-	
-	// Try to load camera capture:
-	try {
-		mCapture = Capture::create( 640, 480 );
-		mCapture->start();
-	}
-	catch(...) {
-		cout << "Failed to initialize capture" << endl;
-	}
+	// Open camera capture (or a stand-in when no camera is available, see FrameSource.h)
+	// and run it on a worker thread (see ThreadedFrameSource.h):
+	mSource = ThreadedFrameSource::create( createDefaultFrameSource( 640, 480 ) );
+	mUploaded = false;
+	mSource->start();
 	
 	// Prepare initial state:
-	mFilterIdx = 0;
+	mFilterIdx  = 0;
+	mInvert     = false;
+	mBlurRadius = 16;
+	
+	// Build the initial filter graph:
+	buildGraph();
 }
 
 void GLSLImageKernelApp::keyUp(KeyEvent event)
@@ -145,80 +105,159 @@ void GLSLImageKernelApp::keyUp(KeyEvent event)
 	char c = event.getChar();
 	if( c >= '0' && c <= '9' ) {
 		mFilterIdx = (int)c - 48;
+		buildGraph();
+	}
+	else if( c == 'i' ) {
+		mInvert = !mInvert;
+		buildGraph();
+	}
+	else if( c == '[' || c == ']' ) {
+		// Adjust the radius of the summed-area table filters:
+		mBlurRadius = constrain( mBlurRadius + ( ( c == ']' ) ? ( 4 ) : ( -4 ) ), 0, 128 );
+		cout << "Blur radius: " << mBlurRadius << endl;
+		buildGraph();
+	}
+	else if( c == 's' ) {
+		printStats();
+	}
+	else if( c == 'b' ) {
+		// Compare cpu box blurs of the current frame, by brute force and from a summed-area table:
+		runSummedAreaTableBenchmark( mSource->getSurface() );
 	}
 }
 
-void GLSLImageKernelApp::update()
+void GLSLImageKernelApp::printStats()
 {
-	if( mCapture && mCapture->checkNewFrame() ) {
-		mTexture = gl::Texture::create( mCapture->getSurface() );
-	}
+	const TextureUploadRing::Stats& tFrame = mUploadRing.getFrameStats();
+	const TextureUploadRing::Stats& tTotal = mUploadRing.getTotalStats();
+	ThreadedFrameSource::Stats tCapture = mSource->getStats();
+	cout << "Uploads this frame: " << tFrame.mUploads << " (" << tFrame.mBytesUploaded << " bytes, " << tFrame.mTextureAllocations << " allocations)" << endl;
+	cout << "Uploads in total: " << tTotal.mUploads << " (" << tTotal.mBytesUploaded << " bytes, " << tTotal.mTextureAllocations << " allocations)" << endl;
+	cout << "Frames captured: " << tCapture.mCaptured << ", delivered: " << tCapture.mDelivered << ", dropped: " << tCapture.mDropped << endl;
+	cout << "Capture to update latency: " << tCapture.mCaptureLatency * 1000.0 << " ms" << endl;
+	cout << "Capture to draw latency: " << tCapture.mPhotonLatency * 1000.0 << " ms (average " << tCapture.mAveragePhotonLatency * 1000.0 << " ms)" << endl;
 }
 
-void GLSLImageKernelApp::draw()
+void GLSLImageKernelApp::buildGraph()
 {
-	// Clear window:
-	gl::clear( Color( 0, 0, 0 ) );
-	
-	// Set matrices from window size:
-	gl::setMatricesWindow( getWindowSize() );
+	// Each pass declares the image it reads and the image it writes.
+	// When inverting, the invert pass is point-wise (it only looks at the current pixel),
+	// so the graph fuses it into the following pass: both run in a single shader.
+	FilterGraph tGraph;
+	string tInput = kFilterSource;
+	if( mInvert ) {
+		tGraph.addPass( createInvertPass( "invert", kFilterSource, "inverted" ) );
+		tInput = "inverted";
+	}
 	
-	// Set color:
-	gl::color( 1.0, 1.0, 1.0 );
+	// Render target format (only applied once the graph has compiled, so a failed
+	// compile keeps the old graph with its own format):
+	GLint tColorFormat = GL_RGBA8;
 	
-	// Check whether texture has been initialized:
-	if( mTexture ) {
-		// Bind texture:
-		mTexture->bind( 0 );
-		
-		// Bind shader:
-		mShader.bind();
-		
-		// Set shader uniform for texture id:
-		mShader.uniform( "mTexture", 0 );
-		
-		// Pass texture dimensions to shader:
-		mShader.uniform( "mWidth", static_cast<float>( mTexture->getWidth() ) );
-		mShader.uniform( "mHeight", static_cast<float>( mTexture->getHeight() ) );
-		
-		// Pass filter kernel array:
+	if( mFilterIdx >= 5 && mFilterIdx <= 7 ) {
+		// Summed-area table filters (see SummedAreaTable.h):
+		// The cost of these filters does not depend on the radius.
+		int tWidth  = mSource->getWidth();
+		int tHeight = mSource->getHeight();
 		switch ( mFilterIdx ) {
-			case 1: {
-				mShader.uniform( "mKernel", kGaussianKernel, 9 );
-				break;
-			}
-			case 2: {
-				mShader.uniform( "mKernel", kSharpenKernel, 9 );
+			case 5: {
+				// Box blur:
+				addSummedAreaTablePasses( tGraph, tInput, "table", tWidth, tHeight );
+				tGraph.addPass( createSatBoxBlurPass( "box", "table", "filtered", mBlurRadius ) );
 				break;
 			}
-			case 3: {
-				mShader.uniform( "mKernel", kEmbossKernel, 9 );
+			case 6: {
+				// Variable-radius blur (sharp at the center, blurry at the corners):
+				tGraph.addPass( createRadialRadiusPass( "radius", kFilterSource, "radii" ) );
+				addSummedAreaTablePasses( tGraph, tInput, "table", tWidth, tHeight );
+				tGraph.addPass( createSatVariableBlurPass( "blur", "table", "radii", "filtered", mBlurRadius ) );
 				break;
 			}
-			case 4: {
-				mShader.uniform( "mKernel", kLaplacianKernel, 9 );
-				break;
-			}
-			default : {
-				mShader.uniform( "mKernel", kNoKernel, 9 );
+			default: {
+				// Local mean (red) and standard deviation (green) of luminance:
+				addSummedAreaTablePasses( tGraph, tInput, "table", tWidth, tHeight, true );
+				tGraph.addPass( createSatLocalStatsPass( "stats", "table", "filtered", mBlurRadius ) );
 				break;
 			}
 		}
 		
+		// The table holds large, signed sums, so it needs float render targets:
+		tColorFormat = GL_RGBA32F_ARB;
+	}
+	else {
+		// Choose filter kernel:
+		const float* tKernel;
+		switch ( mFilterIdx ) {
+			case 1:  { tKernel = kGaussianKernel;	break; }
+			case 2:  { tKernel = kSharpenKernel;	break; }
+			case 3:  { tKernel = kEmbossKernel;		break; }
+			case 4:  { tKernel = kLaplacianKernel;	break; }
+			default: { tKernel = kNoKernel;			break; }
+		}
+		
 		// See:
 		// http://en.wikipedia.org/wiki/Kernel_(image_processing)
 		// http://www.ozone3d.net/tutorials/image_filtering.php
 		// http://matlabtricks.com/post-5/3x3-convolution-kernels-with-online-demo
 		
-		// Draw a solid rectangle:
-		// (The shader will be drawn onto the rect surface)
-		gl::drawSolidRect( getWindowBounds() );
+		tGraph.addPass( createConvolutionPass( "convolve", tInput, "filtered", tKernel ) );
+	}
+	
+	try {
+		mFilter.setGraph( tGraph );
+		mFilter.setColorFormat( tColorFormat );
+		cout << tGraph.getPassCount() << " pass(es) compiled into " << mFilter.getGraph().getKernels().size() << " shader(s) using ";
+		cout << mFilter.getGraph().getSlotCount() << " render target(s)" << endl;
+	}
+	catch( gl::GlslProgCompileExc &exc ) {
+		cout << "Shader compile error: " << endl;
+		cout << exc.what();
+	}
+	catch( FilterGraphExc &exc ) {
+		cout << "Filter graph error: " << exc.what() << endl;
+	}
+}
+
+void GLSLImageKernelApp::update()
+{
+	// Reset per-frame upload counters:
+	mUploadRing.resetFrameStats();
+	
+	if( mSource->checkNewFrame() ) {
+		// Update the next texture of the ring in place (no per-frame allocation):
+		mUploadRing.upload( mSource->getSurface() );
+		mTexture = mUploadRing.getTexture();
+		mUploaded = mUploaded || ( mUploadRing.getFrameStats().mUploads > 0 );
+	}
+}
+
+void GLSLImageKernelApp::draw()
+{
+	// Clear window:
+	gl::clear( Color( 0, 0, 0 ) );
+	
+	// Check whether texture has been initialized:
+	if( mTexture ) {
+		// Run the filter graph into an offscreen framebuffer:
+		gl::Texture tFiltered = mFilter.run( *mTexture );
+		
+		// Set matrices from window size:
+		gl::setMatricesWindow( getWindowSize() );
 		
-		// Unbind shader:
-		mShader.unbind();
+		// Set color:
+		gl::color( 1.0, 1.0, 1.0 );
 		
-		// Unbind texture:
-		mTexture->unbind();
+		// Draw the filtered texture onto a solid rectangle:
+		tFiltered.enableAndBind();
+		gl::drawSolidRect( getWindowBounds() );
+		tFiltered.unbind();
+		tFiltered.disable();
+		
+		// Record capture-to-draw latency (once per uploaded frame, not on every redraw):
+		if( mUploaded ) {
+			mSource->markPresented();
+			mUploaded = false;
+		}
 	}
 }
 
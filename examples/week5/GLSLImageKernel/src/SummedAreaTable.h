@@ -0,0 +1,546 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "cinder/Channel.h"
+#include "cinder/Surface.h"
+
+#include "FilterGraph.h"
+#include "ParallelFor.h"
+
+// A brute-force box blur of radius r reads (2r+1)^2 pixels per output pixel.
+// A summed-area table (or "integral image") stores, at each pixel, the sum of
+// all pixels above and to the left of it (inclusive). The sum of any rectangle
+// can then be found from just four table entries:
+//
+//     sum( x0..x1, y0..y1 ) = S( x1, y1 ) - S( x0-1, y1 ) - S( x1, y0-1 ) + S( x0-1, y0-1 )
+//
+// So a box blur costs the same for any radius, and the radius can even change
+// from pixel to pixel. Storing sums of squared values too gives the local
+// variance: var = E[ v^2 ] - E[ v ]^2.
+//
+// On the CPU, the table is built with two parallel prefix scans: first every
+// row is scanned (rows are independent, so they are split between threads),
+// then every column.
+//
+// On the GPU, the table is built with log2(width) + log2(height) render passes
+// ("recursive doubling"): pass i adds the value 2^i texels to the left (or
+// above), so after all passes each texel holds the sum of everything before it.
+// The values are centered around zero first (v - 0.5), which keeps the float
+// sums small and precise. The GPU passes are FilterGraph passes, so they also
+// run on the graph's CPU executor.
+
+/** @brief a cpu summed-area table over the RGBA channels of an image (and their squares) */
+class SummedAreaTable {
+public:
+	/** @brief default constructor */
+	SummedAreaTable() : mWidth( 0 ), mHeight( 0 ) {}
+
+	/** @brief builds the table for the given image */
+	void build(const ci::Surface8u& iImage)
+	{
+		mWidth  = iImage.getWidth();
+		mHeight = iImage.getHeight();
+
+		// The table has an extra row and column of zeros so that S( -1, y ) and S( x, -1 ) need no special case:
+		size_t tStride = static_cast<size_t>( mWidth + 1 ) * kChannels;
+		mSums.assign( tStride * ( mHeight + 1 ), 0.0 );
+
+		const ci::SurfaceChannelOrder& tOrder = iImage.getChannelOrder();
+		int tOffsets[ 4 ] = { tOrder.getRedOffset(), tOrder.getGreenOffset(), tOrder.getBlueOffset(), tOrder.getAlphaOffset() };
+		uint8_t tInc = iImage.getPixelInc();
+
+		// Scan rows in parallel:
+		parallelFor( mHeight, [&] (size_t iBegin, size_t iEnd) {
+			for(size_t y = iBegin; y < iEnd; y++) {
+				const uint8_t* tSrc = iImage.getData() + y * iImage.getRowBytes();
+				double*        tRow = &mSums[ ( y + 1 ) * tStride ];
+				for(int32_t x = 0; x < mWidth; x++) {
+					double* tPrev = tRow + x * kChannels;
+					double* tCell = tPrev + kChannels;
+					for(int c = 0; c < 4; c++) {
+						double v = ( tOffsets[ c ] >= 0 ) ? ( tSrc[ tOffsets[ c ] ] / 255.0 ) : ( 1.0 );
+						tCell[ c ]     = tPrev[ c ] + v;
+						tCell[ c + 4 ] = tPrev[ c + 4 ] + v * v;
+					}
+					tSrc += tInc;
+				}
+			}
+		} );
+
+		// Scan columns in parallel:
+		parallelFor( mWidth, [&] (size_t iBegin, size_t iEnd) {
+			for(int32_t y = 1; y <= mHeight; y++) {
+				double* tRow  = &mSums[ y * tStride ];
+				double* tPrev = tRow - tStride;
+				for(size_t x = iBegin + 1; x <= iEnd; x++) {
+					for(int c = 0; c < kChannels; c++) {
+						tRow[ x * kChannels + c ] += tPrev[ x * kChannels + c ];
+					}
+				}
+			}
+		} );
+	}
+
+	/** @brief returns the mean of the rectangle [x0,x1] x [y0,y1] (clamped to the image) */
+	ci::ColorA getMean(int iX0, int iY0, int iX1, int iY1) const
+	{
+		double tSum[ kChannels ];
+		double tArea = getSums( iX0, iY0, iX1, iY1, tSum );
+		return ci::ColorA( tSum[ 0 ] / tArea, tSum[ 1 ] / tArea, tSum[ 2 ] / tArea, tSum[ 3 ] / tArea );
+	}
+
+	/** @brief returns the variance of the rectangle [x0,x1] x [y0,y1] (clamped to the image) */
+	ci::ColorA getVariance(int iX0, int iY0, int iX1, int iY1) const
+	{
+		double tSum[ kChannels ];
+		double tArea = getSums( iX0, iY0, iX1, iY1, tSum );
+		double tVar[ 4 ];
+		for(int c = 0; c < 4; c++) {
+			double tMean = tSum[ c ] / tArea;
+			tVar[ c ] = std::max( tSum[ c + 4 ] / tArea - tMean * tMean, 0.0 );
+		}
+		return ci::ColorA( tVar[ 0 ], tVar[ 1 ], tVar[ 2 ], tVar[ 3 ] );
+	}
+
+	/** @brief box blurs the image with the given radius (constant cost per pixel for any radius) */
+	void boxBlur(const int& iRadius, ci::Surface8u& oImage) const
+	{
+		allocate( oImage );
+		parallelFor( mHeight, [&] (size_t iBegin, size_t iEnd) {
+			for(int y = static_cast<int>( iBegin ); y < static_cast<int>( iEnd ); y++) {
+				uint8_t* tDst = oImage.getData() + y * oImage.getRowBytes();
+				for(int x = 0; x < mWidth; x++) {
+					store( getMean( x - iRadius, y - iRadius, x + iRadius, y + iRadius ), tDst + x * 4 );
+				}
+			}
+		} );
+	}
+
+	/** @brief blurs the image with a per-pixel radius of iRadii( x, y ) * iMaxRadius (radii in [0,1]) */
+	void variableBlur(const ci::Channel32f& iRadii, const int& iMaxRadius, ci::Surface8u& oImage) const
+	{
+		allocate( oImage );
+		parallelFor( mHeight, [&] (size_t iBegin, size_t iEnd) {
+			for(int y = static_cast<int>( iBegin ); y < static_cast<int>( iEnd ); y++) {
+				uint8_t* tDst = oImage.getData() + y * oImage.getRowBytes();
+				for(int x = 0; x < mWidth; x++) {
+					int tRadius = static_cast<int>( iRadii.getValue( ci::Vec2i( x, y ) ) * iMaxRadius + 0.5f );
+					store( getMean( x - tRadius, y - tRadius, x + tRadius, y + tRadius ), tDst + x * 4 );
+				}
+			}
+		} );
+	}
+
+	/** @brief computes the local mean and variance over a (2r+1)^2 window around each pixel */
+	void localMeanVariance(const int& iRadius, ci::Surface32f& oMean, ci::Surface32f& oVariance) const
+	{
+		oMean     = ci::Surface32f( mWidth, mHeight, true );
+		oVariance = ci::Surface32f( mWidth, mHeight, true );
+		parallelFor( mHeight, [&] (size_t iBegin, size_t iEnd) {
+			for(int y = static_cast<int>( iBegin ); y < static_cast<int>( iEnd ); y++) {
+				for(int x = 0; x < mWidth; x++) {
+					ci::Vec2i tPos( x, y );
+					oMean.setPixel( tPos, getMean( x - iRadius, y - iRadius, x + iRadius, y + iRadius ) );
+					oVariance.setPixel( tPos, getVariance( x - iRadius, y - iRadius, x + iRadius, y + iRadius ) );
+				}
+			}
+		} );
+	}
+
+	/** @brief returns the table width */
+	int32_t getWidth() const { return mWidth; }
+
+	/** @brief returns the table height */
+	int32_t getHeight() const { return mHeight; }
+
+private:
+	static const int kChannels = 8;	//!< RGBA sums followed by RGBA sums of squares
+
+	/** @brief writes the sums of a clamped rectangle into oSum and returns its area */
+	double getSums(int iX0, int iY0, int iX1, int iY1, double* oSum) const
+	{
+		iX0 = std::max( iX0, 0 );
+		iY0 = std::max( iY0, 0 );
+		iX1 = std::min( iX1, mWidth - 1 );
+		iY1 = std::min( iY1, mHeight - 1 );
+
+		// Table coordinates are offset by one (row and column 0 hold zeros):
+		size_t tStride = static_cast<size_t>( mWidth + 1 ) * kChannels;
+		const double* tA = &mSums[ ( iY0 ) * tStride + ( iX0 ) * kChannels ];
+		const double* tB = &mSums[ ( iY0 ) * tStride + ( iX1 + 1 ) * kChannels ];
+		const double* tC = &mSums[ ( iY1 + 1 ) * tStride + ( iX0 ) * kChannels ];
+		const double* tD = &mSums[ ( iY1 + 1 ) * tStride + ( iX1 + 1 ) * kChannels ];
+		for(int c = 0; c < kChannels; c++) {
+			oSum[ c ] = tD[ c ] - tB[ c ] - tC[ c ] + tA[ c ];
+		}
+		return static_cast<double>( iX1 - iX0 + 1 ) * ( iY1 - iY0 + 1 );
+	}
+
+	/** @brief allocates an RGBA output image of the table's dimension */
+	void allocate(ci::Surface8u& oImage) const
+	{
+		if( !oImage || oImage.getWidth() != mWidth || oImage.getHeight() != mHeight || oImage.getChannelOrder().getCode() != ci::SurfaceChannelOrder::RGBA ) {
+			oImage = ci::Surface8u( mWidth, mHeight, true, ci::SurfaceChannelOrder::RGBA );
+		}
+	}
+
+	/** @brief writes a color as 8-bit RGBA */
+	static void store(const ci::ColorA& iColor, uint8_t* oPixel)
+	{
+		oPixel[ 0 ] = static_cast<uint8_t>( std::min( std::max( iColor.r, 0.0f ), 1.0f ) * 255.0f + 0.5f );
+		oPixel[ 1 ] = static_cast<uint8_t>( std::min( std::max( iColor.g, 0.0f ), 1.0f ) * 255.0f + 0.5f );
+		oPixel[ 2 ] = static_cast<uint8_t>( std::min( std::max( iColor.b, 0.0f ), 1.0f ) * 255.0f + 0.5f );
+		oPixel[ 3 ] = static_cast<uint8_t>( std::min( std::max( iColor.a, 0.0f ), 1.0f ) * 255.0f + 0.5f );
+	}
+
+	int32_t				mWidth;
+	int32_t				mHeight;
+	std::vector<double>	mSums;
+};
+
+/** @brief adds the passes that build a gpu summed-area table of iInput into iOutput
+ *
+ *  If iMoments is true, the table holds ( luminance, luminance^2 ) instead of RGBA,
+ *  for use with the local mean/variance pass. Intermediate targets must be float
+ *  (see FilterGraphGl::setColorFormat).
+ */
+static void addSummedAreaTablePasses(FilterGraph& ioGraph, const std::string& iInput, const std::string& iOutput, const int& iWidth, const int& iHeight, const bool& iMoments = false)
+{
+	// Center the values around zero (and optionally convert to moments):
+	FilterPass tPrep;
+	tPrep.mName		= "sat_prep";
+	tPrep.mKind		= FilterPass::POINTWISE;
+	tPrep.mInputs.push_back( iInput );
+	tPrep.mOutput	= iOutput + "_prep";
+	if( iMoments ) {
+		tPrep.mGlsl		= "float l = dot( c.rgb, vec3( 0.299, 0.587, 0.114 ) ) - 0.5; return vec4( l, l * l, 0.0, 0.0 );";
+		tPrep.mCpuPoint	= [] (const ci::ColorA& c) { float l = c.r * 0.299f + c.g * 0.587f + c.b * 0.114f - 0.5f; return ci::ColorA( l, l * l, 0.0f, 0.0f ); };
+	}
+	else {
+		tPrep.mGlsl		= "return c - vec4( 0.5 );";
+		tPrep.mCpuPoint	= [] (const ci::ColorA& c) { return ci::ColorA( c.r - 0.5f, c.g - 0.5f, c.b - 0.5f, c.a - 0.5f ); };
+	}
+	ioGraph.addPass( tPrep );
+
+	// Recursive doubling along each axis:
+	std::string tPrevious = tPrep.mOutput;
+	for(int tAxis = 0; tAxis < 2; tAxis++) {
+		int tLength = ( tAxis == 0 ) ? ( iWidth ) : ( iHeight );
+		for(int tOffset = 1; tOffset < tLength; tOffset *= 2) {
+			std::stringstream tName;
+			tName << "sat_" << ( ( tAxis == 0 ) ? "x" : "y" ) << tOffset;
+
+			std::stringstream ss;
+			ss << "vec2 p = uv - vec2( " << ( ( tAxis == 0 ) ? tOffset : 0 ) << ".0, " << ( ( tAxis == 1 ) ? tOffset : 0 ) << ".0 ) * mTexelSize;";
+			ss << " vec4 s = readInput0( uv );";
+			ss << " if( p." << ( ( tAxis == 0 ) ? "x" : "y" ) << " > 0.0 ) { s += readInput0( p ); }";
+			ss << " return s;";
+
+			FilterPass tScan;
+			tScan.mName		= tName.str();
+			tScan.mKind		= FilterPass::SAMPLER;
+			tScan.mInputs.push_back( tPrevious );
+			tScan.mOutput	= tScan.mName;
+			tScan.mGlsl		= ss.str();
+			int tDx = ( tAxis == 0 ) ? ( tOffset ) : ( 0 );
+			int tDy = ( tAxis == 1 ) ? ( tOffset ) : ( 0 );
+			tScan.mCpuSample = [tDx, tDy] (const FilterCpuInputs& iIn, int x, int y) {
+				ci::ColorA s = iIn.read( 0, x, y );
+				if( x - tDx >= 0 && y - tDy >= 0 ) { s += iIn.read( 0, x - tDx, y - tDy ); }
+				return s;
+			};
+			ioGraph.addPass( tScan );
+			tPrevious = tScan.mOutput;
+		}
+	}
+
+	// Name the final table:
+	FilterPass tCopy;
+	tCopy.mName		= "sat_out";
+	tCopy.mKind		= FilterPass::POINTWISE;
+	tCopy.mInputs.push_back( tPrevious );
+	tCopy.mOutput	= iOutput;
+	tCopy.mGlsl		= "return c;";
+	tCopy.mCpuPoint	= [] (const ci::ColorA& c) { return c; };
+	ioGraph.addPass( tCopy );
+}
+
+/** @brief GLSL helpers shared by the summed-area table lookup passes (the table is input 0) */
+static const std::string kSatLookupGlsl =
+	"vec4 satAt(vec2 p) {\n"
+	"\tif( p.x < 0.0 || p.y < 0.0 ) { return vec4( 0.0 ); }\n"
+	"\treturn readInput0( ( p + 0.5 ) * mTexelSize );\n"
+	"}\n"
+	"vec4 satMean(vec2 uv, float r) {\n"
+	"\tvec2 tSize = 1.0 / mTexelSize;\n"
+	"\tvec2 tPixel = floor( uv * tSize );\n"
+	"\tvec2 tMin = max( tPixel - r, vec2( 0.0 ) ) - 1.0;\n"
+	"\tvec2 tMax = min( tPixel + r, tSize - 1.0 );\n"
+	"\tvec4 tSum = satAt( tMax ) - satAt( vec2( tMin.x, tMax.y ) ) - satAt( vec2( tMax.x, tMin.y ) ) + satAt( tMin );\n"
+	"\tvec2 tExtent = tMax - tMin;\n"
+	"\treturn tSum / ( tExtent.x * tExtent.y );\n"
+	"}\n";
+
+/** @brief cpu equivalent of satMean() */
+static ci::ColorA satMeanCpu(const FilterCpuInputs& iIn, int x, int y, int r)
+{
+	int tX0 = std::max( x - r, 0 ) - 1;
+	int tY0 = std::max( y - r, 0 ) - 1;
+	int tX1 = std::min( x + r, iIn.getWidth() - 1 );
+	int tY1 = std::min( y + r, iIn.getHeight() - 1 );
+	ci::ColorA tZero( 0.0f, 0.0f, 0.0f, 0.0f );
+	ci::ColorA tA = ( tX0 >= 0 && tY0 >= 0 ) ? ( iIn.read( 0, tX0, tY0 ) ) : ( tZero );
+	ci::ColorA tB = ( tY0 >= 0 ) ? ( iIn.read( 0, tX1, tY0 ) ) : ( tZero );
+	ci::ColorA tC = ( tX0 >= 0 ) ? ( iIn.read( 0, tX0, tY1 ) ) : ( tZero );
+	ci::ColorA tD = iIn.read( 0, tX1, tY1 );
+	return ( tD - tB - tC + tA ) * ( 1.0f / ( ( tX1 - tX0 ) * ( tY1 - tY0 ) ) );
+}
+
+/** @brief creates a box blur pass reading a (color) summed-area table */
+static FilterPass createSatBoxBlurPass(const std::string& iName, const std::string& iTable, const std::string& iOutput, const int& iRadius)
+{
+	std::stringstream ss;
+	ss << "return vec4( satMean( uv, " << iRadius << ".0 ).rgb + 0.5, 1.0 );";
+
+	FilterPass tPass;
+	tPass.mName			= iName;
+	tPass.mKind			= FilterPass::SAMPLER;
+	tPass.mInputs.push_back( iTable );
+	tPass.mOutput		= iOutput;
+	tPass.mGlsl			= ss.str();
+	tPass.mGlslHelpers	= kSatLookupGlsl;
+	int tRadius = iRadius;
+	tPass.mCpuSample = [tRadius] (const FilterCpuInputs& iIn, int x, int y) {
+		ci::ColorA m = satMeanCpu( iIn, x, y, tRadius );
+		return ci::ColorA( m.r + 0.5f, m.g + 0.5f, m.b + 0.5f, 1.0f );
+	};
+	return tPass;
+}
+
+/** @brief creates a blur pass whose radius is iMaxRadius times the red channel of iRadii */
+static FilterPass createSatVariableBlurPass(const std::string& iName, const std::string& iTable, const std::string& iRadii, const std::string& iOutput, const int& iMaxRadius)
+{
+	std::stringstream ss;
+	ss << "float r = floor( readInput1( uv ).r * " << iMaxRadius << ".0 + 0.5 );";
+	ss << " return vec4( satMean( uv, r ).rgb + 0.5, 1.0 );";
+
+	FilterPass tPass;
+	tPass.mName			= iName;
+	tPass.mKind			= FilterPass::SAMPLER;
+	tPass.mInputs.push_back( iTable );
+	tPass.mInputs.push_back( iRadii );
+	tPass.mOutput		= iOutput;
+	tPass.mGlsl			= ss.str();
+	tPass.mGlslHelpers	= kSatLookupGlsl;
+	int tMaxRadius = iMaxRadius;
+	tPass.mCpuSample = [tMaxRadius] (const FilterCpuInputs& iIn, int x, int y) {
+		int r = static_cast<int>( floorf( iIn.read( 1, x, y ).r * tMaxRadius + 0.5f ) );
+		ci::ColorA m = satMeanCpu( iIn, x, y, r );
+		return ci::ColorA( m.r + 0.5f, m.g + 0.5f, m.b + 0.5f, 1.0f );
+	};
+	return tPass;
+}
+
+/** @brief creates a pass that writes ( mean, standard deviation * iGain, 0, 1 ) of the local luminance,
+ *  reading a moments summed-area table */
+static FilterPass createSatLocalStatsPass(const std::string& iName, const std::string& iTable, const std::string& iOutput, const int& iRadius, const float& iGain = 4.0f)
+{
+	std::stringstream ss;
+	ss << std::showpoint;
+	ss << "vec4 m = satMean( uv, " << iRadius << ".0 );";
+	ss << " float v = max( m.y - m.x * m.x, 0.0 );";
+	ss << " return vec4( m.x + 0.5, sqrt( v ) * " << iGain << ", 0.0, 1.0 );";
+
+	FilterPass tPass;
+	tPass.mName			= iName;
+	tPass.mKind			= FilterPass::SAMPLER;
+	tPass.mInputs.push_back( iTable );
+	tPass.mOutput		= iOutput;
+	tPass.mGlsl			= ss.str();
+	tPass.mGlslHelpers	= kSatLookupGlsl;
+	int   tRadius = iRadius;
+	float tGain   = iGain;
+	tPass.mCpuSample = [tRadius, tGain] (const FilterCpuInputs& iIn, int x, int y) {
+		ci::ColorA m = satMeanCpu( iIn, x, y, tRadius );
+		float v = std::max( m.g - m.r * m.r, 0.0f );
+		return ci::ColorA( m.r + 0.5f, sqrtf( v ) * tGain, 0.0f, 1.0f );
+	};
+	return tPass;
+}
+
+/** @brief creates a radius map pass: zero at the image center, growing to one at the corners */
+static FilterPass createRadialRadiusPass(const std::string& iName, const std::string& iInput, const std::string& iOutput)
+{
+	FilterPass tPass;
+	tPass.mName		= iName;
+	tPass.mKind		= FilterPass::SAMPLER;
+	tPass.mInputs.push_back( iInput );
+	tPass.mOutput	= iOutput;
+	tPass.mGlsl		= "float d = clamp( distance( uv, vec2( 0.5 ) ) * 1.41421356, 0.0, 1.0 ); return vec4( d, d, d, 1.0 );";
+	tPass.mCpuSample = [] (const FilterCpuInputs& iIn, int x, int y) {
+		float u = ( x + 0.5f ) / iIn.getWidth() - 0.5f;
+		float v = ( y + 0.5f ) / iIn.getHeight() - 0.5f;
+		float d = std::min( sqrtf( u * u + v * v ) * 1.41421356f, 1.0f );
+		return ci::ColorA( d, d, d, 1.0f );
+	};
+	return tPass;
+}
+
+/** @brief writes the sums (RGBA, then RGBA squared, in [0,1] units) of the clamped window [x-r,x+r] x [y-r,y+r] of a tightly packed RGBA image, and returns its area */
+static double getBruteForceSums(const ci::Surface8u& iImage, const int& iX, const int& iY, const int& iRadius, double* oSum)
+{
+	int x0 = std::max( iX - iRadius, 0 ), x1 = std::min( iX + iRadius, iImage.getWidth() - 1 );
+	int y0 = std::max( iY - iRadius, 0 ), y1 = std::min( iY + iRadius, iImage.getHeight() - 1 );
+	std::fill( oSum, oSum + 8, 0.0 );
+	for(int v = y0; v <= y1; v++) {
+		const uint8_t* tSrc = iImage.getData() + v * iImage.getRowBytes() + x0 * 4;
+		for(int u = x0; u <= x1; u++, tSrc += 4) {
+			for(int c = 0; c < 4; c++) {
+				double tValue = tSrc[ c ] / 255.0;
+				oSum[ c ]     += tValue;
+				oSum[ c + 4 ] += tValue * tValue;
+			}
+		}
+	}
+	return static_cast<double>( x1 - x0 + 1 ) * ( y1 - y0 + 1 );
+}
+
+/** @brief returns the largest difference between two RGBA images of the same size, in 8-bit levels */
+static int getLargestDifference(const ci::Surface8u& iA, const ci::Surface8u& iB)
+{
+	int tError = 0;
+	for(int y = 0; y < iA.getHeight(); y++) {
+		const uint8_t* a = iA.getData() + y * iA.getRowBytes();
+		const uint8_t* b = iB.getData() + y * iB.getRowBytes();
+		for(int x = 0; x < iA.getWidth() * 4; x++) {
+			tError = std::max( tError, std::abs( static_cast<int>( a[ x ] ) - static_cast<int>( b[ x ] ) ) );
+		}
+	}
+	return tError;
+}
+
+/** @brief checks and times the cpu summed-area table filters (box blur at several radii, variable blur, local mean and variance) against brute force, on a corner of the image */
+static void runSummedAreaTableBenchmark(const ci::Surface8u& iImage, const int32_t& iMaxSize = 256)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	if( !iImage || iImage.getWidth() == 0 || iImage.getHeight() == 0 ) { return; }
+
+	// Brute force reads (2r+1)^2 pixels per output pixel, so it is run on a corner of the image only:
+	int32_t tWidth  = std::min( iImage.getWidth(), iMaxSize );
+	int32_t tHeight = std::min( iImage.getHeight(), iMaxSize );
+	ci::Surface8u tImage( tWidth, tHeight, true, ci::SurfaceChannelOrder::RGBA );
+	tImage.copyFrom( iImage, ci::Area( 0, 0, tWidth, tHeight ) );
+	std::cout << "Summed-area table benchmark: " << tWidth << "x" << tHeight << " pixels" << std::endl;
+
+	SummedAreaTable tTable;
+	ci::Surface8u tBrute( tWidth, tHeight, true, ci::SurfaceChannelOrder::RGBA );
+	ci::Surface8u tFast;
+	const int tRadii[] = { 1, 4, 16, 32 };
+	for(size_t i = 0; i < sizeof( tRadii ) / sizeof( tRadii[ 0 ] ); i++) {
+		int r = tRadii[ i ];
+
+		// Brute force (the same clamped window as the table):
+		Clock::time_point tStart = Clock::now();
+		parallelFor( tHeight, [&] (size_t iBegin, size_t iEnd) {
+			for(int y = static_cast<int>( iBegin ); y < static_cast<int>( iEnd ); y++) {
+				int y0 = std::max( y - r, 0 ), y1 = std::min( y + r, tHeight - 1 );
+				uint8_t* tDst = tBrute.getData() + y * tBrute.getRowBytes();
+				for(int x = 0; x < tWidth; x++) {
+					int x0 = std::max( x - r, 0 ), x1 = std::min( x + r, tWidth - 1 );
+					uint32_t tSum[ 4 ] = { 0, 0, 0, 0 };
+					for(int v = y0; v <= y1; v++) {
+						const uint8_t* tSrc = tImage.getData() + v * tImage.getRowBytes() + x0 * 4;
+						for(int u = x0; u <= x1; u++, tSrc += 4) {
+							tSum[ 0 ] += tSrc[ 0 ];
+							tSum[ 1 ] += tSrc[ 1 ];
+							tSum[ 2 ] += tSrc[ 2 ];
+							tSum[ 3 ] += tSrc[ 3 ];
+						}
+					}
+					double tArea = 255.0 * ( x1 - x0 + 1 ) * ( y1 - y0 + 1 );
+					for(int c = 0; c < 4; c++) {
+						tDst[ x * 4 + c ] = static_cast<uint8_t>( tSum[ c ] / tArea * 255.0 + 0.5 );
+					}
+				}
+			}
+		} );
+		double tBruteMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+
+		// From the table (including building it):
+		tStart = Clock::now();
+		tTable.build( tImage );
+		tTable.boxBlur( r, tFast );
+		double tTableMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+
+		std::cout << "  radius " << r << ": brute force " << tBruteMs << " ms, table " << tTableMs << " ms (" << tBruteMs / tTableMs
+			<< "x), largest difference " << getLargestDifference( tBrute, tFast ) << std::endl;
+	}
+
+	// Variable blur, with the radius growing from 0 at the center to the maximum at the corners (as in the GPU filter):
+	const int tMaxRadius = 16;
+	ci::Channel32f tRadiusMap( tWidth, tHeight );
+	for(int y = 0; y < tHeight; y++) {
+		for(int x = 0; x < tWidth; x++) {
+			float u = ( x + 0.5f ) / tWidth - 0.5f;
+			float v = ( y + 0.5f ) / tHeight - 0.5f;
+			tRadiusMap.setValue( ci::Vec2i( x, y ), std::min( sqrtf( u * u + v * v ) * 1.41421356f, 1.0f ) );
+		}
+	}
+	Clock::time_point tStart = Clock::now();
+	parallelFor( tHeight, [&] (size_t iBegin, size_t iEnd) {
+		double tSum[ 8 ];
+		for(int y = static_cast<int>( iBegin ); y < static_cast<int>( iEnd ); y++) {
+			uint8_t* tDst = tBrute.getData() + y * tBrute.getRowBytes();
+			for(int x = 0; x < tWidth; x++) {
+				int    tRadius = static_cast<int>( tRadiusMap.getValue( ci::Vec2i( x, y ) ) * tMaxRadius + 0.5f );
+				double tArea   = getBruteForceSums( tImage, x, y, tRadius, tSum );
+				for(int c = 0; c < 4; c++) {
+					tDst[ x * 4 + c ] = static_cast<uint8_t>( std::min( std::max( tSum[ c ] / tArea, 0.0 ), 1.0 ) * 255.0 + 0.5 );
+				}
+			}
+		}
+	} );
+	double tBruteMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+	tStart = Clock::now();
+	tTable.variableBlur( tRadiusMap, tMaxRadius, tFast );
+	double tTableMs = std::chrono::duration<double, std::milli>( Clock::now() - tStart ).count();
+	std::cout << "  variable blur (radius 0 to " << tMaxRadius << "): brute force " << tBruteMs << " ms, table " << tTableMs
+		<< " ms, largest difference " << getLargestDifference( tBrute, tFast ) << std::endl;
+
+	// Local mean and variance:
+	const int tStatsRadius = 8;
+	ci::Surface32f tMean, tVariance;
+	tTable.localMeanVariance( tStatsRadius, tMean, tVariance );
+	double tMeanError = 0.0, tVarianceError = 0.0;
+	double tSum[ 8 ];
+	for(int y = 0; y < tHeight; y++) {
+		for(int x = 0; x < tWidth; x++) {
+			double     tArea     = getBruteForceSums( tImage, x, y, tStatsRadius, tSum );
+			ci::ColorA tMeanPx   = tMean.getPixel( ci::Vec2i( x, y ) );
+			ci::ColorA tVarPx    = tVariance.getPixel( ci::Vec2i( x, y ) );
+			for(int c = 0; c < 4; c++) {
+				double tExpectedMean = tSum[ c ] / tArea;
+				double tExpectedVar  = std::max( tSum[ c + 4 ] / tArea - tExpectedMean * tExpectedMean, 0.0 );
+				tMeanError     = std::max( tMeanError, std::abs( tMeanPx[ c ] - tExpectedMean ) );
+				tVarianceError = std::max( tVarianceError, std::abs( tVarPx[ c ] - tExpectedVar ) );
+			}
+		}
+	}
+	std::cout << "  local mean / variance (radius " << tStatsRadius << "): largest difference " << tMeanError << " / " << tVarianceError << std::endl;
+}
@@ -0,0 +1,239 @@
+//////////////////////////////////////////////////
+/*          Art of Graphics Programming         */
+/*           Taught by Patrick Hebron           */
+/* Interactive Telecommunications Program (ITP) */
+/*             New York University              */
+/*                  Fall 2014                   */
+//////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "FrameSource.h"
+
+// Polling the camera and copying its frame on the main thread ties capture
+// jitter to our frame time: a slow frame conversion delays drawing, and a
+// slow draw delays capture. Instead, a worker thread polls the source and
+// converts each frame into one of three preallocated buffers.
+//
+// The three buffers form a "triple buffer": the worker always owns one (the
+// back buffer), the render loop always owns one (the front buffer), and the
+// third holds the most recently finished frame. Handing buffers over is a
+// single atomic exchange, so neither side ever waits for the other. If the
+// worker finishes two frames before the render loop looks, the older one is
+// dropped, and the render loop always gets the latest frame.
+
+/** @brief a lock-free single-producer/single-consumer triple buffer */
+template<typename T>
+class TripleBuffer {
+public:
+	/** @brief default constructor */
+	TripleBuffer() : mMiddle( 1 ), mBack( 0 ), mFront( 2 ) {}
+
+	/** @brief returns the producer's buffer */
+	T& getBack() { return mSlots[ mBack ]; }
+
+	/** @brief returns the consumer's buffer */
+	T& getFront() { return mSlots[ mFront ]; }
+
+	/** @brief (producer) publishes the back buffer, returning true if an unread buffer was overwritten */
+	bool publish()
+	{
+		uint8_t tPrev = mMiddle.exchange( mBack | kDirty, std::memory_order_acq_rel );
+		mBack = tPrev & kIndexMask;
+		return ( tPrev & kDirty ) != 0;
+	}
+
+	/** @brief (consumer) takes the latest published buffer as the front buffer, if there is one */
+	bool acquire()
+	{
+		if( !( mMiddle.load( std::memory_order_acquire ) & kDirty ) ) { return false; }
+		uint8_t tPrev = mMiddle.exchange( mFront, std::memory_order_acq_rel );
+		mFront = tPrev & kIndexMask;
+		return true;
+	}
+
+private:
+	static const uint8_t kIndexMask = 0x3;
+	static const uint8_t kDirty     = 0x4;
+
+	T						mSlots[ 3 ];
+	std::atomic<uint8_t>	mMiddle;	//!< index of the shared buffer (plus dirty flag)
+	uint8_t					mBack;		//!< owned by the producer
+	uint8_t					mFront;		//!< owned by the consumer
+};
+
+class ThreadedFrameSource;
+typedef std::shared_ptr<ThreadedFrameSource> ThreadedFrameSourceRef;
+
+/** @brief runs a frame source on a worker thread and hands its latest frame to the render loop */
+class ThreadedFrameSource : public FrameSource {
+public:
+	/** @brief capture counters */
+	struct Stats
+	{
+		uint64_t	mCaptured;			//!< frames converted by the worker
+		uint64_t	mDelivered;			//!< frames taken by the render loop
+		uint64_t	mDropped;			//!< frames overwritten before the render loop took them
+		double		mCaptureLatency;	//!< seconds from capture to checkNewFrame() (last frame)
+		double		mPhotonLatency;		//!< seconds from capture to markPresented() (last frame)
+		double		mAveragePhotonLatency;	//!< moving average of mPhotonLatency
+
+		/** @brief default constructor */
+		Stats() : mCaptured( 0 ), mDelivered( 0 ), mDropped( 0 ), mCaptureLatency( 0.0 ), mPhotonLatency( 0.0 ), mAveragePhotonLatency( 0.0 ) {}
+	};
+
+	/** @brief wraps the given source */
+	static ThreadedFrameSourceRef create(const FrameSourceRef& iSource)
+	{
+		return ThreadedFrameSourceRef( new ThreadedFrameSource( iSource ) );
+	}
+
+	/** @brief destructor */
+	~ThreadedFrameSource() { stop(); }
+
+	/** @brief starts the source and the worker thread */
+	void start()
+	{
+		if( mRunning ) { return; }
+		mSource->start();
+		mRunning = true;
+		mThread  = std::thread( &ThreadedFrameSource::run, this );
+	}
+
+	/** @brief stops the worker thread and the source */
+	void stop()
+	{
+		if( !mRunning ) { return; }
+		mRunning = false;
+		mThread.join();
+		mSource->stop();
+	}
+
+	/** @brief (render loop) takes the latest frame, if a new one has arrived; never blocks */
+	bool checkNewFrame()
+	{
+		if( !mFrames.acquire() ) { return false; }
+		Frame& tFrame = mFrames.getFront();
+		mSurface        = tFrame.mSurface;
+		mPresentedTime  = tFrame.mCaptureTime;
+		mStats.mDelivered++;
+		mStats.mCaptureLatency = seconds( tFrame.mCaptureTime, std::chrono::steady_clock::now() );
+		return true;
+	}
+
+	/** @brief (render loop) records that the current frame has been drawn (call once, when it's first drawn) */
+	void markPresented()
+	{
+		if( mStats.mDelivered == 0 ) { return; }
+		mStats.mPhotonLatency = seconds( mPresentedTime, std::chrono::steady_clock::now() );
+		mStats.mAveragePhotonLatency = ( mStats.mAveragePhotonLatency == 0.0 ) ?
+			( mStats.mPhotonLatency ) : ( mStats.mAveragePhotonLatency * 0.95 + mStats.mPhotonLatency * 0.05 );
+	}
+
+	/** @brief returns the capture counters */
+	Stats getStats() const
+	{
+		Stats tStats    = mStats;
+		tStats.mCaptured = mCaptured.load();
+		tStats.mDropped  = mDropped.load();
+		return tStats;
+	}
+
+	int32_t getWidth() const  { return mSource->getWidth(); }
+	int32_t getHeight() const { return mSource->getHeight(); }
+
+protected:
+	/** @brief a converted frame */
+	struct Frame
+	{
+		ci::Surface8u							mSurface;
+		std::chrono::steady_clock::time_point	mCaptureTime;
+	};
+
+	ThreadedFrameSource(const FrameSourceRef& iSource) : mSource( iSource ), mRunning( false ), mCaptured( 0 ), mDropped( 0 ) {}
+
+	bool readFrame(const size_t& iIndex, ci::Surface8u& oSurface) { return false; }
+
+	/** @brief the worker thread's loop */
+	void run()
+	{
+		while( mRunning ) {
+			if( !mSource->checkNewFrame() ) {
+				std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+				continue;
+			}
+
+			// Convert into the back buffer:
+			Frame& tFrame = mFrames.getBack();
+			tFrame.mCaptureTime = std::chrono::steady_clock::now();
+			if( !convert( mSource->getSurface(), tFrame.mSurface ) ) { continue; }
+			mCaptured++;
+
+			// Hand it over:
+			if( mFrames.publish() ) { mDropped++; }
+		}
+	}
+
+	/** @brief copies a frame into a tightly packed RGBA surface (allocated only when the dimension changes); returns false for an empty frame */
+	static bool convert(const ci::Surface8u& iSrc, ci::Surface8u& oDst)
+	{
+		if( !iSrc || iSrc.getWidth() == 0 || iSrc.getHeight() == 0 ) { return false; }
+		int32_t tWidth  = iSrc.getWidth();
+		int32_t tHeight = iSrc.getHeight();
+		if( !oDst || oDst.getWidth() != tWidth || oDst.getHeight() != tHeight ) {
+			oDst = ci::Surface8u( tWidth, tHeight, true, ci::SurfaceChannelOrder::RGBA );
+		}
+
+		const ci::SurfaceChannelOrder& tOrder = iSrc.getChannelOrder();
+		size_t tRowLength = static_cast<size_t>( tWidth ) * 4;
+
+		// Fast path: same layout, copy row by row:
+		if( tOrder.getCode() == ci::SurfaceChannelOrder::RGBA ) {
+			for(int32_t y = 0; y < tHeight; y++) {
+				memcpy( oDst.getData() + y * oDst.getRowBytes(), iSrc.getData() + y * iSrc.getRowBytes(), tRowLength );
+			}
+			return true;
+		}
+
+		// General path: reorder channels:
+		uint8_t tInc   = iSrc.getPixelInc();
+		int8_t  tRed   = tOrder.getRedOffset();
+		int8_t  tGreen = tOrder.getGreenOffset();
+		int8_t  tBlue  = tOrder.getBlueOffset();
+		int8_t  tAlpha = tOrder.getAlphaOffset();
+		for(int32_t y = 0; y < tHeight; y++) {
+			const uint8_t* tSrc = iSrc.getData() + y * iSrc.getRowBytes();
+			uint8_t*       tDst = oDst.getData() + y * oDst.getRowBytes();
+			for(int32_t x = 0; x < tWidth; x++) {
+				tDst[ 0 ] = tSrc[ tRed ];
+				tDst[ 1 ] = tSrc[ tGreen ];
+				tDst[ 2 ] = tSrc[ tBlue ];
+				tDst[ 3 ] = ( tAlpha >= 0 ) ? ( tSrc[ tAlpha ] ) : ( 255 );
+				tSrc += tInc;
+				tDst += 4;
+			}
+		}
+		return true;
+	}
+
+	/** @brief returns the seconds between two time points */
+	static double seconds(const std::chrono::steady_clock::time_point& iFrom, const std::chrono::steady_clock::time_point& iTo)
+	{
+		return std::chrono::duration<double>( iTo - iFrom ).count();
+	}
+
+	FrameSourceRef							mSource;
+	TripleBuffer<Frame>						mFrames;
+	std::thread								mThread;
+	std::atomic<bool>						mRunning;
+	std::atomic<uint64_t>					mCaptured;
+	std::atomic<uint64_t>					mDropped;
+	Stats									mStats;			//!< consumer-side counters
+	std::chrono::steady_clock::time_point	mPresentedTime;
+};
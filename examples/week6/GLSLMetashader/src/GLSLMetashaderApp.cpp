@@ -10,10 +10,13 @@
 #include "cinder/gl/gl.h"
 #include "cinder/gl/Texture.h"
 #include "cinder/gl/GlslProg.h"
-#include "cinder/Capture.h"
 
 #include <sstream>
 
+#include "FilterGraph.h"
+#include "ThreadedFrameSource.h"
+#include "TextureUploadRing.h"
+
 #define STRINGIFY(s) #s
 
 #define CAM_WIDTH  640
@@ -23,59 +26,62 @@ using namespace ci;
 using namespace ci::app;
 using namespace std;
 
-inline std::string generateBloomFilterGlslVert()
+inline std::string generateBloomFilterGlslBody(const int& xKernal, const int& yKernal)
 {
 	stringstream ss;
 	
-	size_t indent = 0;
-	
-	ss << string( indent++, '\t' )	<< "void main() {" << endl;
-	ss << string( indent, '\t' )	<< "gl_FrontColor = gl_Color;" << endl;
-	ss << string( indent, '\t' )	<< "gl_TexCoord[0] = gl_MultiTexCoord0;" << endl;
-	ss << string( indent, '\t' )	<< "gl_Position = ftransform();" << endl;
-	ss << string( --indent, '\t' )	<< "}" << endl;
-	
-	return ss.str();
-}
-
-inline std::string generateBloomFilterGlslFrag(const int& xKernal, const int& yKernal)
-{
-	stringstream ss;
+	// Note: This is the body of a filter pass function. It receives the current
+	// texture coordinate as "uv" and reads its input through readInput0().
+	size_t indent = 1;
 	
-	size_t indent = 0;
-	
-	ss << string( indent, '\t' )	<< "uniform sampler2D texture;" << endl;
-	ss << string( indent++, '\t' )	<< "void main() {" << endl;
-	
-	ss << string( indent, '\t' )	<< "int  i, j;" << endl;
-	ss << string( indent, '\t' )	<< "vec4 bloom;" << endl;
+	ss << "int  i, j;" << endl;
 	ss << string( indent, '\t' )	<< "vec4 sum = vec4( 0.0 );" << endl;
-	ss << string( indent, '\t' )	<< "vec2 texCoord = gl_TexCoord[ 0 ].xy;" << endl;
+	ss << string( indent, '\t' )	<< "vec4 base = readInput0( uv );" << endl;
 	
 	ss << string( indent++, '\t' )	<< "for(i = " << -xKernal << "; i < " << xKernal << "; i++) {" << endl;
 	ss << string( indent++, '\t' )	<< "for(j = " << -yKernal << "; j < " << yKernal << "; j++) {" << endl;
-	ss << string( indent, '\t' )	<< "sum += texture2D( texture, texCoord + vec2( j, i ) * 0.004 ) * 0.25;" << endl;
+	ss << string( indent, '\t' )	<< "sum += readInput0( uv + vec2( j, i ) * 0.004 ) * 0.25;" << endl;
 	ss << string( --indent, '\t' )	<< "}" << endl;
 	ss << string( --indent, '\t' )	<< "}" << endl;
 	
-	ss << string( indent++, '\t' )	<< "if( texture2D( texture, texCoord ).r < 0.3 ) {" << endl;
-	ss << string( indent, '\t' )	<< "bloom = sum * sum * 0.012 + texture2D( texture, texCoord );" << endl;
-	ss << string( --indent, '\t' )	<< "}" << endl;
-	ss << string( indent++, '\t' )	<< "else {" << endl;
-	ss << string( indent++, '\t' )	<< "if( texture2D( texture, texCoord ).r < 0.5 ) {" << endl;
-	ss << string( indent, '\t' )	<< "bloom = sum * sum * 0.009 + texture2D( texture, texCoord );" << endl;
-	ss << string( --indent, '\t' )	<< "}" << endl;
-	ss << string( indent++, '\t' )	<< "else {" << endl;
-	ss << string( indent, '\t' )	<< "bloom = sum * sum * 0.0075 + texture2D( texture, texCoord );" << endl;
+	ss << string( indent++, '\t' )	<< "if( base.r < 0.3 ) {" << endl;
+	ss << string( indent, '\t' )	<< "return sum * sum * 0.012 + base;" << endl;
 	ss << string( --indent, '\t' )	<< "}" << endl;
+	ss << string( indent++, '\t' )	<< "if( base.r < 0.5 ) {" << endl;
+	ss << string( indent, '\t' )	<< "return sum * sum * 0.009 + base;" << endl;
 	ss << string( --indent, '\t' )	<< "}" << endl;
-	
-	ss << string( indent, '\t' )	<< "gl_FragColor = vec4( bloom );" << endl;
-	ss << string( --indent, '\t' )	<< "}" << endl;
+	ss << string( indent, '\t' )	<< "return sum * sum * 0.0075 + base;";
 	
 	return ss.str();
 }
 
+inline FilterPass generateBloomFilterPass(const int& xKernal, const int& yKernal)
+{
+	FilterPass tPass;
+	tPass.mName		= "bloom";
+	tPass.mKind		= FilterPass::SAMPLER;
+	tPass.mInputs.push_back( kFilterSource );
+	tPass.mOutput	= "bloomed";
+	tPass.mGlsl		= generateBloomFilterGlslBody( xKernal, yKernal );
+	
+	// CPU equivalent (used when running the graph without a GL context):
+	tPass.mCpuSample = [xKernal, yKernal] (const FilterCpuInputs& iIn, int x, int y) {
+		ColorA tSum( 0.0f, 0.0f, 0.0f, 0.0f );
+		ColorA tBase = iIn.read( 0, x, y );
+		for(int i = -xKernal; i < xKernal; i++) {
+			for(int j = -yKernal; j < yKernal; j++) {
+				int tX = x + static_cast<int>( floorf( j * 0.004f * iIn.getWidth() + 0.5f ) );
+				int tY = y + static_cast<int>( floorf( i * 0.004f * iIn.getHeight() + 0.5f ) );
+				tSum += iIn.read( 0, tX, tY ) * 0.25f;
+			}
+		}
+		float tGain = ( tBase.r < 0.3f ) ? ( 0.012f ) : ( ( tBase.r < 0.5f ) ? ( 0.009f ) : ( 0.0075f ) );
+		return ColorA( tSum.r * tSum.r, tSum.g * tSum.g, tSum.b * tSum.b, tSum.a * tSum.a ) * tGain + tBase;
+	};
+	
+	return tPass;
+}
+
 class GLSLMetashaderApp : public AppNative {
   public:
 	void prepareSettings(Settings *settings);
@@ -85,10 +91,13 @@ class GLSLMetashaderApp : public AppNative {
 	void draw();
 	
 	void generateShader(const size_t& iKernelAxisLen);
+	void printStats();
 	
-	ci::CaptureRef			mCapture;
+	ThreadedFrameSourceRef	mSource;
 	ci::gl::TextureRef		mTexture;
-	ci::gl::GlslProgRef		mShader;
+	TextureUploadRing		mUploadRing;
+	bool					mUploaded;	//!< a new frame was uploaded and hasn't been drawn yet
+	FilterGraphGl			mFilter;
 };
 
 void GLSLMetashaderApp::prepareSettings(Settings *settings)
@@ -100,12 +109,11 @@ void GLSLMetashaderApp::prepareSettings(Settings *settings)
 
 void GLSLMetashaderApp::setup()
 {
-	// Try to initialize camera capture:
-	try {
-		mCapture = Capture::create( CAM_WIDTH, CAM_HEIGHT );
-		mCapture->start();
-	}
-	catch(...) { cout << "Failed to initialize capture" << endl; }
+	// Open camera capture (or a stand-in when no camera is available, see FrameSource.h)
+	// and run it on a worker thread (see ThreadedFrameSource.h):
+	mSource = ThreadedFrameSource::create( createDefaultFrameSource( CAM_WIDTH, CAM_HEIGHT ) );
+	mUploaded = false;
+	mSource->start();
 	
 	// Create initial shader with a 3x3 kernel:
 	generateShader( 3 );
@@ -121,14 +129,34 @@ void GLSLMetashaderApp::keyUp(KeyEvent event)
 		// Create shader with a NxN kernel:
 		generateShader( tAxisLen );
 	}
+	else if( c == 's' ) {
+		printStats();
+	}
+}
+
+void GLSLMetashaderApp::printStats()
+{
+	const TextureUploadRing::Stats& tFrame = mUploadRing.getFrameStats();
+	const TextureUploadRing::Stats& tTotal = mUploadRing.getTotalStats();
+	ThreadedFrameSource::Stats tCapture = mSource->getStats();
+	cout << "Uploads this frame: " << tFrame.mUploads << " (" << tFrame.mBytesUploaded << " bytes, " << tFrame.mTextureAllocations << " allocations)" << endl;
+	cout << "Uploads in total: " << tTotal.mUploads << " (" << tTotal.mBytesUploaded << " bytes, " << tTotal.mTextureAllocations << " allocations)" << endl;
+	cout << "Frames captured: " << tCapture.mCaptured << ", delivered: " << tCapture.mDelivered << ", dropped: " << tCapture.mDropped << endl;
+	cout << "Capture to update latency: " << tCapture.mCaptureLatency * 1000.0 << " ms" << endl;
+	cout << "Capture to draw latency: " << tCapture.mPhotonLatency * 1000.0 << " ms (average " << tCapture.mAveragePhotonLatency * 1000.0 << " ms)" << endl;
 }
 
 void GLSLMetashaderApp::update()
 {
+	// Reset per-frame upload counters:
+	mUploadRing.resetFrameStats();
+	
 	// Check whether capture is live and has a new frame:
-	if( mCapture && mCapture->checkNewFrame() ) {
-		// Get texture from camera:
-		mTexture = gl::Texture::create( mCapture->getSurface() );
+	if( mSource->checkNewFrame() ) {
+		// Update the next texture of the ring in place (no per-frame allocation):
+		mUploadRing.upload( mSource->getSurface() );
+		mTexture = mUploadRing.getTexture();
+		mUploaded = mUploaded || ( mUploadRing.getFrameStats().mUploads > 0 );
 	}
 }
 
@@ -145,43 +173,37 @@ void GLSLMetashaderApp::draw()
 		// Draw camera texture:
 		gl::draw( mTexture );
 		
+		// Run the filter graph into an offscreen framebuffer:
+		gl::Texture tFiltered = mFilter.run( *mTexture );
+		
 		// Push matrix and translate along x-axis:
 		gl::pushMatrices();
 		gl::translate( CAM_WIDTH, 0.0 );
 		
-		// Bind texture:
-		mTexture->bind( 0 );
-		
-		// Bind shader:
-		mShader->bind();
-		
-		// Set shader uniforms:
-		mShader->uniform( "texture", 0 );
-		mShader->uniform( "width", static_cast<float>( mTexture->getWidth() ) );
-		mShader->uniform( "height", static_cast<float>( mTexture->getHeight() ) );
-		
-		// Draw rect with texture bounds:
+		// Draw filtered texture onto a rect with texture bounds:
+		tFiltered.enableAndBind();
 		gl::drawSolidRect( mTexture->getBounds() );
-		
-		// Unbind shader:
-		mShader->unbind();
-		
-		// Unbind texture:
-		mTexture->unbind();
+		tFiltered.unbind();
+		tFiltered.disable();
 		
 		// Pop matrix:
 		gl::popMatrices();
+		
+		// Record capture-to-draw latency (once per uploaded frame, not on every redraw):
+		if( mUploaded ) {
+			mSource->markPresented();
+			mUploaded = false;
+		}
 	}
 }
 
 void GLSLMetashaderApp::generateShader(const size_t& iKernelAxisLen)
 {
-	string tVert = generateBloomFilterGlslVert();
-	string tFrag = generateBloomFilterGlslFrag( iKernelAxisLen, iKernelAxisLen );
+	FilterGraph tGraph;
+	tGraph.addPass( generateBloomFilterPass( iKernelAxisLen, iKernelAxisLen ) );
 	try {
-		mShader = gl::GlslProg::create( tVert.c_str(), tFrag.c_str() );
-		cout << "// Vertex shader:" << endl << tVert << endl;
-		cout << "// Fragment shader:" << endl << tFrag << endl << endl;
+		mFilter.setGraph( tGraph );
+		cout << "// Fragment shader:" << endl << mFilter.getGraph().getKernels().front().mFrag << endl << endl;
 	}
 	catch( gl::GlslProgCompileExc &exc ) {
 		cout << "Shader compile error: " << endl;